@@ -786,6 +786,15 @@ namespace UserConfigParams
     /** If unit testing is enabled. */
     PARAM_PREFIX bool m_unit_testing PARAM_DEFAULT(false);
 
+    /** If the sector lookup benchmark is run. */
+    PARAM_PREFIX bool m_benchmark_sectors PARAM_DEFAULT(false);
+
+    /** If the kart characteristics benchmark is run. */
+    PARAM_PREFIX bool m_benchmark_characteristics PARAM_DEFAULT(false);
+
+    /** If the network state saving benchmark is run. */
+    PARAM_PREFIX bool m_benchmark_states PARAM_DEFAULT(false);
+
     /** If gamepad debugging is enabled. */
     PARAM_PREFIX bool m_gamepad_debug PARAM_DEFAULT( false );
 
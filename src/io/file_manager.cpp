@@ -266,6 +266,8 @@ FileManager::FileManager()
     checkAndCreateScreenshotDir();
     checkAndCreateReplayDir();
     checkAndCreateCachedTexturesDir();
+    checkAndCreateCachedPhysicsDir();
+    checkAndCreateCachedScriptsDir();
     checkAndCreateGPDir();
 
     redirectOutput();
@@ -841,6 +843,23 @@ std::string FileManager::getCachedTexturesDir() const
     return m_cached_textures_dir;
 }   // getCachedTexturesDir
 
+//-----------------------------------------------------------------------------
+/** Returns the directory in which collision and navigation data of tracks
+ *  is cached.
+ */
+std::string FileManager::getCachedPhysicsDir() const
+{
+    return m_cached_physics_dir;
+}   // getCachedPhysicsDir
+
+//-----------------------------------------------------------------------------
+/** Returns the directory in which compiled track scripts are cached.
+ */
+std::string FileManager::getCachedScriptsDir() const
+{
+    return m_cached_scripts_dir;
+}   // getCachedScriptsDir
+
 //-----------------------------------------------------------------------------
 /** Returns the directory in which user-defined grand prix should be stored.
  */
@@ -1209,6 +1228,56 @@ void FileManager::checkAndCreateCachedTexturesDir()
 
 }   // checkAndCreateCachedTexturesDir
 
+// ----------------------------------------------------------------------------
+/** Creates the directory for cached collision and navigation data of tracks. This will set
+ *  m_cached_physics_dir with the appropriate path.
+ */
+void FileManager::checkAndCreateCachedPhysicsDir()
+{
+#if defined(WIN32) || defined(__HAIKU__)
+    m_cached_physics_dir = m_user_config_dir + "cached-physics/";
+#elif defined(__APPLE__)
+    m_cached_physics_dir = getenv("HOME");
+    m_cached_physics_dir += "/Library/Application Support/SuperTuxKart/CachedPhysics/";
+#else
+    m_cached_physics_dir = checkAndCreateLinuxDir("XDG_CACHE_HOME", "supertuxkart", ".cache/", ".");
+    m_cached_physics_dir += "cached-physics/";
+#endif
+
+    if (!checkAndCreateDirectory(m_cached_physics_dir))
+    {
+        Log::error("FileManager", "Can not create cached physics directory '%s', "
+            "falling back to '.'.", m_cached_physics_dir.c_str());
+        m_cached_physics_dir = "./";
+    }
+
+}   // checkAndCreateCachedPhysicsDir
+
+// ----------------------------------------------------------------------------
+/** Creates the directory for compiled bytecode of track scripts. This will set
+ *  m_cached_scripts_dir with the appropriate path.
+ */
+void FileManager::checkAndCreateCachedScriptsDir()
+{
+#if defined(WIN32) || defined(__HAIKU__)
+    m_cached_scripts_dir = m_user_config_dir + "cached-scripts/";
+#elif defined(__APPLE__)
+    m_cached_scripts_dir = getenv("HOME");
+    m_cached_scripts_dir += "/Library/Application Support/SuperTuxKart/CachedScripts/";
+#else
+    m_cached_scripts_dir = checkAndCreateLinuxDir("XDG_CACHE_HOME", "supertuxkart", ".cache/", ".");
+    m_cached_scripts_dir += "cached-scripts/";
+#endif
+
+    if (!checkAndCreateDirectory(m_cached_scripts_dir))
+    {
+        Log::error("FileManager", "Can not create cached scripts directory '%s', "
+            "falling back to '.'.", m_cached_scripts_dir.c_str());
+        m_cached_scripts_dir = "./";
+    }
+
+}   // checkAndCreateCachedScriptsDir
+
 // ----------------------------------------------------------------------------
 /** Creates the directories for user-defined grand prix. This will set m_gp_dir
  *  with the appropriate path.
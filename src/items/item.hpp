@@ -409,6 +409,11 @@ public:
         return lc.length2() < m_distance_2;
     }   // hitKart
     // ------------------------------------------------------------------------
+    /** Returns the distance from the item beyond which hitKart is false for
+     *  any kart. hitKart halves the vertical distance, so this is twice the
+     *  collection distance. */
+    float getMaxHitDistance() const          { return 2.0f*sqrtf(m_distance_2); }
+    // ------------------------------------------------------------------------
     bool rotating() const               { return getType() != ITEM_BUBBLEGUM; }
 
 public:
@@ -41,10 +41,15 @@
 #include <IAnimatedMesh.h>
 
 #include <assert.h>
+#include <cmath>
 #include <stdexcept>
 #include <sstream>
 #include <string>
 
+/** Size of the grid cells of m_items_in_cells, a kart is usually only close
+ *  enough to the items of 1 to 4 cells. */
+static const float ITEM_CELL_SIZE = 4.0f;
+
 
 std::vector<scene::IMesh *>  ItemManager::m_item_mesh;
 std::vector<scene::IMesh *>  ItemManager::m_item_lowres_mesh;
@@ -181,6 +186,7 @@ ItemManager::ItemManager()
         m_switch_to.push_back((ItemState::ItemType)i);
     setSwitchItems(stk_config->m_switch_items);
 
+    m_max_hit_distance = 0.0f;
     if(Graph::get())
     {
         m_items_in_quads = new std::vector<AllItemTypes>;
@@ -253,10 +259,18 @@ unsigned int ItemManager::insertItem(Item *item)
 
 //-----------------------------------------------------------------------------
 /** Insert into the appropriate quad list, if there is a quad list
- *  (i.e. race mode has a quad graph).
+ *  (i.e. race mode has a quad graph), and into the grid cell of the item.
+ *  The item must be removed with deleteItemInQuad before it is moved.
  */
 void ItemManager::insertItemInQuad(Item *item)
 {
+    const Vec3& xyz = item->getXYZ();
+    m_items_in_cells[getItemCellKey(
+        (int)floorf(xyz.getX() / ITEM_CELL_SIZE),
+        (int)floorf(xyz.getZ() / ITEM_CELL_SIZE))].push_back(item);
+    m_max_hit_distance = std::max(m_max_hit_distance,
+                                  item->getMaxHitDistance());
+
     if(m_items_in_quads)
     {
         int graph_node = item->getGraphNode();
@@ -388,14 +402,9 @@ void ItemManager::collectedItem(ItemState *item, AbstractKart *kart)
  */
 void  ItemManager::checkItemHit(AbstractKart* kart)
 {
-    // We could use m_items_in_quads to to check for item hits: take the quad
-    // of the graph node of the kart, and only check items in that quad. But
-    // then we also need to check for any adjacent quads (since an item just
-    // on the order of one quad might get hit from an adjacent quad). Then
-    // it is possible that a quad is that short that we need to test adjacent
-    // of adjacent quads. And check for items outside of the track.
-    // Since at this stace item detection is by far not a bottle neck,
-    // the original, simple and stable algorithm is left in place.
+    // Only the items in the grid cells within m_max_hit_distance of the
+    // kart can be hit. They are tested in the order of m_all_items, so the
+    // result is the same as testing all items (which is needed for rewind).
 
     /** Disable item collection detection for debug purposes. */
     if(m_disable_item_collection) return;
@@ -403,28 +412,50 @@ void  ItemManager::checkItemHit(AbstractKart* kart)
     // Spare tire karts don't collect items
     if ( dynamic_cast<SpareTireAI*>(kart->getController()) ) return;
 
-    for(AllItemTypes::iterator i =m_all_items.begin();
-                               i!=m_all_items.end();  i++)
+    const Vec3& xyz = kart->getXYZ();
+    int min_x = (int)floorf((xyz.getX() - m_max_hit_distance) / ITEM_CELL_SIZE);
+    int max_x = (int)floorf((xyz.getX() + m_max_hit_distance) / ITEM_CELL_SIZE);
+    int min_z = (int)floorf((xyz.getZ() - m_max_hit_distance) / ITEM_CELL_SIZE);
+    int max_z = (int)floorf((xyz.getZ() + m_max_hit_distance) / ITEM_CELL_SIZE);
+    m_hit_candidates.clear();
+    for (int x = min_x; x <= max_x; x++)
     {
+        for (int z = min_z; z <= max_z; z++)
+        {
+            auto cell = m_items_in_cells.find(getItemCellKey(x, z));
+            if (cell == m_items_in_cells.end())
+                continue;
+            for (ItemState* item : cell->second)
+                m_hit_candidates.push_back(item->getItemId());
+        }
+    }
+    if (m_hit_candidates.empty())
+        return;
+    std::sort(m_hit_candidates.begin(), m_hit_candidates.end());
+
+    for (unsigned int n = 0; n < m_hit_candidates.size(); n++)
+    {
+        // Collecting an earlier item can delete this one
+        ItemState* item = m_all_items[m_hit_candidates[n]];
+
         // Ignore items that have been collected or are not available atm
-        if ((!*i) || !(*i)->isAvailable() || (*i)->isUsedUp()) continue;
+        if (!item || !item->isAvailable() || item->isUsedUp()) continue;
 
         // Shielded karts can simply drive over bubble gums without any effect
         if ( kart->isShielded() &&
-             ( (*i)->getType() == ItemState::ITEM_BUBBLEGUM      ||
-               (*i)->getType() == ItemState::ITEM_BUBBLEGUM_NOLOK  ) )
+             ( item->getType() == ItemState::ITEM_BUBBLEGUM      ||
+               item->getType() == ItemState::ITEM_BUBBLEGUM_NOLOK  ) )
         {
             continue;
         }
 
-
         // To allow inlining and avoid including kart.hpp in item.hpp,
         // we pass the kart and the position separately.
-        if((*i)->hitKart(kart->getXYZ(), kart))
+        if(item->hitKart(xyz, kart))
         {
-            collectedItem(*i, kart);
+            collectedItem(item, kart);
         }   // if hit
-    }   // for m_all_items
+    }   // for m_hit_candidates
 }   // checkItemHit
 
 //-----------------------------------------------------------------------------
@@ -535,11 +566,27 @@ void ItemManager::deleteItem(ItemState *item)
 }   // delete item
 
 //-----------------------------------------------------------------------------
-/** Removes an items from the items-in-quad list only
+/** Removes an items from the items-in-quad list and the grid cells only
  *  \param The item to delete.
  */
 void ItemManager::deleteItemInQuad(ItemState* item)
 {
+    const Vec3& xyz = item->getXYZ();
+    auto cell = m_items_in_cells.find(getItemCellKey(
+        (int)floorf(xyz.getX() / ITEM_CELL_SIZE),
+        (int)floorf(xyz.getZ() / ITEM_CELL_SIZE)));
+    assert(cell != m_items_in_cells.end());
+    if (cell != m_items_in_cells.end())
+    {
+        AllItemTypes::iterator it = std::find(cell->second.begin(),
+                                              cell->second.end(), item);
+        assert(it != cell->second.end());
+        if (it != cell->second.end())
+            cell->second.erase(it);
+        if (cell->second.empty())
+            m_items_in_cells.erase(cell);
+    }
+
     if(m_items_in_quads)
     {
         int sector = item->getGraphNode();
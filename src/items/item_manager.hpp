@@ -35,6 +35,7 @@
 #include <memory>
 #include <random>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class Kart;
@@ -113,6 +114,19 @@ private:
      *  field is undefined if no Graph exist, e.g. arena without navmesh. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** Stores which items are in which cell of a uniform grid on the XZ
+     *  plane, used by checkItemHit to only test the items close to a kart.
+     *  The key is created by getItemCellKey. */
+    std::unordered_map<uint64_t, AllItemTypes> m_items_in_cells;
+
+    /** Largest distance of a kart from an item which collects it, of all
+     *  items inserted so far. */
+    float m_max_hit_distance;
+
+    /** Indices of the items to test in checkItemHit, kept to avoid
+     *  reallocation. */
+    std::vector<unsigned int> m_hit_candidates;
+
     /** Stores all item models. */
     static std::vector<scene::IMesh *> m_item_mesh;
 
@@ -132,6 +146,12 @@ protected:
     void setSwitchItems(const std::vector<int> &switch_items);
     void insertItemInQuad(Item *item);
     void deleteItemInQuad(ItemState *item);
+    // ------------------------------------------------------------------------
+    /** Returns the key of grid cell x, z in m_items_in_cells. */
+    static uint64_t getItemCellKey(int x, int z)
+    {
+        return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z;
+    }   // getItemCellKey
 public:
              ItemManager();
     virtual ~ItemManager();
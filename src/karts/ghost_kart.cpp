@@ -62,26 +62,29 @@ void GhostKart::addReplayEvent(float time,
                                const ReplayBase::PhysicInfo &pi,
                                const ReplayBase::BonusInfo &bi,
                                const ReplayBase::KartReplayEvent &kre)
+{
+    addReplayFrame(ReplayBase::encodeFrame(time, trans, pi, bi, kre));
+}   // addReplayEvent
+
+// ----------------------------------------------------------------------------
+void GhostKart::addReplayFrame(const ReplayBase::ReplayFrame& frame)
 {
     GhostController* gc = dynamic_cast<GhostController*>(getController());
-    gc->addReplayTime(time);
+    gc->addReplayTime(frame.m_time);
 
-    m_all_transform.push_back(trans);
-    m_all_physic_info.push_back(pi);
-    m_all_bonus_info.push_back(bi);
-    m_all_replay_events.push_back(kre);
+    m_all_frames.push_back(frame);
 
     // Use first frame of replay to calculate default suspension
-    if (m_all_physic_info.size() == 1)
+    if (m_all_frames.size() == 1)
     {
         float f = 0;
         for (int i = 0; i < 4; i++)
-            f += m_all_physic_info[0].m_suspension_length[i];
+            f += m_all_frames[0].getSuspensionLength(i);
         m_graphical_y_offset = -f / 4 + getKartModel()->getLowestPoint();
         m_kart_model->setDefaultSuspension();
     }
 
-}   // addReplayEvent
+}   // addReplayFrame
 
 // ----------------------------------------------------------------------------
 /** Called once per rendered frame. It is used to only update any graphical
@@ -133,27 +136,29 @@ void GhostKart::update(int ticks)
     }
 
     const float rd         = gc->getReplayDelta();
-    assert(idx < m_all_transform.size());
+    assert(idx < m_all_frames.size());
 
-    if (idx >= m_all_transform.size() - 1)
+    if (idx >= m_all_frames.size() - 1)
     {
-        setXYZ(m_all_transform.back().getOrigin());
-        setRotation(m_all_transform.back().getRotation());
+        const btTransform last = m_all_frames.back().getTransform();
+        setXYZ(last.getOrigin());
+        setRotation(last.getRotation());
     }
     else
     {
-        setXYZ((1- rd)*m_all_transform[idx    ].getOrigin()
-               +  rd  *m_all_transform[idx + 1].getOrigin() );
-        const btQuaternion q = m_all_transform[idx].getRotation()
-            .slerp(m_all_transform[idx + 1].getRotation(), rd);
+        const btTransform current = m_all_frames[idx].getTransform();
+        const btTransform next = m_all_frames[idx + 1].getTransform();
+        setXYZ((1- rd)*current.getOrigin() + rd*next.getOrigin());
+        const btQuaternion q = current.getRotation()
+            .slerp(next.getRotation(), rd);
         setRotation(q);
     }
 
     Moveable::updatePosition();
     float dt = stk_config->ticks2Time(ticks);
-    getKartModel()->update(dt, dt*(m_all_physic_info[idx].m_speed),
-        m_all_physic_info[idx].m_steer, m_all_physic_info[idx].m_speed,
-        /*lean*/0.0f, idx);
+    const ReplayBase::ReplayFrame& frame = m_all_frames[idx];
+    getKartModel()->update(dt, dt*frame.getSpeed(), frame.getSteer(),
+        frame.getSpeed(), /*lean*/0.0f, idx);
 
     // Attachment management
     // Note that this doesn't get ticks value from replay file,
@@ -163,7 +168,7 @@ void GhostKart::update(int ticks)
     // graphical effect only.
 
     Attachment::AttachmentType attach_type =
-        ReplayRecorder::codeToEnumAttach(m_all_bonus_info[idx].m_attachment);
+        ReplayRecorder::codeToEnumAttach(frame.m_attachment);
     int16_t attach_ticks = 0;
     if (attach_type == Attachment::ATTACH_BUBBLEGUM_SHIELD)
         attach_ticks = (int16_t)stk_config->time2Ticks(10);
@@ -192,15 +197,15 @@ void GhostKart::update(int ticks)
 
     // Update item amount and type
     PowerupManager::PowerupType item_type =
-        ReplayRecorder::codeToEnumItem(m_all_bonus_info[idx].m_item_type); 
-    m_powerup->set(item_type, m_all_bonus_info[idx].m_item_amount);
+        ReplayRecorder::codeToEnumItem(frame.m_item_type);
+    m_powerup->set(item_type, frame.m_item_amount);
 
     // Update special values in easter egg and battle modes
     if (RaceManager::get()->isEggHuntMode())
     {
         if (idx > m_last_egg_idx &&
-            m_all_bonus_info[idx].m_special_value >
-            m_all_bonus_info[m_last_egg_idx].m_special_value)
+            frame.m_special_value >
+            m_all_frames[m_last_egg_idx].m_special_value)
         {
             EasterEggHunt *world = dynamic_cast<EasterEggHunt*>(World::getWorld());
             assert(world);
@@ -209,25 +214,25 @@ void GhostKart::update(int ticks)
         }
     }
 
-    m_collected_energy = (1- rd)*m_all_bonus_info[idx    ].m_nitro_amount
-                         +  rd  *m_all_bonus_info[idx + 1].m_nitro_amount;
+    m_collected_energy = (1- rd)*frame.getNitroAmount()
+                         +  rd  *m_all_frames[idx + 1].getNitroAmount();
 
     // Graphical effects for nitro, zipper and skidding
-    getKartGFX()->setGFXFromReplay(m_all_replay_events[idx].m_nitro_usage,
-                                   m_all_replay_events[idx].m_zipper_usage,
-                                   m_all_replay_events[idx].m_skidding_effect,
-                                   m_all_replay_events[idx].m_red_skidding);
+    getKartGFX()->setGFXFromReplay(frame.m_nitro_usage,
+                                   frame.getZipperUsage(),
+                                   frame.m_skidding_effect,
+                                   frame.getRedSkidding());
     getKartGFX()->update(dt);
 
     Vec3 front(0, 0, getKartLength()*0.5f);
     m_xyz_front = getTrans()(front);
 
-    if (m_all_replay_events[idx].m_jumping && !m_is_jumping)
+    if (frame.getJumping() && !m_is_jumping)
     {
         m_is_jumping = true;
         getKartModel()->setAnimation(KartModel::AF_JUMP_START);
     }
-    else if (!m_all_replay_events[idx].m_jumping && m_is_jumping)
+    else if (!frame.getJumping() && m_is_jumping)
     {
         m_is_jumping = false;
         getKartModel()->setAnimation(KartModel::AF_DEFAULT);
@@ -245,13 +250,13 @@ float GhostKart::getSpeed() const
     unsigned int current_index = gc->getCurrentReplayIndex();
     const float rd             = gc->getReplayDelta();
 
-    assert(gc->getCurrentReplayIndex() < m_all_physic_info.size());
+    assert(gc->getCurrentReplayIndex() < m_all_frames.size());
 
-    if (current_index >= m_all_physic_info.size() - 1)
-        return m_all_physic_info.back().m_speed;
+    if (current_index >= m_all_frames.size() - 1)
+        return m_all_frames.back().getSpeed();
 
-    return (1-rd)*m_all_physic_info[current_index    ].m_speed
-           +  rd *m_all_physic_info[current_index + 1].m_speed;
+    return (1-rd)*m_all_frames[current_index    ].getSpeed()
+           +  rd *m_all_frames[current_index + 1].getSpeed();
 }   // getSpeed
 
 // ----------------------------------------------------------------------------
@@ -296,7 +301,7 @@ float GhostKart::getTimeForDistance(float distance)
     int current_index = gc->getCurrentReplayIndex();
 
     // Second, get the current distance
-    float current_distance = m_all_replay_events[current_index].m_distance;
+    float current_distance = m_all_frames[current_index].m_distance;
 
     // This determines in which direction we will search a matching frame
     bool search_forward = (current_distance < distance);
@@ -318,18 +323,18 @@ float GhostKart::getTimeForDistance(float distance)
     {
         // If we have reached the end of the replay file without finding the
         // searched distance, break
-        if (upper_frame_index >= m_all_replay_events.size() ||
+        if (upper_frame_index >= m_all_frames.size() ||
             lower_frame_index < 0 )
             break;
 
         // The target distance was reached between those two frames
-        if (m_all_replay_events[lower_frame_index].m_distance <= distance &&
-            m_all_replay_events[upper_frame_index].m_distance >= distance )
+        if (m_all_frames[lower_frame_index].m_distance <= distance &&
+            m_all_frames[upper_frame_index].m_distance >= distance )
         {
             float lower_diff =
-                distance - m_all_replay_events[lower_frame_index].m_distance;
+                distance - m_all_frames[lower_frame_index].m_distance;
             float upper_diff =
-                m_all_replay_events[upper_frame_index].m_distance - distance;
+                m_all_frames[upper_frame_index].m_distance - distance;
 
             if ((lower_diff + upper_diff) == 0)
                 upper_ratio = 0.0f;
@@ -353,7 +358,7 @@ float GhostKart::getTimeForDistance(float distance)
 
     float ghost_time;
 
-    if (upper_frame_index >= m_all_replay_events.size() ||
+    if (upper_frame_index >= m_all_frames.size() ||
         lower_frame_index < 0 )
         ghost_time = -1.0f;
     else
@@ -374,7 +379,7 @@ float GhostKart::getTimeForEggs(int egg_number)
     int current_index = gc->getCurrentReplayIndex();
 
     // Second, get the current egg number
-    int current_eggs = m_all_bonus_info[current_index].m_special_value;
+    int current_eggs = m_all_frames[current_index].m_special_value;
 
     // This determines in which direction we will search a matching frame
     bool search_forward = (current_eggs < egg_number);
@@ -389,13 +394,13 @@ float GhostKart::getTimeForEggs(int egg_number)
     {
         // If we have reached the end of the replay file without finding the
         // searched distance, break
-        if (upper_frame_index >= m_all_bonus_info.size() ||
+        if (upper_frame_index >= m_all_frames.size() ||
             lower_frame_index < 0 )
             break;
 
         // The target distance was reached between those two frames
-        if (m_all_bonus_info[lower_frame_index].m_special_value <  egg_number &&
-            m_all_bonus_info[upper_frame_index].m_special_value == egg_number)
+        if (m_all_frames[lower_frame_index].m_special_value <  egg_number &&
+            m_all_frames[upper_frame_index].m_special_value == egg_number)
         {
             break;
         }
@@ -414,7 +419,7 @@ float GhostKart::getTimeForEggs(int egg_number)
 
     float ghost_time;
 
-    if (upper_frame_index >= m_all_bonus_info.size() ||
+    if (upper_frame_index >= m_all_frames.size() ||
         lower_frame_index < 0 )
         ghost_time = -1.0f;
     else
@@ -37,14 +37,9 @@
 class GhostKart : public Kart
 {
 private:
-    /** The transforms to assume at the corresponding time in m_all_times. */
-    std::vector<btTransform>                 m_all_transform;
-
-    std::vector<ReplayBase::PhysicInfo>      m_all_physic_info;
-
-    std::vector<ReplayBase::BonusInfo>       m_all_bonus_info;
-
-    std::vector<ReplayBase::KartReplayEvent> m_all_replay_events;
+    /** The frames to assume at the corresponding time in m_all_times of
+     *  the controller, stored compressed like in binary replay files. */
+    std::vector<ReplayBase::ReplayFrame>     m_all_frames;
 
     ReplayPlay::ReplayData m_replay_data;
 
@@ -70,7 +65,7 @@ public:
     virtual void  createPhysics() OVERRIDE {};
     // ------------------------------------------------------------------------
     const float   getSuspensionLength(int index, int wheel) const
-               { return m_all_physic_info[index].m_suspension_length[wheel]; }
+               { return m_all_frames[index].getSuspensionLength(wheel); }
     // ------------------------------------------------------------------------
     void          addReplayEvent(float time,
                                  const btTransform &trans,
@@ -78,6 +73,8 @@ public:
                                  const ReplayBase::BonusInfo &bi,
                                  const ReplayBase::KartReplayEvent &kre);
     // ------------------------------------------------------------------------
+    void          addReplayFrame(const ReplayBase::ReplayFrame& frame);
+    // ------------------------------------------------------------------------
     /** Returns whether this kart is a ghost (replay) kart. */
     virtual bool  isGhostKart() const OVERRIDE { return true; }
     // ------------------------------------------------------------------------
@@ -86,6 +86,7 @@ void KartPropertiesManager::addKartSearchDir(const std::string &s)
 void KartPropertiesManager::unloadAllKarts()
 {
     m_karts_properties.clearAndDeleteAll();
+    m_kart_indices.clear();
     m_selected_karts.clear();
     m_kart_available.clear();
     m_groups_2_indices.clear();
@@ -104,6 +105,9 @@ void KartPropertiesManager::removeKart(const std::string &ident)
     m_karts_properties.remove(index);
     m_all_kart_dirs.erase(m_all_kart_dirs.begin()+index);
     m_kart_available.erase(m_kart_available.begin()+index);
+    m_kart_indices.clear();
+    for (unsigned int i=0; i<m_karts_properties.size(); i++)
+        m_kart_indices.emplace(m_karts_properties[i].getIdent(), (int)i);
 
     // Remove the just removed kart from the 'group-name to kart property
     // index' mapping. If a group is now empty (i.e. the removed kart was
@@ -281,6 +285,8 @@ bool KartPropertiesManager::loadKart(const std::string &dir)
 
     m_karts_properties.push_back(kart_properties);
     m_kart_available.push_back(true);
+    m_kart_indices.emplace(kart_properties->getIdent(),
+                           (int)m_karts_properties.size()-1);
     const std::vector<std::string>& groups=kart_properties->getGroups();
     for(unsigned int g=0; g<groups.size(); g++)
     {
@@ -356,11 +362,9 @@ const AbstractCharacteristic* KartPropertiesManager::getPlayerCharacteristic(con
  */
 const int KartPropertiesManager::getKartId(const std::string &ident) const
 {
-    for (unsigned int i=0; i<m_karts_properties.size(); i++)
-    {
-        if (m_karts_properties[i].getIdent() == ident)
-            return i;
-    }
+    auto it = m_kart_indices.find(ident);
+    if (it != m_kart_indices.end())
+        return it->second;
 
     std::ostringstream msg;
     msg << "KartPropertiesManager: Couldn't find kart: '" << ident << "'";
@@ -371,13 +375,10 @@ const int KartPropertiesManager::getKartId(const std::string &ident) const
 const KartProperties* KartPropertiesManager::getKart(
                                                 const std::string &ident) const
 {
-    for (const KartProperties* kp : m_karts_properties)
-    {
-        if (kp->getIdent() == ident)
-            return kp;
-    }
-
-    return NULL;
+    auto it = m_kart_indices.find(ident);
+    if (it == m_kart_indices.end())
+        return NULL;
+    return m_karts_properties.get(it->second);
 }   // getKart
 
 //-----------------------------------------------------------------------------
@@ -24,6 +24,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 #include "network/remote_kart_info.hpp"
 #include "utils/no_copy.hpp"
@@ -65,6 +66,9 @@ private:
      *  all clients or not. */
     std::vector<bool>        m_kart_available;
 
+    /** Index of each kart in m_karts_properties by its identifier. */
+    std::unordered_map<std::string, int> m_kart_indices;
+
     std::unique_ptr<AbstractCharacteristic>                         m_base_characteristic;
     std::map<std::string, std::unique_ptr<AbstractCharacteristic> > m_difficulty_characteristics;
     std::map<std::string, std::unique_ptr<AbstractCharacteristic> > m_kart_type_characteristics;
@@ -0,0 +1,145 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "karts/resolved_characteristic.hpp"
+
+#include "karts/abstract_characteristic.hpp"
+
+/** Reads all values from a characteristic, it aborts if a value isn't set.
+ *  \param characteristic The characteristic to read, usually the combined
+ *         characteristic of a kart.
+ */
+void ResolvedCharacteristic::resolve(
+                                 const AbstractCharacteristic* characteristic)
+{
+    // Script-generated content generated by tools/create_kart_properties.py rcresolve
+    // Please don't change the following tag. It will be automatically detected
+    // by the script and replace the contained content.
+    // To update the code, use tools/update_characteristics.py
+    /* <characteristics-start rcresolve> */
+    m_suspension_stiffness = characteristic->getSuspensionStiffness();
+    m_suspension_rest = characteristic->getSuspensionRest();
+    m_suspension_travel = characteristic->getSuspensionTravel();
+    m_suspension_exp_spring_response = characteristic->getSuspensionExpSpringResponse();
+    m_suspension_max_force = characteristic->getSuspensionMaxForce();
+    m_stability_roll_influence = characteristic->getStabilityRollInfluence();
+    m_stability_chassis_linear_damping = characteristic->getStabilityChassisLinearDamping();
+    m_stability_chassis_angular_damping = characteristic->getStabilityChassisAngularDamping();
+    m_stability_downward_impulse_factor = characteristic->getStabilityDownwardImpulseFactor();
+    m_stability_track_connection_accel = characteristic->getStabilityTrackConnectionAccel();
+    m_stability_angular_factor = characteristic->getStabilityAngularFactor();
+    m_stability_smooth_flying_impulse = characteristic->getStabilitySmoothFlyingImpulse();
+    m_turn_radius = characteristic->getTurnRadius();
+    m_turn_time_reset_steer = characteristic->getTurnTimeResetSteer();
+    m_turn_time_full_steer = characteristic->getTurnTimeFullSteer();
+    m_engine_power = characteristic->getEnginePower();
+    m_engine_max_speed = characteristic->getEngineMaxSpeed();
+    m_engine_generic_max_speed = characteristic->getEngineGenericMaxSpeed();
+    m_engine_brake_factor = characteristic->getEngineBrakeFactor();
+    m_engine_brake_time_increase = characteristic->getEngineBrakeTimeIncrease();
+    m_engine_max_speed_reverse_ratio = characteristic->getEngineMaxSpeedReverseRatio();
+    m_gear_switch_ratio = characteristic->getGearSwitchRatio();
+    m_gear_power_increase = characteristic->getGearPowerIncrease();
+    m_mass = characteristic->getMass();
+    m_wheels_damping_relaxation = characteristic->getWheelsDampingRelaxation();
+    m_wheels_damping_compression = characteristic->getWheelsDampingCompression();
+    m_jump_animation_time = characteristic->getJumpAnimationTime();
+    m_lean_max = characteristic->getLeanMax();
+    m_lean_speed = characteristic->getLeanSpeed();
+    m_anvil_duration = characteristic->getAnvilDuration();
+    m_anvil_weight = characteristic->getAnvilWeight();
+    m_anvil_speed_factor = characteristic->getAnvilSpeedFactor();
+    m_parachute_friction = characteristic->getParachuteFriction();
+    m_parachute_duration = characteristic->getParachuteDuration();
+    m_parachute_duration_other = characteristic->getParachuteDurationOther();
+    m_parachute_duration_rank_mult = characteristic->getParachuteDurationRankMult();
+    m_parachute_duration_speed_mult = characteristic->getParachuteDurationSpeedMult();
+    m_parachute_lbound_fraction = characteristic->getParachuteLboundFraction();
+    m_parachute_ubound_fraction = characteristic->getParachuteUboundFraction();
+    m_parachute_max_speed = characteristic->getParachuteMaxSpeed();
+    m_friction_kart_friction = characteristic->getFrictionKartFriction();
+    m_bubblegum_duration = characteristic->getBubblegumDuration();
+    m_bubblegum_speed_fraction = characteristic->getBubblegumSpeedFraction();
+    m_bubblegum_torque = characteristic->getBubblegumTorque();
+    m_bubblegum_fade_in_time = characteristic->getBubblegumFadeInTime();
+    m_bubblegum_shield_duration = characteristic->getBubblegumShieldDuration();
+    m_zipper_duration = characteristic->getZipperDuration();
+    m_zipper_force = characteristic->getZipperForce();
+    m_zipper_speed_gain = characteristic->getZipperSpeedGain();
+    m_zipper_max_speed_increase = characteristic->getZipperMaxSpeedIncrease();
+    m_zipper_fade_out_time = characteristic->getZipperFadeOutTime();
+    m_swatter_duration = characteristic->getSwatterDuration();
+    m_swatter_distance = characteristic->getSwatterDistance();
+    m_swatter_squash_duration = characteristic->getSwatterSquashDuration();
+    m_swatter_squash_slowdown = characteristic->getSwatterSquashSlowdown();
+    m_plunger_band_max_length = characteristic->getPlungerBandMaxLength();
+    m_plunger_band_force = characteristic->getPlungerBandForce();
+    m_plunger_band_duration = characteristic->getPlungerBandDuration();
+    m_plunger_band_speed_increase = characteristic->getPlungerBandSpeedIncrease();
+    m_plunger_band_fade_out_time = characteristic->getPlungerBandFadeOutTime();
+    m_plunger_in_face_time = characteristic->getPlungerInFaceTime();
+    m_startup_time = characteristic->getStartupTime();
+    m_startup_boost = characteristic->getStartupBoost();
+    m_rescue_duration = characteristic->getRescueDuration();
+    m_rescue_vert_offset = characteristic->getRescueVertOffset();
+    m_rescue_height = characteristic->getRescueHeight();
+    m_explosion_duration = characteristic->getExplosionDuration();
+    m_explosion_radius = characteristic->getExplosionRadius();
+    m_explosion_invulnerability_time = characteristic->getExplosionInvulnerabilityTime();
+    m_nitro_duration = characteristic->getNitroDuration();
+    m_nitro_engine_force = characteristic->getNitroEngineForce();
+    m_nitro_engine_mult = characteristic->getNitroEngineMult();
+    m_nitro_consumption = characteristic->getNitroConsumption();
+    m_nitro_small_container = characteristic->getNitroSmallContainer();
+    m_nitro_big_container = characteristic->getNitroBigContainer();
+    m_nitro_max_speed_increase = characteristic->getNitroMaxSpeedIncrease();
+    m_nitro_fade_out_time = characteristic->getNitroFadeOutTime();
+    m_nitro_max = characteristic->getNitroMax();
+    m_slipstream_duration_factor = characteristic->getSlipstreamDurationFactor();
+    m_slipstream_base_speed = characteristic->getSlipstreamBaseSpeed();
+    m_slipstream_length = characteristic->getSlipstreamLength();
+    m_slipstream_width = characteristic->getSlipstreamWidth();
+    m_slipstream_inner_factor = characteristic->getSlipstreamInnerFactor();
+    m_slipstream_min_collect_time = characteristic->getSlipstreamMinCollectTime();
+    m_slipstream_max_collect_time = characteristic->getSlipstreamMaxCollectTime();
+    m_slipstream_add_power = characteristic->getSlipstreamAddPower();
+    m_slipstream_min_speed = characteristic->getSlipstreamMinSpeed();
+    m_slipstream_max_speed_increase = characteristic->getSlipstreamMaxSpeedIncrease();
+    m_slipstream_fade_out_time = characteristic->getSlipstreamFadeOutTime();
+    m_skid_increase = characteristic->getSkidIncrease();
+    m_skid_decrease = characteristic->getSkidDecrease();
+    m_skid_max = characteristic->getSkidMax();
+    m_skid_time_till_max = characteristic->getSkidTimeTillMax();
+    m_skid_visual = characteristic->getSkidVisual();
+    m_skid_visual_time = characteristic->getSkidVisualTime();
+    m_skid_revert_visual_time = characteristic->getSkidRevertVisualTime();
+    m_skid_min_speed = characteristic->getSkidMinSpeed();
+    m_skid_time_till_bonus = characteristic->getSkidTimeTillBonus();
+    m_skid_bonus_speed = characteristic->getSkidBonusSpeed();
+    m_skid_bonus_time = characteristic->getSkidBonusTime();
+    m_skid_bonus_force = characteristic->getSkidBonusForce();
+    m_skid_physical_jump_time = characteristic->getSkidPhysicalJumpTime();
+    m_skid_graphical_jump_time = characteristic->getSkidGraphicalJumpTime();
+    m_skid_post_skid_rotate_factor = characteristic->getSkidPostSkidRotateFactor();
+    m_skid_reduce_turn_min = characteristic->getSkidReduceTurnMin();
+    m_skid_reduce_turn_max = characteristic->getSkidReduceTurnMax();
+    m_skid_enabled = characteristic->getSkidEnabled();
+
+    /* <characteristics-end rcresolve> */
+}   // resolve
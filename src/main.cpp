@@ -245,6 +245,8 @@ extern "C" {
 #include "modes/cutscene_world.hpp"
 #include "modes/demo_world.hpp"
 #include "network/protocols/connect_to_server.hpp"
+#include "network/protocols/game_protocol.hpp"
+#include "network/protocols/global_log.hpp"
 #include "network/protocols/client_lobby.hpp"
 #include "network/protocols/server_lobby.hpp"
 #include "network/network.hpp"
@@ -259,7 +261,10 @@ extern "C" {
 #include "network/server.hpp"
 #include "network/server_config.hpp"
 #include "network/servers_manager.hpp"
+#include "network/soccer_ranking.hpp"
+#include "network/track_records.hpp"
 #include "network/socket_address.hpp"
+#include "network/state_delta.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
 #include "online/profile_manager.hpp"
@@ -280,11 +285,13 @@ extern "C" {
 #include "states_screens/dialogs/message_dialog.hpp"
 #include "tips/tips_manager.hpp"
 #include "tracks/arena_graph.hpp"
+#include "tracks/drive_graph.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/command_line.hpp"
 #include "utils/constants.hpp"
 #include "utils/crash_reporting.hpp"
+#include "utils/interval_index.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/log.hpp"
 #include "mini_glm.hpp"
@@ -726,6 +733,13 @@ void cmdDebugHelp()
     "       --gamepad-visuals           Debug gamepads by visualising their values.\n"
     "       --no-high-scores            Disable writing high scores.\n"
     "       --unit-testing              Run unit tests and exit.\n"
+    "       --benchmark-sectors         Time the sector lookup of all race tracks and exit.\n"
+    "       --benchmark-characteristics Time the kart characteristics used in a kart\n"
+    "                                   update of 32 karts and exit.\n"
+    "       --benchmark-states          Time saving a network state of 8, 16 and 32\n"
+    "                                   karts and exit.\n"
+    "       --convert-replay=file       Convert a text replay to the binary replay format\n"
+    "                                   (saved as file_binary.replay) and exit.\n"
     "       --gamepad-debug             Enable verbose logging of gamepad button presses.\n"
     "       --keyboard-debug            Enable verbose logging of keyboard key presses.\n"
     "       --wiimote-debug             Enable verbose logging of Wii Remote button presses.\n"
@@ -1029,6 +1043,12 @@ int handleCmdLine(bool has_server_config, bool has_parent_process)
         UserConfigParams::m_no_high_scores=true;
     if (CommandLine::has("--unit-testing"))
         UserConfigParams::m_unit_testing = true;
+    if (CommandLine::has("--benchmark-sectors"))
+        UserConfigParams::m_benchmark_sectors = true;
+    if (CommandLine::has("--benchmark-characteristics"))
+        UserConfigParams::m_benchmark_characteristics = true;
+    if (CommandLine::has("--benchmark-states"))
+        UserConfigParams::m_benchmark_states = true;
     if (CommandLine::has("--gamepad-debug"))
         UserConfigParams::m_gamepad_debug=true;
     if (CommandLine::has("--keyboard-debug"))
@@ -2381,6 +2401,32 @@ int main(int argc, char *argv[])
             exit(0);
         }
 
+        if (UserConfigParams::m_benchmark_sectors)
+        {
+            DriveGraph::benchmarkSectorLookup();
+            exit(0);
+        }
+
+        if (UserConfigParams::m_benchmark_characteristics)
+        {
+            KartProperties::benchmarkCharacteristics();
+            exit(0);
+        }
+
+        if (UserConfigParams::m_benchmark_states)
+        {
+            RewindManager::benchmarkStates();
+            exit(0);
+        }
+
+        std::string replay;
+        if (CommandLine::has("--convert-replay", &replay))
+        {
+            bool converted = ReplayPlay::get()->convertReplayFile(replay,
+                StringUtils::removeExtension(replay) + "_binary.replay");
+            exit(converted ? 0 : 1);
+        }
+
 #ifndef SERVER_ONLY
         if (!GUIEngine::isNoGraphics())
         {
@@ -2720,6 +2766,9 @@ static void cleanSuperTuxKart()
     // Race manager needs to be deleted after sfx manager as it checks for
     // the kart size structure from race manager
     RaceManager::destroy();
+    GlobalLog::stopWriter();
+    SoccerRanking::destroy();
+    TrackRecords::destroy();
     if(grand_prix_manager)      delete grand_prix_manager;
     if(highscore_manager)       delete highscore_manager;
     if(tiers_roulette)          delete tiers_roulette;
@@ -2824,6 +2873,8 @@ void runUnitTests()
     SocketAddress::unitTesting();
     Log::info("UnitTest", "StringUtils::versionToInt");
     StringUtils::unitTesting();
+    Log::info("UnitTest", "IntervalIndex");
+    IntervalIndex<int, int>::unitTesting();
 
     Log::info("UnitTest", "Easter detection");
     // Test easter mode: in 2015 Easter is 5th of April - check with 0 days
@@ -2871,6 +2922,15 @@ void runUnitTests()
     Log::info("UnitTest", "RewindQueue");
     RewindQueue::unitTesting();
 
+    Log::info("UnitTest", "StateDelta");
+    StateDelta::unitTesting();
+
+    Log::info("UnitTest", "GameProtocol state interest");
+    GameProtocol::unitTesting();
+
+    Log::info("UnitTest", "Binary replay");
+    ReplayBase::unitTesting();
+
     Log::info("UnitTest", "=====================");
     Log::info("UnitTest", "Testing successful   ");
     Log::info("UnitTest", "=====================");
@@ -54,6 +54,7 @@
 #include "states_screens/main_menu_screen.hpp"
 #include "states_screens/state_manager.hpp"
 #include "utils/profiler.hpp"
+#include "utils/tracer.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/time.hpp"
 #include "utils/translation.hpp"
@@ -455,6 +456,7 @@ void MainLoop::run()
 #endif
 
         PROFILER_PUSH_CPU_MARKER("Main loop", 0xFF, 0x00, 0xF7);
+        TRACE_SCOPE("Main loop");
         TimePoint frame_start = std::chrono::steady_clock::now();
 
         left_over_time += getLimitedDt();
@@ -590,6 +592,7 @@ void MainLoop::run()
             if (!m_download_assets)
             {
                 PROFILER_PUSH_CPU_MARKER("Database polling update", 0x00, 0x7F, 0x7F);
+                TRACE_SCOPE("Database polling update");
                 Online::RequestManager::get()->update(frame_duration);
                 PROFILER_POP_CPU_MARKER();
             }
@@ -636,6 +639,7 @@ void MainLoop::run()
                                          0x7F, 0x00, 0x7F);
                 if (auto pm = ProtocolManager::lock())
                 {
+                    TRACE_SCOPE("Protocol manager update");
                     pm->update(1);
                 }
                 PROFILER_POP_CPU_MARKER();
@@ -643,6 +647,7 @@ void MainLoop::run()
                 PROFILER_PUSH_CPU_MARKER("Update race", 0, 255, 255);
                 if (World::getWorld())
                 {
+                    TRACE_SCOPE("Update race");
                     updateRace(1, fast_forward);
                 }
                 PROFILER_POP_CPU_MARKER();
@@ -729,6 +734,7 @@ void MainLoop::run()
             std::chrono::nanoseconds wait_time_ns(
                 (uint64_t)(wait_time * 1000.0 * 1000.0 * 1000.0));
             PROFILER_PUSH_CPU_MARKER("Throttle framerate", 0, 0, 0);
+            TRACE_SCOPE("Throttle framerate");
             std::this_thread::sleep_for(wait_time_ns);
             PROFILER_POP_CPU_MARKER();
         }
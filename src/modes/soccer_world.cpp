@@ -698,7 +698,8 @@ void SoccerWorld::onCheckGoalTriggered(bool first_goal)
 	{
             if (m_soccer_log)
 	    {
-		    GlobalLog::writeLog( "goal "+ player_name_log + " "+team_name+"\n", GlobalLogTypes::POS_LOG);
+		    GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "goal", sd.m_id,
+		        "goal "+ player_name_log + " "+team_name+"\n", { { "team", team_name } });
 	  	    std::ofstream log_file(ServerConfig::m_live_soccer_log_path, std::ios::app);
 	  	    float match_time = getTime();
 	   	    log_file << match_time << "s: " << player_name_log << " (" << team_name
@@ -710,7 +711,8 @@ void SoccerWorld::onCheckGoalTriggered(bool first_goal)
 	{
             if (m_soccer_log)
 	    {
-		    GlobalLog::writeLog( "own_goal "+ player_name_log + " "+team_name+"\n", GlobalLogTypes::POS_LOG);
+		    GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "own_goal", sd.m_id,
+		        "own_goal "+ player_name_log + " "+team_name+"\n", { { "team", team_name } });
 		    std::ofstream log_file(ServerConfig::m_live_soccer_log_path, std::ios::app);
 		    float match_time = getTime();
 	    	    log_file << match_time << "s: " << player_name_log << " (" << team_name << ") scored an own goal\n";
@@ -765,7 +767,9 @@ void SoccerWorld::onCheckGoalTriggered(bool first_goal)
         {
             set_powerup_multiplier(3);
 	    std::string msg = "Powerupper on";
-            if (m_soccer_log) GlobalLog::writeLog( "Powerupper on!\n", GlobalLogTypes::POS_LOG);
+            if (m_soccer_log)
+                GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "powerupper", -1,
+                    "Powerupper on!\n", { { "state", "on" } });
             sl->sendStringToAllPeers(msg);
             once = 2;
 	}
@@ -776,7 +780,9 @@ void SoccerWorld::onCheckGoalTriggered(bool first_goal)
 	    if ((abs(getScore(KART_TEAM_BLUE)-getScore(KART_TEAM_RED)) == 2) && (once == 2))
 	    {
                 std::string msg = "Powerupper off";
-                if (m_soccer_log) GlobalLog::writeLog( "Powerupper off!\n", GlobalLogTypes::POS_LOG);
+                if (m_soccer_log)
+                    GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "powerupper", -1,
+                        "Powerupper off!\n", { { "state", "off" } });
                 sl->sendStringToAllPeers(msg);
                 once = 1;
 	    }
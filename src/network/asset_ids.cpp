@@ -0,0 +1,69 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "network/asset_ids.hpp"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace AssetIds
+{
+    static std::mutex g_ids_mutex;
+
+    static std::unordered_map<std::string, unsigned> g_ids;
+
+    static std::vector<std::string> g_idents;
+
+    // ------------------------------------------------------------------------
+    unsigned intern(const std::string& ident)
+    {
+        std::lock_guard<std::mutex> lock(g_ids_mutex);
+        auto it = g_ids.find(ident);
+        if (it != g_ids.end())
+            return it->second;
+        unsigned id = (unsigned)g_idents.size();
+        g_ids[ident] = id;
+        g_idents.push_back(ident);
+        return id;
+    }   // intern
+
+    // ------------------------------------------------------------------------
+    int find(const std::string& ident)
+    {
+        std::lock_guard<std::mutex> lock(g_ids_mutex);
+        auto it = g_ids.find(ident);
+        return it == g_ids.end() ? -1 : (int)it->second;
+    }   // find
+
+    // ------------------------------------------------------------------------
+    std::string getIdent(unsigned id)
+    {
+        std::lock_guard<std::mutex> lock(g_ids_mutex);
+        return id < g_idents.size() ? g_idents[id] : "";
+    }   // getIdent
+
+    // ------------------------------------------------------------------------
+    unsigned size()
+    {
+        std::lock_guard<std::mutex> lock(g_ids_mutex);
+        return (unsigned)g_idents.size();
+    }   // size
+
+}   // namespace AssetIds
@@ -0,0 +1,46 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_ASSET_IDS_HPP
+#define HEADER_ASSET_IDS_HPP
+
+#include <string>
+
+/** \ingroup network
+ *  Global table which gives each kart or track identifier known by the
+ *  server a dense id, so the assets of peers can be stored as bitsets
+ *  (see DynamicBitset) instead of string sets. Ids are never removed, so
+ *  they stay valid when addons are uninstalled. Identifiers sent by clients
+ *  are only looked up, never added, so clients can't grow the table.
+ *  All functions can be called from any thread.
+ */
+namespace AssetIds
+{
+    /** Returns the id of the identifier, adding it if it's new. */
+    unsigned intern(const std::string& ident);
+    // ------------------------------------------------------------------------
+    /** Returns the id of the identifier, or -1 if it's unknown. */
+    int find(const std::string& ident);
+    // ------------------------------------------------------------------------
+    std::string getIdent(unsigned id);
+    // ------------------------------------------------------------------------
+    unsigned size();
+}   // namespace AssetIds
+
+#endif // HEADER_ASSET_IDS_HPP
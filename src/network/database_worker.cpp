@@ -0,0 +1,343 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifdef ENABLE_SQLITE3
+
+#include "network/database_worker.hpp"
+
+#include "utils/log.hpp"
+#include "utils/vs.hpp"
+
+#include <utility>
+
+/** Maximum number of prepared statements kept, queries which format values
+ *  into their text would otherwise fill the cache forever. */
+static const unsigned MAX_CACHED_STATEMENTS = 64;
+
+// ----------------------------------------------------------------------------
+/** Takes ownership of the database connection and starts the worker thread.
+ *  \param db Connection only used by this worker, it is closed in stop().
+ */
+DatabaseWorker::DatabaseWorker(sqlite3* db)
+{
+    m_db = db;
+    m_stop = false;
+    m_thread = std::thread(std::bind(&DatabaseWorker::mainLoop, this));
+}   // DatabaseWorker
+
+// ----------------------------------------------------------------------------
+DatabaseWorker::~DatabaseWorker()
+{
+    stop();
+}   // ~DatabaseWorker
+
+// ----------------------------------------------------------------------------
+/** Finishes all queued requests, then stops the worker thread and closes
+ *  the connection. Callbacks which have not been handled are discarded.
+ */
+void DatabaseWorker::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_requests_mutex);
+        m_stop = true;
+    }
+    m_requests_cv.notify_one();
+    if (m_thread.joinable())
+        m_thread.join();
+    if (m_db)
+    {
+        finalizeStatements();
+        sqlite3_close(m_db);
+        m_db = NULL;
+    }
+}   // stop
+
+// ----------------------------------------------------------------------------
+void DatabaseWorker::addRequest(Request& request)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_requests_mutex);
+        if (m_stop)
+        {
+            Log::warn("DatabaseWorker", "Ignored query after stop: %s",
+                request.m_query.c_str());
+            return;
+        }
+        m_requests.push_back(std::move(request));
+    }
+    m_requests_cv.notify_one();
+}   // addRequest
+
+// ----------------------------------------------------------------------------
+/** Queues a query which changes the database.
+ *  \param query The query text, it is used as key of the statement cache.
+ *  \param bind Optional function called in worker thread to bind values.
+ *  \param callback Optional function called in handleCompletions with true
+ *  if the query succeeded and its transaction was committed.
+ */
+void DatabaseWorker::addWrite(const std::string& query, BindFunction bind,
+                              std::function<void(bool)> callback)
+{
+    Request request;
+    request.m_query = query;
+    request.m_bind = bind;
+    request.m_write = true;
+    if (callback)
+    {
+        request.m_callback = [callback](bool success, const Rows& rows)
+            {
+                callback(success);
+            };
+    }
+    addRequest(request);
+}   // addWrite
+
+// ----------------------------------------------------------------------------
+/** Queues a query which reads from the database.
+ *  \param query The query text, it is used as key of the statement cache.
+ *  \param bind Optional function called in worker thread to bind values.
+ *  \param callback Function called in handleCompletions with the success
+ *  and the result rows of the query.
+ */
+void DatabaseWorker::addQuery(const std::string& query, BindFunction bind,
+                              std::function<void(bool, const Rows&)> callback)
+{
+    Request request;
+    request.m_query = query;
+    request.m_bind = bind;
+    request.m_write = false;
+    request.m_callback = callback;
+    addRequest(request);
+}   // addQuery
+
+// ----------------------------------------------------------------------------
+/** Queues a callback which is called in handleCompletions after all
+ *  previously queued requests are done.
+ */
+void DatabaseWorker::addCallback(std::function<void()> callback)
+{
+    Request request;
+    request.m_write = false;
+    request.m_callback = [callback](bool success, const Rows& rows)
+        {
+            callback();
+        };
+    addRequest(request);
+}   // addCallback
+
+// ----------------------------------------------------------------------------
+/** Queues a function which is called in worker thread with its connection,
+ *  for work which reads too many rows to be copied into Rows.
+ *  \param task Returns true if it succeeded.
+ *  \param callback Optional function called in handleCompletions with the
+ *  result of task.
+ */
+void DatabaseWorker::addTask(std::function<bool(sqlite3*)> task,
+                             std::function<void(bool)> callback)
+{
+    Request request;
+    request.m_write = false;
+    request.m_task = task;
+    if (callback)
+    {
+        request.m_callback = [callback](bool success, const Rows& rows)
+            {
+                callback(success);
+            };
+    }
+    addRequest(request);
+}   // addTask
+
+// ----------------------------------------------------------------------------
+/** Calls the callbacks of all finished requests in the calling thread. */
+void DatabaseWorker::handleCompletions()
+{
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_completions_mutex);
+        if (m_completions.empty())
+            return;
+        std::swap(completions, m_completions);
+    }
+    for (Completion& c : completions)
+        c.m_callback(c.m_success, c.m_rows);
+}   // handleCompletions
+
+// ----------------------------------------------------------------------------
+void DatabaseWorker::mainLoop()
+{
+    VS::setThreadName("DatabaseWorker");
+    std::deque<Request> requests;
+    std::vector<Completion> completed;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> ul(m_requests_mutex);
+            m_requests_cv.wait(ul, [this]()
+                { return m_stop || !m_requests.empty(); });
+            // Queued requests are always finished before stopping
+            if (m_requests.empty())
+                break;
+            std::swap(requests, m_requests);
+        }
+
+        bool in_transaction = false;
+        size_t first_in_transaction = 0;
+        auto end_transaction = [&]()
+            {
+                if (!in_transaction)
+                    return;
+                in_transaction = false;
+                if (execute("COMMIT;"))
+                    return;
+                execute("ROLLBACK;");
+                for (size_t i = first_in_transaction; i < completed.size();
+                    i++)
+                    completed[i].m_success = false;
+            };
+
+        for (Request& request : requests)
+        {
+            Completion c;
+            c.m_success = true;
+            if (request.m_task)
+            {
+                end_transaction();
+                c.m_success = request.m_task(m_db);
+            }
+            else if (!request.m_query.empty())
+            {
+                if (request.m_write && !in_transaction)
+                {
+                    first_in_transaction = completed.size();
+                    in_transaction = execute("BEGIN;");
+                }
+                else if (!request.m_write)
+                    end_transaction();
+                c.m_success = runRequest(request,
+                    request.m_callback ? &c.m_rows : NULL);
+            }
+            if (request.m_callback)
+            {
+                c.m_callback = std::move(request.m_callback);
+                completed.push_back(std::move(c));
+            }
+        }
+        end_transaction();
+        requests.clear();
+
+        // Callbacks of writes are only handled after their transaction is
+        // committed
+        if (!completed.empty())
+        {
+            std::lock_guard<std::mutex> lock(m_completions_mutex);
+            for (Completion& c : completed)
+                m_completions.push_back(std::move(c));
+        }
+        completed.clear();
+    }
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+bool DatabaseWorker::execute(const char* query)
+{
+    char* errmsg = NULL;
+    if (sqlite3_exec(m_db, query, NULL, NULL, &errmsg) != SQLITE_OK)
+    {
+        Log::error("DatabaseWorker", "Error executing %s: %s", query,
+            errmsg ? errmsg : sqlite3_errmsg(m_db));
+        sqlite3_free(errmsg);
+        return false;
+    }
+    return true;
+}   // execute
+
+// ----------------------------------------------------------------------------
+/** Returns a prepared statement for the query text, prepared statements are
+ *  reused for the same query text.
+ */
+sqlite3_stmt* DatabaseWorker::getStatement(const std::string& query)
+{
+    auto it = m_statements.find(query);
+    if (it != m_statements.end())
+        return it->second;
+
+    if (m_statements.size() >= MAX_CACHED_STATEMENTS)
+        finalizeStatements();
+
+    sqlite3_stmt* stmt = NULL;
+    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
+    if (ret != SQLITE_OK || !stmt)
+    {
+        Log::error("DatabaseWorker",
+            "Error preparing database for query %s: %s",
+            query.c_str(), sqlite3_errmsg(m_db));
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+    m_statements[query] = stmt;
+    return stmt;
+}   // getStatement
+
+// ----------------------------------------------------------------------------
+/** Runs a request, return true if no error occurs.
+ *  \param rows If not NULL, the result rows are stored there.
+ */
+bool DatabaseWorker::runRequest(const Request& request, Rows* rows)
+{
+    sqlite3_stmt* stmt = getStatement(request.m_query);
+    if (!stmt)
+        return false;
+    if (request.m_bind)
+        request.m_bind(stmt);
+
+    int ret = sqlite3_step(stmt);
+    while (ret == SQLITE_ROW)
+    {
+        if (rows)
+        {
+            const int count = sqlite3_column_count(stmt);
+            rows->emplace_back();
+            std::vector<std::string>& row = rows->back();
+            for (int i = 0; i < count; i++)
+            {
+                const char* text = (const char*)sqlite3_column_text(stmt, i);
+                row.push_back(text ? text : "");
+            }
+        }
+        ret = sqlite3_step(stmt);
+    }
+    if (ret != SQLITE_DONE)
+    {
+        Log::error("DatabaseWorker", "Error running query %s: %s",
+            request.m_query.c_str(), sqlite3_errmsg(m_db));
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ret == SQLITE_DONE;
+}   // runRequest
+
+// ----------------------------------------------------------------------------
+void DatabaseWorker::finalizeStatements()
+{
+    for (auto& p : m_statements)
+        sqlite3_finalize(p.second);
+    m_statements.clear();
+}   // finalizeStatements
+
+#endif // ENABLE_SQLITE3
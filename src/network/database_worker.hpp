@@ -0,0 +1,144 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifdef ENABLE_SQLITE3
+
+#ifndef HEADER_DATABASE_WORKER_HPP
+#define HEADER_DATABASE_WORKER_HPP
+
+#include <sqlite3.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** \ingroup network
+ *  Runs SQLite queries of the server lobby in a separate thread with its own
+ *  database connection, so a slow disk or a database locked by an external
+ *  tool never stalls the lobby. Requests are executed in the order they are
+ *  queued, consecutive writes are batched into one transaction. Prepared
+ *  statements are cached by query text, so queries should bind their
+ *  changing values instead of formatting them into the text.
+ *  Callbacks are never called in the worker thread, they are queued and
+ *  called by the thread which calls handleCompletions(). Bind functions
+ *  however are called in the worker thread, so they must only use copies of
+ *  the data they bind.
+ */
+class DatabaseWorker
+{
+public:
+    /** Result rows of a query, each column converted to text (NULL values
+     *  become empty strings). */
+    typedef std::vector<std::vector<std::string> > Rows;
+
+    typedef std::function<void(sqlite3_stmt* stmt)> BindFunction;
+
+private:
+    struct Request
+    {
+        std::string m_query;
+
+        BindFunction m_bind;
+
+        /** True if the query changes the database, consecutive writes are
+         *  run in one transaction. */
+        bool m_write;
+
+        /** If set, called in worker thread with the connection instead of
+         *  running m_query. */
+        std::function<bool(sqlite3*)> m_task;
+
+        /** Called by handleCompletions with the success and result rows. */
+        std::function<void(bool, const Rows&)> m_callback;
+    };
+
+    /** A finished request waiting for handleCompletions. */
+    struct Completion
+    {
+        std::function<void(bool, const Rows&)> m_callback;
+
+        bool m_success;
+
+        Rows m_rows;
+    };
+
+    /** Connection used only by the worker thread. */
+    sqlite3* m_db;
+
+    std::thread m_thread;
+
+    std::mutex m_requests_mutex;
+
+    std::condition_variable m_requests_cv;
+
+    std::deque<Request> m_requests;
+
+    bool m_stop;
+
+    std::mutex m_completions_mutex;
+
+    std::vector<Completion> m_completions;
+
+    /** Prepared statements keyed by their query text, only used in worker
+     *  thread. */
+    std::map<std::string, sqlite3_stmt*> m_statements;
+
+    // ------------------------------------------------------------------------
+    void mainLoop();
+    // ------------------------------------------------------------------------
+    bool execute(const char* query);
+    // ------------------------------------------------------------------------
+    sqlite3_stmt* getStatement(const std::string& query);
+    // ------------------------------------------------------------------------
+    bool runRequest(const Request& request, Rows* rows);
+    // ------------------------------------------------------------------------
+    void finalizeStatements();
+    // ------------------------------------------------------------------------
+    void addRequest(Request& request);
+
+public:
+    // ------------------------------------------------------------------------
+    DatabaseWorker(sqlite3* db);
+    // ------------------------------------------------------------------------
+    ~DatabaseWorker();
+    // ------------------------------------------------------------------------
+    void addWrite(const std::string& query, BindFunction bind = nullptr,
+                  std::function<void(bool)> callback = nullptr);
+    // ------------------------------------------------------------------------
+    void addQuery(const std::string& query, BindFunction bind,
+                  std::function<void(bool, const Rows&)> callback);
+    // ------------------------------------------------------------------------
+    void addCallback(std::function<void()> callback);
+    // ------------------------------------------------------------------------
+    void addTask(std::function<bool(sqlite3*)> task,
+                 std::function<void(bool)> callback = nullptr);
+    // ------------------------------------------------------------------------
+    void handleCompletions();
+    // ------------------------------------------------------------------------
+    void stop();
+
+};   // class DatabaseWorker
+
+#endif // HEADER_DATABASE_WORKER_HPP
+
+#endif // ENABLE_SQLITE3
@@ -0,0 +1,282 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifdef ENABLE_SQLITE3
+
+#include "network/ip_index.hpp"
+
+#include "network/stk_ipv6.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+
+#include <unordered_map>
+
+// ----------------------------------------------------------------------------
+static std::string columnText(sqlite3_stmt* stmt, int column)
+{
+    const char* text = (const char*)sqlite3_column_text(stmt, column);
+    return text ? text : "";
+}   // columnText
+
+// ----------------------------------------------------------------------------
+/** Prepares a query, logs and returns NULL if failed. */
+static sqlite3_stmt* prepare(sqlite3* db, const std::string& query)
+{
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, 0) != SQLITE_OK)
+    {
+        Log::error("IPIndex", "Error preparing database for query %s: %s",
+            query.c_str(), sqlite3_errmsg(db));
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+    return stmt;
+}   // prepare
+
+// ----------------------------------------------------------------------------
+/** Finalizes a statement after all rows are read, return false if there was
+ *  an error. */
+static bool finish(sqlite3* db, sqlite3_stmt* stmt, int ret,
+                   const std::string& query)
+{
+    sqlite3_finalize(stmt);
+    if (ret != SQLITE_DONE)
+    {
+        Log::error("IPIndex", "Error running query %s: %s", query.c_str(),
+            sqlite3_errmsg(db));
+        return false;
+    }
+    return true;
+}   // finish
+
+// ----------------------------------------------------------------------------
+/** Condition for ban entries which are effective now. */
+static const char* g_effective_ban =
+    " WHERE datetime('now') > datetime(starting_time) AND "
+    "(expired_days is NULL OR datetime"
+    "(starting_time, '+'||expired_days||' days') > datetime('now'));";
+
+// ----------------------------------------------------------------------------
+/** Loads the effective entries of the IPv4 ban table, return NULL if the
+ *  table cannot be read. */
+std::shared_ptr<const IPBanIndex> IPBanIndex::loadIPv4(sqlite3* db,
+                                                      const std::string& table)
+{
+    std::string query = "SELECT rowid, ip_start, ip_end, reason, description "
+        "FROM " + table + g_effective_ban;
+    sqlite3_stmt* stmt = prepare(db, query);
+    if (!stmt)
+        return nullptr;
+
+    std::shared_ptr<IPBanIndex> index = std::make_shared<IPBanIndex>();
+    int ret;
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        IPBanInfo info;
+        info.m_rowid = sqlite3_column_int64(stmt, 0);
+        info.m_ip_start = sqlite3_column_int64(stmt, 1);
+        info.m_ip_end = sqlite3_column_int64(stmt, 2);
+        info.m_reason = columnText(stmt, 3);
+        info.m_description = columnText(stmt, 4);
+        index->m_bans.add(Address(0, (uint32_t)info.m_ip_start),
+            Address(0, (uint32_t)info.m_ip_end), info);
+    }
+    if (!finish(db, stmt, ret, query))
+        return nullptr;
+    index->m_bans.build();
+    return index;
+}   // loadIPv4
+
+// ----------------------------------------------------------------------------
+/** Loads the effective entries of the IPv6 ban table, return NULL if the
+ *  table cannot be read. */
+std::shared_ptr<const IPBanIndex> IPBanIndex::loadIPv6(sqlite3* db,
+                                                      const std::string& table)
+{
+    std::string query = "SELECT rowid, ipv6_cidr, reason, description "
+        "FROM " + table + g_effective_ban;
+    sqlite3_stmt* stmt = prepare(db, query);
+    if (!stmt)
+        return nullptr;
+
+    std::shared_ptr<IPBanIndex> index = std::make_shared<IPBanIndex>();
+    int ret;
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        IPBanInfo info;
+        info.m_rowid = sqlite3_column_int64(stmt, 0);
+        info.m_ip_start = 0;
+        info.m_ip_end = 0;
+        info.m_ipv6_cidr = columnText(stmt, 1);
+        info.m_reason = columnText(stmt, 2);
+        info.m_description = columnText(stmt, 3);
+        uint64_t start[2];
+        uint64_t end[2];
+        if (rangeIPv6CIDR(info.m_ipv6_cidr.c_str(), start, end) != 1)
+        {
+            Log::warn("IPIndex", "Invalid IPv6 CIDR %s in %s.",
+                info.m_ipv6_cidr.c_str(), table.c_str());
+            continue;
+        }
+        index->m_bans.add(Address(start[0], start[1]),
+            Address(end[0], end[1]), info);
+    }
+    if (!finish(db, stmt, ret, query))
+        return nullptr;
+    index->m_bans.build();
+    return index;
+}   // loadIPv6
+
+// ----------------------------------------------------------------------------
+const IPBanInfo* IPBanIndex::findIPv6(const std::string& ipv6) const
+{
+    Address address;
+    if (splitIPv6(ipv6.c_str(), &address.first, &address.second) != 1)
+        return NULL;
+    return m_bans.find(address);
+}   // findIPv6
+
+// ----------------------------------------------------------------------------
+/** Loads a geolocation table, return NULL if the table cannot be read.
+ *  \param previous If not NULL, it is returned if the table did not change,
+ *  or extended with the new rows if rows were only added after its last
+ *  ip_start.
+ */
+std::shared_ptr<const GeolocationIndex>
+    GeolocationIndex::load(sqlite3* db, const std::string& table,
+                           std::shared_ptr<const GeolocationIndex> previous)
+{
+    std::string query = "SELECT count(*), max(ip_start) FROM " + table + ";";
+    sqlite3_stmt* stmt = prepare(db, query);
+    if (!stmt)
+        return nullptr;
+    int64_t rows = 0;
+    int64_t max_ip_start = 0;
+    int ret = sqlite3_step(stmt);
+    if (ret == SQLITE_ROW)
+    {
+        rows = sqlite3_column_int64(stmt, 0);
+        max_ip_start = sqlite3_column_int64(stmt, 1);
+        ret = sqlite3_step(stmt);
+    }
+    if (!finish(db, stmt, ret, query))
+        return nullptr;
+
+    if (previous && previous->m_rows == rows &&
+        previous->m_max_ip_start == max_ip_start)
+        return previous;
+
+    std::shared_ptr<GeolocationIndex> index;
+    if (previous && rows > previous->m_rows &&
+        max_ip_start > previous->m_max_ip_start)
+    {
+        query = StringUtils::insertValues(
+            "SELECT count(*) FROM %s WHERE ip_start > %s;", table.c_str(),
+            StringUtils::toString(previous->m_max_ip_start).c_str());
+        stmt = prepare(db, query);
+        if (!stmt)
+            return nullptr;
+        int64_t new_rows = -1;
+        ret = sqlite3_step(stmt);
+        if (ret == SQLITE_ROW)
+        {
+            new_rows = sqlite3_column_int64(stmt, 0);
+            ret = sqlite3_step(stmt);
+        }
+        if (!finish(db, stmt, ret, query))
+            return nullptr;
+        if (new_rows == rows - previous->m_rows)
+        {
+            index = std::make_shared<GeolocationIndex>(*previous);
+            if (!index->loadRows(db, table, true/*only_new*/))
+                return nullptr;
+        }
+    }
+    if (!index)
+    {
+        index = std::make_shared<GeolocationIndex>();
+        if (!index->loadRows(db, table, false/*only_new*/))
+            return nullptr;
+    }
+    index->m_rows = rows;
+    index->m_max_ip_start = max_ip_start;
+    return index;
+}   // load
+
+// ----------------------------------------------------------------------------
+/** Adds the rows of the table to this index.
+ *  \param only_new Only add rows after the largest ip_start of last load.
+ */
+bool GeolocationIndex::loadRows(sqlite3* db, const std::string& table,
+                                bool only_new)
+{
+    std::string query = "SELECT ip_start, ip_end, country_code FROM " + table;
+    if (only_new)
+    {
+        query += " WHERE ip_start > ";
+        query += StringUtils::toString(m_max_ip_start);
+    }
+    query += ";";
+    sqlite3_stmt* stmt = prepare(db, query);
+    if (!stmt)
+        return false;
+
+    std::unordered_map<std::string, uint16_t> code_ids;
+    for (unsigned i = 0; i < m_country_codes.size(); i++)
+        code_ids[m_country_codes[i]] = (uint16_t)i;
+
+    // Ranges are usually sorted, so consecutive rows often have the same
+    // country
+    std::string last_code;
+    uint16_t last_id = 0;
+    bool has_last = false;
+    int ret;
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const char* code = (const char*)sqlite3_column_text(stmt, 2);
+        if (!code)
+            continue;
+        if (!has_last || last_code != code)
+        {
+            last_code = code;
+            auto it = code_ids.find(last_code);
+            if (it != code_ids.end())
+                last_id = it->second;
+            else
+            {
+                if (m_country_codes.size() > 0xffff)
+                {
+                    has_last = false;
+                    continue;
+                }
+                last_id = (uint16_t)m_country_codes.size();
+                m_country_codes.push_back(last_code);
+                code_ids[last_code] = last_id;
+            }
+            has_last = true;
+        }
+        m_ranges.add(sqlite3_column_int64(stmt, 0),
+            sqlite3_column_int64(stmt, 1), last_id);
+    }
+    if (!finish(db, stmt, ret, query))
+        return false;
+    m_ranges.build();
+    return true;
+}   // loadRows
+
+#endif // ENABLE_SQLITE3
@@ -0,0 +1,127 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifdef ENABLE_SQLITE3
+
+#ifndef HEADER_IP_INDEX_HPP
+#define HEADER_IP_INDEX_HPP
+
+#include "utils/interval_index.hpp"
+
+#include <sqlite3.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** A ban entry of the IPv4 or IPv6 ban table. */
+struct IPBanInfo
+{
+    int64_t m_rowid;
+
+    std::string m_reason;
+
+    std::string m_description;
+
+    /** ip_start and ip_end for IPv4, ipv6_cidr for IPv6, used to update
+     *  the trigger count. */
+    int64_t m_ip_start;
+
+    int64_t m_ip_end;
+
+    std::string m_ipv6_cidr;
+};
+
+// ============================================================================
+/** \ingroup network
+ *  In-memory copy of the effective entries of an IPv4 or IPv6 ban table,
+ *  addresses are stored as upper and lower 64 bits (upper is 0 for IPv4).
+ *  An index is never changed after loading, so it can be shared between
+ *  threads, a refreshed table is loaded into a new index.
+ */
+class IPBanIndex
+{
+private:
+    typedef std::pair<uint64_t, uint64_t> Address;
+
+    IntervalIndex<Address, IPBanInfo> m_bans;
+
+public:
+    // ------------------------------------------------------------------------
+    static std::shared_ptr<const IPBanIndex> loadIPv4(sqlite3* db,
+                                                    const std::string& table);
+    // ------------------------------------------------------------------------
+    static std::shared_ptr<const IPBanIndex> loadIPv6(sqlite3* db,
+                                                    const std::string& table);
+    // ------------------------------------------------------------------------
+    const IPBanInfo* findIPv4(uint32_t ip) const
+                                   { return m_bans.find(Address(0, ip)); }
+    // ------------------------------------------------------------------------
+    const IPBanInfo* findIPv6(const std::string& ipv6) const;
+    // ------------------------------------------------------------------------
+    size_t size() const                               { return m_bans.size(); }
+
+};   // class IPBanIndex
+
+// ============================================================================
+/** \ingroup network
+ *  In-memory copy of an IPv4 or IPv6 geolocation table, keyed by the same
+ *  integers as ip_start and ip_end in the table (the upper 64 bits of an
+ *  IPv6 address). Country codes are stored once and referred by index.
+ *  A table which only got rows after the last ip_start is refreshed by
+ *  loading only the new rows.
+ */
+class GeolocationIndex
+{
+private:
+    IntervalIndex<int64_t, uint16_t> m_ranges;
+
+    std::vector<std::string> m_country_codes;
+
+    /** Number of rows and largest ip_start when loaded, used to detect
+     *  changes of the table. */
+    int64_t m_rows;
+
+    int64_t m_max_ip_start;
+
+    // ------------------------------------------------------------------------
+    bool loadRows(sqlite3* db, const std::string& table, bool only_new);
+
+public:
+    // ------------------------------------------------------------------------
+    GeolocationIndex() : m_rows(0), m_max_ip_start(0) {}
+    // ------------------------------------------------------------------------
+    static std::shared_ptr<const GeolocationIndex>
+        load(sqlite3* db, const std::string& table,
+             std::shared_ptr<const GeolocationIndex> previous);
+    // ------------------------------------------------------------------------
+    std::string find(int64_t ip) const
+    {
+        const uint16_t* code = m_ranges.find(ip);
+        return code ? m_country_codes[*code] : "";
+    }   // find
+    // ------------------------------------------------------------------------
+    size_t size() const                             { return m_ranges.size(); }
+
+};   // class GeolocationIndex
+
+#endif
+
+#endif // ENABLE_SQLITE3
@@ -27,12 +27,16 @@
 #include "network/socket_address.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
+#include "network/track_records.hpp"
 #include "network/protocols/server_lobby.hpp"
 #include "utils/time.hpp"
+#include "utils/tracer.hpp"
 #include "utils/vs.hpp"
 #include "modes/world.hpp"
 #include "main_loop.hpp"
 
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <limits>
 #include <string>
@@ -62,6 +66,19 @@ void showHelp()
     std::cout << "listpeers, List all peers with host ID and IP." << std::endl;
     std::cout << "listban, List IP ban list of server." << std::endl;
     std::cout << "speedstats, Show upload and download speed." << std::endl;
+    std::cout << "queuestats, Show depth and latency of the packet send "
+        "queue." << std::endl;
+    std::cout << "commandstats, Show handling time of chat commands."
+        << std::endl;
+    std::cout << "benchcommands file, Time the lookup of each chat command "
+        "in file (one command per line)." << std::endl;
+    std::cout << "importrecords file, Import track records from a records "
+        "file or plain text race log." << std::endl;
+    std::cout << "trace on|off, Start or stop recording a trace of the "
+        "server threads." << std::endl;
+    std::cout << "savetrace file, Save the recorded trace to file (Chrome "
+        "trace format, for chrome://tracing or ui.perfetto.dev)."
+        << std::endl;
     std::cout << "setplayer name, Set permission to player." << std::endl;
     std::cout << "setmoderator name, Set permission to moderator." 
         << std::endl;
@@ -568,6 +585,102 @@ void mainLoop(STKHost* host)
                 "   Download speed (KBps): " <<
                 (float)host->getDownloadSpeed() / 1024.0f  << std::endl;
         }
+        else if (str == "queuestats")
+        {
+            ENetCommandStats stats = host->getENetCommandStats();
+            std::cout << "Queued commands: " << stats.m_queued <<
+                "   Waiting: " << stats.m_depth <<
+                "   Largest batch: " << stats.m_max_batch << std::endl;
+            std::cout << "Latency until sent: average " <<
+                stats.m_average_latency_us << "us, max " <<
+                stats.m_max_latency_us << "us" << std::endl;
+        }
+        else if (str == "commandstats")
+        {
+            auto sl = LobbyProtocol::get<ServerLobby>();
+            if (!sl)
+                continue;
+            auto stats = sl->getServerCommandStats();
+            for (unsigned i = 0; i < stats.size(); i++)
+            {
+                if (stats[i].m_count == 0)
+                    continue;
+                const ServerLobby::ServerCommand* command =
+                    ServerLobby::getServerCommand(
+                    (ServerLobby::ServerCommandType)i);
+                std::cout << (command ? command->m_names : "(unknown)") <<
+                    ": " << stats[i].m_count << " calls, average " <<
+                    stats[i].m_total_us / stats[i].m_count << "us, max " <<
+                    stats[i].m_max_us << "us" << std::endl;
+            }
+        }
+        else if (str == "benchcommands" && !str2.empty())
+        {
+            // Replays a captured command log through the command table
+            std::ifstream file(str2);
+            if (!file.is_open())
+            {
+                std::cout << "Cannot open " << str2 << std::endl;
+                continue;
+            }
+            const unsigned repeat = 1000;
+            std::vector<uint64_t> total_ns(ServerLobby::SC_COUNT, 0);
+            std::vector<unsigned> count(ServerLobby::SC_COUNT, 0);
+            std::string line;
+            while (std::getline(file, line))
+            {
+                if (!line.empty() && line[0] == '/')
+                    line.erase(0, 1);
+                auto argv = StringUtils::split(line, ' ');
+                if (argv.empty())
+                    continue;
+                const ServerLobby::ServerCommand* command = NULL;
+                auto start = std::chrono::steady_clock::now();
+                for (unsigned i = 0; i < repeat; i++)
+                    command = ServerLobby::findServerCommand(argv);
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>
+                    (std::chrono::steady_clock::now() - start).count();
+                const int type =
+                    command ? command->m_type : ServerLobby::SC_UNKNOWN;
+                total_ns[type] += ns / repeat;
+                count[type]++;
+            }
+            for (unsigned i = 0; i < count.size(); i++)
+            {
+                if (count[i] == 0)
+                    continue;
+                const ServerLobby::ServerCommand* command =
+                    ServerLobby::getServerCommand(
+                    (ServerLobby::ServerCommandType)i);
+                std::cout << (command ? command->m_names : "(unknown)") <<
+                    ": " << count[i] << " lines, average " <<
+                    total_ns[i] / count[i] << "ns" << std::endl;
+            }
+        }
+        else if (str == "importrecords" && !str2.empty())
+        {
+            int improved = TrackRecords::get()->importFile(str2);
+            if (improved < 0)
+                std::cout << "Cannot open " << str2 << std::endl;
+            else
+            {
+                std::cout << "Improved " << improved << " records, " <<
+                    TrackRecords::get()->size() << " records in total." <<
+                    std::endl;
+            }
+        }
+        else if (str == "trace" && (str2 == "on" || str2 == "off"))
+        {
+            Tracer::setEnabled(str2 == "on");
+            std::cout << "Tracing is " << str2 << "." << std::endl;
+        }
+        else if (str == "savetrace" && !str2.empty())
+        {
+            if (Tracer::writeChromeTrace(str2))
+                std::cout << "Trace saved to " << str2 << "." << std::endl;
+            else
+                std::cout << "Cannot write " << str2 << std::endl;
+        }
         // MODERATION TOOLKIT
         else if (str == "setplayer")
         {
@@ -26,6 +26,7 @@
 #include "network/stk_peer.hpp"
 #include "utils/log.hpp"
 #include "utils/profiler.hpp"
+#include "utils/tracer.hpp"
 #include "utils/time.hpp"
 #include "utils/vs.hpp"
 
@@ -96,6 +97,7 @@ std::shared_ptr<ProtocolManager> ProtocolManager::createInstance()
                         }
                     }
                     auto gp = GameProtocol::lock();
+                    TRACE_SCOPE("Controller event");
                     if (gp)
                         gp->notifyEventAsynchronous(event_top);
                     delete event_top;
@@ -429,6 +431,7 @@ void ProtocolManager::update(int ticks)
  */
 void ProtocolManager::asynchronousUpdate()
 {
+    TRACE_SCOPE("Asynchronous update");
     PROFILER_PUSH_CPU_MARKER("Message delivery", 255, 0, 0);
     // First deliver asynchronous messages for all protocols
     // =====================================================
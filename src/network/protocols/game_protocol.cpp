@@ -31,7 +31,10 @@
 #include "network/protocol_manager.hpp"
 #include "network/rewind_info.hpp"
 #include "network/rewind_manager.hpp"
+#include "network/rewinder.hpp"
+#include "network/server_config.hpp"
 #include "network/socket_address.hpp"
+#include "network/state_delta.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
 #include "tracks/track.hpp"
@@ -39,6 +42,8 @@
 #include "utils/time.hpp"
 #include "main_loop.hpp"
 
+#include <algorithm>
+
 // ============================================================================
 std::weak_ptr<GameProtocol> GameProtocol::m_game_protocol[PT_COUNT];
 // ============================================================================
@@ -60,9 +65,16 @@ std::shared_ptr<GameProtocol> GameProtocol::createInstance()
 GameProtocol::GameProtocol()
             : Protocol(PROTOCOL_CONTROLLER_EVENTS)
 {
-    m_network_item_manager = static_cast<NetworkItemManager*>
-        (Track::getCurrentTrack()->getItemManager());
+    // There is no track when benchmarking states
+    Track* track = Track::getCurrentTrack();
+    m_network_item_manager = track ?
+        static_cast<NetworkItemManager*>(track->getItemManager()) : NULL;
     m_data_to_send = getNetworkString();
+    m_state_names_size = 0;
+    m_state_count = 0;
+    const auto& caps = NetworkConfig::get()->getServerCapabilities();
+    m_delta_state = NetworkConfig::get()->isClient() &&
+        caps.find("state_delta") != caps.end();
 }   // GameProtocol
 
 //-----------------------------------------------------------------------------
@@ -131,6 +143,8 @@ bool GameProtocol::notifyEventAsynchronous(Event* event)
     {
     case GP_CONTROLLER_ACTION: handleControllerAction(event); break;
     case GP_STATE:             handleState(event);            break;
+    case GP_STATE_DELTA:       handleStateDelta(event);       break;
+    case GP_STATE_ACK:         handleStateAck(event);         break;
     case GP_ITEM_CONFIRMATION: handleItemEventConfirmation(event); break;
     case GP_ADJUST_TIME:
     case GP_ITEM_UPDATE:
@@ -286,20 +300,41 @@ void GameProtocol::startNewState()
 {
     assert(NetworkConfig::get()->isServer());
     m_data_to_send->clear();
+    // There is no world when benchmarking states
+    World* world = World::getWorld();
     m_data_to_send->addUInt8(GP_STATE)
-        .addUInt32(World::getWorld()->getTicksSinceStart());
+        .addUInt32(world ? world->getTicksSinceStart() : 0);
+    m_state_chunks.clear();
 }   // startNewState
 
 // ----------------------------------------------------------------------------
-/** Called by a server to add data to the current state. The data in buffer
- *  is copied, so the data can be freed after this call/.
- *  \param buffer Adds the data in the buffer to the current state.
+/** Called by a server to add the state of a rewinder to the current state.
+ *  The rewinder writes directly into the state buffer after a placeholder
+ *  for its size, which is filled in afterwards.
+ *  \param rewinder The rewinder to save state.
+ *  \param[out] ru The unique identity of rewinder writing to.
+ *  \return Size of the rewinder state, 0 if the rewinder saved no state.
  */
-void GameProtocol::addState(BareNetworkString *buffer)
+unsigned GameProtocol::addState(Rewinder* rewinder,
+                                std::vector<std::string>* ru)
 {
     assert(NetworkConfig::get()->isServer());
-    m_data_to_send->addUInt16(buffer->size());
-    (*m_data_to_send) += *buffer;
+    auto& buffer = m_data_to_send->getBuffer();
+    const unsigned size_offset = (unsigned)buffer.size();
+    m_data_to_send->addUInt16(0);
+    if (!rewinder->saveState(m_data_to_send, ru))
+    {
+        buffer.resize(size_offset);
+        return 0;
+    }
+
+    const unsigned size = (unsigned)buffer.size() - size_offset - 2;
+    assert(size <= 65535);
+    buffer[size_offset] = (size >> 8) & 0xff;
+    buffer[size_offset + 1] = size & 0xff;
+    // Skip protocol type, gp event type and time
+    m_state_chunks.emplace_back(size_offset - 6, size + 2);
+    return size;
 }   // addState
 
 // ----------------------------------------------------------------------------
@@ -315,37 +350,286 @@ void GameProtocol::finalizeState(std::vector<std::string>& cur_rewinder)
         4/*time*/;
 
     m_data_to_send->reset();
-    std::vector<uint8_t> names;
-    names.push_back((uint8_t)cur_rewinder.size());
+    m_state_names.clear();
+    m_state_names.push_back((uint8_t)cur_rewinder.size());
     for (std::string& name : cur_rewinder)
     {
-        names.push_back((uint8_t)name.size());
-        std::vector<uint8_t> rewinder(name.begin(), name.end());
-        names.insert(names.end(), rewinder.begin(), rewinder.end());
+        m_state_names.push_back((uint8_t)name.size());
+        m_state_names.insert(m_state_names.end(), name.begin(), name.end());
     }
-    buffer.insert(pos, names.begin(), names.end());
+    buffer.insert(pos, m_state_names.begin(), m_state_names.end());
+    // Used by getStateForPeer to assemble a state with only some rewinders
+    assert(cur_rewinder.size() == m_state_chunks.size());
+    m_state_names_size = (unsigned)m_state_names.size();
+    m_state_rewinders = cur_rewinder;
 }   // finalizeState
 
+// ----------------------------------------------------------------------------
+/** Returns which rewinders of a state are sent to a peer. Karts too far from
+ *  all karts of the peer (or all karts for spectators) are only needed in one
+ *  out of interval states. Other rewinders are always needed: flyables
+ *  without a state are removed by clients, and the item manager and physical
+ *  objects decide themselves when a state is needed.
+ *  \param rewinders Unique identities of the rewinders in the state.
+ *  \param kart_ids Karts of the peer, empty for spectators.
+ *  \param kart_xyz Position of all karts in world.
+ *  \param max_distance Karts farther than this from all karts of the peer
+ *         are far.
+ *  \param interval Far karts are needed in one out of this many states.
+ *  \param state_count Number of the state, to spread far karts over
+ *         different states.
+ */
+std::vector<bool> GameProtocol::getNeededRewinders(
+                                     const std::vector<std::string>& rewinders,
+                                     const std::set<unsigned>& kart_ids,
+                                     const std::vector<Vec3>& kart_xyz,
+                                     float max_distance, unsigned interval,
+                                     unsigned state_count)
+{
+    const float max_distance2 = max_distance * max_distance;
+    interval = std::max(interval, 1u);
+    std::vector<bool> needed(rewinders.size(), true);
+    for (unsigned i = 0; i < rewinders.size(); i++)
+    {
+        const std::string& name = rewinders[i];
+        if (name.size() != 2 || name[0] != RN_KART)
+            continue;
+        const unsigned kart_id = (uint8_t)name[1];
+        if (kart_id >= kart_xyz.size() ||
+            kart_ids.find(kart_id) != kart_ids.end())
+            continue;
+
+        bool near = false;
+        for (unsigned id : kart_ids)
+        {
+            if (id < kart_xyz.size() &&
+                (kart_xyz[id] - kart_xyz[kart_id]).length2() < max_distance2)
+            {
+                near = true;
+                break;
+            }
+        }
+        // Spread far karts over different states
+        if (near || (state_count + kart_id) % interval == 0)
+            continue;
+        needed[i] = false;
+    }
+    return needed;
+}   // getNeededRewinders
+
+// ----------------------------------------------------------------------------
+/** Returns the state to be sent to a peer, see getNeededRewinders.
+ *  \param peer The peer to send the state to.
+ *  \param full_state State with all rewinders.
+ *  \param kart_xyz Position of all karts in world.
+ *  \return full_state if all rewinders are needed, or a new state.
+ */
+std::shared_ptr<std::vector<uint8_t> > GameProtocol::getStateForPeer(
+                    const STKPeer* peer,
+                    const std::shared_ptr<std::vector<uint8_t> >& full_state,
+                    const std::vector<Vec3>& kart_xyz) const
+{
+    std::vector<bool> needed = getNeededRewinders(m_state_rewinders,
+        peer->getAvailableKartIDs(), kart_xyz,
+        ServerConfig::m_state_interest_distance,
+        (unsigned)std::max((int)ServerConfig::m_state_far_interval, 1),
+        m_state_count);
+    if (std::find(needed.begin(), needed.end(), false) == needed.end())
+        return full_state;
+
+    // Rewinders left out are still listed, with an empty state, so that
+    // clients don't take karts missing from a state as disconnected
+    auto state = std::make_shared<std::vector<uint8_t> >();
+    state->reserve(full_state->size());
+    state->insert(state->end(), full_state->begin(),
+        full_state->begin() + m_state_names_size);
+    for (unsigned i = 0; i < m_state_chunks.size(); i++)
+    {
+        if (!needed[i])
+        {
+            state->push_back(0);
+            state->push_back(0);
+            continue;
+        }
+        auto chunk = full_state->begin() + m_state_names_size +
+            m_state_chunks[i].first;
+        state->insert(state->end(), chunk, chunk + m_state_chunks[i].second);
+    }
+    return state;
+}   // getStateForPeer
+
+// ----------------------------------------------------------------------------
+/** Returns the state confirmed by the peer if it's still kept, which can be
+ *  used as the baseline of a delta state, or NULL if a full state needs to
+ *  be sent.
+ */
+const std::vector<uint8_t>*
+              GameProtocol::getBaseline(const PeerStateHistory& h) const
+{
+    if (h.m_acked_ticks == -1)
+        return NULL;
+    for (auto& sent : h.m_sent_states)
+    {
+        if (sent.first == h.m_acked_ticks)
+            return sent.second.get();
+    }
+    return NULL;
+}   // getBaseline
+
 // ----------------------------------------------------------------------------
 /** Called when the last state information has been added and the message
- *  can be sent to the clients.
+ *  can be sent to the clients. If delta-state is enabled, each peer
+ *  supporting it will receive the state encoded against the latest state
+ *  it confirmed. If state-interest-distance is set, far karts are only
+ *  included in some states for each peer.
  */
 void GameProtocol::sendState()
 {
     assert(NetworkConfig::get()->isServer());
-    sendMessageToPeers(m_data_to_send, /*reliable*/false);
+    m_state_count++;
+    const bool use_interest = ServerConfig::m_state_interest_distance > 0.0f;
+    if (!ServerConfig::m_delta_state && !use_interest)
+    {
+        sendMessageToPeers(m_data_to_send, /*reliable*/false);
+        return;
+    }
+
+    // Skip protocol type, gp event type and time
+    const unsigned header_size = 1 + 1 + 4;
+    auto& buffer = m_data_to_send->getBuffer();
+    auto full_state = std::make_shared<std::vector<uint8_t> >
+        (buffer.begin() + header_size, buffer.end());
+    const int ticks = World::getWorld()->getTicksSinceStart();
+
+    std::vector<Vec3> kart_xyz;
+    if (use_interest)
+    {
+        World* w = World::getWorld();
+        for (unsigned i = 0; i < w->getNumKarts(); i++)
+            kart_xyz.push_back(w->getKart(i)->getXYZ());
+    }
+
+    NetworkString* ns = getNetworkString(m_data_to_send->getTotalSize());
+    std::lock_guard<std::mutex> lock(m_state_history_mutex);
+    auto snapshot = STKHost::get()->getPeerSnapshot();
+    for (auto& peer : snapshot->m_peers)
+    {
+        if (!peer->isValidated() || peer->isWaitingForGame())
+            continue;
+        const auto& caps = peer->getClientCapabilities();
+        std::shared_ptr<std::vector<uint8_t> > state = full_state;
+        if (use_interest && caps.find("partial_state") != caps.end())
+            state = getStateForPeer(peer.get(), full_state, kart_xyz);
+
+        const bool use_delta = ServerConfig::m_delta_state &&
+            caps.find("state_delta") != caps.end();
+        bool sent = false;
+        PeerStateHistory* h = NULL;
+        if (use_delta)
+        {
+            h = &m_peer_state_history[peer];
+            const std::vector<uint8_t>* baseline = getBaseline(*h);
+            if (baseline)
+            {
+                ns->clear();
+                ns->addUInt8(GP_STATE_DELTA).addUInt32(ticks)
+                    .addUInt32(h->m_acked_ticks);
+                StateDelta::encode(*baseline, state->data(), state->size(),
+                    ns);
+                if (ns->getTotalSize() < state->size() + header_size)
+                {
+                    peer->sendPacket(ns, /*reliable*/false);
+                    sent = true;
+                }
+            }
+        }
+        if (!sent)
+        {
+            if (state == full_state)
+                peer->sendPacket(m_data_to_send, /*reliable*/false);
+            else
+            {
+                ns->clear();
+                ns->addUInt8(GP_STATE).addUInt32(ticks);
+                ns->getBuffer().insert(ns->getBuffer().end(), state->begin(),
+                    state->end());
+                peer->sendPacket(ns, /*reliable*/false);
+            }
+        }
+
+        if (h)
+        {
+            h->m_sent_states.emplace_back(ticks, state);
+            while (h->m_sent_states.size() > MAX_SENT_STATES)
+                h->m_sent_states.pop_front();
+        }
+    }
+    delete ns;
+
+    for (auto it = m_peer_state_history.begin();
+         it != m_peer_state_history.end();)
+    {
+        if (it->first.expired())
+            it = m_peer_state_history.erase(it);
+        else
+            it++;
+    }
 }   // sendState
 
 // ----------------------------------------------------------------------------
-/** Called when a new full state is received form the server.
+/** Called by the server when a client confirmed it received a state, which
+ *  will then be used as baseline for the next delta states to that client.
+ *  \param event The data from the client.
  */
-void GameProtocol::handleState(Event *event)
+void GameProtocol::handleStateAck(Event *event)
 {
-    if (!NetworkConfig::get()->isClient())
+    if (!NetworkConfig::get()->isServer() || !checkDataSize(event, 4))
         return;
-    NetworkString &data = event->data();
-    int ticks          = data.getUInt32();
+    int ticks = event->data().getTime();
+    std::lock_guard<std::mutex> lock(m_state_history_mutex);
+    auto it = m_peer_state_history.find(event->getPeerSP());
+    if (it == m_peer_state_history.end() || ticks <= it->second.m_acked_ticks)
+        return;
+
+    PeerStateHistory& h = it->second;
+    auto sent = std::find_if(h.m_sent_states.begin(), h.m_sent_states.end(),
+        [ticks](const std::pair<int, std::shared_ptr<std::vector<uint8_t> > >&
+        p) { return p.first == ticks; });
+    if (sent == h.m_sent_states.end())
+        return;
+    // Older states will never be used as baseline anymore
+    h.m_sent_states.erase(h.m_sent_states.begin(), sent);
+    h.m_acked_ticks = ticks;
+}   // handleStateAck
+
+// ----------------------------------------------------------------------------
+/** Called in client to save a full state received from server, which can be
+ *  used as baseline for later delta states, and confirms it to the server.
+ *  \param ticks Time of the state.
+ *  \param state The state without the gp event type and time.
+ */
+void GameProtocol::saveReceivedState(int ticks, std::vector<uint8_t>&& state)
+{
+    m_received_states[ticks] = std::move(state);
+    while (m_received_states.size() > MAX_RECEIVED_STATES)
+        m_received_states.erase(m_received_states.begin());
 
+    NetworkString *ns = getNetworkString(5);
+    ns->addUInt8(GP_STATE_ACK).addUInt32(ticks);
+    // Unreliable, a lost confirmation only delays using a newer baseline
+    sendToServer(ns, /*reliable*/false);
+    delete ns;
+}   // saveReceivedState
+
+// ----------------------------------------------------------------------------
+/** Reads the list of rewinder using and adds the state to the rewind
+ *  manager.
+ *  \param ticks Time of the state.
+ *  \param data Network string with the state at its current offset, the
+ *         buffer will be taken by the created RewindInfoState.
+ */
+void GameProtocol::addStateRewindInfo(int ticks, BareNetworkString& data)
+{
     // Check for updated rewinder using
     unsigned rewinder_size = data.getUInt8();
     std::vector<std::string> rewinder_using;
@@ -360,8 +644,56 @@ void GameProtocol::handleState(Event *event)
     RewindInfoState* ris = new RewindInfoState(ticks, data.getCurrentOffset(),
         rewinder_using, data.getBuffer());
     RewindManager::get()->addNetworkRewindInfo(ris);
+}   // addStateRewindInfo
+
+// ----------------------------------------------------------------------------
+/** Called when a new full state is received form the server.
+ */
+void GameProtocol::handleState(Event *event)
+{
+    if (!NetworkConfig::get()->isClient())
+        return;
+    NetworkString &data = event->data();
+    int ticks          = data.getUInt32();
+
+    if (m_delta_state)
+    {
+        std::vector<uint8_t> state(data.getCurrentData(),
+            data.getCurrentData() + data.size());
+        saveReceivedState(ticks, std::move(state));
+    }
+    addStateRewindInfo(ticks, data);
 }   // handleState
 
+// ----------------------------------------------------------------------------
+/** Called when a delta state is received form the server, the full state is
+ *  rebuilt from the baseline state confirmed before.
+ */
+void GameProtocol::handleStateDelta(Event *event)
+{
+    if (!NetworkConfig::get()->isClient() || !checkDataSize(event, 8))
+        return;
+    NetworkString &data = event->data();
+    int ticks          = data.getUInt32();
+    int baseline_ticks = data.getUInt32();
+
+    auto it = m_received_states.find(baseline_ticks);
+    if (it == m_received_states.end())
+    {
+        Log::warn("GameProtocol", "Missing baseline %d for delta state %d.",
+            baseline_ticks, ticks);
+        return;
+    }
+    BareNetworkString state;
+    if (!StateDelta::decode(it->second, data, &state.getBuffer()))
+    {
+        Log::warn("GameProtocol", "Invalid delta state %d.", ticks);
+        return;
+    }
+    saveReceivedState(ticks, std::vector<uint8_t>(state.getBuffer()));
+    addStateRewindInfo(ticks, state);
+}   // handleStateDelta
+
 // ----------------------------------------------------------------------------
 /** Called from the RewindManager when rolling back.
  *  \param buffer Pointer to the saved state information.
@@ -400,3 +732,68 @@ void GameProtocol::update(int ticks)
     if (!World::getWorld())
         ProtocolManager::lock()->findAndTerminate(PROTOCOL_CONTROLLER_EVENTS);
 }   // update
+
+// ----------------------------------------------------------------------------
+/** Unit tests for the selection of rewinders in per-peer states: own, near
+ *  and non kart rewinders are always sent, and each far kart exactly once in
+ *  each interval consecutive states.
+ */
+void GameProtocol::unitTesting()
+{
+    std::vector<std::string> rewinders;
+    rewinders.push_back(std::string(1, (char)RN_ITEM_MANAGER));
+    for (unsigned i = 0; i < 5; i++)
+        rewinders.push_back(std::string{ (char)RN_KART, (char)i });
+    rewinders.push_back(std::string{ (char)RN_CAKE, 0, 1 });
+    // Kart 4 has no position, so it is always needed
+    std::vector<Vec3> kart_xyz;
+    kart_xyz.push_back(Vec3(0.0f, 0.0f, 0.0f));
+    kart_xyz.push_back(Vec3(5.0f, 0.0f, 0.0f));
+    kart_xyz.push_back(Vec3(100.0f, 0.0f, 0.0f));
+    kart_xyz.push_back(Vec3(0.0f, 0.0f, 200.0f));
+
+    // A player with kart 0, kart 1 is near, 2 and 3 are far
+    std::set<unsigned> player = { 0 };
+    std::vector<unsigned> far_count(rewinders.size(), 0);
+    for (unsigned count = 0; count < 6; count++)
+    {
+        std::vector<bool> needed = getNeededRewinders(rewinders, player,
+            kart_xyz, 20.0f, 3, count);
+        assert(needed.size() == rewinders.size());
+        assert(needed[0] && needed[1] && needed[2] && needed[5] &&
+            needed[6]);
+        for (unsigned i : { 3, 4 })
+        {
+            // Rewinder i is the kart with id i - 1
+            assert(needed[i] == ((count + i - 1) % 3 == 0));
+            if (needed[i])
+                far_count[i]++;
+        }
+    }
+    assert(far_count[3] == 2 && far_count[4] == 2);
+
+    // Spectators are far from all karts with a position
+    std::set<unsigned> spectator;
+    std::fill(far_count.begin(), far_count.end(), 0);
+    for (unsigned count = 0; count < 3; count++)
+    {
+        std::vector<bool> needed = getNeededRewinders(rewinders, spectator,
+            kart_xyz, 20.0f, 3, count);
+        assert(needed[0] && needed[5] && needed[6]);
+        for (unsigned i = 1; i < 5; i++)
+        {
+            if (needed[i])
+                far_count[i]++;
+        }
+    }
+    for (unsigned i = 1; i < 5; i++)
+        assert(far_count[i] == 1);
+
+    // All rewinders are needed with an interval of 1 (or 0)
+    for (unsigned interval : { 0, 1 })
+    {
+        std::vector<bool> needed = getNeededRewinders(rewinders, spectator,
+            kart_xyz, 20.0f, interval, 1);
+        assert(std::count(needed.begin(), needed.end(), false) == 0);
+    }
+}   // unitTesting
@@ -27,14 +27,21 @@
 #include "utils/stk_process.hpp"
 
 #include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <string>
 #include <vector>
 #include <tuple>
 
 class BareNetworkString;
 class NetworkItemManager;
 class NetworkString;
+class Rewinder;
 class STKPeer;
+class Vec3;
 
 class GameProtocol : public Protocol
                    , public EventRewinder
@@ -49,9 +56,65 @@ private:
            GP_STATE,
            GP_ITEM_UPDATE,
            GP_ITEM_CONFIRMATION,
-           GP_ADJUST_TIME
+           GP_ADJUST_TIME,
+           GP_STATE_DELTA,
+           GP_STATE_ACK
     };
 
+    /** Maximum number of states sent to a peer which are kept as possible
+     *  baseline for delta states, if the peer has not confirmed any of them
+     *  a full state is sent. */
+    static const unsigned MAX_SENT_STATES = 32;
+
+    /** Maximum number of received full states kept in client as baseline
+     *  for delta states, it needs to be larger than MAX_SENT_STATES. */
+    static const unsigned MAX_RECEIVED_STATES = 64;
+
+    /** Server only: states sent to a peer supporting delta states. */
+    struct PeerStateHistory
+    {
+        /** States sent to the peer sorted by ticks. */
+        std::deque<std::pair<int, std::shared_ptr<std::vector<uint8_t> > > >
+            m_sent_states;
+
+        /** Ticks of the latest state confirmed by the peer, which is used as
+         *  the baseline for delta states. */
+        int m_acked_ticks = -1;
+    };
+
+    /** Protects m_peer_state_history, as confirmations are handled in
+     *  the protocol thread. */
+    std::mutex m_state_history_mutex;
+
+    std::map<std::weak_ptr<STKPeer>, PeerStateHistory,
+        std::owner_less<std::weak_ptr<STKPeer> > > m_peer_state_history;
+
+    /** Server only: offset (relative to the first rewinder state before
+     *  finalizeState) and size of each rewinder state in the current state,
+     *  in the same order as m_state_rewinders. */
+    std::vector<std::pair<unsigned, unsigned> > m_state_chunks;
+
+    /** Server only: unique identities of rewinders in the current state. */
+    std::vector<std::string> m_state_rewinders;
+
+    /** Server only: size of the rewinder names written by finalizeState. */
+    unsigned m_state_names_size;
+
+    /** Server only: the rewinder names written by finalizeState, kept to
+     *  avoid allocation for each state. */
+    std::vector<uint8_t> m_state_names;
+
+    /** Server only: number of states sent, used to send far karts only in
+     *  some states. */
+    unsigned m_state_count;
+
+    /** Client only: full states received from server, which can be used as
+     *  baseline for delta states. */
+    std::map<int, std::vector<uint8_t> > m_received_states;
+
+    /** Client only: if the server sends delta states. */
+    bool m_delta_state;
+
     /** A network string that collects all information from the server to be sent
      *  next. */
     NetworkString *m_data_to_send;
@@ -76,6 +139,21 @@ private:
 
     void handleControllerAction(Event *event);
     void handleState(Event *event);
+    void handleStateDelta(Event *event);
+    void handleStateAck(Event *event);
+    void addStateRewindInfo(int ticks, BareNetworkString& data);
+    void saveReceivedState(int ticks, std::vector<uint8_t>&& state);
+    const std::vector<uint8_t>* getBaseline(const PeerStateHistory& h) const;
+    static std::vector<bool> getNeededRewinders(
+                            const std::vector<std::string>& rewinders,
+                            const std::set<unsigned>& kart_ids,
+                            const std::vector<Vec3>& kart_xyz,
+                            float max_distance, unsigned interval,
+                            unsigned state_count);
+    std::shared_ptr<std::vector<uint8_t> > getStateForPeer(
+                    const STKPeer* peer,
+                    const std::shared_ptr<std::vector<uint8_t> >& full_state,
+                    const std::vector<Vec3>& kart_xyz) const;
     void handleAdjustTime(Event *event);
     void handleItemEventConfirmation(Event *event);
     static std::weak_ptr<GameProtocol> m_game_protocol[PT_COUNT];
@@ -112,10 +190,11 @@ public:
     void controllerAction(int kart_id, PlayerAction action,
                           int value, int val_l, int val_r);
     void startNewState();
-    void addState(BareNetworkString *buffer);
+    unsigned addState(Rewinder* rewinder, std::vector<std::string>* ru);
     void sendState();
     void finalizeState(std::vector<std::string>& cur_rewinder);
     void sendItemEventConfirmation(int ticks);
+    static void unitTesting();
 
     virtual void undo(BareNetworkString *buffer) OVERRIDE;
     virtual void rewind(BareNetworkString *buffer) OVERRIDE;
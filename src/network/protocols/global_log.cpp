@@ -1,15 +1,60 @@
 #include "global_log.hpp"
+#include <modes/world.hpp>
 #include <network/server_config.hpp>
 #include <network/network_player_profile.hpp>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <utils/log.hpp>
 #include <utils/string_utils.hpp>
+#include <utils/vs.hpp>
 
 std::ofstream GlobalLog::outfile_posLog;  
 std::ofstream GlobalLog::outfile_goalLog;
 std::map<unsigned int, std::string> GlobalLog::ingame_players;
 
+std::mutex GlobalLog::pending_mutex;
+std::condition_variable GlobalLog::pending_cv;
+std::condition_variable GlobalLog::closed_cv;
+std::vector<GlobalLog::PendingLine> GlobalLog::pending_lines;
+size_t GlobalLog::pending_bytes = 0;
+uint64_t GlobalLog::close_requests = 0;
+uint64_t GlobalLog::closes_done = 0;
+bool GlobalLog::writer_stop = false;
+std::thread GlobalLog::writer_thread;
+
+static std::string jsonString(const std::string& s)
+{
+    std::string result = "\"";
+    for (char c : s)
+    {
+        switch (c)
+        {
+        case '"':  result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n";  break;
+        case '\r': result += "\\r";  break;
+        case '\t': result += "\\t";  break;
+        default:
+            if ((unsigned char)c < 0x20)
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                result += buf;
+            }
+            else
+                result += c;
+        }
+    }
+    result += "\"";
+    return result;
+}
+
+std::ofstream& GlobalLog::getFile(GlobalLogTypes log_name)
+{
+    return log_name == GlobalLogTypes::POS_LOG ? outfile_posLog : outfile_goalLog;
+}
+
 void GlobalLog::openLog(GlobalLogTypes log_name)
 {
     if (log_name == GlobalLogTypes::POS_LOG)
@@ -27,33 +72,151 @@ void GlobalLog::openLog(GlobalLogTypes log_name)
 
 void GlobalLog::writeLog(std::string text, GlobalLogTypes log_name)
 {
-    openLog(log_name);
-    if (log_name == GlobalLogTypes::POS_LOG)
+    queueLine(log_name, std::move(text), false);
+}
+
+void GlobalLog::writeEvent(GlobalLogTypes log_name, const std::string& event,
+                           int world_kart_id, const std::string& text,
+                           const Payload& payload)
+{
+    if (!ServerConfig::m_soccer_log_json)
     {
-        GlobalLog::outfile_posLog << text;
-        GlobalLog::outfile_posLog.flush();
+        writeLog(text, log_name);
+        return;
     }
-    else if (log_name == GlobalLogTypes::GOAL_LOG)
+    World* w = World::getWorld();
+    std::string line = "{\"event\":" + jsonString(event) +
+        ",\"tick\":" + std::to_string(w ? w->getTicksSinceStart() : -1) +
+        ",\"world_kart_id\":" + std::to_string(world_kart_id);
+    if (world_kart_id >= 0)
     {
-        GlobalLog::outfile_goalLog << text;
-        GlobalLog::outfile_goalLog.flush();
-        if (!text.empty()) text.pop_back();
+        auto it = ingame_players.find(world_kart_id);
+        if (it != ingame_players.end())
+            line += ",\"player\":" + jsonString(it->second);
+    }
+    for (auto& p : payload)
+        line += "," + jsonString(p.first) + ":" + jsonString(p.second);
+    line += "}\n";
+    queueLine(log_name, std::move(line), false);
+}
+
+void GlobalLog::queueLine(GlobalLogTypes log_name, std::string text, bool close)
+{
+    std::unique_lock<std::mutex> ul(pending_mutex);
+    if (writer_stop)
+    {
+        // Written directly after the writer thread is stopped
+        std::ofstream& file = getFile(log_name);
+        if (close)
+        {
+            if (file.is_open())
+                file.close();
+            return;
+        }
+        openLog(log_name);
+        file << text;
+        file.flush();
+        return;
+    }
+    if (!writer_thread.joinable())
+        writer_thread = std::thread(&GlobalLog::writerLoop);
+
+    pending_bytes += text.size();
+    PendingLine line = { log_name, std::move(text), close };
+    pending_lines.push_back(std::move(line));
+    if (close || ServerConfig::m_soccer_log_flush_interval <= 0 ||
+        pending_bytes >= (size_t)(int)ServerConfig::m_soccer_log_flush_size)
+        pending_cv.notify_one();
+}
+
+void GlobalLog::writerLoop()
+{
+    VS::setThreadName("GlobalLog");
+    std::unique_lock<std::mutex> ul(pending_mutex);
+    while (true)
+    {
+        const int interval = ServerConfig::m_soccer_log_flush_interval;
+        const size_t flush_size = (int)ServerConfig::m_soccer_log_flush_size;
+        auto ready = [flush_size, interval]()
+            {
+                if (writer_stop || close_requests > closes_done)
+                    return true;
+                if (interval <= 0)
+                    return !pending_lines.empty();
+                return pending_bytes >= flush_size;
+            };
+        if (interval > 0)
+        {
+            pending_cv.wait_for(ul, std::chrono::milliseconds(interval),
+                ready);
+        }
+        else
+            pending_cv.wait(ul, ready);
+
+        std::vector<PendingLine> lines;
+        std::swap(lines, pending_lines);
+        pending_bytes = 0;
+        const bool stop = writer_stop;
+        ul.unlock();
+
+        uint64_t closes = 0;
+        for (PendingLine& line : lines)
+        {
+            std::ofstream& file = getFile(line.log_name);
+            if (line.close)
+            {
+                if (file.is_open())
+                    file.close();
+                closes++;
+                continue;
+            }
+            openLog(line.log_name);
+            file << line.text;
+        }
+        if (outfile_posLog.is_open())
+            outfile_posLog.flush();
+        if (outfile_goalLog.is_open())
+            outfile_goalLog.flush();
+
+        ul.lock();
+        if (closes > 0)
+        {
+            closes_done += closes;
+            closed_cv.notify_all();
+        }
+        if (stop && pending_lines.empty())
+            break;
     }
 }
 
 void GlobalLog::closeLog(GlobalLogTypes log_name)
 {
-    std::string msg = "closeLog called " + (log_name == GlobalLogTypes::POS_LOG) ? "posLog" : "goalLog";
-    if (log_name == GlobalLogTypes::POS_LOG)
+    std::unique_lock<std::mutex> ul(pending_mutex);
+    if (writer_stop || !writer_thread.joinable())
     {
-        if (!GlobalLog::outfile_posLog.is_open()) return;
-        else GlobalLog::outfile_posLog.close();
+        std::ofstream& file = getFile(log_name);
+        if (file.is_open())
+            file.close();
+        return;
     }
-    else if (log_name == GlobalLogTypes::GOAL_LOG)
+    // Wait until the queued lines are written, scripts read the file after
+    // this returns
+    const uint64_t request = ++close_requests;
+    PendingLine line = { log_name, "", true };
+    pending_lines.push_back(std::move(line));
+    pending_cv.notify_one();
+    closed_cv.wait(ul, [request]() { return closes_done >= request; });
+}
+
+void GlobalLog::stopWriter()
+{
     {
-        if (!GlobalLog::outfile_goalLog.is_open()) return;
-        else GlobalLog::outfile_goalLog.close();
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        writer_stop = true;
     }
+    pending_cv.notify_one();
+    if (writer_thread.joinable())
+        writer_thread.join();
 }
 
 void GlobalLog::addIngamePlayer(unsigned int world_kart_id, std::string player_name, bool offline_account)
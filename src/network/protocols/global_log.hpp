@@ -1,17 +1,37 @@
+#include <condition_variable>
+#include <cstdint>
 #include <fstream>
 #include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #ifndef STK_PROTO_LOGGING_GLOBAL_H_
 #define STK_PROTO_LOGGING_GLOBAL_H_
 
 enum class GlobalLogTypes { POS_LOG, GOAL_LOG };
 
+/* Lines are queued and written by a background thread, which flushes the
+ * files after soccer-log-flush-interval milliseconds or when
+ * soccer-log-flush-size bytes are queued. closeLog waits until all queued
+ * lines of the log are written, so the file is complete when it returns. */
 class GlobalLog
 {
     public:
+        typedef std::vector<std::pair<std::string, std::string> > Payload;
+
         static void writeLog(std::string text, GlobalLogTypes log_name);
+        // Writes text in the plain text format, or a JSON line with event
+        // type, tick, world kart id (-1 if none) and payload if soccer-log-json
+        // is enabled.
+        static void writeEvent(GlobalLogTypes log_name, const std::string& event,
+                               int world_kart_id, const std::string& text,
+                               const Payload& payload = Payload());
         static void openLog(GlobalLogTypes log_name);
         static void closeLog(GlobalLogTypes log_name);
+        static void stopWriter();
 
         // Player names are normalized by adding a ? prefix for offline accounts, and replacing spaces by tabulators.
         static void addIngamePlayer(unsigned int world_kart_id, std::string player_name, bool offline_account);
@@ -19,9 +39,31 @@ class GlobalLog
         static std::string getPlayerName(unsigned int world_kart_id);
         static void resetIngamePlayers();
     private:
+        struct PendingLine
+        {
+            GlobalLogTypes log_name;
+            std::string text;
+            // Close the file instead of writing text
+            bool close;
+        };
+
+        static void queueLine(GlobalLogTypes log_name, std::string text, bool close);
+        static void writerLoop();
+        static std::ofstream& getFile(GlobalLogTypes log_name);
+
         static std::ofstream outfile_posLog;
         static std::ofstream outfile_goalLog;
         static std::map<unsigned int, std::string> ingame_players;
+
+        static std::mutex pending_mutex;
+        static std::condition_variable pending_cv;
+        static std::condition_variable closed_cv;
+        static std::vector<PendingLine> pending_lines;
+        static size_t pending_bytes;
+        static uint64_t close_requests;
+        static uint64_t closes_done;
+        static bool writer_stop;
+        static std::thread writer_thread;
 };
 
 #endif /* STK_PROTO_LOGGING_GLOBAL_H_ */
@@ -171,7 +171,8 @@ void LobbyProtocol::configRemoteKart(
 	    std::string team = kart_team == KART_TEAM_RED ? "red" : "blue";
 	    std::string msg =  StringUtils::wideToUtf8(profile->getName()) + " joined the " + team + " team.\n";
 	    std::string empty_msg = " joined the " + team + " team.\n";
-	    if (!(msg == empty_msg)) GlobalLog::writeLog(msg, GlobalLogTypes::POS_LOG);
+	    if (!(msg == empty_msg))
+	        GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "join", i, msg, { { "team", team } });
 	}
     }   // for i in players
     // Clean all previous AI if exists in offline game
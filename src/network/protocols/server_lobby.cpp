@@ -33,9 +33,12 @@
 #include "modes/capture_the_flag.hpp"
 #include "modes/linear_world.hpp"
 #include "modes/soccer_world.hpp"
+#include "network/asset_ids.hpp"
 #include "network/crypto.hpp"
+#include "network/database_worker.hpp"
 #include "network/event.hpp"
 #include "network/game_setup.hpp"
+#include "network/ip_index.hpp"
 #include "network/network.hpp"
 #include "network/network_config.hpp"
 #include "network/network_player_profile.hpp"
@@ -54,6 +57,7 @@
 #include "network/stk_host.hpp"
 #include "network/stk_ipv6.hpp"
 #include "network/stk_peer.hpp"
+#include "network/track_records.hpp"
 #include "online/online_profile.hpp"
 #include "online/request_manager.hpp"
 #include "online/xml_request.hpp"
@@ -66,6 +70,7 @@
 #include "utils/random_generator.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/time.hpp"
+#include "utils/tracer.hpp"
 #include <unordered_map>
 #include <algorithm>
 #include <cassert>
@@ -219,6 +224,42 @@ sqlite3_extension_init(sqlite3* db, char** pzErrMsg,
 }   // sqlite3_extension_init
 */
 
+// ----------------------------------------------------------------------------
+/** Opens the server database with the busy handler and the IPv6 functions
+ *  used by the queries, return NULL if failed.
+ *  \param cache_flag SQLITE_OPEN_SHAREDCACHE or SQLITE_OPEN_PRIVATECACHE.
+ */
+static sqlite3* openDatabase(const std::string& path, int cache_flag)
+{
+    sqlite3* db = NULL;
+    int ret = sqlite3_open_v2(path.c_str(), &db, cache_flag |
+        SQLITE_OPEN_FULLMUTEX | SQLITE_OPEN_READWRITE, NULL);
+    if (ret != SQLITE_OK)
+    {
+        Log::error("ServerLobby", "Cannot open database: %s.",
+            sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return NULL;
+    }
+    sqlite3_busy_handler(db, [](void* data, int retry)
+        {
+            int retry_count = ServerConfig::m_database_timeout / 100;
+            if (retry < retry_count)
+            {
+                sqlite3_sleep(100);
+                // Return non-zero to let caller retry again
+                return 1;
+            }
+            // Return zero to let caller return SQLITE_BUSY immediately
+            return 0;
+        }, NULL);
+    sqlite3_create_function(db, "insideIPv6CIDR", 2, SQLITE_UTF8, NULL,
+        &insideIPv6CIDRSQL, NULL, NULL);
+    sqlite3_create_function(db, "upperIPv6", 1, SQLITE_UTF8, NULL,
+        &upperIPv6SQL, NULL, NULL);
+    return db;
+}   // openDatabase
+
 #endif
 
 /** This is the central game setup protocol running in the server. It is
@@ -288,6 +329,7 @@ ServerLobby::ServerLobby() : LobbyProtocol()
     m_last_unsuccess_poll_time = StkTime::getMonoTimeMs();
     m_server_owner_id.store(-1);
     m_registered_for_once_only = false;
+    memset(m_command_stats, 0, sizeof(m_command_stats));
     setHandleDisconnections(true);
     m_state = SET_PUBLIC_ADDRESS;
     m_save_server_config = true;
@@ -350,37 +392,24 @@ void ServerLobby::initDatabase()
     m_ipv6_geolocation_table_exists = false;
     m_permissions_table_exists = false;
     m_restrictions_table_exists = false;
+    m_db_cache_pending_writes = 0;
     if (!ServerConfig::m_sql_management)
         return;
     const std::string& path = ServerConfig::getConfigDirectory() + "/" +
         ServerConfig::m_database_file.c_str();
-    int ret = sqlite3_open_v2(path.c_str(), &m_db,
-        SQLITE_OPEN_SHAREDCACHE | SQLITE_OPEN_FULLMUTEX |
-        SQLITE_OPEN_READWRITE, NULL);
-    if (ret != SQLITE_OK)
+    m_db = openDatabase(path, SQLITE_OPEN_SHAREDCACHE);
+    if (!m_db)
+        return;
+    // The worker uses a private cache, so it waits in the busy handler
+    // instead of failing with a shared cache table lock
+    sqlite3* worker_db = openDatabase(path, SQLITE_OPEN_PRIVATECACHE);
+    if (!worker_db)
     {
-        Log::error("ServerLobby", "Cannot open database: %s.",
-            sqlite3_errmsg(m_db));
         sqlite3_close(m_db);
         m_db = NULL;
         return;
     }
-    sqlite3_busy_handler(m_db, [](void* data, int retry)
-        {
-            int retry_count = ServerConfig::m_database_timeout / 100;
-            if (retry < retry_count)
-            {
-                sqlite3_sleep(100);
-                // Return non-zero to let caller retry again
-                return 1;
-            }
-            // Return zero to let caller return SQLITE_BUSY immediately
-            return 0;
-        }, NULL);
-    sqlite3_create_function(m_db, "insideIPv6CIDR", 2, SQLITE_UTF8, NULL,
-        &insideIPv6CIDRSQL, NULL, NULL);
-    sqlite3_create_function(m_db, "upperIPv6", 1, SQLITE_UTF8, NULL,
-        &upperIPv6SQL, NULL, NULL);
+    m_db_worker.reset(new DatabaseWorker(worker_db));
     checkTableExists(ServerConfig::m_ip_ban_table, m_ip_ban_table_exists);
     checkTableExists(ServerConfig::m_ipv6_ban_table, m_ipv6_ban_table_exists);
     checkTableExists(ServerConfig::m_online_id_ban_table,
@@ -395,6 +424,20 @@ void ServerLobby::initDatabase()
         m_permissions_table_exists);
     checkTableExists(ServerConfig::m_restrictions_table,
         m_restrictions_table_exists);
+
+    // Ban lists are needed before the first connection, geolocation tables
+    // can be large so they are loaded in the database worker
+    if (m_ip_ban_table_exists)
+    {
+        m_ip_ban_index = IPBanIndex::loadIPv4(m_db,
+            ServerConfig::m_ip_ban_table);
+    }
+    if (m_ipv6_ban_table_exists)
+    {
+        m_ipv6_ban_index = IPBanIndex::loadIPv6(m_db,
+            ServerConfig::m_ipv6_ban_table);
+    }
+    reloadIPIndexes();
 #endif
 }   // initDatabase
 
@@ -615,6 +658,11 @@ void ServerLobby::destroyDatabase()
     auto peers = STKHost::get()->getPeers();
     for (auto& peer : peers)
         writeDisconnectInfoTable(peer.get());
+    // Finish all queued queries before closing
+    m_db_worker.reset();
+    for (auto& p : m_db_statements)
+        sqlite3_finalize(p.second);
+    m_db_statements.clear();
     if (m_db != NULL)
         sqlite3_close(m_db);
 #endif
@@ -628,11 +676,17 @@ void ServerLobby::writeDisconnectInfoTable(STKPeer* peer)
         return;
     std::string query = StringUtils::insertValues(
         "UPDATE %s SET disconnected_time = datetime('now'), "
-        "ping = %d, packet_loss = %d "
-        "WHERE host_id = %u;", m_server_stats_table.c_str(),
-        peer->getAveragePing(), peer->getPacketLoss(),
-        peer->getHostId());
-    easySQLQuery(query);
+        "ping = ?, packet_loss = ? WHERE host_id = ?;",
+        m_server_stats_table.c_str());
+    const int ping = peer->getAveragePing();
+    const int packet_loss = peer->getPacketLoss();
+    const uint32_t host_id = peer->getHostId();
+    asyncSQLQuery(query, [ping, packet_loss, host_id](sqlite3_stmt* stmt)
+        {
+            sqlite3_bind_int(stmt, 1, ping);
+            sqlite3_bind_int(stmt, 2, packet_loss);
+            sqlite3_bind_int64(stmt, 3, host_id);
+        });
 #endif
 }   // writeDisconnectInfoTable
 
@@ -694,8 +748,33 @@ void ServerLobby::updateAddons()
         m_available_kts.first = m_official_kts.first;
     else
         m_available_kts.first = { all_k.begin(), all_k.end() };
+
+    // Give all karts and tracks of the server an asset id, so assets of
+    // peers can be compared with them as bitsets
+    for (unsigned i = 0; i < kart_properties_manager->getNumberOfKarts(); i++)
+        AssetIds::intern(kart_properties_manager->getKartById(i)->getIdent());
+    for (unsigned i = 0; i < track_manager->getNumberOfTracks(); i++)
+        AssetIds::intern(track_manager->getTrack(i)->getIdent());
+    m_official_kart_ids = toAssetIds(m_official_kts.first);
+    m_official_track_ids = toAssetIds(m_official_kts.second);
+    m_addon_kart_ids = toAssetIds(m_addon_kts.first);
+    m_addon_track_ids = toAssetIds(m_addon_kts.second);
+    m_addon_arena_ids = toAssetIds(m_addon_arenas);
+    m_addon_soccer_ids = toAssetIds(m_addon_soccers);
 }   // updateAddons
 
+//-----------------------------------------------------------------------------
+/** Returns the asset ids of karts or tracks, adding the ones which have no
+ *  id yet.
+ */
+DynamicBitset ServerLobby::toAssetIds(const std::set<std::string>& idents)
+{
+    DynamicBitset ids;
+    for (const std::string& ident : idents)
+        ids.set(AssetIds::intern(ident));
+    return ids;
+}   // toAssetIds
+
 //-----------------------------------------------------------------------------
 /** Called whenever server is reset or game mode is changed.
  */
@@ -1245,81 +1324,21 @@ void ServerLobby::pollDatabase()
 
     m_last_poll_db_time = StkTime::getMonoTimeMs();
 
-    if (m_ip_ban_table_exists)
-    {
-        std::string query =
-            "SELECT ip_start, ip_end, reason, description FROM ";
-        query += ServerConfig::m_ip_ban_table;
-        query += " WHERE datetime('now') > datetime(starting_time) AND "
-            "(expired_days is NULL OR datetime"
-            "(starting_time, '+'||expired_days||' days') > datetime('now'));";
-        auto peers = STKHost::get()->getPeers();
-        sqlite3_exec(m_db, query.c_str(),
-            [](void* ptr, int count, char** data, char** columns)
-            {
-                std::vector<std::shared_ptr<STKPeer> >* peers_ptr =
-                    (std::vector<std::shared_ptr<STKPeer> >*)ptr;
-                for (std::shared_ptr<STKPeer>& p : *peers_ptr)
-                {
-                    // IPv4 ban list atm
-                    if (p->isAIPeer() || p->getAddress().isIPv6())
-                        continue;
-
-                    uint32_t ip_start = 0;
-                    uint32_t ip_end = 0;
-                    if (!StringUtils::fromString(data[0], ip_start))
-                        continue;
-                    if (!StringUtils::fromString(data[1], ip_end))
-                        continue;
-                    uint32_t peer_addr = p->getAddress().getIP();
-                    if (ip_start <= peer_addr && ip_end >= peer_addr)
-                    {
-                        Log::info("ServerLobby",
-                            "Kick %s, reason: %s, description: %s",
-                            p->getAddress().toString().c_str(),
-                            data[2], data[3]);
-                        p->kick();
-                    }
-                }
-                return 0;
-            }, &peers, NULL);
-    }
-
-    if (m_ipv6_ban_table_exists)
-    {
-        std::string query =
-            "SELECT ipv6_cidr, reason, description FROM ";
-        query += ServerConfig::m_ipv6_ban_table;
-        query += " WHERE datetime('now') > datetime(starting_time) AND "
-            "(expired_days is NULL OR datetime"
-            "(starting_time, '+'||expired_days||' days') > datetime('now'));";
-        auto peers = STKHost::get()->getPeers();
-        sqlite3_exec(m_db, query.c_str(),
-            [](void* ptr, int count, char** data, char** columns)
-            {
-                std::vector<std::shared_ptr<STKPeer> >* peers_ptr =
-                    (std::vector<std::shared_ptr<STKPeer> >*)ptr;
-                for (std::shared_ptr<STKPeer>& p : *peers_ptr)
-                {
-                    std::string ipv6;
-                    if (p->getAddress().isIPv6())
-                        ipv6 = p->getAddress().toString(false);
-                    // IPv6 ban list atm
-                    if (p->isAIPeer() || ipv6.empty())
-                        continue;
+    // Drop the permission and restriction caches, so changes made by other
+    // tools are used, unless a cached value is not yet written
+    m_db_worker->addCallback([this]()
+        {
+            std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+            if (m_db_cache_pending_writes != 0)
+                return;
+            m_permission_cache.clear();
+            m_restrictions_cache.clear();
+            m_online_id_cache.clear();
+        });
 
-                    char* ipv6_cidr = data[0];
-                    if (insideIPv6CIDR(ipv6_cidr, ipv6.c_str()) == 1)
-                    {
-                        Log::info("ServerLobby",
-                            "Kick %s, reason: %s, description: %s",
-                            ipv6.c_str(), data[1], data[2]);
-                        p->kick();
-                    }
-                }
-                return 0;
-            }, &peers, NULL);
-    }
+    // The ban lists are read in the database worker, peers are checked
+    // against them in the callbacks when the result is ready
+    reloadIPIndexes();
 
     if (m_online_id_ban_table_exists)
     {
@@ -1328,32 +1347,33 @@ void ServerLobby::pollDatabase()
         query += " WHERE datetime('now') > datetime(starting_time) AND "
             "(expired_days is NULL OR datetime"
             "(starting_time, '+'||expired_days||' days') > datetime('now'));";
-        auto peers = STKHost::get()->getPeers();
-        sqlite3_exec(m_db, query.c_str(),
-            [](void* ptr, int count, char** data, char** columns)
+        m_db_worker->addQuery(query, nullptr,
+            [](bool success, const DatabaseWorker::Rows& rows)
             {
-                std::vector<std::shared_ptr<STKPeer> >* peers_ptr =
-                    (std::vector<std::shared_ptr<STKPeer> >*)ptr;
-                for (std::shared_ptr<STKPeer>& p : *peers_ptr)
+                auto snapshot = STKHost::get()->getPeerSnapshot();
+                for (auto& data : rows)
                 {
-                    if (p->isAIPeer()
-                        || p->getPlayerProfiles().empty())
-                        continue;
-
                     uint32_t online_id = 0;
                     if (!StringUtils::fromString(data[0], online_id))
                         continue;
-                    if (online_id == p->getPlayerProfiles()[0]->getOnlineId())
+                    for (const std::shared_ptr<STKPeer>& p : snapshot->m_peers)
                     {
-                        Log::info("ServerLobby",
-                            "Kick %s, reason: %s, description: %s",
-                            p->getAddress().toString().c_str(),
-                            data[1], data[2]);
-                        p->kick();
+                        if (p->isAIPeer()
+                            || p->getPlayerProfiles().empty())
+                            continue;
+
+                        if (online_id ==
+                            p->getPlayerProfiles()[0]->getOnlineId())
+                        {
+                            Log::info("ServerLobby",
+                                "Kick %s, reason: %s, description: %s",
+                                p->getAddress().toString().c_str(),
+                                data[1].c_str(), data[2].c_str());
+                            p->kick();
+                        }
                     }
                 }
-                return 0;
-            }, &peers, NULL);
+            });
     }
 
     if (m_player_reports_table_exists &&
@@ -1365,13 +1385,14 @@ void ServerLobby::pollDatabase()
             "(reported_time, '+%f days') < datetime('now');",
             ServerConfig::m_player_reports_table.c_str(),
             ServerConfig::m_player_reports_expired_days);
-        easySQLQuery(query);
+        asyncSQLQuery(query);
     }
     if (m_server_stats_table.empty())
         return;
 
     std::string query;
-    auto peers = STKHost::get()->getPeers();
+    auto snapshot = STKHost::get()->getPeerSnapshot();
+    const std::vector<std::shared_ptr<STKPeer> >& peers = snapshot->m_peers;
     std::vector<uint32_t> exist_hosts;
     if (!peers.empty())
     {
@@ -1405,9 +1426,124 @@ void ServerLobby::pollDatabase()
         oss << ");";
         query = oss.str();
     }
-    easySQLQuery(query);
+    asyncSQLQuery(query);
 }   // pollDatabase
 
+//-----------------------------------------------------------------------------
+/** Reloads the IP ban and geolocation tables in database worker, then kicks
+ *  peers which are banned by the new ban lists. Geolocation tables are only
+ *  read again if they changed.
+ */
+void ServerLobby::reloadIPIndexes()
+{
+    if (!m_db_worker)
+        return;
+
+    struct Indexes
+    {
+        std::shared_ptr<const IPBanIndex> m_ip_ban;
+        std::shared_ptr<const IPBanIndex> m_ipv6_ban;
+        std::shared_ptr<const GeolocationIndex> m_ip_geolocation;
+        std::shared_ptr<const GeolocationIndex> m_ipv6_geolocation;
+    };
+    std::shared_ptr<Indexes> indexes = std::make_shared<Indexes>();
+    {
+        std::lock_guard<std::mutex> lock(m_ip_index_mutex);
+        indexes->m_ip_geolocation = m_ip_geolocation_index;
+        indexes->m_ipv6_geolocation = m_ipv6_geolocation_index;
+    }
+    const std::string ip_ban_table = m_ip_ban_table_exists ?
+        std::string(ServerConfig::m_ip_ban_table) : "";
+    const std::string ipv6_ban_table = m_ipv6_ban_table_exists ?
+        std::string(ServerConfig::m_ipv6_ban_table) : "";
+    const std::string ip_geolocation_table = m_ip_geolocation_table_exists ?
+        std::string(ServerConfig::m_ip_geolocation_table) : "";
+    const std::string ipv6_geolocation_table =
+        m_ipv6_geolocation_table_exists ?
+        std::string(ServerConfig::m_ipv6_geolocation_table) : "";
+
+    m_db_worker->addTask([indexes, ip_ban_table, ipv6_ban_table,
+        ip_geolocation_table, ipv6_geolocation_table](sqlite3* db)
+        {
+            if (!ip_ban_table.empty())
+                indexes->m_ip_ban = IPBanIndex::loadIPv4(db, ip_ban_table);
+            if (!ipv6_ban_table.empty())
+            {
+                indexes->m_ipv6_ban =
+                    IPBanIndex::loadIPv6(db, ipv6_ban_table);
+            }
+            if (!ip_geolocation_table.empty())
+            {
+                indexes->m_ip_geolocation = GeolocationIndex::load(db,
+                    ip_geolocation_table, indexes->m_ip_geolocation);
+            }
+            if (!ipv6_geolocation_table.empty())
+            {
+                indexes->m_ipv6_geolocation = GeolocationIndex::load(db,
+                    ipv6_geolocation_table, indexes->m_ipv6_geolocation);
+            }
+            return true;
+        },
+        [this, indexes](bool success)
+        {
+            // Keep the previous index if a table failed to load
+            {
+                std::lock_guard<std::mutex> lock(m_ip_index_mutex);
+                if (indexes->m_ip_ban)
+                    m_ip_ban_index = indexes->m_ip_ban;
+                if (indexes->m_ipv6_ban)
+                    m_ipv6_ban_index = indexes->m_ipv6_ban;
+                if (indexes->m_ip_geolocation &&
+                    indexes->m_ip_geolocation != m_ip_geolocation_index)
+                {
+                    m_ip_geolocation_index = indexes->m_ip_geolocation;
+                    Log::info("ServerLobby", "Loaded %d IPv4 geolocation "
+                        "ranges.", (int)m_ip_geolocation_index->size());
+                }
+                if (indexes->m_ipv6_geolocation &&
+                    indexes->m_ipv6_geolocation != m_ipv6_geolocation_index)
+                {
+                    m_ipv6_geolocation_index = indexes->m_ipv6_geolocation;
+                    Log::info("ServerLobby", "Loaded %d IPv6 geolocation "
+                        "ranges.", (int)m_ipv6_geolocation_index->size());
+                }
+            }
+            kickIPBannedPeers();
+        });
+}   // reloadIPIndexes
+
+//-----------------------------------------------------------------------------
+/** Kicks connected peers which are in the IP ban lists. */
+void ServerLobby::kickIPBannedPeers()
+{
+    std::shared_ptr<const IPBanIndex> ip_ban;
+    std::shared_ptr<const IPBanIndex> ipv6_ban;
+    {
+        std::lock_guard<std::mutex> lock(m_ip_index_mutex);
+        ip_ban = m_ip_ban_index;
+        ipv6_ban = m_ipv6_ban_index;
+    }
+    auto snapshot = STKHost::get()->getPeerSnapshot();
+    for (const std::shared_ptr<STKPeer>& p : snapshot->m_peers)
+    {
+        if (p->isAIPeer())
+            continue;
+        const IPBanInfo* ban = NULL;
+        if (!p->getAddress().isIPv6() && ip_ban)
+            ban = ip_ban->findIPv4(p->getAddress().getIP());
+        else if (p->getAddress().isIPv6() && ipv6_ban)
+            ban = ipv6_ban->findIPv6(p->getAddress().toString(false));
+        if (ban)
+        {
+            Log::info("ServerLobby",
+                "Kick %s, reason: %s, description: %s",
+                p->getAddress().toString().c_str(), ban->m_reason.c_str(),
+                ban->m_description.c_str());
+            p->kick();
+        }
+    }
+}   // kickIPBannedPeers
+
 //-----------------------------------------------------------------------------
 /** Run simple query with write lock waiting and optional function, this
  *  function has no callback for the return (if any) by the query.
@@ -1444,6 +1580,90 @@ bool ServerLobby::easySQLQuery(const std::string& query,
     return true;
 }   // easySQLQuery
 
+//-----------------------------------------------------------------------------
+/** Queue a query which does not return rows to the database worker, the
+ *  optional callback is called in lobby thread with true if no error occurs.
+ */
+void ServerLobby::asyncSQLQuery(const std::string& query,
+                   std::function<void(sqlite3_stmt* stmt)> bind_function,
+                   std::function<void(bool)> callback) const
+{
+    if (!m_db_worker)
+    {
+        if (callback)
+            callback(false);
+        return;
+    }
+    m_db_worker->addWrite(query, bind_function, callback);
+}   // asyncSQLQuery
+
+//-----------------------------------------------------------------------------
+/** Run a query synchronously with a prepared statement which is kept for
+ *  the next query with the same text, so values should be bound instead of
+ *  formatted into the text. row_function is called for each result row.
+ *  Return true if no error occurs
+ */
+bool ServerLobby::cachedSQLQuery(const std::string& query,
+                   std::function<void(sqlite3_stmt* stmt)> bind_function,
+                   std::function<void(sqlite3_stmt* stmt)> row_function)
+{
+    if (!m_db)
+        return false;
+    std::lock_guard<std::mutex> lock(m_db_statements_mutex);
+    sqlite3_stmt* stmt = NULL;
+    auto it = m_db_statements.find(query);
+    if (it != m_db_statements.end())
+        stmt = it->second;
+    else
+    {
+        int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
+        if (ret != SQLITE_OK || !stmt)
+        {
+            Log::error("ServerLobby",
+                "Error preparing database for query %s: %s",
+                query.c_str(), sqlite3_errmsg(m_db));
+            sqlite3_finalize(stmt);
+            return false;
+        }
+        m_db_statements[query] = stmt;
+    }
+    if (bind_function)
+        bind_function(stmt);
+    int ret = sqlite3_step(stmt);
+    while (ret == SQLITE_ROW)
+    {
+        if (row_function)
+            row_function(stmt);
+        ret = sqlite3_step(stmt);
+    }
+    if (ret != SQLITE_DONE)
+    {
+        Log::error("ServerLobby", "Error running query %s: %s",
+            query.c_str(), sqlite3_errmsg(m_db));
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ret == SQLITE_DONE;
+}   // cachedSQLQuery
+
+//-----------------------------------------------------------------------------
+/** Queue a write of a value which is already stored in the permission or
+ *  restriction caches, the caches are not cleared until it is written.
+ */
+void ServerLobby::asyncCacheWrite(const std::string& query,
+                   std::function<void(sqlite3_stmt* stmt)> bind_function)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        m_db_cache_pending_writes++;
+    }
+    asyncSQLQuery(query, bind_function, [this](bool written)
+        {
+            std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+            m_db_cache_pending_writes--;
+        });
+}   // asyncCacheWrite
+
 //-----------------------------------------------------------------------------
 /* Write true to result if table name exists in database. */
 void ServerLobby::checkTableExists(const std::string& table, bool& result)
@@ -1491,38 +1711,31 @@ std::string ServerLobby::ip2Country(const SocketAddress& addr) const
     if (!m_db || !m_ip_geolocation_table_exists || addr.isLAN())
         return "";
 
+    {
+        std::lock_guard<std::mutex> lock(m_ip_index_mutex);
+        if (m_ip_geolocation_index)
+            return m_ip_geolocation_index->find(addr.getIP());
+    }
+
+    // Geolocation table is still being loaded by database worker
     std::string cc_code;
     std::string query = StringUtils::insertValues(
         "SELECT country_code FROM %s "
-        "WHERE `ip_start` <= %d AND `ip_end` >= %d "
+        "WHERE `ip_start` <= ?1 AND `ip_end` >= ?1 "
         "ORDER BY `ip_start` DESC LIMIT 1;",
-        ServerConfig::m_ip_geolocation_table.c_str(), addr.getIP(),
-        addr.getIP());
-
-    sqlite3_stmt* stmt = NULL;
-    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
-    if (ret == SQLITE_OK)
-    {
-        ret = sqlite3_step(stmt);
-        if (ret == SQLITE_ROW)
+        ServerConfig::m_ip_geolocation_table.c_str());
+    const uint32_t ip = addr.getIP();
+    const_cast<ServerLobby*>(this)->cachedSQLQuery(query,
+        [ip](sqlite3_stmt* stmt)
         {
-            const char* country_code = (char*)sqlite3_column_text(stmt, 0);
-            cc_code = country_code;
-        }
-        ret = sqlite3_finalize(stmt);
-        if (ret != SQLITE_OK)
+            sqlite3_bind_int64(stmt, 1, ip);
+        },
+        [&cc_code](sqlite3_stmt* stmt)
         {
-            Log::error("ServerLobby",
-                "Error finalize database for query %s: %s",
-                query.c_str(), sqlite3_errmsg(m_db));
-        }
-    }
-    else
-    {
-        Log::error("ServerLobby", "Error preparing database for query %s: %s",
-            query.c_str(), sqlite3_errmsg(m_db));
-        return "";
-    }
+            const char* country_code = (char*)sqlite3_column_text(stmt, 0);
+            if (country_code)
+                cc_code = country_code;
+        });
     return cc_code;
 }   // ip2Country
 
@@ -1532,39 +1745,32 @@ std::string ServerLobby::ipv62Country(const SocketAddress& addr) const
     if (!m_db || !m_ipv6_geolocation_table_exists)
         return "";
 
-    std::string cc_code;
     const std::string& ipv6 = addr.toString(false/*show_port*/);
+    {
+        std::lock_guard<std::mutex> lock(m_ip_index_mutex);
+        if (m_ipv6_geolocation_index)
+            return m_ipv6_geolocation_index->find(upperIPv6(ipv6.c_str()));
+    }
+
+    // Geolocation table is still being loaded by database worker
+    std::string cc_code;
     std::string query = StringUtils::insertValues(
         "SELECT country_code FROM %s "
-        "WHERE `ip_start` <= upperIPv6(\"%s\") AND `ip_end` >= upperIPv6(\"%s\") "
+        "WHERE `ip_start` <= ?1 AND `ip_end` >= ?1 "
         "ORDER BY `ip_start` DESC LIMIT 1;",
-        ServerConfig::m_ipv6_geolocation_table.c_str(), ipv6.c_str(),
-        ipv6.c_str());
-
-    sqlite3_stmt* stmt = NULL;
-    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
-    if (ret == SQLITE_OK)
-    {
-        ret = sqlite3_step(stmt);
-        if (ret == SQLITE_ROW)
+        ServerConfig::m_ipv6_geolocation_table.c_str());
+    const int64_t upper = upperIPv6(ipv6.c_str());
+    const_cast<ServerLobby*>(this)->cachedSQLQuery(query,
+        [upper](sqlite3_stmt* stmt)
         {
-            const char* country_code = (char*)sqlite3_column_text(stmt, 0);
-            cc_code = country_code;
-        }
-        ret = sqlite3_finalize(stmt);
-        if (ret != SQLITE_OK)
+            sqlite3_bind_int64(stmt, 1, upper);
+        },
+        [&cc_code](sqlite3_stmt* stmt)
         {
-            Log::error("ServerLobby",
-                "Error finalize database for query %s: %s",
-                query.c_str(), sqlite3_errmsg(m_db));
-        }
-    }
-    else
-    {
-        Log::error("ServerLobby", "Error preparing database for query %s: %s",
-            query.c_str(), sqlite3_errmsg(m_db));
-        return "";
-    }
+            const char* country_code = (char*)sqlite3_column_text(stmt, 0);
+            if (country_code)
+                cc_code = country_code;
+        });
     return cc_code;
 }   // ipv62Country
 
@@ -1619,8 +1825,16 @@ void ServerLobby::writePlayerReport(Event* event)
             reporter->getAddress().getIP(), reporter_npp->getOnlineId(),
             reporting_peer->getAddress().getIP(), reporting_npp->getOnlineId());
     }
-    bool written = easySQLQuery(query,
-        [reporter_npp, reporting_npp, info](sqlite3_stmt* stmt)
+    // Copy the names now, the bind function is called in database worker
+    const std::string reporter_name =
+        StringUtils::wideToUtf8(reporter_npp->getName());
+    const std::string reporting_name =
+        StringUtils::wideToUtf8(reporting_npp->getName());
+    const std::string info_utf8 = StringUtils::wideToUtf8(info);
+    const core::stringw reporting_wname = reporting_npp->getName();
+    std::weak_ptr<STKPeer> reporter_wp = event->getPeerSP();
+    asyncSQLQuery(query,
+        [reporter_name, reporting_name, info_utf8](sqlite3_stmt* stmt)
         {
             // SQLITE_TRANSIENT to copy string
             if (sqlite3_bind_text(stmt, 1, ServerConfig::m_server_uid.c_str(),
@@ -1629,37 +1843,37 @@ void ServerLobby::writePlayerReport(Event* event)
                 Log::error("easySQLQuery", "Failed to bind %s.",
                     ServerConfig::m_server_uid.c_str());
             }
-            if (sqlite3_bind_text(stmt, 2,
-                StringUtils::wideToUtf8(reporter_npp->getName()).c_str(),
+            if (sqlite3_bind_text(stmt, 2, reporter_name.c_str(),
                 -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
                 Log::error("easySQLQuery", "Failed to bind %s.",
-                    StringUtils::wideToUtf8(reporter_npp->getName()).c_str());
+                    reporter_name.c_str());
             }
-            if (sqlite3_bind_text(stmt, 3,
-                StringUtils::wideToUtf8(info).c_str(),
+            if (sqlite3_bind_text(stmt, 3, info_utf8.c_str(),
                 -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
                 Log::error("easySQLQuery", "Failed to bind %s.",
-                    StringUtils::wideToUtf8(info).c_str());
+                    info_utf8.c_str());
             }
-            if (sqlite3_bind_text(stmt, 4,
-                StringUtils::wideToUtf8(reporting_npp->getName()).c_str(),
+            if (sqlite3_bind_text(stmt, 4, reporting_name.c_str(),
                 -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
                 Log::error("easySQLQuery", "Failed to bind %s.",
-                    StringUtils::wideToUtf8(reporting_npp->getName()).c_str());
+                    reporting_name.c_str());
             }
+        },
+        [this, reporter_wp, reporting_wname](bool written)
+        {
+            auto reporter = reporter_wp.lock();
+            if (!written || !reporter)
+                return;
+            NetworkString* success = getNetworkString();
+            success->setSynchronous(true);
+            success->addUInt8(LE_REPORT_PLAYER).addUInt8(1)
+                .encodeString(reporting_wname);
+            reporter->sendPacket(success, true/*reliable*/);
+            delete success;
         });
-    if (written)
-    {
-        NetworkString* success = getNetworkString();
-        success->setSynchronous(true);
-        success->addUInt8(LE_REPORT_PLAYER).addUInt8(1)
-            .encodeString(reporting_npp->getName());
-        event->getPeer()->sendPacket(success, true/*reliable*/);
-        delete success;
-    }
 #endif
 }   // writePlayerReport
 
@@ -1724,6 +1938,7 @@ void ServerLobby::sendWANListToPeer(std::shared_ptr<STKPeer> peer)
 /** Find out the public IP server or poll STK server asynchronously. */
 void ServerLobby::asynchronousUpdate()
 {
+    TRACE_SCOPE("ServerLobby::asynchronousUpdate");
     if (m_rs_state.load() == RS_ASYNC_RESET)
     {
         resetVotingTime();
@@ -1741,6 +1956,8 @@ void ServerLobby::asynchronousUpdate()
     }
 
 #ifdef ENABLE_SQLITE3
+    if (m_db_worker)
+        m_db_worker->handleCompletions();
     pollDatabase();
 #endif
 
@@ -2105,7 +2322,8 @@ void ServerLobby::asynchronousUpdate()
                 }
                 else
                     log_msg = "Addon: " + winner_vote.m_track_name;
-               	    GlobalLog::writeLog(log_msg + "\n", GlobalLogTypes::POS_LOG);
+               	    GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "addon", -1,
+                        log_msg + "\n", { { "track", winner_vote.m_track_name } });
                     Log::info("AddonLog", log_msg.c_str());
             }
 
@@ -2519,7 +2737,8 @@ void ServerLobby::finishedLoadingLiveJoinClient(Event* event)
             auto kart_team = w->getKartTeam(id);
             std::string team =  kart_team==KART_TEAM_RED ? "red" : "blue";
             msg =  StringUtils::wideToUtf8(rki.getPlayerName()) + " joined the " + team + " team at "+ time + "\n";
-            GlobalLog::writeLog(msg, GlobalLogTypes::POS_LOG);
+            GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "join", id, msg,
+                { { "team", team }, { "time", time } });
             Log::verbose("ServerLobby", "%s", msg.c_str());
 	    }
 	}
@@ -2573,6 +2792,9 @@ void ServerLobby::finishedLoadingLiveJoinClient(Event* event)
  */
 void ServerLobby::update(int ticks)
 {	
+    TRACE_SCOPE("ServerLobby::update");
+    if (ReplayRecorder::get())
+        ReplayRecorder::get()->handleSaveCompletions();
     World* w = World::getWorld();
     bool world_started = m_state.load() >= WAIT_FOR_WORLD_LOADED &&
         m_state.load() <= RACING && m_server_has_loaded_world.load();
@@ -2750,26 +2972,36 @@ void ServerLobby::update(int ticks)
 	        time = std::to_string(w->getTime());
             }
 	    time_msg = "The game ended after " + time + " seconds.\n";
-            GlobalLog::writeLog(time_msg, GlobalLogTypes::POS_LOG);
+            GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "game_duration", -1,
+                time_msg, { { "time", time } });
 	}
         if ((m_replay_requested || RaceManager::get()->isRecordingRace())
                 && World::getWorld() && World::getWorld()->isRacePhase())	
         {
            m_replay_dir = ServerConfig::m_replay_dir;
 
-           ReplayRecorder::get()->save();
-           std::string replay_path = file_manager->getReplayDir() + ReplayRecorder::get()->getReplayFilename();
-           if (file_manager->fileExists(replay_path))
-           {
-               Log::info("ServerLobby", "Replay file verified at: %s", replay_path.c_str());
-               irr::core::stringw msg = "The replay has been successfully recorded and properly saved!";
-               broadcastMessageInGame(msg);
-           }
-           else
-           {
-               Log::error("ServerLobby", "Replay file not found at: %s", replay_path.c_str());
-	       Log::error("ServerLobby", "Failed to save replay"); 
-           }
+           // The file is written in the replay writer thread, the result
+           // is reported by handleSaveCompletions in update()
+           std::weak_ptr<ServerLobby> lobby =
+               std::dynamic_pointer_cast<ServerLobby>(shared_from_this());
+           ReplayRecorder::get()->save([lobby]
+               (bool success, const std::string& replay_path)
+               {
+                   if (!success)
+                   {
+                       Log::error("ServerLobby", "Failed to save replay %s",
+                           replay_path.c_str());
+                       return;
+                   }
+                   Log::info("ServerLobby", "Replay file saved at: %s",
+                       replay_path.c_str());
+                   std::shared_ptr<ServerLobby> sl = lobby.lock();
+                   if (sl)
+                   {
+                       irr::core::stringw msg = "The replay has been successfully recorded and properly saved!";
+                       sl->broadcastMessageInGame(msg);
+                   }
+               });
            // This is no longer required since the replay recording can be turned off with the command /replay off
            // m_replay_requested = false;
            // RaceManager::get()->setRecordRace(false);
@@ -2788,7 +3020,7 @@ void ServerLobby::update(int ticks)
 
         if (ServerConfig::m_soccer_log || ServerConfig::m_race_log)
 	{
-		GlobalLog::writeLog("GAME_END\n", GlobalLogTypes::POS_LOG);
+		GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "game_end", -1, "GAME_END\n");
 		GlobalLog::closeLog(GlobalLogTypes::POS_LOG);
 		// Execute a python script
 		if (ServerConfig::m_race_log)
@@ -3179,6 +3411,8 @@ void ServerLobby::startSelection(const Event *event)
     auto peers = STKHost::get()->getPeers();
     std::set<STKPeer*> always_spectate_peers;
     bool has_peer_plays_game = false;
+    DynamicBitset common_karts, common_tracks;
+    bool has_common_karts = false, has_common_tracks = false;
     for (auto peer : peers)
     {
         if (!peer->isValidated() || peer->isWaitingForGame())
@@ -3191,8 +3425,23 @@ void ServerLobby::startSelection(const Event *event)
                 && peer->getPlayerProfiles()[0]->getPermissionLevel()
                         >= PERM_PLAYER && canRace(peer))
         {
-            peer->eraseServerKarts(m_available_kts.first, karts_erase);
-            peer->eraseServerTracks(m_available_kts.second, tracks_erase);
+            // Only karts and tracks which all players have are kept
+            if (!peer->getAvailableKarts().none())
+            {
+                if (has_common_karts)
+                    common_karts &= peer->getAvailableKarts();
+                else
+                    common_karts = peer->getAvailableKarts();
+                has_common_karts = true;
+            }
+            if (!peer->getAvailableTracks().none())
+            {
+                if (has_common_tracks)
+                    common_tracks &= peer->getAvailableTracks();
+                else
+                    common_tracks = peer->getAvailableTracks();
+                has_common_tracks = true;
+            }
             has_peer_plays_game = true;
         }
         else
@@ -3214,6 +3463,24 @@ void ServerLobby::startSelection(const Event *event)
             }
         }
     }
+    if (has_common_karts)
+    {
+        for (const std::string& server_kart : m_available_kts.first)
+        {
+            int id = AssetIds::find(server_kart);
+            if (id == -1 || !common_karts.test(id))
+                karts_erase.insert(server_kart);
+        }
+    }
+    if (has_common_tracks)
+    {
+        for (const std::string& server_track : m_available_kts.second)
+        {
+            int id = AssetIds::find(server_track);
+            if (id == -1 || !common_tracks.test(id))
+                tracks_erase.insert(server_track);
+        }
+    }
 
     // Disable always spectate peers if no players join the game
     if (!has_peer_plays_game)
@@ -3250,7 +3517,7 @@ void ServerLobby::startSelection(const Event *event)
     
     if (ServerConfig::m_soccer_log || ServerConfig::m_race_log)
     {
-        GlobalLog::writeLog("GAME_START\n", GlobalLogTypes::POS_LOG);
+        GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "game_start", -1, "GAME_START\n");
 	time_t now;
         time(&now);
         char buf[sizeof "2011-10-08T07:07:09Z"];
@@ -3259,7 +3526,8 @@ void ServerLobby::startSelection(const Event *event)
 	for (int i=0;i< sizeof buf - 1 ;i++)
 	    buf2 += buf[i];
 	std::string msg = "Match started at " + buf2 + "\n";
-        GlobalLog::writeLog(msg, GlobalLogTypes::POS_LOG);
+        GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "match_start", -1, msg,
+            { { "date", buf2 } });
     }
 
     // Set late coming player to spectate if too many players
@@ -4190,7 +4458,8 @@ void ServerLobby::clientDisconnected(Event* event)
             {
                 player_name = GlobalLog::getPlayerName(id);
                 msg2 =  player_name + " left the game at " + time + ". \n";
-                GlobalLog::writeLog(msg2, GlobalLogTypes::POS_LOG);
+                GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "leave", id, msg2,
+                    { { "time", time } });
                 GlobalLog::removeIngamePlayer(id);
             }
         }
@@ -4326,6 +4595,8 @@ void ServerLobby::saveIPBanTable(const SocketAddress& addr)
         "VALUES (%u, %u);",
         ServerConfig::m_ip_ban_table.c_str(), addr.getIP(), addr.getIP());
     easySQLQuery(query);
+    // Use the changed table now instead of at the next database poll
+    reloadIPIndexes();
 #endif
 }   // saveIPBanTable
 
@@ -4341,65 +4612,77 @@ void ServerLobby::removeIPBanTable(const SocketAddress& addr)
         "WHERE ip_start = %u AND ip_end = %u;",
         ServerConfig::m_ip_ban_table.c_str(), addr.getIP(), addr.getIP());
     easySQLQuery(query);
+    // Use the changed table now instead of at the next database poll
+    reloadIPIndexes();
 #endif
 }   // removeIPBanTable
 
 //-----------------------------------------------------------------------------
 bool ServerLobby::handleAssets(const NetworkString& ns, STKPeer* peer)
 {
-    std::set<std::string> client_karts, client_tracks;
+    // Karts and tracks unknown to the server have no asset id, only a
+    // limited number of unknown addons is kept for /playerhasaddon. The
+    // exception is the player of a server created by the client, who may
+    // have installed new addons which are added by updateAddons below.
+    const bool intern_all = m_process_type == PT_CHILD &&
+        peer->getHostId() == m_client_server_host_id.load();
+    const unsigned max_unknown_addons = 1024;
+    DynamicBitset client_karts, client_tracks;
+    std::set<std::string> unknown_addons;
+    bool all_unknown_addons = true;
     const unsigned kart_num = ns.getUInt16();
     const unsigned track_num = ns.getUInt16();
-    for (unsigned i = 0; i < kart_num; i++)
-    {
-        std::string kart;
-        ns.decodeString(&kart);
-        client_karts.insert(kart);
+    for (unsigned i = 0; i < kart_num + track_num; i++)
+    {
+        std::string asset;
+        ns.decodeString(&asset);
+        int id = intern_all ? (int)AssetIds::intern(asset) :
+            AssetIds::find(asset);
+        if (id != -1)
+            (i < kart_num ? client_karts : client_tracks).set(id);
+        else if (StringUtils::startsWith(asset, "addon_"))
+        {
+            if (unknown_addons.size() < max_unknown_addons)
+                unknown_addons.insert(asset);
+            else
+                all_unknown_addons = false;
+        }
     }
-    for (unsigned i = 0; i < track_num; i++)
+    if (!all_unknown_addons)
     {
-        std::string track;
-        ns.decodeString(&track);
-        client_tracks.insert(track);
+        Log::info("ServerLobby", "%s has more than %d addons unknown to the "
+            "server, /playerhasaddon doesn't know all of them.",
+            peer->getAddress().toString().c_str(), max_unknown_addons);
     }
 
     // Drop this player if he doesn't have at least 1 kart / track the same
     // as server
-    float okt = 0.0f;
-    float ott = 0.0f;
-    for (auto& client_kart : client_karts)
-    {
-        if (m_official_kts.first.find(client_kart) !=
-            m_official_kts.first.end())
-            okt += 1.0f;
-    }
-    okt = okt / (float)m_official_kts.first.size();
-    for (auto& client_track : client_tracks)
-    {
-        if (m_official_kts.second.find(client_track) !=
-            m_official_kts.second.end())
-            ott += 1.0f;
-    }
-    ott = ott / (float)m_official_kts.second.size();
+    float okt = (float)client_karts.countCommon(m_official_kart_ids) /
+        (float)m_official_kts.first.size();
+    float ott = (float)client_tracks.countCommon(m_official_track_ids) /
+        (float)m_official_kts.second.size();
 
-    std::set<std::string> karts_erase, tracks_erase;
+    bool has_kart = false, has_track = false;
     for (const std::string& server_kart : m_available_kts.first)
     {
-        if (client_karts.find(server_kart) == client_karts.end())
+        int id = AssetIds::find(server_kart);
+        if (id != -1 && client_karts.test(id))
         {
-            karts_erase.insert(server_kart);
+            has_kart = true;
+            break;
         }
     }
     for (const std::string& server_track : m_available_kts.second)
     {
-        if (client_tracks.find(server_track) == client_tracks.end())
+        int id = AssetIds::find(server_track);
+        if (id != -1 && client_tracks.test(id))
         {
-            tracks_erase.insert(server_track);
+            has_track = true;
+            break;
         }
     }
 
-    if (karts_erase.size() == m_available_kts.first.size() ||
-        tracks_erase.size() == m_available_kts.second.size() ||
+    if (!has_kart || !has_track ||
         okt < ServerConfig::m_official_karts_threshold ||
         ott < ServerConfig::m_official_tracks_threshold)
     {
@@ -4416,31 +4699,10 @@ bool ServerLobby::handleAssets(const NetworkString& ns, STKPeer* peer)
     }
 
     std::array<int, AS_TOTAL> addons_scores = {{ -1, -1, -1, -1 }};
-    size_t addon_kart = 0;
-    size_t addon_track = 0;
-    size_t addon_arena = 0;
-    size_t addon_soccer = 0;
-
-    for (auto& kart : m_addon_kts.first)
-    {
-        if (client_karts.find(kart) != client_karts.end())
-            addon_kart++;
-    }
-    for (auto& track : m_addon_kts.second)
-    {
-        if (client_tracks.find(track) != client_tracks.end())
-            addon_track++;
-    }
-    for (auto& arena : m_addon_arenas)
-    {
-        if (client_tracks.find(arena) != client_tracks.end())
-            addon_arena++;
-    }
-    for (auto& soccer : m_addon_soccers)
-    {
-        if (client_tracks.find(soccer) != client_tracks.end())
-            addon_soccer++;
-    }
+    size_t addon_kart = client_karts.countCommon(m_addon_kart_ids);
+    size_t addon_track = client_tracks.countCommon(m_addon_track_ids);
+    size_t addon_arena = client_tracks.countCommon(m_addon_arena_ids);
+    size_t addon_soccer = client_tracks.countCommon(m_addon_soccer_ids);
 
     if (!m_addon_kts.first.empty())
     {
@@ -4466,6 +4728,7 @@ bool ServerLobby::handleAssets(const NetworkString& ns, STKPeer* peer)
     // Save available karts and tracks from clients in STKPeer so if this peer
     // disconnects later in lobby it won't affect current players
     peer->setAvailableKartsTracks(client_karts, client_tracks);
+    peer->setUnknownAddons(unknown_addons, all_unknown_addons);
     peer->setAddonsScores(addons_scores);
 
     if (m_process_type == PT_CHILD &&
@@ -4541,20 +4804,53 @@ void ServerLobby::connectionRequested(Event* event)
     encrypted_size = data.getUInt32();
 
     // Will be disconnected if banned by IP
-    testBannedForIP(peer.get());
+    testBannedForIP(peer);
     if (peer->isDisconnected())
         return;
 
-    testBannedForIPv6(peer.get());
+    testBannedForIPv6(peer);
     if (peer->isDisconnected())
         return;
 
+    // Will be disconnected if banned by online id, the ban table is checked
+    // in database worker so the rest of the request is handled after its
+    // result
     if (online_id != 0)
-        testBannedForOnlineId(peer.get(), online_id);
-    // Will be disconnected if banned by online id
-    if (peer->isDisconnected())
+        testBannedForOnlineId(peer, online_id);
+
+#ifdef ENABLE_SQLITE3
+    if (m_db_worker)
+    {
+        std::weak_ptr<STKPeer> peer_wp = peer;
+        std::shared_ptr<BareNetworkString> remaining =
+            std::make_shared<BareNetworkString>(data.getCurrentData(),
+            data.size());
+        m_db_worker->addCallback([this, peer_wp, remaining, player_count,
+            online_id, encrypted_size]()
+            {
+                auto peer = peer_wp.lock();
+                if (!peer || peer->isDisconnected())
+                    return;
+                handleBanTestedConnection(peer, *remaining, player_count,
+                    online_id, encrypted_size);
+            });
         return;
+    }
+#endif
+    handleBanTestedConnection(peer, data, player_count, online_id,
+        encrypted_size);
+}   // connectionRequested
 
+//-----------------------------------------------------------------------------
+/** Handles the rest of a connection request after the peer has been tested
+ *  for bans.
+ */
+void ServerLobby::handleBanTestedConnection(std::shared_ptr<STKPeer> peer,
+                                            BareNetworkString& data,
+                                            unsigned player_count,
+                                            uint32_t online_id,
+                                            uint32_t encrypted_size)
+{
     unsigned total_players = 0;
     STKHost::get()->updatePlayers(NULL, NULL, &total_players);
     if (total_players + player_count + m_ai_profiles.size() >
@@ -4616,7 +4912,7 @@ void ServerLobby::connectionRequested(Event* event)
         handleUnencryptedConnection(peer, data, online_id, online_name,
             false/*is_pending_connection*/);
     }
-}   // connectionRequested
+}   // handleBanTestedConnection
 
 //-----------------------------------------------------------------------------
 void ServerLobby::handleUnencryptedConnection(std::shared_ptr<STKPeer> peer,
@@ -4909,15 +5205,24 @@ void ServerLobby::handleUnencryptedConnection(std::shared_ptr<STKPeer> peer,
             peer->getAddress().getIP(), peer->getAddress().getPort(),
             online_id, player_count, peer->getAveragePing());
     }
-    easySQLQuery(query, [peer, country_code](sqlite3_stmt* stmt)
+    // Copy everything bound now, the bind function is called in database
+    // worker
+    const std::string username =
+        StringUtils::wideToUtf8(peer->getPlayerProfiles()[0]->getName());
+    const auto version_os =
+        StringUtils::extractVersionOS(peer->getUserVersion());
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        m_online_id_cache[username] = online_id;
+    }
+    asyncSQLQuery(query, [username, country_code, version_os]
+        (sqlite3_stmt* stmt)
         {
-            if (sqlite3_bind_text(stmt, 1, StringUtils::wideToUtf8(
-                peer->getPlayerProfiles()[0]->getName()).c_str(),
+            if (sqlite3_bind_text(stmt, 1, username.c_str(),
                 -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
                 Log::error("easySQLQuery", "Failed to bind %s.",
-                    StringUtils::wideToUtf8(
-                    peer->getPlayerProfiles()[0]->getName()).c_str());
+                    username.c_str());
             }
             if (country_code.empty())
             {
@@ -4936,8 +5241,6 @@ void ServerLobby::handleUnencryptedConnection(std::shared_ptr<STKPeer> peer,
                         country_code.c_str());
                 }
             }
-            auto version_os =
-                StringUtils::extractVersionOS(peer->getUserVersion());
             if (sqlite3_bind_text(stmt, 3, version_os.first.c_str(),
                 -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
@@ -5792,20 +6095,9 @@ void ServerLobby::configPeersStartTime()
 			    Log::info("ServerLobby", "%s", log_msg.c_str());
 		    }
 	    }
-	    try
-	    {
-		    std::string python_output = ServerLobby::exec_python_script();
-		    python_output.erase(std::remove(python_output.begin(), python_output.end(), '\n'), python_output.end());
-		    Log::info("ServerLobby", "%s", python_output.c_str());
-		    if (python_output.length() > 2)
-		    {
-			    broadcastMessageInGame(StringUtils::utf8ToWide(python_output));
-		    }
-	    }
-	    catch (const std::exception& e)
-	    {
-		    Log::error("ServerLobby", "Python script execution failed: %s", e.what());
-	    }
+	    std::string record_msg = getTrackRecordMessage();
+	    Log::info("ServerLobby", "%s", record_msg.c_str());
+	    broadcastMessageInGame(StringUtils::utf8ToWide(record_msg));
     }
     if (m_replay_requested && ServerConfig::m_is_world_record_race)
     {
@@ -5922,7 +6214,7 @@ void ServerLobby::resetServer()
 }   // resetServer
 
 //-----------------------------------------------------------------------------
-void ServerLobby::testBannedForIP(STKPeer* peer) const
+void ServerLobby::testBannedForIP(std::shared_ptr<STKPeer> peer) const
 {
 #ifdef ENABLE_SQLITE3
     if (!m_db || !m_ip_ban_table_exists)
@@ -5932,64 +6224,40 @@ void ServerLobby::testBannedForIP(STKPeer* peer) const
     if (peer->getAddress().isIPv6())
         return;
 
-    int row_id = -1;
-    unsigned ip_start = 0;
-    unsigned ip_end = 0;
-    std::string query = StringUtils::insertValues(
-        "SELECT rowid, ip_start, ip_end, reason, description FROM %s "
-        "WHERE ip_start <= %u AND ip_end >= %u "
-        "AND datetime('now') > datetime(starting_time) AND "
-        "(expired_days is NULL OR datetime"
-        "(starting_time, '+'||expired_days||' days') > datetime('now')) "
-        "LIMIT 1;",
-        ServerConfig::m_ip_ban_table.c_str(),
-        peer->getAddress().getIP(), peer->getAddress().getIP());
-
-    sqlite3_stmt* stmt = NULL;
-    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
-    if (ret == SQLITE_OK)
+    std::shared_ptr<const IPBanIndex> index;
     {
-        ret = sqlite3_step(stmt);
-        if (ret == SQLITE_ROW)
-        {
-            row_id = sqlite3_column_int(stmt, 0);
-            ip_start = (unsigned)sqlite3_column_int64(stmt, 1);
-            ip_end = (unsigned)sqlite3_column_int64(stmt, 2);
-            const char* reason = (char*)sqlite3_column_text(stmt, 3);
-            const char* desc = (char*)sqlite3_column_text(stmt, 4);
-            Log::info("ServerLobby", "%s banned by IP: %s "
-                "(rowid: %d, description: %s).",
-                peer->getAddress().toString().c_str(), reason, row_id, desc);
-            kickPlayerWithReason(peer, reason);
-        }
-        ret = sqlite3_finalize(stmt);
-        if (ret != SQLITE_OK)
-        {
-            Log::error("ServerLobby",
-                "Error finalize database for query %s: %s",
-                query.c_str(), sqlite3_errmsg(m_db));
-        }
+        std::lock_guard<std::mutex> lock(m_ip_index_mutex);
+        index = m_ip_ban_index;
     }
-    else
-    {
-        Log::error("ServerLobby", "Error preparing database for query %s: %s",
-            query.c_str(), sqlite3_errmsg(m_db));
+    if (!index)
         return;
-    }
-    if (row_id != -1)
-    {
-        query = StringUtils::insertValues(
-            "UPDATE %s SET trigger_count = trigger_count + 1, "
-            "last_trigger = datetime('now') "
-            "WHERE ip_start = %u AND ip_end = %u;",
-            ServerConfig::m_ip_ban_table.c_str(), ip_start, ip_end);
-        easySQLQuery(query);
-    }
+    const IPBanInfo* ban = index->findIPv4(peer->getAddress().getIP());
+    if (!ban)
+        return;
+
+    Log::info("ServerLobby", "%s banned by IP: %s "
+        "(rowid: %d, description: %s).",
+        peer->getAddress().toString().c_str(), ban->m_reason.c_str(),
+        (int)ban->m_rowid, ban->m_description.c_str());
+    kickPlayerWithReason(peer.get(), ban->m_reason.c_str());
+
+    const int64_t ip_start = ban->m_ip_start;
+    const int64_t ip_end = ban->m_ip_end;
+    std::string query = StringUtils::insertValues(
+        "UPDATE %s SET trigger_count = trigger_count + 1, "
+        "last_trigger = datetime('now') "
+        "WHERE ip_start = ? AND ip_end = ?;",
+        ServerConfig::m_ip_ban_table.c_str());
+    asyncSQLQuery(query, [ip_start, ip_end](sqlite3_stmt* stmt)
+        {
+            sqlite3_bind_int64(stmt, 1, ip_start);
+            sqlite3_bind_int64(stmt, 2, ip_end);
+        });
 #endif
 }   // testBannedForIP
 
 //-----------------------------------------------------------------------------
-void ServerLobby::testBannedForIPv6(STKPeer* peer) const
+void ServerLobby::testBannedForIPv6(std::shared_ptr<STKPeer> peer) const
 {
 #ifdef ENABLE_SQLITE3
     if (!m_db || !m_ipv6_ban_table_exists)
@@ -5999,130 +6267,86 @@ void ServerLobby::testBannedForIPv6(STKPeer* peer) const
     if (!peer->getAddress().isIPv6())
         return;
 
-    int row_id = -1;
-    std::string ipv6_cidr;
-    std::string query = StringUtils::insertValues(
-        "SELECT rowid, ipv6_cidr, reason, description FROM %s "
-        "WHERE insideIPv6CIDR(ipv6_cidr, ?) = 1 "
-        "AND datetime('now') > datetime(starting_time) AND "
-        "(expired_days is NULL OR datetime"
-        "(starting_time, '+'||expired_days||' days') > datetime('now')) "
-        "LIMIT 1;",
-        ServerConfig::m_ipv6_ban_table.c_str());
-
-    sqlite3_stmt* stmt = NULL;
-    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
-    if (ret == SQLITE_OK)
+    std::shared_ptr<const IPBanIndex> index;
     {
-        if (sqlite3_bind_text(stmt, 1,
-            peer->getAddress().toString(false).c_str(), -1, SQLITE_TRANSIENT)
-            != SQLITE_OK)
-        {
-            Log::error("ServerLobby", "Error binding ipv6 addr for query: %s",
-                sqlite3_errmsg(m_db));
-        }
-
-        ret = sqlite3_step(stmt);
-        if (ret == SQLITE_ROW)
-        {
-            row_id = sqlite3_column_int(stmt, 0);
-            ipv6_cidr = (char*)sqlite3_column_text(stmt, 1);
-            const char* reason = (char*)sqlite3_column_text(stmt, 2);
-            const char* desc = (char*)sqlite3_column_text(stmt, 3);
-            Log::info("ServerLobby", "%s banned by IP: %s "
-                "(rowid: %d, description: %s).",
-                peer->getAddress().toString().c_str(), reason, row_id, desc);
-            kickPlayerWithReason(peer, reason);
-        }
-        ret = sqlite3_finalize(stmt);
-        if (ret != SQLITE_OK)
-        {
-            Log::error("ServerLobby",
-                "Error finalize database for query %s: %s",
-                query.c_str(), sqlite3_errmsg(m_db));
-        }
+        std::lock_guard<std::mutex> lock(m_ip_index_mutex);
+        index = m_ipv6_ban_index;
     }
-    else
-    {
-        Log::error("ServerLobby", "Error preparing database for query %s: %s",
-            query.c_str(), sqlite3_errmsg(m_db));
+    if (!index)
         return;
-    }
-    if (row_id != -1)
-    {
-        query = StringUtils::insertValues(
-            "UPDATE %s SET trigger_count = trigger_count + 1, "
-            "last_trigger = datetime('now') "
-            "WHERE ipv6_cidr = ?;", ServerConfig::m_ipv6_ban_table.c_str());
-        easySQLQuery(query, [ipv6_cidr](sqlite3_stmt* stmt)
+    const IPBanInfo* ban =
+        index->findIPv6(peer->getAddress().toString(false));
+    if (!ban)
+        return;
+
+    Log::info("ServerLobby", "%s banned by IP: %s "
+        "(rowid: %d, description: %s).",
+        peer->getAddress().toString().c_str(), ban->m_reason.c_str(),
+        (int)ban->m_rowid, ban->m_description.c_str());
+    kickPlayerWithReason(peer.get(), ban->m_reason.c_str());
+
+    const std::string ipv6_cidr = ban->m_ipv6_cidr;
+    std::string query = StringUtils::insertValues(
+        "UPDATE %s SET trigger_count = trigger_count + 1, "
+        "last_trigger = datetime('now') "
+        "WHERE ipv6_cidr = ?;", ServerConfig::m_ipv6_ban_table.c_str());
+    asyncSQLQuery(query, [ipv6_cidr](sqlite3_stmt* stmt)
+        {
+            if (sqlite3_bind_text(stmt, 1, ipv6_cidr.c_str(),
+                -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
-                if (sqlite3_bind_text(stmt, 1, ipv6_cidr.c_str(),
-                    -1, SQLITE_TRANSIENT) != SQLITE_OK)
-                {
-                    Log::error("easySQLQuery", "Failed to bind %s.",
-                        ipv6_cidr.c_str());
-                }
-            });
-    }
+                Log::error("easySQLQuery", "Failed to bind %s.",
+                    ipv6_cidr.c_str());
+            }
+        });
 #endif
 }   // testBannedForIPv6
 
 //-----------------------------------------------------------------------------
-void ServerLobby::testBannedForOnlineId(STKPeer* peer,
+void ServerLobby::testBannedForOnlineId(std::shared_ptr<STKPeer> peer,
                                         uint32_t online_id) const
 {
 #ifdef ENABLE_SQLITE3
     if (!m_db || !m_online_id_ban_table_exists)
         return;
 
-    int row_id = -1;
     std::string query = StringUtils::insertValues(
         "SELECT rowid, reason, description FROM %s "
-        "WHERE online_id = %u "
+        "WHERE online_id = ? "
         "AND datetime('now') > datetime(starting_time) AND "
         "(expired_days is NULL OR datetime"
         "(starting_time, '+'||expired_days||' days') > datetime('now')) "
         "LIMIT 1;",
-        ServerConfig::m_online_id_ban_table.c_str(), online_id);
+        ServerConfig::m_online_id_ban_table.c_str());
 
-    sqlite3_stmt* stmt = NULL;
-    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
-    if (ret == SQLITE_OK)
-    {
-        ret = sqlite3_step(stmt);
-        if (ret == SQLITE_ROW)
+    std::weak_ptr<STKPeer> peer_wp = peer;
+    m_db_worker->addQuery(query, [online_id](sqlite3_stmt* stmt)
         {
-            row_id = sqlite3_column_int(stmt, 0);
-            const char* reason = (char*)sqlite3_column_text(stmt, 1);
-            const char* desc = (char*)sqlite3_column_text(stmt, 2);
-            Log::info("ServerLobby", "%s banned by online id: %s "
-                "(online id: %u rowid: %d, description: %s).",
-                peer->getAddress().toString().c_str(), reason, online_id,
-                row_id, desc);
-            kickPlayerWithReason(peer, reason);
-        }
-        ret = sqlite3_finalize(stmt);
-        if (ret != SQLITE_OK)
+            sqlite3_bind_int64(stmt, 1, online_id);
+        },
+        [this, peer_wp, online_id]
+        (bool success, const DatabaseWorker::Rows& rows)
         {
-            Log::error("ServerLobby", "Error finalize database: %s",
-                sqlite3_errmsg(m_db));
-        }
-    }
-    else
-    {
-        Log::error("ServerLobby", "Error preparing database: %s",
-            sqlite3_errmsg(m_db));
-        return;
-    }
-    if (row_id != -1)
-    {
-        query = StringUtils::insertValues(
-            "UPDATE %s SET trigger_count = trigger_count + 1, "
-            "last_trigger = datetime('now') "
-            "WHERE online_id = %u;",
-            ServerConfig::m_online_id_ban_table.c_str(), online_id);
-        easySQLQuery(query);
-    }
+            auto peer = peer_wp.lock();
+            if (rows.empty() || !peer)
+                return;
+            const std::vector<std::string>& row = rows[0];
+            Log::info("ServerLobby", "%s banned by online id: %s "
+                "(online id: %u rowid: %s, description: %s).",
+                peer->getAddress().toString().c_str(), row[1].c_str(),
+                online_id, row[0].c_str(), row[2].c_str());
+            kickPlayerWithReason(peer.get(), row[1].c_str());
+
+            std::string query = StringUtils::insertValues(
+                "UPDATE %s SET trigger_count = trigger_count + 1, "
+                "last_trigger = datetime('now') "
+                "WHERE online_id = ?;",
+                ServerConfig::m_online_id_ban_table.c_str());
+            asyncSQLQuery(query, [online_id](sqlite3_stmt* stmt)
+                {
+                    sqlite3_bind_int64(stmt, 1, online_id);
+                });
+        });
 #endif
 }   // testBannedForOnlineId
 
@@ -6276,18 +6500,18 @@ void ServerLobby::updateServerConfiguration(int new_difficulty,
     auto peers = STKHost::get()->getPeers();
     for (auto& peer : peers)
     {
-        auto assets = peer->getClientAssets();
-        if (!peer->isValidated() || assets.second.empty())
+        if (!peer->isValidated() || peer->getAvailableTracks().none())
             continue;
-        std::set<std::string> tracks_erase;
+        bool has_track = false;
         for (const std::string& server_track : m_available_kts.second)
         {
-            if (assets.second.find(server_track) == assets.second.end())
+            if (peer->hasTrack(server_track))
             {
-                tracks_erase.insert(server_track);
+                has_track = true;
+                break;
             }
         }
-        if (tracks_erase.size() == m_available_kts.second.size())
+        if (!has_track)
         {
             NetworkString *message = getNetworkString(2);
             message->setSynchronous(true);
@@ -7007,17 +7231,45 @@ void ServerLobby::handleServerCommand(Event* event,
         noVeto = true;
     }
 
-    unsigned int argv0_number;
-    std::stringstream argv0_ss;
-    argv0_ss << argv[0];
-    argv0_ss >> argv0_number;
+    if (isPoleEnabled() && argv.size() == 1)
+    {
+        unsigned int argv0_number;
+        std::stringstream argv0_ss;
+        argv0_ss << argv[0];
+        argv0_ss >> argv0_number;
+        if (!argv0_ss.fail())
+        {
+            // command is a number, /1 /2 /3 ... and pole is enabled
+            submitPoleVote(peer, argv0_number);
+            return;
+        }
+    }
 
-    if (isPoleEnabled() && argv.size() == 1 && !argv0_ss.fail())
+    const ServerCommand* command = findServerCommand(argv);
+    if (noVeto && command && !command->m_votable)
     {
-        // command is a number, /1 /2 /3 ... and pole is enabled
-        submitPoleVote(peer, argv0_number);
+        std::string msg = "This command cannot be voted for.";
+        sendStringToPeer(msg, peer);
+        return;
     }
-    else if (argv[0] == "spectate" || argv[0] == "s" || argv[0] == "sp" || argv[0] == "spec" || argv[0] == "spect")
+
+    // Handling time is recorded on every return of the command handler
+    struct CommandTimer
+    {
+        ServerLobby* m_lobby;
+        ServerCommandType m_type;
+        uint64_t m_start;
+        ~CommandTimer()
+        {
+            m_lobby->addServerCommandTime(m_type,
+                StkTime::getMonoTimeUs() - m_start);
+        }
+    } timer = { this, command ? command->m_type : SC_UNKNOWN,
+        StkTime::getMonoTimeUs() };
+
+    switch (timer.m_type)
+    {
+    case SC_SPECTATE:
     {
         if (m_game_setup->isGrandPrix() || !ServerConfig::m_live_players)
         {
@@ -7048,8 +7300,9 @@ void ServerLobby::handleServerCommand(Event* event,
         else
             peer->setAlwaysSpectate(ASM_NONE);
         updatePlayerList();
+        break;
     }
-    else if (argv[0] == "addtime" || argv[0] == "addt")
+    case SC_ADDTIME:
     {
         std::string msg;
         int amount_sec = 0;
@@ -7081,8 +7334,9 @@ void ServerLobby::handleServerCommand(Event* event,
         }
         changeTimeout(amount_sec, false, false);
 	sendRandomInstalladdonLine(peer);
+        break;
     }
-    else if (argv[0] == "score" || argv[0] == "sc")
+    case SC_SCORE:
     {
         if (m_state.load() != RACING)
         {
@@ -7096,9 +7350,10 @@ void ServerLobby::handleServerCommand(Event* event,
         const int blue_score = sw->getScore(KART_TEAM_BLUE);
         std::string msg = "\U0001f7e5 Red " + std::to_string(red_score)+ " : " + std::to_string(blue_score) + " Blue \U0001f7e6";
         sendStringToPeer(msg, peer);
+        break;
     }
 
-    else if (argv[0] == "teamchat" || argv[0] == "tc" || argv[0] == "tchat")
+    case SC_TEAMCHAT:
     {
 
         std::string message;
@@ -7113,10 +7368,11 @@ void ServerLobby::handleServerCommand(Event* event,
             message = "Your messages are now addressed to team only";
         }
         sendStringToPeer(message, peer);
+        break;
     }
 
-    else if (argv[0] == "to" || argv[0] == "msg" || argv[0] == "dm" || argv[0] == "pm")
-    {       
+    case SC_TO:
+    {
         if (!peer->hasPlayerProfiles())
             return;
 
@@ -7188,9 +7444,10 @@ void ServerLobby::handleServerCommand(Event* event,
         target->sendPacket(recipientMsg, true/*reliable*/);
         delete senderMsg;
         delete recipientMsg;
+        break;
     }
 
-    else if (argv[0] == "slots" || argv[0] == "sl")
+    case SC_SLOTS:
     {
 	if (argv[0] == "sl")
         {
@@ -7244,9 +7501,10 @@ void ServerLobby::handleServerCommand(Event* event,
             m_max_players_in_game = limit;
             setMaxPlayersInGame(limit, true);
         }
+        break;
     }
 #if 0
-    else if (argv[0] == "powerupper-on")
+    case SC_POWERUPPER_ON:
     {
 	if (!(m_allow_powerupper)) return;
 	if (m_server_owner.lock() != peer)
@@ -7256,9 +7514,10 @@ void ServerLobby::handleServerCommand(Event* event,
 	m_powerupper_active = true;
         std::string message = "The powerupper is now on.";
         sendStringToAllPeers(message);
+        break;
     }
 
-    else if (argv[0] == "powerupper-off")
+    case SC_POWERUPPER_OFF:
     {
 	if (!(m_allow_powerupper)) return;
 	if (m_server_owner.lock() != peer)
@@ -7268,10 +7527,11 @@ void ServerLobby::handleServerCommand(Event* event,
 	m_powerupper_active = false;
         std::string message = "The powerupper is now off.";
         sendStringToAllPeers(message);
+        break;
     }
 #endif
     
-    else if (argv[0] == "public" || argv[0] == "pub" || argv[0] == "all")
+    case SC_PUBLIC:
     {
         std::string s;
         //m_message_receivers[peer.get()].clear();
@@ -7286,9 +7546,10 @@ void ServerLobby::handleServerCommand(Event* event,
             s = "Your messages are now public";
         }
         sendStringToPeer(s, peer);
+        break;
     }
 
-    else if (argv[0] == "listserveraddon" || argv[0] == "lsa")
+    case SC_LISTSERVERADDON:
     {
         if (player->getPermissionLevel() <= PERM_NONE)
         {
@@ -7369,8 +7630,9 @@ void ServerLobby::handleServerCommand(Event* event,
         }
         peer->sendPacket(chat, true/*reliable*/);
         delete chat;
+        break;
     }
-    else if (argv[0] == "playerhasaddon" || argv[0] == "pha")
+    case SC_PLAYERHASADDON:
     {
         if (!player || player->getPermissionLevel() <= PERM_NONE)
         {
@@ -7404,32 +7666,18 @@ void ServerLobby::handleServerCommand(Event* event,
         else
         {
             std::string addon_id_test = Addon::createAddonId(addon_id);
-            bool found = false;
-            const auto& kt = player_peer->getClientAssets();
-            for (auto& kart : kt.first)
-            {
-                if (kart == addon_id_test)
-                {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found)
-            {
-                for (auto& track : kt.second)
-                {
-                    if (track == addon_id_test)
-                    {
-                        found = true;
-                        break;
-                    }
-                }
-            }
+            bool found = player_peer->hasAddon(addon_id_test);
             if (found)
             {
                 chat->encodeString16(StringUtils::utf8ToWide
                     (player_name + " has addon " + addon_id));
             }
+            else if (!player_peer->hasAllUnknownAddons())
+            {
+                chat->encodeString16(StringUtils::utf8ToWide
+                    ("It is unknown if " + player_name + " has addon " +
+                    addon_id + ", the player has too many addons."));
+            }
             else
             {
                 chat->encodeString16(StringUtils::utf8ToWide
@@ -7438,8 +7686,9 @@ void ServerLobby::handleServerCommand(Event* event,
         }
         peer->sendPacket(chat, true/*reliable*/);
         delete chat;
+        break;
     }
-    else if (argv[0] == "kick")
+    case SC_KICK:
     {
         if (argv.size() == 1)
         {
@@ -7476,8 +7725,9 @@ void ServerLobby::handleServerCommand(Event* event,
         {
             player_peer->kick();
         }
+        break;
     }
-    else if (argv[0] == "playeraddonscore" || argv[0] == "pas")
+    case SC_PLAYERADDONSCORE:
     {
         if (!player || player->getPermissionLevel() <= PERM_NONE)
         {
@@ -7529,8 +7779,9 @@ void ServerLobby::handleServerCommand(Event* event,
         }
         peer->sendPacket(chat, true/*reliable*/);
         delete chat;
+        break;
     }
-    else if (argv[0] == "serverhasaddon" || argv[0] == "sha")
+    case SC_SERVERHASADDON:
     {
         if (!player || player->getPermissionLevel() <= PERM_NONE)
         {
@@ -7567,9 +7818,9 @@ void ServerLobby::handleServerCommand(Event* event,
         }
         peer->sendPacket(chat, true/*reliable*/);
         delete chat;
+        break;
     }
-    else if (!ServerConfig::m_soccer_ranking_file.toString().empty() &&
-            (argv[0] == "rank" || argv[0] == "rank10" || argv[0] == "top"))
+    case SC_RANK:
     {
         std::size_t max = 10;
         std::size_t page = 1;
@@ -7590,76 +7841,54 @@ void ServerLobby::handleServerCommand(Event* event,
 	std::string msg("Soccer rankings (page ");
 	msg += std::to_string(page);
 	msg += "):\n";
+	auto rankings =
+		SoccerRanking::getRankings(ServerConfig::m_soccer_ranking_path);
 	if (!playername.empty())
 	{
 		if (playername[0] == '$')
 			playername.erase(0, 1);
-		std::ifstream file(ServerConfig::m_soccer_ranking_path.c_str());
-		std::string line;
-		int rank = 1;
-		bool found = false;
-		while (std::getline(file, line))
+		const SoccerRanking::RankingEntry* re =
+			rankings ? rankings->find(playername) : NULL;
+		if (re)
 		{
-			std::istringstream iss(line);
-			std::string name;
-			std::string games_str, team_str, goals_str, win_str, elo_str;
-			iss >> name >> games_str >> team_str >> goals_str >> win_str >> elo_str;
-			if (name == playername)
-			{
-				msg = StringUtils::insertValues(
-						"Player: %s\n"
-						"Played Games: %s\n"
-						"Average team size: %s\n"
-						"Goals per Game: %s\n"
-						"Winning rate: %s\n"
-						"ELO: %s",
-						name.c_str(),
-						games_str.c_str(),
-						team_str.c_str(),
-						goals_str.c_str(),
-						win_str.c_str(),
-						elo_str.c_str());
-				found = true;
-				break;
-			}
-			rank++;
+			msg = StringUtils::insertValues(
+					"Player: %s\n"
+					"Played Games: %s\n"
+					"Average team size: %s\n"
+					"Goals per Game: %s\n"
+					"Winning rate: %s\n"
+					"ELO: %s",
+					re->m_name.c_str(),
+					re->m_played_games,
+					re->m_avg_team_size,
+					re->m_goals_per_game,
+					re->m_win_rate,
+					re->m_elo);
 		}
-		if (!found)
+		else
 			msg = "No records for the player.";
 		sendStringToPeer(msg, peer);
 		return;
 	}
-	std::ifstream file(ServerConfig::m_soccer_ranking_path.c_str());
-	std::string line;
-	int rank = 1;
-	int start = max * (page - 1);
-	int count = 0;
-	while (std::getline(file, line) && count < max)
+	std::size_t start = max * (page - 1);
+	std::size_t count = 0;
+	for (std::size_t i = start; rankings &&
+		i < rankings->m_entries.size() && count < max; i++)
 	{
-		if (rank <= start)
-		{
-			rank++;
-			continue;
-		}
-		std::istringstream iss(line);
-		std::string name;
-		float games, avg_team, goals, winrate;
-		int elo;
-		iss >> name >> games >> avg_team >> goals >> winrate >> elo;
+		const SoccerRanking::RankingEntry& re = rankings->m_entries[i];
 		msg += StringUtils::insertValues(
 				"%s #%d: %s (ELO %d)",
-				"", rank, name.c_str(), elo);
+				"", re.m_rank, re.m_name.c_str(), re.m_elo);
 		if (count != max - 1)
 			msg += "\n";
 		count++;
-		rank++;
 	}
 	if (count == 0)
 		msg = "Rankings are currently unavailable.";
 	sendStringToPeer(msg, peer);
+        break;
     }
-    else if (!ServerConfig::m_feature_filepath.toString().empty() && 
-            (argv[0] == "feature" || argv[0] == "inform" || argv[0] == "ifm" || argv[0] == "bug" || argv[0] == "suggest"))
+    case SC_FEATURE:
     {
         if (!player || player->hasRestriction(PRF_NOCHAT) ||
                 player->getPermissionLevel() <= PERM_NONE)
@@ -7729,9 +7958,9 @@ void ServerLobby::handleServerCommand(Event* event,
         chat->encodeString16(response);
         peer->sendPacket(chat, true/*reliable*/);
         delete chat;
+        break;
     }
-    else if (!ServerConfig::m_reports_filepath.toString().empty() && 
-            (argv[0] == "report" || argv[0] == "tell" || argv[0] == "rp"))
+    case SC_REPORT:
     {
         if (!player || player->hasRestriction(PRF_NOCHAT) ||
                 player->getPermissionLevel() <= PERM_NONE)
@@ -7801,8 +8030,9 @@ void ServerLobby::handleServerCommand(Event* event,
         chat->encodeString16(response);
         peer->sendPacket(chat, true/*reliable*/);
         delete chat;
+        break;
     }
-    else if (ServerConfig::m_allow_heavyparty && (argv[0] == "heavyparty" || argv[0] == "hp"))
+    case SC_HEAVYPARTY:
     {
         irr::core::stringw response;
         if (argv[0] == "hp")
@@ -7854,8 +8084,9 @@ void ServerLobby::handleServerCommand(Event* event,
         }
 
         sendStringToAllPeers(message);
+        break;
     }
-    else if (ServerConfig::m_allow_mediumparty && (argv[0] == "mediumparty" || argv[0] == "mp"))
+    case SC_MEDIUMPARTY:
     {
         irr::core::stringw response;
 
@@ -7908,8 +8139,9 @@ void ServerLobby::handleServerCommand(Event* event,
         }
 
         sendStringToAllPeers(message);
+        break;
     }
-    else if (ServerConfig::m_allow_lightparty && (argv[0] == "lightparty" || argv[0] == "lp"))
+    case SC_LIGHTPARTY:
     {
         irr::core::stringw response;
 
@@ -7962,8 +8194,9 @@ void ServerLobby::handleServerCommand(Event* event,
         }
 
         sendStringToAllPeers(message);	
+        break;
     }
-    else if (argv[0] == "bowlparty" || argv[0] == "bp")
+    case SC_BOWLPARTY:
     {
         irr::core::stringw response;
 
@@ -8025,8 +8258,9 @@ void ServerLobby::handleServerCommand(Event* event,
         }
 
         sendStringToAllPeers(message);
+        break;
     }
-    else if (argv[0] == "bowltrainingparty" || argv[0] == "btp")
+    case SC_BOWLTRAININGPARTY:
     {
 	    irr::core::stringw response;
 	    if (argv[0] == "btp")
@@ -8090,8 +8324,9 @@ void ServerLobby::handleServerCommand(Event* event,
 		    sendStringToPeer(msg, peer);
 		    return;
 	    }
+        break;
     }
-    else if (argv[0] == "itemless" || argv[0] == "il")
+    case SC_ITEMLESS:
     {
 	    if (argv[0] == "il")
 	    {
@@ -8142,8 +8377,9 @@ void ServerLobby::handleServerCommand(Event* event,
 	    message += state ? "ACTIVE. No items can be collected."
 		    : "INACTIVE. Items can be collected as normal.";
 	    sendStringToAllPeers(message);
+        break;
     }
-    else if (argv[0] == "nitroless" || argv[0] == "nl")
+    case SC_NITROLESS:
     {
 	    if (argv[0] == "nl")
 	    {
@@ -8193,9 +8429,10 @@ void ServerLobby::handleServerCommand(Event* event,
 	    message += state ? "ACTIVE. No nitro can be used."
 		    : "INACTIVE. Nitro can be used as normal.";
 	    sendStringToAllPeers(message);
+        break;
     }
 
-    else if (argv[0] == "cakeparty" || argv[0] == "cp" || argv[0] == "cakefest")
+    case SC_CAKEPARTY:
     {
         irr::core::stringw response;
 	
@@ -8262,9 +8499,9 @@ void ServerLobby::handleServerCommand(Event* event,
         }
 
         sendStringToAllPeers(message);
+        break;
     }
-    else if ((argv[0] == "scanservers" || argv[0] == "online" || argv[0] == "o")
-            && ServerConfig::m_check_servers_cooldown > 0.0f)
+    case SC_SCANSERVERS:
     {
         if (!player || player->getPermissionLevel() <= PERM_NONE)
         {
@@ -8293,7 +8530,7 @@ void ServerLobby::handleServerCommand(Event* event,
 	sendStringToPeer(msg, peer);
         return;
     }
-    else if (argv[0] == "mute")
+    case SC_MUTE:
     {
         std::shared_ptr<STKPeer> player_peer;
         std::string result_msg;
@@ -8328,8 +8565,9 @@ mute_error:
         error->encodeString16(StringUtils::utf8ToWide(msg));
         peer->sendPacket(error, true/*reliable*/);
         delete error;
+        break;
     }
-    else if (argv[0] == "unmute")
+    case SC_UNMUTE:
     {
         std::shared_ptr<STKPeer> player_peer;
         std::string result_msg;
@@ -8374,8 +8612,9 @@ unmute_error:
         error->encodeString16(StringUtils::utf8ToWide(msg));
         peer->sendPacket(error, true/*reliable*/);
         delete error;
+        break;
     }
-    else if (argv[0] == "listmute")
+    case SC_LISTMUTE:
     {
         NetworkString* chat = getNetworkString();
         chat->addUInt8(LE_CHAT);
@@ -8395,22 +8634,32 @@ unmute_error:
         }
         peer->sendPacket(chat, true/*reliable*/);
         delete chat;
+        break;
     }
-    else if (argv[0] == "showcommands" || argv[0] == "commands" || argv[0] == "cmds" || argv[0] == "cmd")
-    {
-	    std::string msg = (
-            	"Available commands:\n/showcommands|commands|cmds|cmd, /vote, /spectate|s|sp|spec|spect, /addtime|addt, "
-            	"/score|sc, /teamchat|tc|tchat, /to|msg|dm|pm, /slots|sl, /public|pub|all, "
-            	"/listserveraddon|lsa, /playerhasaddon|pha, /kick, /playeraddonscore|pas, /serverhasaddon|sha, /inform|ifm, "
-            	"/report, /heavyparty|hp, /mediumparty|mp, /lightparty|lp, /scanservers|online|o, /mute, /unmute, /listmute, /pole, "
-            	"/start, /end, /bug, /rank, /rank10|top, /results|rs, /date|time, " 
-            	"/bowlparty|bp, /bowltrainingparty|btp, /cakeparty|cp|cakefest, /feature|suggest, /rank, /autoteams|mix|am, /help (command), /when eventsoccer, /tracks, /karts, /randomkarts|rks "
-                "/setowner, /setmode, /setdifficulty, /setgoaltarget, /stk-seen|seen, /itemless, /nitroless, /resetball|resetpuck|rb|rp"
-        );
-	    sendStringToPeer(msg, peer);
+    case SC_SHOWCOMMANDS:
+    {
+        // Commands which the player can use directly or vote for
+        const int level = player ? player->getPermissionLevel() : PERM_NONE;
+        const bool is_owner = m_server_owner.lock() == peer;
+        std::string msg = "Available commands:\n/vote";
+        for (int type = SC_UNKNOWN + 1; type < SC_COUNT; type++)
+        {
+            const ServerCommand* command =
+                getServerCommand((ServerCommandType)type);
+            std::vector<std::string> names =
+                StringUtils::split(std::string(command->m_names), '|');
+            if (findServerCommand(names) != command)
+                continue;
+            if (!is_owner && level < command->m_permission &&
+                !(command->m_votable && ServerConfig::m_command_voting))
+                continue;
+            msg += ", /";
+            msg += command->m_names;
+        }
+        sendStringToPeer(msg, peer);
         return;
     }
-    else if (ServerConfig::m_allow_pole && (argv[0] == "pole"))
+    case SC_POLE:
     {
         if (
             RaceManager::get()->getMinorMode() != RaceManager::MINOR_MODE_SOCCER &&
@@ -8449,8 +8698,9 @@ unmute_error:
         }
 
         setPoleEnabled(state);
+        break;
     }
-    else if (ServerConfig::m_ishigami_enabled && (argv[0] == "stk-seen" || argv[0] == "seen"))
+    case SC_SEEN:
     {
         if (argv.size() < 2)
         {
@@ -8516,8 +8766,9 @@ unmute_error:
 			sendStringToPeer(error_msg, peer);
 		}
 	}).detach();
-    }   
-    else if (argv[0] == "date" || argv[0] == "time")
+        break;
+    }
+    case SC_DATE:
     {
 	   const std::unordered_map<std::string, double> TZ_OFFSETS = {
 		  // America (DST and Std.)
@@ -8631,10 +8882,11 @@ unmute_error:
 		   sendStringToPeer(error, peer);
 		   return;
 	   }
+        break;
     }
 
     // MODERATION TOOLKIT
-    else if (argv[0] == "veto")
+    case SC_VETO:
     {
         if (!player || player->getPermissionLevel() < 50)
         {
@@ -8660,8 +8912,9 @@ unmute_error:
             std::string msg = "Votable commands are no longer forced.";
             sendStringToPeer(msg, peer);
         }
+        break;
     }
-    else if (argv[0] == "start")
+    case SC_START:
     {
         if (m_state.load() != WAITING_FOR_START_GAME)
         {
@@ -8708,8 +8961,9 @@ unmute_error:
         }
 
         startSelection();
+        break;
     }
-    else if (argv[0] == "help") //help commands
+    case SC_HELP:
     {
         if (argv.size() > 2) return;  
     
@@ -8823,12 +9077,21 @@ unmute_error:
         }
         else
         {
+            std::vector<std::string> help_argv(argv.begin() + 1, argv.end());
+            const ServerCommand* command = findServerCommand(help_argv);
+            if (command && command->m_usage)
+            {
+                std::string msg = std::string("Usage: ") + command->m_usage;
+                sendStringToPeer(msg, peer);
+                return;
+            }
             std::string msg = "Unknown help command: " + argv[1] + ". Use /showcommands to see all the available commands";
             sendStringToPeer(msg, peer);
             return;
         }
+        break;
     }
-    else if (argv[0] == "website")
+    case SC_WEBSITE:
     {
         if (argv.size() > 2) return;
         std::string msg;
@@ -8840,7 +9103,7 @@ unmute_error:
         } 
         return;
     }
-    else if (argv[0] == "discord")
+    case SC_DISCORD:
     {
 	if (argv.size() > 2) return;
 	std::string msg;
@@ -8852,7 +9115,7 @@ unmute_error:
 	}
 	return;
     }
-    else if (argv[0] == "tracks")
+    case SC_TRACKS:
     {
 	    if (argv.size() > 2) return;
 	    std::string msg;
@@ -8863,7 +9126,7 @@ unmute_error:
 	    }
 	    return;
     }
-    else if (argv[0] == "karts")
+    case SC_KARTS:
     {
 	    if (argv.size() > 2) return;
             std::string msg;
@@ -8873,9 +9136,9 @@ unmute_error:
 		    sendStringToPeer(msg, peer);
 	    }
 	    return;
-	    }
+    }
 
-    else if (argv[0] == "when") 
+    case SC_WHEN:
     {
         if (argv.size() > 2) return;
 
@@ -8892,7 +9155,7 @@ unmute_error:
 	}
             return;
     }
-    else if (argv[0] == "randomkarts" || argv[0] == "rks")
+    case SC_RANDOMKARTS:
     {
 	     if (argv[0] == "rks")
 	     {
@@ -8946,7 +9209,7 @@ unmute_error:
 	     updatePlayerList();
 	     return;
     }
-    else if (argv[0] == "resetpuck" || argv[0] == "resetball" || argv[0] == "rp" || argv[0] == "rb")
+    case SC_RESETPUCK:
     {
             if (argv[0] == "resetpuck")
             {
@@ -8999,7 +9262,7 @@ unmute_error:
 	    }
 	    return;
     }
-    else if (argv[0] == "replay")
+    case SC_REPLAY:
     {
         std::string msg;
         if (argv.size() < 2)
@@ -9031,15 +9294,16 @@ unmute_error:
         else
             msg = "Recording of the new replay is cancelled.";
         sendStringToAllPeers(msg);
+        break;
     }
-    else if (argv[0] == "results" || argv[0] == "rs")
+    case SC_RESULTS:
     {
         std::string result = ServerLobby::get_elo_change_string();
         
         sendStringToPeer(result.empty() ? "No ELO changes" : result, peer);
         return;
-    }    
-    else if (argv[0] == "autoteams" || argv[0] == "mix" || argv[0] == "am")
+    }
+    case SC_AUTOTEAMS:
     {
 	    if (argv[0] == "mix")
 	    {
@@ -9076,6 +9340,8 @@ unmute_error:
         auto elorank = std::make_pair(0U, 1500);
         std::string msg = "";
         auto peers = STKHost::get()->getPeers();
+        auto rankings =
+            SoccerRanking::getRankings(ServerConfig::m_soccer_ranking_path);
         std::vector <std::pair<std::string, int>> player_vec;
         for (auto peer : peers)
         {
@@ -9084,27 +9350,11 @@ unmute_error:
                 for (auto player : peer->getPlayerProfiles())
                 {
                     std::string username = StringUtils::wideToUtf8(player->getName());
-                    std::ifstream file(ServerConfig::m_soccer_ranking_path.c_str());
-		    std::string line;
-		    bool found = false;
+		    const SoccerRanking::RankingEntry* re =
+			    rankings ? rankings->find(username) : NULL;
 		    int default_elo = 1500;
-                    while (std::getline(file, line))
-		    {
-			    std::istringstream iss(line);
-			    std::string name;
-			    int games;
-			    float team_size, goals_per_game, win_rate;
-			    int elo;
-			    iss >> name >> games >> team_size >> goals_per_game >> win_rate >> elo;
-			    if (name == username)
-			    {
-                                    player_vec.push_back(std::pair<std::string, int>(username, elo));
-                                    found = true;
-				    break;
-			    }
-		    }
-		    if (!found)
-			    player_vec.push_back(std::pair<std::string, int>(username, default_elo));
+		    player_vec.push_back(std::pair<std::string, int>(username,
+			    re ? re->m_elo : default_elo));
 		    msg = "Player " + username + " will be sent into a team.";
 		    Log::info("ServerLobby", msg.c_str());
 		}
@@ -9117,8 +9367,9 @@ unmute_error:
         updatePlayerList();
         std::string message = "Teams have been generated automatically using the new formula! If teams seem unbalanced, please report it with /bug";
         sendStringToAllPeers(message);
+        break;
     }
-    else if (argv[0] == "goal" && argv[1] == "history")
+    case SC_GOAL_HISTORY:
     {
 	    if (m_state.load() != WAITING_FOR_START_GAME)
 	    {
@@ -9136,7 +9387,7 @@ unmute_error:
 	    }
 	    return;
     }
-    else if (argv[0] == "end" || argv[0] == "lobby")
+    case SC_END:
     {
         // if the game is even active
         if (!isRacing())
@@ -9182,8 +9433,9 @@ unmute_error:
             peer->sendPacket(ns, true/*reliable*/);
 
         delete ns;
+        break;
     }
-    else if (argv[0] == "ban")
+    case SC_BAN:
     {
         std::string msg;
         if (!player || player->getPermissionLevel() < PERM_MODERATOR)
@@ -9248,8 +9500,9 @@ unmute_error:
             msg = "Failed to ban the player, check the network console.";
             sendStringToPeer(msg, peer);
         }
+        break;
     }
-    else if (argv[0] == "unban" || argv[0] == "pardon")
+    case SC_UNBAN:
     {
         std::string msg;
         if (!player || player->getPermissionLevel() < PERM_MODERATOR)
@@ -9280,8 +9533,9 @@ unmute_error:
             msg = "Failed to unban the player, check the network console.";
             sendStringToPeer(msg, peer);
         }
+        break;
     }
-    else if (argv[0] == "restrict" || argv[0] == "punish")
+    case SC_RESTRICT:
     {
         std::string msg;
         if (!player || player->getPermissionLevel() < PERM_MODERATOR)
@@ -9367,13 +9621,9 @@ unmute_error:
             msg = "Invalid target player: " + argv[2];
             sendStringToPeer(msg, peer);
         }
+        break;
     }
-    else if (argv[0] == "nospec" ||
-             argv[0] == "nogame" ||
-             argv[0] == "nochat" ||
-             argv[0] == "nopchat" ||
-             argv[0] == "noteam"
-             )
+    case SC_RESTRICT_SHORTCUT:
     {
         std::string msg;
         if (!player || player->getPermissionLevel() < PERM_MODERATOR)
@@ -9456,8 +9706,9 @@ unmute_error:
             msg = "Invalid target player: " + argv[2];
             sendStringToPeer(msg, peer);
         }
+        break;
     }
-    else if (argv[0] == "setteam")
+    case SC_SETTEAM:
     {
         std::string msg;
         if (!player || player->getPermissionLevel() < PERM_MODERATOR)
@@ -9497,8 +9748,9 @@ unmute_error:
 
         msg = "Player team has been updated.";
         sendStringToPeer(msg, peer);
+        break;
     }
-    else if (argv[0] == "setkart")
+    case SC_SETKART:
     {
         std::string msg;
         auto spectators_by_limit = getSpectatorsByLimit();
@@ -9589,8 +9841,9 @@ unmute_error:
             }
         }
         Log::info("ServerLobby", "setkart %s %s", argv[1].c_str(), playername.c_str());
+        break;
     }
-    else if (argv[0] == "setfield" || argv[0] == "settrack" || argv[0] == "setarena")
+    case SC_SETFIELD:
     {
         std::string msg;
         if (ServerConfig::m_command_track_mode)
@@ -9647,8 +9900,9 @@ unmute_error:
             sendStringToPeer(msg, peer);
             return;
         }
+        break;
     }
-    else if (argv[0] == "sethandicap")
+    case SC_SETHANDICAP:
     {
         std::string msg;
         if (!player || player->getPermissionLevel() < PERM_REFEREE)
@@ -9695,9 +9949,10 @@ unmute_error:
 
         msg = "Player handicap has been updated.";
         sendStringToPeer(msg, peer);
+        break;
     }
     // admin commands for custom servers, works always regardless of "server-configurable"
-    else if (argv[0] == "setowner")
+    case SC_SETOWNER:
     {
         if (ServerConfig::m_ranked)
             return;
@@ -9751,8 +10006,9 @@ unmute_error:
 
         std::string msg = "Owner has been changed.";
         sendStringToPeer(msg, peer);
+        break;
     }
-    else if (argv[0] == "setmode")
+    case SC_SETMODE:
     {
         std::string msg;
         int mode;
@@ -9800,8 +10056,9 @@ unmute_error:
         msg += RaceManager::get()->getMinorModeName();
         msg += ".";
         sendStringToPeer(msg, peer);
+        break;
     }
-    else if (argv[0] == "setdifficulty" || argv[0] == "setdiff")
+    case SC_SETDIFFICULTY:
     {
         std::string msg;
         RaceManager::Difficulty diff;
@@ -9851,8 +10108,9 @@ unmute_error:
                 RaceManager::get()->getDifficulty());
         msg += ".";
         sendStringToPeer(msg, peer);
+        break;
     }
-    else if (argv[0] == "setgoaltarget")
+    case SC_SETGOALTARGET:
     {
         std::string msg;
 
@@ -9887,10 +10145,10 @@ unmute_error:
         msg += state ? "on." : "off.";
 
         sendStringToPeer(msg, peer);
+        break;
     }
     // (CHEATS) Not gonna be used in game.
-    else if (!ServerConfig::m_ranked &&
-        (argv[0] == "hackitem" || argv[0] == "hki"))
+    case SC_HACKITEM:
     {
         // admin only
         if (player->getPermissionLevel() < PERM_ADMINISTRATOR)
@@ -9985,9 +10243,9 @@ unmute_error:
                 sendStringToPeer(msg, peer);
             }
         }
+        break;
     }
-    else if (!ServerConfig::m_ranked &&
-        (argv[0] == "hacknitro" || argv[0] == "hkn"))
+    case SC_HACKNITRO:
     {
         // can only use it during the game
         if (player->getPermissionLevel() < PERM_ADMINISTRATOR)
@@ -10077,10 +10335,10 @@ unmute_error:
             }
         }
 
+        break;
     }
     // CHEATS (gonna be used in game for training server)
-    else if (ServerConfig::m_cheats &&
-        (argv[0] == "item" || argv[0] == "i"))
+    case SC_ITEM:
     {
         if (player->getPermissionLevel() < PERM_PRISONER)
         {
@@ -10153,9 +10411,9 @@ unmute_error:
                 argv[1].c_str(), type, quantity, 
                 StringUtils::wideToUtf8(peer->getPlayerProfiles()[0]->getName()).c_str());
         }
+        break;
     }
-    else if (ServerConfig::m_cheats &&
-        (argv[0] == "nitro" || argv[0] == "n"))
+    case SC_NITRO:
     {
         if (player->getPermissionLevel() < PERM_PRISONER)
         {
@@ -10225,8 +10483,9 @@ unmute_error:
                 quantity, 
                 StringUtils::wideToUtf8(peer->getPlayerProfiles()[0]->getName()).c_str());
         }
+        break;
     }
-    else if (argv[0] == "infinite")
+    case SC_INFINITE:
     {
     	if (argv.size() < 2 || (argv[1] != "on" && argv[1] != "off") )
         {
@@ -10243,26 +10502,316 @@ unmute_error:
 
         bool state = argv[1] == "on";
         RaceManager::get()->setInfiniteMode(state);
+        break;
     }
-    else
+    default:
     {
         std::string msg = "Unknown command: ";
         msg += cmd;
         sendStringToPeer(msg, peer);
+        break;
+    }
     }
 }   // handleServerCommand
 
 //-----------------------------------------------------------------------------
-bool ServerLobby::isVIP(std::shared_ptr<STKPeer>& peer) const
+static bool rankingAvailable(const std::vector<std::string>& argv)
 {
-    return isVIP(peer.get());
-}
-//-----------------------------------------------------------------------------
-bool ServerLobby::isVIP(STKPeer* peer) const
+    return !ServerConfig::m_soccer_ranking_file.toString().empty();
+}   // rankingAvailable
+
+static bool featureAvailable(const std::vector<std::string>& argv)
 {
-#if 0
-    std::string username = StringUtils::wideToUtf8(
-        peer->getPlayerProfiles()[0]->getName());
+    return !ServerConfig::m_feature_filepath.toString().empty();
+}   // featureAvailable
+
+static bool reportAvailable(const std::vector<std::string>& argv)
+{
+    return !ServerConfig::m_reports_filepath.toString().empty();
+}   // reportAvailable
+
+static bool heavypartyAvailable(const std::vector<std::string>& argv)
+{
+    return ServerConfig::m_allow_heavyparty;
+}   // heavypartyAvailable
+
+static bool mediumpartyAvailable(const std::vector<std::string>& argv)
+{
+    return ServerConfig::m_allow_mediumparty;
+}   // mediumpartyAvailable
+
+static bool lightpartyAvailable(const std::vector<std::string>& argv)
+{
+    return ServerConfig::m_allow_lightparty;
+}   // lightpartyAvailable
+
+static bool scanServersAvailable(const std::vector<std::string>& argv)
+{
+    return ServerConfig::m_check_servers_cooldown > 0.0f;
+}   // scanServersAvailable
+
+static bool poleAvailable(const std::vector<std::string>& argv)
+{
+    return ServerConfig::m_allow_pole;
+}   // poleAvailable
+
+static bool seenAvailable(const std::vector<std::string>& argv)
+{
+    return ServerConfig::m_ishigami_enabled;
+}   // seenAvailable
+
+static bool goalHistoryAvailable(const std::vector<std::string>& argv)
+{
+    return argv.size() > 1 && argv[1] == "history";
+}   // goalHistoryAvailable
+
+static bool hackAvailable(const std::vector<std::string>& argv)
+{
+    return !ServerConfig::m_ranked;
+}   // hackAvailable
+
+static bool cheatsAvailable(const std::vector<std::string>& argv)
+{
+    return ServerConfig::m_cheats;
+}   // cheatsAvailable
+
+//-----------------------------------------------------------------------------
+/** All chat commands, a name used by more than one command resolves to the
+ *  first available one in this order. */
+static const ServerLobby::ServerCommand g_server_commands[] =
+{
+    { ServerLobby::SC_SPECTATE, "spectate|s|sp|spec|spect",
+      ServerLobby::PERM_NONE, false,
+      "/spectate [0 or 1], before game started", NULL },
+    { ServerLobby::SC_ADDTIME, "addtime|addt",
+      ServerLobby::PERM_MODERATOR, true, "/addtime [seconds]", NULL },
+    { ServerLobby::SC_SCORE, "score|sc",
+      ServerLobby::PERM_NONE, false, "/score", NULL },
+    { ServerLobby::SC_TEAMCHAT, "teamchat|tc|tchat",
+      ServerLobby::PERM_SPECTATOR, false, "/teamchat [message]", NULL },
+    { ServerLobby::SC_TO, "to|msg|dm|pm",
+      ServerLobby::PERM_SPECTATOR, false, "/to (username) message...", NULL },
+    { ServerLobby::SC_SLOTS, "slots|sl",
+      ServerLobby::PERM_REFEREE, true, "/slots [number]", NULL },
+    { ServerLobby::SC_PUBLIC, "public|pub|all",
+      ServerLobby::PERM_SPECTATOR, false, "/public", NULL },
+    { ServerLobby::SC_LISTSERVERADDON, "listserveraddon|lsa",
+      ServerLobby::PERM_SPECTATOR, false,
+      "/listserveraddon [option][addon string to find]", NULL },
+    { ServerLobby::SC_PLAYERHASADDON, "playerhasaddon|pha",
+      ServerLobby::PERM_SPECTATOR, false,
+      "/playerhasaddon [addon_identity] [player name]", NULL },
+    { ServerLobby::SC_KICK, "kick",
+      ServerLobby::PERM_MODERATOR, true, "/kick [player name]", NULL },
+    { ServerLobby::SC_PLAYERADDONSCORE, "playeraddonscore|pas",
+      ServerLobby::PERM_SPECTATOR, false,
+      "/playeraddonscore [player name]", NULL },
+    { ServerLobby::SC_SERVERHASADDON, "serverhasaddon|sha",
+      ServerLobby::PERM_SPECTATOR, false,
+      "/serverhasaddon [addon_identity]", NULL },
+    { ServerLobby::SC_RANK, "rank|rank10|top",
+      ServerLobby::PERM_NONE, false, "/rank [player name or page]",
+      rankingAvailable },
+    { ServerLobby::SC_FEATURE, "feature|inform|ifm|bug|suggest",
+      ServerLobby::PERM_SPECTATOR, false, "/feature [message]",
+      featureAvailable },
+    { ServerLobby::SC_REPORT, "report|tell|rp",
+      ServerLobby::PERM_SPECTATOR, false, "/report [message]",
+      reportAvailable },
+    { ServerLobby::SC_HEAVYPARTY, "heavyparty|hp",
+      ServerLobby::PERM_REFEREE, true, "/heavyparty [on/off]",
+      heavypartyAvailable },
+    { ServerLobby::SC_MEDIUMPARTY, "mediumparty|mp",
+      ServerLobby::PERM_REFEREE, true, "/mediumparty [on/off]",
+      mediumpartyAvailable },
+    { ServerLobby::SC_LIGHTPARTY, "lightparty|lp",
+      ServerLobby::PERM_REFEREE, true, "/lightparty [on/off]",
+      lightpartyAvailable },
+    { ServerLobby::SC_BOWLPARTY, "bowlparty|bp",
+      ServerLobby::PERM_REFEREE, true, "/bowlparty [on/off]", NULL },
+    { ServerLobby::SC_BOWLTRAININGPARTY, "bowltrainingparty|btp",
+      ServerLobby::PERM_REFEREE, true, "/bowltrainingparty [on/off]", NULL },
+    { ServerLobby::SC_ITEMLESS, "itemless|il",
+      ServerLobby::PERM_REFEREE, true, "/itemless <on|off>", NULL },
+    { ServerLobby::SC_NITROLESS, "nitroless|nl",
+      ServerLobby::PERM_REFEREE, true, "/nitroless <on|off>", NULL },
+    { ServerLobby::SC_CAKEPARTY, "cakeparty|cp|cakefest",
+      ServerLobby::PERM_REFEREE, true, "/cakeparty [on/off]", NULL },
+    { ServerLobby::SC_SCANSERVERS, "scanservers|online|o",
+      ServerLobby::PERM_SPECTATOR, false, "/scanservers",
+      scanServersAvailable },
+    { ServerLobby::SC_MUTE, "mute",
+      ServerLobby::PERM_NONE, false, "/mute player_name", NULL },
+    { ServerLobby::SC_UNMUTE, "unmute",
+      ServerLobby::PERM_NONE, false, "/unmute player_name", NULL },
+    { ServerLobby::SC_LISTMUTE, "listmute",
+      ServerLobby::PERM_NONE, false, "/listmute", NULL },
+    { ServerLobby::SC_SHOWCOMMANDS, "showcommands|commands|cmds|cmd",
+      ServerLobby::PERM_NONE, false, "/showcommands", NULL },
+    { ServerLobby::SC_POLE, "pole",
+      ServerLobby::PERM_REFEREE, true, "/pole [on/off]", poleAvailable },
+    { ServerLobby::SC_SEEN, "stk-seen|seen",
+      ServerLobby::PERM_NONE, false, "/stk-seen <playername>",
+      seenAvailable },
+    { ServerLobby::SC_DATE, "date|time",
+      ServerLobby::PERM_NONE, false, "/date (TIMEZONE/DST_TIMEZONE)", NULL },
+    { ServerLobby::SC_VETO, "veto",
+      50, false, "/veto [on/off]", NULL },
+    { ServerLobby::SC_START, "start",
+      ServerLobby::PERM_REFEREE, true, "/start", NULL },
+    { ServerLobby::SC_HELP, "help",
+      ServerLobby::PERM_NONE, false, "/help (command)", NULL },
+    { ServerLobby::SC_WEBSITE, "website",
+      ServerLobby::PERM_NONE, false, "/website", NULL },
+    { ServerLobby::SC_DISCORD, "discord",
+      ServerLobby::PERM_NONE, false, "/discord", NULL },
+    { ServerLobby::SC_TRACKS, "tracks",
+      ServerLobby::PERM_NONE, false, "/tracks", NULL },
+    { ServerLobby::SC_KARTS, "karts",
+      ServerLobby::PERM_NONE, false, "/karts", NULL },
+    { ServerLobby::SC_WHEN, "when",
+      ServerLobby::PERM_NONE, false, "/when eventsoccer", NULL },
+    { ServerLobby::SC_RANDOMKARTS, "randomkarts|rks",
+      ServerLobby::PERM_REFEREE, true, "/randomkarts [on/off]", NULL },
+    { ServerLobby::SC_RESETPUCK, "resetpuck|resetball|rp|rb",
+      ServerLobby::PERM_REFEREE, true, "/resetball", NULL },
+    { ServerLobby::SC_REPLAY, "replay",
+      ServerLobby::PERM_NONE, false, "/replay [on/off]", NULL },
+    { ServerLobby::SC_RESULTS, "results|rs",
+      ServerLobby::PERM_NONE, false, "/results", NULL },
+    { ServerLobby::SC_AUTOTEAMS, "autoteams|mix|am",
+      ServerLobby::PERM_REFEREE, true, "/autoteams", NULL },
+    { ServerLobby::SC_GOAL_HISTORY, "goal",
+      ServerLobby::PERM_NONE, false, "/goal history", goalHistoryAvailable },
+    { ServerLobby::SC_END, "end|lobby",
+      ServerLobby::PERM_REFEREE, true, "/end", NULL },
+    { ServerLobby::SC_BAN, "ban",
+      ServerLobby::PERM_MODERATOR, false,
+      "/ban [player] [reason] or /ban [player] days [days] [reason]", NULL },
+    { ServerLobby::SC_UNBAN, "unban|pardon",
+      ServerLobby::PERM_MODERATOR, false, "/unban [player]", NULL },
+    { ServerLobby::SC_RESTRICT, "restrict|punish",
+      ServerLobby::PERM_MODERATOR, false,
+      "/restrict [on/off] [nospec/nogame/nochat/nopchat/noteam/handicap/"
+      "track] [player]", NULL },
+    { ServerLobby::SC_RESTRICT_SHORTCUT, "nospec|nogame|nochat|nopchat|noteam",
+      ServerLobby::PERM_MODERATOR, false,
+      "/[nospec/nogame/nochat/nopchat/noteam] [on] [player]", NULL },
+    { ServerLobby::SC_SETTEAM, "setteam",
+      ServerLobby::PERM_MODERATOR, false,
+      "/setteam [red/blue/none] [player]", NULL },
+    { ServerLobby::SC_SETKART, "setkart",
+      ServerLobby::PERM_MODERATOR, false,
+      "/setkart [kart_name or off] [player] [permanent?]", NULL },
+    { ServerLobby::SC_SETFIELD, "setfield|settrack|setarena",
+      ServerLobby::PERM_REFEREE, false, "/setfield [track] [laps]", NULL },
+    { ServerLobby::SC_SETHANDICAP, "sethandicap",
+      ServerLobby::PERM_REFEREE, false,
+      "/sethandicap [none/count/medium] [player]", NULL },
+    { ServerLobby::SC_SETOWNER, "setowner",
+      ServerLobby::PERM_ADMINISTRATOR, true, "/setowner (player name)", NULL },
+    { ServerLobby::SC_SETMODE, "setmode",
+      ServerLobby::PERM_ADMINISTRATOR, true,
+      "/setmode (standard/time-trial/ffa/soccer/ctf) [goal-target: on/off]",
+      NULL },
+    { ServerLobby::SC_SETDIFFICULTY, "setdifficulty|setdiff",
+      ServerLobby::PERM_ADMINISTRATOR, true,
+      "/setdifficulty (novice/intermediate/expert/supertux)", NULL },
+    { ServerLobby::SC_SETGOALTARGET, "setgoaltarget",
+      ServerLobby::PERM_ADMINISTRATOR, true, "/setgoaltarget (on/off)", NULL },
+    { ServerLobby::SC_HACKITEM, "hackitem|hki",
+      ServerLobby::PERM_ADMINISTRATOR, false,
+      "/hackitem (item) (quantity.0) [player]", hackAvailable },
+    { ServerLobby::SC_HACKNITRO, "hacknitro|hkn",
+      ServerLobby::PERM_ADMINISTRATOR, false,
+      "/hacknitro (quantity) [player]", hackAvailable },
+    { ServerLobby::SC_ITEM, "item|i",
+      ServerLobby::PERM_PRISONER, false, "/item (item)", cheatsAvailable },
+    { ServerLobby::SC_NITRO, "nitro|n",
+      ServerLobby::PERM_PRISONER, false, "/nitro", cheatsAvailable },
+    { ServerLobby::SC_INFINITE, "infinite",
+      ServerLobby::PERM_ADMINISTRATOR, false, "/infinite [on/off]", NULL },
+};
+
+//-----------------------------------------------------------------------------
+/** Returns the command for the first word of a chat command, or NULL if
+ *  there is no such command available.
+ */
+const ServerLobby::ServerCommand* ServerLobby::findServerCommand(
+                                         const std::vector<std::string>& argv)
+{
+    typedef std::unordered_map<std::string,
+        std::vector<const ServerCommand*> > CommandMap;
+    // Built once, the table never changes
+    static const CommandMap commands = []()
+        {
+            CommandMap commands;
+            for (const ServerCommand& command : g_server_commands)
+            {
+                for (const std::string& name :
+                    StringUtils::split(std::string(command.m_names), '|'))
+                    commands[name].push_back(&command);
+            }
+            return commands;
+        }();
+
+    if (argv.empty())
+        return NULL;
+    auto it = commands.find(argv[0]);
+    if (it == commands.end())
+        return NULL;
+    for (const ServerCommand* command : it->second)
+    {
+        if (!command->m_available || command->m_available(argv))
+            return command;
+    }
+    return NULL;
+}   // findServerCommand
+
+//-----------------------------------------------------------------------------
+const ServerLobby::ServerCommand*
+    ServerLobby::getServerCommand(ServerCommandType type)
+{
+    for (const ServerCommand& command : g_server_commands)
+    {
+        if (command.m_type == type)
+            return &command;
+    }
+    return NULL;
+}   // getServerCommand
+
+//-----------------------------------------------------------------------------
+void ServerLobby::addServerCommandTime(ServerCommandType type, uint64_t us)
+{
+    std::lock_guard<std::mutex> lock(m_command_stats_mutex);
+    ServerCommandStats& stats = m_command_stats[type];
+    stats.m_count++;
+    stats.m_total_us += us;
+    stats.m_max_us = std::max(stats.m_max_us, us);
+}   // addServerCommandTime
+
+//-----------------------------------------------------------------------------
+/** Returns the handling time of chat commands, indexed by
+ *  ServerCommandType. */
+std::vector<ServerLobby::ServerCommandStats>
+    ServerLobby::getServerCommandStats() const
+{
+    std::lock_guard<std::mutex> lock(m_command_stats_mutex);
+    return std::vector<ServerCommandStats>(m_command_stats,
+        m_command_stats + SC_COUNT);
+}   // getServerCommandStats
+
+//-----------------------------------------------------------------------------
+bool ServerLobby::isVIP(std::shared_ptr<STKPeer>& peer) const
+{
+    return isVIP(peer.get());
+}
+//-----------------------------------------------------------------------------
+bool ServerLobby::isVIP(STKPeer* peer) const
+{
+#if 0
+    std::string username = StringUtils::wideToUtf8(
+        peer->getPlayerProfiles()[0]->getName());
     return m_vip_players.count(username);
 #endif
     return peer->hasPlayerProfiles() && 
@@ -10294,8 +10843,7 @@ bool ServerLobby::serverAndPeerHaveTrack(std::shared_ptr<STKPeer>& peer, std::st
 //-----------------------------------------------------------------------------
 bool ServerLobby::serverAndPeerHaveTrack(STKPeer* peer, std::string track_id) const
 {
-    std::pair<std::set<std::string>, std::set<std::string>> kt = peer->getClientAssets();
-    bool peerHasTrack = kt.second.find(track_id) != kt.second.end();
+    bool peerHasTrack = peer->hasTrack(track_id);
     bool serverHasTrack = (m_official_kts.second.find(track_id) != m_official_kts.second.end()) ||
         (m_addon_kts.second.find(track_id) != m_addon_kts.second.end()) ||
         (m_addon_soccers.find(track_id) != m_addon_soccers.end()) ||
@@ -10312,23 +10860,11 @@ bool ServerLobby::canRace(STKPeer* peer) const
 {
   if (peer == NULL || peer->getPlayerProfiles().size() == 0) return false;
   std::string username = StringUtils::wideToUtf8(peer->getPlayerProfiles()[0]->getName());
-  const auto& kt = peer->getClientAssets();
 
   // Players who do not have the addon defined via /setfield are not allowed to play.
-  if (!m_set_field.empty())
-  {
-      bool has_addon = false;
-      for (auto& track : kt.second)
-      {
-          if (track == m_set_field)
-          {
-              has_addon = true;
-              break;
-          }
-      }
-      if (has_addon == false) return false;
-    }
-    return true;
+  if (!m_set_field.empty() && !peer->hasTrack(m_set_field))
+      return false;
+  return true;
 }   // canRace
 
 //-----------------------------------------------------------------------------
@@ -10379,7 +10915,7 @@ bool ServerLobby::voteForCommand(std::shared_ptr<STKPeer>& peer, std::string com
     if (!ServerConfig::m_command_voting) return false;
 
     std::string username = StringUtils::wideToUtf8(peer->getPlayerProfiles()[0]->getName());
-    int playerCount = STKHost::get()->getPeers().size();
+    int playerCount = STKHost::get()->getPeerCount();
 
     if (m_command_voters.count(command) == 0)
     {
@@ -10855,24 +11391,32 @@ int ServerLobby::loadPermissionLevelForOID(const uint32_t online_id)
             && online_id == ServerConfig::m_server_owner)
         return std::numeric_limits<int>::max();
 
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        auto it = m_permission_cache.find(online_id);
+        if (it != m_permission_cache.end())
+            return it->second;
+    }
+
     int lvl = 0;
-    char* errmsg;
     std::string query = StringUtils::insertValues(
-        "SELECT level FROM %s WHERE online_id = %u;",
-        ServerConfig::m_permissions_table.c_str(),
-        online_id);
-    sqlite3_exec(m_db, query.c_str(),
-            [](void* ptr, int amount, char** data, char** columns) {
-                int* target = (int*)ptr;
-                *target = std::atoi(data[0]);
-                return 0;
-            }, &lvl, &errmsg);
-    if (errmsg)
-    {
-        Log::error("ServerLobby", "loadPermissionLevelForOID failure: %s", errmsg);
-        sqlite3_free(errmsg);
+        "SELECT level FROM %s WHERE online_id = ?;",
+        ServerConfig::m_permissions_table.c_str());
+    if (!cachedSQLQuery(query,
+        [online_id](sqlite3_stmt* stmt)
+        {
+            sqlite3_bind_int64(stmt, 1, online_id);
+        },
+        [&lvl](sqlite3_stmt* stmt)
+        {
+            lvl = sqlite3_column_int(stmt, 0);
+        }))
+    {
+        Log::error("ServerLobby", "loadPermissionLevelForOID failure");
         return 0;
     }
+    std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+    m_permission_cache[online_id] = lvl;
     return lvl;
 #else
     return 0;
@@ -10884,13 +11428,20 @@ void ServerLobby::writePermissionLevelForOID(const uint32_t online_id, const int
     if (!m_db || !m_permissions_table_exists)
         return;
 
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        m_permission_cache[online_id] = lvl;
+    }
     std::string query = StringUtils::insertValues(
-        "INSERT INTO %s (online_id, level) VALUES (%u, %d) "
-        "ON CONFLICT (online_id) DO UPDATE SET level = %d;",
-        ServerConfig::m_permissions_table.c_str(),
-        online_id, lvl, lvl
-    );
-    easySQLQuery(query);
+        "INSERT INTO %s (online_id, level) VALUES (?1, ?2) "
+        "ON CONFLICT (online_id) DO UPDATE SET level = ?2;",
+        ServerConfig::m_permissions_table.c_str());
+    asyncCacheWrite(query,
+        [online_id, lvl](sqlite3_stmt* stmt)
+        {
+            sqlite3_bind_int64(stmt, 1, online_id);
+            sqlite3_bind_int(stmt, 2, lvl);
+        });
 #endif
 }
 void ServerLobby::writePermissionLevelForUsername(const core::stringw& name, const int lvl)
@@ -10899,16 +11450,26 @@ void ServerLobby::writePermissionLevelForUsername(const core::stringw& name, con
     if (!m_db || !m_permissions_table_exists)
         return;
 
+    // Online id 0 may be an unknown username or offline accounts, let the
+    // next load read it from database
+    uint32_t online_id = lookupOID(name);
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        if (online_id != 0)
+            m_permission_cache[online_id] = lvl;
+        else
+            m_permission_cache.erase(0);
+    }
     std::string query = StringUtils::insertValues(
         "INSERT INTO %s (online_id, level) "
-        "SELECT online_id, %d AS level FROM %s WHERE "
-        "username = ?"
-        "ON CONFLICT (online_id) DO UPDATE SET level = %d;",
+        "SELECT online_id, ?2 AS level FROM %s WHERE "
+        "username = ?1 "
+        "ON CONFLICT (online_id) DO UPDATE SET level = ?2;",
         (std::string) ServerConfig::m_permissions_table.c_str(),
-        lvl, m_server_stats_table, lvl
+        m_server_stats_table
     );
-    easySQLQuery(query,
-        [name](sqlite3_stmt* stmt)
+    asyncCacheWrite(query,
+        [name, lvl](sqlite3_stmt* stmt)
         {
             if ((sqlite3_bind_text(stmt, 1,
                     StringUtils::wideToUtf8(name).c_str(),
@@ -10918,7 +11479,7 @@ void ServerLobby::writePermissionLevelForUsername(const core::stringw& name, con
                 Log::error("easySQLQuery", "Failed to bind %s.",
                     name.c_str());
             }
-            return 0;
+            sqlite3_bind_int(stmt, 2, lvl);
         });
 #endif
 }
@@ -10928,37 +11489,37 @@ std::tuple<uint32_t, std::string> ServerLobby::loadRestrictionsForOID(const uint
     if (!m_db || !m_restrictions_table_exists)
         return std::make_tuple(0, "");
 
-    int res;
-    struct target {
-        uint32_t lvl = 0;
-        std::string kart_id;
-    } __target;
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        auto it = m_restrictions_cache.find(online_id);
+        if (it != m_restrictions_cache.end())
+            return it->second;
+    }
 
-    char* errmsg;
+    uint32_t lvl = 0;
+    std::string kart_id;
     std::string query = StringUtils::insertValues(
-        "SELECT flags, kart_id FROM %s WHERE online_id = %u;",
-        ServerConfig::m_restrictions_table.c_str(),
-        online_id);
-    res = sqlite3_exec(m_db, query.c_str(),
-            [](void* ptr, int amount, char** data, char** columns) {
-                struct target* target = (struct target*)ptr;
-                target->lvl = std::atol(data[0]);
-                char kart_buf[121];
-                if (data[1])
-                    std::strncpy(kart_buf, data[1], 120);
-                else
-                    kart_buf[0] = 0;
-                target->kart_id = std::string(kart_buf);
-                return 0;
-            }, &__target, &errmsg);
-    if (res != SQLITE_OK && errmsg)
-    {
-        Log::error("ServerLobby", "loadRestrictionsForOID failure: %s", errmsg);
-        sqlite3_free(errmsg);
-        return std::make_tuple(__target.lvl, __target.kart_id);
-    }
-    Log::verbose("ServerLobby", "%u restrictions = %u", online_id, __target.lvl);
-    return std::make_tuple(__target.lvl, __target.kart_id);
+        "SELECT flags, kart_id FROM %s WHERE online_id = ?;",
+        ServerConfig::m_restrictions_table.c_str());
+    if (!cachedSQLQuery(query,
+        [online_id](sqlite3_stmt* stmt)
+        {
+            sqlite3_bind_int64(stmt, 1, online_id);
+        },
+        [&lvl, &kart_id](sqlite3_stmt* stmt)
+        {
+            lvl = (uint32_t)sqlite3_column_int64(stmt, 0);
+            const char* c_kart_id = (const char*)sqlite3_column_text(stmt, 1);
+            kart_id = c_kart_id ? std::string(c_kart_id).substr(0, 120) : "";
+        }))
+    {
+        Log::error("ServerLobby", "loadRestrictionsForOID failure");
+        return std::make_tuple(lvl, kart_id);
+    }
+    Log::verbose("ServerLobby", "%u restrictions = %u", online_id, lvl);
+    std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+    m_restrictions_cache[online_id] = std::make_tuple(lvl, kart_id);
+    return std::make_tuple(lvl, kart_id);
 #else
     return 0;
 #endif
@@ -10966,53 +11527,15 @@ std::tuple<uint32_t, std::string> ServerLobby::loadRestrictionsForOID(const uint
 std::tuple<uint32_t, std::string> ServerLobby::loadRestrictionsForUsername(const core::stringw& name)
 {
 #ifdef ENABLE_SQLITE3
-    if (!m_db || !m_restrictions_table_exists)
-        return std::make_tuple(0, "");
-
     uint32_t df = PRF_OK;
-    int res;
     auto default_ = std::make_tuple(df, "");
-    std::string query = StringUtils::insertValues(
-        "SELECT flags, kart_id FROM %s AS r INNER JOIN %s AS s ON (r.online_id = s.online_id) WHERE username = ?;",
-        ServerConfig::m_restrictions_table.c_str(),
-        m_server_stats_table);
-    sqlite3_stmt* stmt = NULL;
-    res = sqlite3_prepare_v2(m_db, query.c_str(), query.size(), &stmt, NULL);
-    if (res != SQLITE_OK || !stmt)
-    {
-        Log::error("ServerLobby", "loadRestrictionsForUsername failure: %s",
-                sqlite3_errmsg(m_db));
-        return default_;
-    }
-    res = sqlite3_bind_text(stmt, 1, 
-            StringUtils::wideToUtf8(name).c_str(), -1, SQLITE_TRANSIENT);
-    if (res != SQLITE_OK)
-    {
-        Log::error("ServerLobby::loadRestrictionsForUsername", "Failed to bind %s.",
-            name.c_str());
+    if (!m_db || !m_restrictions_table_exists)
         return default_;
-    }
 
-    res = sqlite3_step(stmt);
-    if (res == SQLITE_DONE)
-    {
-        sqlite3_finalize(stmt);
+    uint32_t online_id = lookupOID(name);
+    if (online_id == 0)
         return default_;
-    }
-    if (res == SQLITE_ROW)
-    {
-        uint32_t flags = sqlite3_column_int(stmt, 0);
-        const char* c_kart_id = (const char*)sqlite3_column_text(stmt, 1);
-        std::string kart_id;
-        if (c_kart_id)
-            kart_id = c_kart_id;
-        sqlite3_finalize(stmt);
-        return std::make_tuple(flags, kart_id);
-    }
-    Log::error("ServerLobby", "loadRestrictionsForUsername failed to dispatch: %s",
-            sqlite3_errmsg(m_db));
-    sqlite3_finalize(stmt);
-    return default_;
+    return loadRestrictionsForOID(online_id);
 #else
     return 0;
 #endif
@@ -11023,13 +11546,22 @@ void ServerLobby::writeRestrictionsForOID(const uint32_t online_id, const uint32
     if (!m_db || !m_restrictions_table_exists)
         return;
 
+    auto restrictions = loadRestrictionsForOID(online_id);
+    std::get<0>(restrictions) = flags;
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        m_restrictions_cache[online_id] = restrictions;
+    }
     std::string query = StringUtils::insertValues(
-        "INSERT INTO %s (online_id, flags) VALUES (%u, %u) "
-        "ON CONFLICT (online_id) DO UPDATE SET flags = %u;",
-        ServerConfig::m_restrictions_table.c_str(),
-        online_id, flags, flags
-    );
-    easySQLQuery(query);
+        "INSERT INTO %s (online_id, flags) VALUES (?1, ?2) "
+        "ON CONFLICT (online_id) DO UPDATE SET flags = ?2;",
+        ServerConfig::m_restrictions_table.c_str());
+    asyncCacheWrite(query,
+        [online_id, flags](sqlite3_stmt* stmt)
+        {
+            sqlite3_bind_int64(stmt, 1, online_id);
+            sqlite3_bind_int64(stmt, 2, flags);
+        });
 #endif
 }
 void ServerLobby::writeRestrictionsForOID(const uint32_t online_id, const uint32_t flags,
@@ -11039,14 +11571,16 @@ void ServerLobby::writeRestrictionsForOID(const uint32_t online_id, const uint32
     if (!m_db || !m_restrictions_table_exists)
         return;
 
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        m_restrictions_cache[online_id] = std::make_tuple(flags, kart_id);
+    }
     std::string query = StringUtils::insertValues(
-        "INSERT INTO %s (online_id, flags, kart_id) VALUES (%u, %u, ?1) "
-        "ON CONFLICT (online_id) DO UPDATE SET flags = %u, kart_id = ?1;",
-        ServerConfig::m_restrictions_table.c_str(),
-        online_id, flags, flags
-    );
-    easySQLQuery(query,
-        [kart_id](sqlite3_stmt* stmt)
+        "INSERT INTO %s (online_id, flags, kart_id) VALUES (?2, ?3, ?1) "
+        "ON CONFLICT (online_id) DO UPDATE SET flags = ?3, kart_id = ?1;",
+        ServerConfig::m_restrictions_table.c_str());
+    asyncCacheWrite(query,
+        [online_id, flags, kart_id](sqlite3_stmt* stmt)
         {
             if (kart_id.empty() ? (sqlite3_bind_null(stmt, 1) != SQLITE_OK)
                     :
@@ -11058,6 +11592,8 @@ void ServerLobby::writeRestrictionsForOID(const uint32_t online_id, const uint32
                 Log::error("easySQLQuery", "Failed to bind %s.",
                     kart_id.c_str());
             }
+            sqlite3_bind_int64(stmt, 2, online_id);
+            sqlite3_bind_int64(stmt, 3, flags);
         });
 #endif
 }
@@ -11067,14 +11603,18 @@ void ServerLobby::writeRestrictionsForOID(const uint32_t online_id, const std::s
     if (!m_db || !m_restrictions_table_exists)
         return;
 
+    auto restrictions = loadRestrictionsForOID(online_id);
+    std::get<1>(restrictions) = kart_id;
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        m_restrictions_cache[online_id] = restrictions;
+    }
     std::string query = StringUtils::insertValues(
-        "INSERT INTO %s (online_id, kart_id) VALUES (%u, ?1) "
+        "INSERT INTO %s (online_id, kart_id) VALUES (?2, ?1) "
         "ON CONFLICT (online_id) DO UPDATE SET kart_id = ?1;",
-        ServerConfig::m_restrictions_table.c_str(),
-        online_id
-    );
-    easySQLQuery(query,
-        [kart_id](sqlite3_stmt* stmt)
+        ServerConfig::m_restrictions_table.c_str());
+    asyncCacheWrite(query,
+        [online_id, kart_id](sqlite3_stmt* stmt)
         {
             if (kart_id.empty() ? (sqlite3_bind_null(stmt, 1) != SQLITE_OK)
                     :
@@ -11086,6 +11626,7 @@ void ServerLobby::writeRestrictionsForOID(const uint32_t online_id, const std::s
                 Log::error("easySQLQuery", "Failed to bind %s.",
                     kart_id.c_str());
             }
+            sqlite3_bind_int64(stmt, 2, online_id);
         });
 #endif
 }
@@ -11095,16 +11636,28 @@ void ServerLobby::writeRestrictionsForUsername(const core::stringw& name, const
     if (!m_db || !m_restrictions_table_exists)
         return;
 
+    uint32_t online_id = lookupOID(name);
+    if (online_id != 0)
+    {
+        writeRestrictionsForOID(online_id, flags);
+        return;
+    }
+    // Unknown username or offline accounts, let the next load read it from
+    // database
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        m_restrictions_cache.erase(0);
+    }
     std::string query = StringUtils::insertValues(
         "INSERT INTO %s (online_id, flags) "
-        "SELECT online_id, %d AS flags FROM %s WHERE "
-        "username = ?"
-        "ON CONFLICT (online_id) DO UPDATE SET flags = %d;",
+        "SELECT online_id, ?2 AS flags FROM %s WHERE "
+        "username = ?1 "
+        "ON CONFLICT (online_id) DO UPDATE SET flags = ?2;",
         ServerConfig::m_restrictions_table.c_str(),
-        flags, m_server_stats_table, flags
+        m_server_stats_table
     );
-    easySQLQuery(query,
-        [name](sqlite3_stmt* stmt)
+    asyncCacheWrite(query,
+        [name, flags](sqlite3_stmt* stmt)
         {
             if ((sqlite3_bind_text(stmt, 1,
                     StringUtils::wideToUtf8(name).c_str(),
@@ -11114,7 +11667,7 @@ void ServerLobby::writeRestrictionsForUsername(const core::stringw& name, const
                 Log::error("easySQLQuery", "Failed to bind %s.",
                     name.c_str());
             }
-            return 0;
+            sqlite3_bind_int64(stmt, 2, flags);
         });
 #endif
 }
@@ -11125,16 +11678,26 @@ void ServerLobby::writeRestrictionsForUsername(const core::stringw& name, const
     if (!m_db || !m_restrictions_table_exists)
         return;
 
+    uint32_t online_id = lookupOID(name);
+    if (online_id != 0)
+    {
+        writeRestrictionsForOID(online_id, flags, kart_id);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        m_restrictions_cache.erase(0);
+    }
     std::string query = StringUtils::insertValues(
         "INSERT INTO %s (online_id, flags, kart_id) "
-        "SELECT online_id, %d AS flags, ?1 AS kart_id FROM %s WHERE "
-        "username = ?2"
-        "ON CONFLICT (online_id) DO UPDATE SET flags = %d, kart_id = ?1;",
+        "SELECT online_id, ?3 AS flags, ?1 AS kart_id FROM %s WHERE "
+        "username = ?2 "
+        "ON CONFLICT (online_id) DO UPDATE SET flags = ?3, kart_id = ?1;",
         ServerConfig::m_restrictions_table.c_str(),
-        flags, m_server_stats_table, flags
+        m_server_stats_table
     );
-    easySQLQuery(query,
-        [name, kart_id](sqlite3_stmt* stmt)
+    asyncCacheWrite(query,
+        [name, flags, kart_id](sqlite3_stmt* stmt)
         {
             if (kart_id.empty() ? (sqlite3_bind_null(stmt, 1) != SQLITE_OK)
                     :
@@ -11154,7 +11717,7 @@ void ServerLobby::writeRestrictionsForUsername(const core::stringw& name, const
                 Log::error("easySQLQuery", "Failed to bind %s.",
                     name.c_str());
             }
-            return 0;
+            sqlite3_bind_int64(stmt, 3, flags);
         });
 #endif
 }
@@ -11165,15 +11728,25 @@ void ServerLobby::writeRestrictionsForUsername(const core::stringw& name,
     if (!m_db || !m_restrictions_table_exists)
         return;
 
+    uint32_t online_id = lookupOID(name);
+    if (online_id != 0)
+    {
+        writeRestrictionsForOID(online_id, kart_id);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        m_restrictions_cache.erase(0);
+    }
     std::string query = StringUtils::insertValues(
         "INSERT INTO %s (online_id, kart_id) "
         "SELECT online_id, ?1 AS kart_id FROM %s WHERE "
-        "username = ?2"
+        "username = ?2 "
         "ON CONFLICT (online_id) DO UPDATE SET kart_id = ?1;",
         ServerConfig::m_restrictions_table.c_str(),
         m_server_stats_table
     );
-    easySQLQuery(query,
+    asyncCacheWrite(query,
         [name, kart_id](sqlite3_stmt* stmt)
         {
             if (kart_id.empty() ? (sqlite3_bind_null(stmt, 1) != SQLITE_OK)
@@ -11221,98 +11794,59 @@ uint32_t ServerLobby::lookupOID(const std::string& name)
     if (name.empty() || !m_db)
         return 0;
 
+    {
+        std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+        auto it = m_online_id_cache.find(name);
+        if (it != m_online_id_cache.end())
+            return it->second;
+    }
+
     std::string query = StringUtils::insertValues(
         "SELECT online_id FROM %s WHERE username = ? LIMIT 1;",
         m_server_stats_table
     );
-    sqlite3_stmt* stmt = NULL;
-    int res = sqlite3_prepare_v2(m_db, query.c_str(), query.size(), &stmt, NULL);
-    if (res != SQLITE_OK || !stmt)
-    {
-        Log::error("ServerLobby", "Error in lookupOID, sqlite3_prepare_v2 returned %d: %s",
-                res, sqlite3_errmsg(m_db));
-        return 0;
-    }
-    res = sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
-    if (res != SQLITE_OK)
+    uint32_t online_id = 0;
+    bool found = false;
+    bool success = cachedSQLQuery(query,
+        [name](sqlite3_stmt* stmt)
+        {
+            if (sqlite3_bind_text(stmt, 1, name.c_str(), -1,
+                SQLITE_TRANSIENT) != SQLITE_OK)
+            {
+                Log::error("ServerLobby::lookupOID", "Failed to bind %s.",
+                    name.c_str());
+            }
+        },
+        [&online_id, &found](sqlite3_stmt* stmt)
+        {
+            online_id = sqlite3_column_int(stmt, 0);
+            found = true;
+        });
+    if (!success)
     {
-        Log::error("ServerLobby::lookupOID", "Failed to bind %s.",
+        Log::error("ServerLobby", "Error in lookupOID for %s.",
             name.c_str());
         return 0;
     }
-
-    res = sqlite3_step(stmt);
-    if (res == SQLITE_ROW)
-    {
-        uint32_t ret = sqlite3_column_int(stmt, 0);
-        sqlite3_finalize(stmt);
-        return ret;
-    }
-    if (res == SQLITE_DONE)
+    if (!found)
     {
+        // Not cached, the player may join later
         Log::verbose("ServerLobby", "lookupOID: %s not found.",
                 name.c_str());
-        sqlite3_finalize(stmt);
-        // not found
         return 0;
     }
-    // error occurred
-    Log::error("ServerLobby", "Error in lookupOID, step returned %d: %s",
-            res, sqlite3_errmsg(m_db));
-    sqlite3_finalize(stmt);
-#endif
+    Log::verbose("ServerLobby", "lookupOID: %s = %d.", name.c_str(),
+        online_id);
+    std::lock_guard<std::mutex> lock(m_db_cache_mutex);
+    m_online_id_cache[name] = online_id;
+    return online_id;
+#else
     return 0;
+#endif
 }
 uint32_t ServerLobby::lookupOID(const core::stringw& name)
 {
-#ifdef ENABLE_SQLITE3
-    if (name.empty() || !m_db)
-        return 0;
-
-    std::string query = StringUtils::insertValues(
-        "SELECT online_id FROM %s WHERE username = ? LIMIT 1;",
-        m_server_stats_table
-    );
-    sqlite3_stmt* stmt = NULL;
-    int res = sqlite3_prepare_v2(m_db, query.c_str(), query.size(), &stmt, NULL);
-    if (res != SQLITE_OK || !stmt)
-    {
-        Log::error("ServerLobby", "Error in lookupOID, sqlite3_prepare_v2 returned %d: %s",
-                res, sqlite3_errmsg(m_db));
-        return 0;
-    }
-    res = sqlite3_bind_text(stmt, 1, StringUtils::wideToUtf8(name).c_str(), -1, SQLITE_TRANSIENT);
-    if (res != SQLITE_OK)
-    {
-        Log::error("ServerLobby::lookupOID", "Failed to bind %s.",
-            name.c_str());
-        return 0;
-    }
-
-    res = sqlite3_step(stmt);
-    if (res == SQLITE_ROW)
-    {
-        uint32_t ret = sqlite3_column_int(stmt, 0);
-        Log::verbose("ServerLobby", "lookupOID: %s = %d.",
-                StringUtils::wideToUtf8(name).c_str(),
-                ret);
-        sqlite3_finalize(stmt);
-        return ret;
-    }
-    if (res == SQLITE_DONE)
-    {
-        Log::verbose("ServerLobby", "lookupOID: %s not found.",
-                StringUtils::wideToUtf8(name).c_str());
-        sqlite3_finalize(stmt);
-        // not found
-        return 0;
-    }
-    // error occurred
-    Log::error("ServerLobby", "Error in lookupOID, step returned %d: %s",
-            res, sqlite3_errmsg(m_db));
-    sqlite3_finalize(stmt);
-#endif
-    return 0;
+    return lookupOID(StringUtils::wideToUtf8(name));
 }
 int ServerLobby::banPlayer(const std::string& name, const std::string& reason, const int days)
 {
@@ -11636,52 +12170,9 @@ int ServerLobby::loadPermissionLevelForUsername(const core::stringw& name)
         return PERM_PLAYER;
 
     uint32_t online_id = lookupOID(name);
-    if (ServerConfig::m_server_owner != -1 
-            && online_id == ServerConfig::m_server_owner)
-        return std::numeric_limits<int>::max();
-
-    std::string query = StringUtils::insertValues(
-            "SELECT p.level FROM %s AS p"
-            " INNER JOIN %s AS s ON (p.online_id = s.online_id) WHERE s.username = ?;",
-            ServerConfig::m_permissions_table.c_str(),
-            m_server_stats_table
-            );
-    sqlite3_stmt* stmt = NULL;
-    int res = sqlite3_prepare_v2(m_db, query.c_str(), query.size(), &stmt, NULL);
-    if (res != SQLITE_OK || !stmt)
-    {
-        Log::error("ServerLobby::loadPermissionLevelForUsername", "Unable to prepare the statement: %d, %s",
-                res, sqlite3_errmsg(m_db));
-        return PERM_PLAYER;
-    }
-
-    res = sqlite3_bind_text(stmt, 1, StringUtils::wideToUtf8(name).c_str(), -1, SQLITE_TRANSIENT);
-    if (res != SQLITE_OK)
-    {
-        Log::error("ServerLobby::loadPermissionLevelForUsername", "Failed to bind arg #1.");
-        return PERM_PLAYER;
-    }
-
-    res = sqlite3_step(stmt);
-    if (res == SQLITE_DONE)
-    {
-        // nothing found
-        sqlite3_finalize(stmt);
-        return PERM_PLAYER;
-    }
-    else if (res == SQLITE_ROW)
-    {
-        uint32_t result = sqlite3_column_int(stmt, 0);
-        sqlite3_finalize(stmt);
-        return result;
-    }
-    else 
-    {
-        Log::error("ServerLobby::loadPermissionLevelForUsername", "Unable to execute the statement: %d, %s",
-                res, sqlite3_errmsg(m_db));
-        sqlite3_finalize(stmt);
+    if (online_id == 0)
         return PERM_PLAYER;
-    }
+    return loadPermissionLevelForOID(online_id);
 #else
     return PERM_PLAYER;
 #endif
@@ -11827,7 +12318,35 @@ std::pair<std::vector<std::string>, std::vector<std::string>> ServerLobby::creat
     int min_elo_diff = INT_MAX;
     int optimal_teams = -1;
 
-    for (int teams = 0; teams < pow(2, num_players - 1); teams++)
+    // Trying all splits is exponential, with many players the strongest
+    // remaining player joins the team with less total ELO instead
+    if (num_players > 16)
+    {
+        std::vector<std::pair<std::string, int> > sorted = elo_players;
+        std::stable_sort(sorted.begin(), sorted.end(),
+            [](const std::pair<std::string, int>& a,
+               const std::pair<std::string, int>& b)
+            { return a.second > b.second; });
+        std::vector<std::string> red_team, blue_team;
+        int elo_red = 0, elo_blue = 0;
+        for (auto& p : sorted)
+        {
+            if (elo_red <= elo_blue)
+            {
+                red_team.push_back(p.first);
+                elo_red += p.second;
+            }
+            else
+            {
+                blue_team.push_back(p.first);
+                elo_blue += p.second;
+            }
+        }
+        return std::make_pair(red_team, blue_team);
+    }
+
+    const int splits = num_players > 0 ? 1 << (num_players - 1) : 1;
+    for (int teams = 0; teams < splits; teams++)
     {
         int elo_red = 0, elo_blue = 0;
         for (int player_idx = 0; player_idx < num_players; player_idx++)
@@ -12102,60 +12621,47 @@ void ServerLobby::resetKartSelections()
                 }
         }
 }
-// ========================================================================
-// Executes the Python script for track records and returns its output
-
-std::string ServerLobby::exec_python_script()
-{
-    std::array<char, 1024> buffer;
-    std::string result;
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(
-        popen("python3 track_records.py", "r"), pclose);
-
-    if (!pipe)
-    {
-        throw std::runtime_error("popen() failed!");
-    }
-
-    while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr)
-    {
-        result += buffer.data();
-    }
+//-----------------------------------------------------------------------------
+/** Returns the message with the current record of the track, direction and
+ *  laps of the race which is starting. */
+std::string ServerLobby::getTrackRecordMessage() const
+{
+    RaceManager* rm = RaceManager::get();
+    std::string race = rm->getTrackName() +
+        (rm->getReverseTrack() ? " (reverse, " : " (") +
+        StringUtils::toString(rm->getNumLaps()) + " laps)";
+    TrackRecords::Record record;
+    if (!TrackRecords::get()->getRecord(rm->getTrackName(),
+        RaceManager::getIdentOf(rm->getMinorMode()), rm->getReverseTrack(),
+        rm->getNumLaps(), &record))
+        return "No record yet on " + race;
+    return "Record on " + race + ": " +
+        StringUtils::timeToString(record.m_time) + " by " +
+        TrackRecords::getDisplayName(record.m_player) + " with " +
+        record.m_kart;
+}   // getTrackRecordMessage
 
-    return result;
-}
 // =========================================================================
 // Gets a player's soccer ranking and rating from the ranking file
 // Returns a pair containing:
 // - first: player's rank (or max unsigned int if not found)
 // - second: player's rating (or 0 if not found)
-// Reads through ranking file line by line to find matching username
+// Looks the username up in the in-memory copy of the ranking file
 
 std::pair<unsigned int, int> ServerLobby::getSoccerRanking(std::string username) const
 {
-    std::ifstream file(ServerConfig::m_soccer_ranking_path.c_str());
-    std::string line, name;
-    int rank = 1;
-    int rating;
-    while (std::getline(file, line))
-    {
-        std::istringstream iss(line);
-        iss >> name;
-        std::string word;
-        while (iss >> word) {
-            rating = std::stoi(word);
-        }
-        if (name == username)
-            return std::make_pair(rank, rating);
-        rank++;
-    }
+    auto rankings =
+        SoccerRanking::getRankings(ServerConfig::m_soccer_ranking_path);
+    const SoccerRanking::RankingEntry* re =
+        rankings ? rankings->find(username) : NULL;
+    if (re)
+        return std::make_pair(re->m_rank, re->m_elo);
     return std::make_pair(std::numeric_limits<unsigned int>::max(), 0);
 }
 //=========================================================================
 // Checks if a player has all required standard tracks installed (except for allowed exceptions)
 bool ServerLobby::checkAllStandardContentInstalled(std::shared_ptr<STKPeer> peer)
 {
-    const auto& client_assets = peer->getClientAssets();
     std::vector<std::string> missing_tracks;
     std::set<std::string> allowed_missing_tracks = {"hole_drop", "oasis"};
     const std::vector<std::string>& all_track_ids = track_manager->getAllTrackIdentifiers();   
@@ -12165,7 +12671,7 @@ bool ServerLobby::checkAllStandardContentInstalled(std::shared_ptr<STKPeer> peer
             continue;      
         Track* track = track_manager->getTrack(track_id);
         if (track && !track->isAddon() && 
-            client_assets.second.find(track_id) == client_assets.second.end())
+            !peer->hasTrack(track_id))
         {
             missing_tracks.push_back(track_id);
         }
@@ -24,6 +24,7 @@
 #include "race/race_manager.hpp"
 #include "race/kart_restriction.hpp"
 #include "utils/cpp2011.hpp"
+#include "utils/dynamic_bitset.hpp"
 #include "utils/time.hpp"
 #include "network/servers_manager.hpp"
 
@@ -38,12 +39,17 @@
 #include <memory>
 #include <mutex>
 #include <set>
+#include <tuple>
+#include <unordered_map>
 
 #ifdef ENABLE_SQLITE3
 #include <sqlite3.h>
 #endif
 
 class BareNetworkString;
+class DatabaseWorker;
+class GeolocationIndex;
+class IPBanIndex;
 class NetworkItemManager;
 class NetworkString;
 class NetworkPlayerProfile;
@@ -113,6 +119,52 @@ public:
                                  // including giving the administrator permission level.
                                  // Specified in the configuration file.
     };
+
+    /* Chat commands handled by handleServerCommand. */
+    enum ServerCommandType : uint8_t
+    {
+        SC_UNKNOWN,
+        SC_SPECTATE, SC_ADDTIME, SC_SCORE, SC_TEAMCHAT, SC_TO, SC_SLOTS,
+        SC_PUBLIC, SC_LISTSERVERADDON, SC_PLAYERHASADDON, SC_KICK,
+        SC_PLAYERADDONSCORE, SC_SERVERHASADDON, SC_RANK, SC_FEATURE,
+        SC_REPORT, SC_HEAVYPARTY, SC_MEDIUMPARTY, SC_LIGHTPARTY, SC_BOWLPARTY,
+        SC_BOWLTRAININGPARTY, SC_ITEMLESS, SC_NITROLESS, SC_CAKEPARTY,
+        SC_SCANSERVERS, SC_MUTE, SC_UNMUTE, SC_LISTMUTE, SC_SHOWCOMMANDS,
+        SC_POLE, SC_SEEN, SC_DATE, SC_VETO, SC_START, SC_HELP, SC_WEBSITE,
+        SC_DISCORD, SC_TRACKS, SC_KARTS, SC_WHEN, SC_RANDOMKARTS,
+        SC_RESETPUCK, SC_REPLAY, SC_RESULTS, SC_AUTOTEAMS, SC_GOAL_HISTORY,
+        SC_END, SC_BAN, SC_UNBAN, SC_RESTRICT, SC_RESTRICT_SHORTCUT,
+        SC_SETTEAM, SC_SETKART, SC_SETFIELD, SC_SETHANDICAP, SC_SETOWNER,
+        SC_SETMODE, SC_SETDIFFICULTY, SC_SETGOALTARGET, SC_HACKITEM,
+        SC_HACKNITRO, SC_ITEM, SC_NITRO, SC_INFINITE,
+        SC_COUNT
+    };
+
+    /* Entry of the chat command table. */
+    struct ServerCommand
+    {
+        ServerCommandType m_type;
+        /* Name followed by the aliases, separated by '|'. */
+        const char* m_names;
+        /* Permission level to use the command without voting. */
+        int m_permission;
+        /* True if players below m_permission can vote for the command. */
+        bool m_votable;
+        /* Shown by /help, NULL if there is none. */
+        const char* m_usage;
+        /* If not NULL, the command is only available when it returns true,
+         * otherwise the next command with the same name is used. */
+        bool (*m_available)(const std::vector<std::string>& argv);
+    };
+
+    /* Handling time of chat commands, see /commandstats in the network
+     * console. */
+    struct ServerCommandStats
+    {
+        uint64_t m_count;
+        uint64_t m_total_us;
+        uint64_t m_max_us;
+    };
 private:
     bool checkAllStandardContentInstalled(std::shared_ptr<STKPeer> peer);
     bool m_random_karts_enabled;
@@ -121,7 +173,7 @@ private:
     std::string m_replay_dir;
     bool m_replay_requested = false;    
     std::string getTimeStamp();    
-    std::string exec_python_script();    
+    std::string getTrackRecordMessage() const;    
     std::string currentTrackName;
     std::string currentPlayerName;
     std::string currentRecordTime;
@@ -138,6 +190,43 @@ private:
 #ifdef ENABLE_SQLITE3
     sqlite3* m_db;
 
+    /* Runs the queries which do not need their result immediately in a
+     * separate thread with its own connection. */
+    std::unique_ptr<DatabaseWorker> m_db_worker;
+
+    /* Prepared statements of the synchronous queries keyed by query text,
+     * guarded by m_db_statements_mutex while one is running. */
+    std::map<std::string, sqlite3_stmt*> m_db_statements;
+
+    std::mutex m_db_statements_mutex;
+
+    /* Write-through caches of the permission and restriction tables keyed
+     * by online id, and of username to online id lookups. They are cleared
+     * when the database is polled (if no cached write is still queued), so
+     * changes made by other tools are picked up. */
+    std::mutex m_db_cache_mutex;
+
+    std::unordered_map<uint32_t, int> m_permission_cache;
+
+    std::unordered_map<uint32_t, std::tuple<uint32_t, std::string> >
+        m_restrictions_cache;
+
+    std::unordered_map<std::string, uint32_t> m_online_id_cache;
+
+    unsigned m_db_cache_pending_writes;
+
+    /* In-memory copies of the IP ban and geolocation tables, replaced as a
+     * whole when the database worker reloads them. */
+    mutable std::mutex m_ip_index_mutex;
+
+    std::shared_ptr<const IPBanIndex> m_ip_ban_index;
+
+    std::shared_ptr<const IPBanIndex> m_ipv6_ban_index;
+
+    std::shared_ptr<const GeolocationIndex> m_ip_geolocation_index;
+
+    std::shared_ptr<const GeolocationIndex> m_ipv6_geolocation_index;
+
     std::string m_server_stats_table;
 
     bool m_ip_ban_table_exists;
@@ -161,8 +250,23 @@ private:
     bool easySQLQuery(const std::string& query,
         std::function<void(sqlite3_stmt* stmt)> bind_function = nullptr) const;
 
+    void asyncSQLQuery(const std::string& query,
+        std::function<void(sqlite3_stmt* stmt)> bind_function = nullptr,
+        std::function<void(bool)> callback = nullptr) const;
+
+    bool cachedSQLQuery(const std::string& query,
+        std::function<void(sqlite3_stmt* stmt)> bind_function,
+        std::function<void(sqlite3_stmt* stmt)> row_function);
+
+    void asyncCacheWrite(const std::string& query,
+        std::function<void(sqlite3_stmt* stmt)> bind_function = nullptr);
+
     void checkTableExists(const std::string& table, bool& result);
 
+    void reloadIPIndexes();
+
+    void kickIPBannedPeers();
+
     std::string ip2Country(const SocketAddress& addr) const;
 
     std::string ipv62Country(const SocketAddress& addr) const;
@@ -172,6 +276,10 @@ private:
 
     void destroyDatabase();
 
+    mutable std::mutex m_command_stats_mutex;
+
+    ServerCommandStats m_command_stats[SC_COUNT];
+
     std::atomic<ServerState> m_state;
 
     /* The state used in multiple threads when reseting server. */
@@ -211,6 +319,20 @@ private:
     /** Addon soccers available in server. */
     std::set<std::string> m_addon_soccers;
 
+    /** AssetIds of the official and addon karts and tracks above, to count
+     *  the ones which a client has. */
+    DynamicBitset m_official_kart_ids;
+
+    DynamicBitset m_official_track_ids;
+
+    DynamicBitset m_addon_kart_ids;
+
+    DynamicBitset m_addon_track_ids;
+
+    DynamicBitset m_addon_arena_ids;
+
+    DynamicBitset m_addon_soccer_ids;
+
     /** Available karts and tracks for all clients, this will be initialized
      *  with data in server first. */
     std::pair<std::set<std::string>, std::set<std::string> > m_available_kts;
@@ -420,6 +542,7 @@ private:
     void setPlayerKarts(const NetworkString& ns, STKPeer* peer) const;
     bool handleAssets(const NetworkString& ns, STKPeer* peer);
     void handleServerCommand(Event* event, std::shared_ptr<STKPeer> peer);
+    void addServerCommandTime(ServerCommandType type, uint64_t us);
     void liveJoinRequest(Event* event);
     void rejectLiveJoin(STKPeer* peer, BackLobbyReason blr);
     bool canLiveJoinNow() const;
@@ -431,13 +554,19 @@ private:
     void clientSelectingAssetsWantsToBackLobby(Event* event);
     std::set<std::shared_ptr<STKPeer>> getSpectatorsByLimit();
     void kickPlayerWithReason(STKPeer* peer, const char* reason) const;
-    void testBannedForIP(STKPeer* peer) const;
-    void testBannedForIPv6(STKPeer* peer) const;
-    void testBannedForOnlineId(STKPeer* peer, uint32_t online_id) const;
+    void testBannedForIP(std::shared_ptr<STKPeer> peer) const;
+    void testBannedForIPv6(std::shared_ptr<STKPeer> peer) const;
+    void testBannedForOnlineId(std::shared_ptr<STKPeer> peer,
+                               uint32_t online_id) const;
+    void handleBanTestedConnection(std::shared_ptr<STKPeer> peer,
+                                   BareNetworkString& data,
+                                   unsigned player_count, uint32_t online_id,
+                                   uint32_t encrypted_size);
     void writeDisconnectInfoTable(STKPeer* peer);
     void writePlayerReport(Event* event);
     bool supportsAI();
     void updateAddons();
+    static DynamicBitset toAssetIds(const std::set<std::string>& idents);
 public:
              ServerLobby();
     virtual ~ServerLobby();
@@ -527,6 +656,10 @@ public:
     bool canRace(std::shared_ptr<STKPeer>& peer) const;
     bool canRace(STKPeer* peer) const;
     static int m_fixed_laps;
+    static const ServerCommand* findServerCommand(
+                                        const std::vector<std::string>& argv);
+    static const ServerCommand* getServerCommand(ServerCommandType type);
+    std::vector<ServerCommandStats> getServerCommandStats() const;
     void sendStringToPeer(const std::string& s, std::shared_ptr<STKPeer>& peer) const;
     void sendStringToPeer(const irr::core::stringw& s, std::shared_ptr<STKPeer>& peer) const;
     void sendStringToAllPeers(std::string& s);
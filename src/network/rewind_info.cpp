@@ -82,6 +82,15 @@ void RewindInfoState::restore()
     {
         const uint16_t data_size = m_buffer->getUInt16();
         const unsigned current_offset_now = m_buffer->getCurrentOffset();
+        // Only karts are left out of a state by the server, with an empty
+        // state. Other rewinders can save an empty state, like the item
+        // manager without item events, which still needs to be restored.
+        if (data_size == 0 && name.size() == 2 && name[0] == RN_KART)
+        {
+            // It is kept out of the rewind by the rewind manager
+            RewindManager::get()->setLeftOutOfState(name);
+            continue;
+        }
         std::shared_ptr<Rewinder> r =
             RewindManager::get()->getRewinder(name);
 
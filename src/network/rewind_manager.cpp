@@ -20,6 +20,8 @@
 
 #include "graphics/irr_driver.hpp"
 #include "modes/soccer_world.hpp"
+#include "karts/controller/kart_control.hpp"
+#include "network/compress_network_body.hpp"
 #include "network/network_config.hpp"
 #include "network/network_string.hpp"
 #include "network/protocols/game_protocol.hpp"
@@ -34,6 +36,8 @@
 #include "tracks/track_object_manager.hpp"
 #include "utils/log.hpp"
 #include "utils/profiler.hpp"
+#include "utils/time.hpp"
+#include "utils/tracer.hpp"
 
 #include <algorithm>
 
@@ -64,6 +68,7 @@ void RewindManager::destroy()
  */
 RewindManager::RewindManager()
 {
+    m_kart_state_buffer.reset(new BareNetworkString());
     reset();
 }   // RewindManager
 
@@ -155,29 +160,23 @@ void RewindManager::addNetworkState(BareNetworkString *buffer, int ticks)
 void RewindManager::saveState()
 {
     PROFILER_PUSH_CPU_MARKER("RewindManager - save state", 0x20, 0x7F, 0x20);
+    TRACE_SCOPE("RewindManager - save state");
     auto gp = GameProtocol::lock();
     if (!gp)
         return;
     gp->startNewState();
 
     m_overall_state_size = 0;
-    std::vector<std::string> rewinder_using;
+    m_rewinder_using.clear();
 
     for (auto& p : m_all_rewinder)
     {
-        // TODO: check if it's worth passing in a sufficiently large buffer from
-        // GameProtocol - this would save the copy operation.
-        BareNetworkString* buffer = NULL;
+        // Each rewinder writes directly into the state buffer of
+        // GameProtocol, which is reused for every state
         if (auto r = p.second.lock())
-            buffer = r->saveState(&rewinder_using);
-        if (buffer != NULL)
-        {
-            m_overall_state_size += buffer->size();
-            gp->addState(buffer);
-        }
-        delete buffer;    // buffer can be freed
+            m_overall_state_size += gp->addState(r.get(), &m_rewinder_using);
     }
-    gp->finalizeState(rewinder_using);
+    gp->finalizeState(m_rewinder_using);
     PROFILER_POP_CPU_MARKER();
 }   // saveState
 
@@ -216,7 +215,10 @@ void RewindManager::update(int ticks_not_used)
         saveState();
         PROFILER_PUSH_CPU_MARKER("RewindManager - send state", 0x20, 0x7F, 0x40);
         if (auto gp = GameProtocol::lock())
+        {
+            TRACE_SCOPE("RewindManager - send state");
             gp->sendState();
+        }
     }
     PROFILER_POP_CPU_MARKER();
 }   // update
@@ -246,6 +248,7 @@ void RewindManager::playEventsTill(int world_ticks, bool fast_forward)
     {
         Log::setPrefix("Rewind");
         PROFILER_PUSH_CPU_MARKER("Rewind", 128, 128, 128);
+        TRACE_SCOPE("Rewind");
         rewindTo(rewind_ticks, world_ticks, fast_forward);
         // This should replay everything up to 'now'
         assert(World::getWorld()->getTicksSinceStart() == world_ticks);
@@ -306,6 +309,7 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
         if (auto r = p.second.lock())
             r->saveTransform();
     }
+    saveKartStates();
 
     // Then undo the rewind infos going backwards in time
     // --------------------------------------------------
@@ -395,6 +399,8 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
 
     }   // while (world->getTicks() < current_ticks)
 
+    restoreLeftOutKarts();
+
     // Now compute the errors which need to be visually smoothed
     for (auto& p : m_all_rewinder)
     {
@@ -407,6 +413,83 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
     mergeRewindInfoEventFunction();
 }   // rewindTo
 
+// ----------------------------------------------------------------------------
+/** Saves the state of all karts before a rewind. The server can leave far
+ *  karts out of a state (see state-interest-distance), they are sent without
+ *  data then. Such karts are not restored by the state and would be simulated
+ *  again over the whole rewind starting from their current transform, so
+ *  restoreLeftOutKarts puts them back to the saved state after the rewind.
+ */
+void RewindManager::saveKartStates()
+{
+    m_kart_states.clear();
+    m_kart_state_buffer->getBuffer().clear();
+    m_kart_state_buffer->reset();
+    const auto& caps = NetworkConfig::get()->getServerCapabilities();
+    if (caps.find("partial_state") == caps.end())
+        return;
+    std::vector<std::string> ru;
+    for (auto& p : m_all_rewinder)
+    {
+        if (p.first.empty() || p.first[0] != RN_KART)
+            continue;
+        std::shared_ptr<Rewinder> r = p.second.lock();
+        if (!r)
+            continue;
+        auto& buffer = m_kart_state_buffer->getBuffer();
+        const unsigned offset = (unsigned)buffer.size();
+        if (!r->saveState(m_kart_state_buffer.get(), &ru))
+        {
+            buffer.resize(offset);
+            continue;
+        }
+        KartStateBeforeRewind ks;
+        ks.m_rewinder = r;
+        ks.m_offset = offset;
+        ks.m_size = (unsigned)buffer.size() - offset;
+        ks.m_left_out = false;
+        m_kart_states.push_back(ks);
+    }
+}   // saveKartStates
+
+// ----------------------------------------------------------------------------
+/** Called by RewindInfoState::restore for a rewinder sent without data.
+ */
+void RewindManager::setLeftOutOfState(const std::string& name)
+{
+    for (KartStateBeforeRewind& ks : m_kart_states)
+    {
+        if (ks.m_rewinder->getUniqueIdentity() == name)
+            ks.m_left_out = true;
+    }
+}   // setLeftOutOfState
+
+// ----------------------------------------------------------------------------
+/** Restores the karts left out of the state rewound to to the state saved by
+ *  saveKartStates, see there.
+ */
+void RewindManager::restoreLeftOutKarts()
+{
+    for (KartStateBeforeRewind& ks : m_kart_states)
+    {
+        if (!ks.m_left_out)
+            continue;
+        m_kart_state_buffer->reset();
+        m_kart_state_buffer->skip(ks.m_offset);
+        try
+        {
+            ks.m_rewinder->restoreState(m_kart_state_buffer.get(),
+                ks.m_size);
+        }
+        catch (std::exception& e)
+        {
+            Log::error("RewindManager", "Restore kart state error: %s",
+                e.what());
+        }
+    }
+    m_kart_states.clear();
+}   // restoreLeftOutKarts
+
 // ----------------------------------------------------------------------------
 bool RewindManager::useLocalEvent() const
 {
@@ -447,3 +530,108 @@ void RewindManager::handleResetSmoothNetworkBody()
             sw->getBall()->setEnabled(true);
     }
 }   // handleResetSmoothNetworkBody
+
+// ============================================================================
+namespace
+{
+/** A rewinder saving a state of the same layout and size as a kart, used to
+ *  benchmark states without loading a world with karts. */
+class BenchmarkRewinder : public Rewinder
+{
+private:
+    btDefaultMotionState m_motion_state;
+    btBoxShape m_shape;
+    btRigidBody m_body;
+    KartControl m_control;
+    unsigned m_count;
+
+public:
+    BenchmarkRewinder(unsigned id)
+        : Rewinder({RN_KART, (char)id}), m_shape(btVector3(0.5f, 0.5f, 1.0f)),
+          m_body(btRigidBody::btRigidBodyConstructionInfo(200.0f,
+                 &m_motion_state, &m_shape)), m_count(id)
+    {
+        m_body.setWorldTransform(btTransform(btQuaternion(0, 0, 0, 1),
+            btVector3((float)id, 0.0f, 0.0f)));
+    }
+    // ------------------------------------------------------------------------
+    virtual bool saveState(BareNetworkString* buffer,
+                           std::vector<std::string>* ru)
+    {
+        ru->push_back(getUniqueIdentity());
+        // Move the kart a bit so the compressed values change every state
+        m_count++;
+        m_body.setLinearVelocity(btVector3((float)(m_count % 30), 0.0f, 1.0f));
+        m_body.setAngularVelocity(btVector3(0.0f, (float)(m_count % 7), 0.0f));
+        m_control.saveState(buffer);
+        // Controller, item, powerup and attachment
+        buffer->addUInt8(0).addUInt8(0).addUInt8(0).addUInt8(0).addUInt8(0);
+        buffer->addUInt8(0).addUInt8(1).addFloat((float)(m_count % 100));
+        CompressNetworkBody::compress(&m_body, &m_motion_state, buffer);
+        // Max speed, skidding and slipstream
+        buffer->addUInt16(0).addUInt16(0).addUInt8(0).addUInt8(0);
+        buffer->addUInt16(0).addUInt16(0).addUInt8(0);
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    virtual void saveTransform() {}
+    virtual void computeError() {}
+    virtual void undoEvent(BareNetworkString *buffer) {}
+    virtual void rewindToEvent(BareNetworkString *buffer) {}
+    virtual void restoreState(BareNetworkString *buffer, int count) {}
+    virtual void undoState(BareNetworkString *buffer) {}
+};   // BenchmarkRewinder
+
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Times saving a state of 8, 16 and 32 karts into the state buffer of
+ *  GameProtocol, which is how a server saves a state each time before it
+ *  is sent to clients.
+ */
+void RewindManager::benchmarkStates()
+{
+    const unsigned int states = 20000;
+    NetworkConfig::get()->setIsServer(true);
+    setEnable(true);
+    if (!exists())
+        create();
+    std::shared_ptr<GameProtocol> gp = GameProtocol::createInstance();
+
+    Log::info("RewindManager", "Saving states (%d states each):", states);
+    const unsigned int num_karts[] = { 8, 16, 32 };
+    for (unsigned int num : num_karts)
+    {
+        std::vector<std::shared_ptr<BenchmarkRewinder> > karts;
+        for (unsigned int i = 0; i < num; i++)
+        {
+            karts.push_back(std::make_shared<BenchmarkRewinder>(i));
+            karts.back()->rewinderAdd();
+        }
+        // Warm up so the buffers reached the size of a state
+        for (unsigned int i = 0; i < 100; i++)
+            get()->saveState();
+
+        const std::vector<uint8_t>& buffer = gp->getState()->getBuffer();
+        unsigned int growths = 0;
+        size_t capacity = buffer.capacity();
+        double start = StkTime::getRealTime();
+        for (unsigned int i = 0; i < states; i++)
+        {
+            get()->saveState();
+            if (buffer.capacity() != capacity)
+            {
+                growths++;
+                capacity = buffer.capacity();
+            }
+        }
+        double time = StkTime::getRealTime() - start;
+        Log::info("RewindManager", "%2d karts: %8.1f ns/state, %5d bytes/state, "
+            "%d buffer growths", num, time * 1e9 / states,
+            gp->getState()->getTotalSize(), growths);
+
+        karts.clear();
+        get()->reset();
+    }
+    destroy();
+}   // benchmarkStates
@@ -31,6 +31,7 @@
 #include <string>
 #include <vector>
 
+class BareNetworkString;
 class Rewinder;
 class RewindInfo;
 class RewindInfoEventFunction;
@@ -119,6 +120,26 @@ private:
 
     std::set<std::string> m_missing_rewinders;
 
+    /** Unique identities of rewinders in the state being saved, kept to
+     *  avoid allocation for each state. */
+    std::vector<std::string> m_rewinder_using;
+
+    /** State of a kart before a rewind, see saveKartStates. */
+    struct KartStateBeforeRewind
+    {
+        std::shared_ptr<Rewinder> m_rewinder;
+        unsigned m_offset;
+        unsigned m_size;
+        /** If the server left the kart out of the state rewound to. */
+        bool m_left_out;
+    };
+
+    /** Client only: states of the karts saved before a rewind, in
+     *  m_kart_state_buffer. */
+    std::vector<KartStateBeforeRewind> m_kart_states;
+
+    std::unique_ptr<BareNetworkString> m_kart_state_buffer;
+
     RewindManager();
    ~RewindManager();
     // ------------------------------------------------------------------------
@@ -136,12 +157,17 @@ private:
     }
     // ------------------------------------------------------------------------
     void mergeRewindInfoEventFunction();
+    // ------------------------------------------------------------------------
+    void saveKartStates();
+    // ------------------------------------------------------------------------
+    void restoreLeftOutKarts();
 
 public:
     // First static functions to manage rewinding.
     // ===========================================
     static RewindManager *create();
     static void destroy();
+    static void benchmarkStates();
     // ------------------------------------------------------------------------
     /** En- or disables rewinding. */
     static void setEnable(bool m) { m_enable_rewind_manager = m; }
@@ -228,6 +254,8 @@ public:
     // ------------------------------------------------------------------------
     bool hasMissingRewinder(const std::string& name) const
         { return m_missing_rewinders.find(name) != m_missing_rewinders.end(); }
+    // ------------------------------------------------------------------------
+    void setLeftOutOfState(const std::string& name);
 
 };   // RewindManager
 
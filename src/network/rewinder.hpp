@@ -70,12 +70,16 @@ public:
      *  caused by the rewind (which is then visually smoothed over time). */
     virtual void computeError() = 0;
 
-    /** Provides a copy of the state of the object in one memory buffer.
-     *  The memory is managed by the RewindManager.
-     *  \param[out] ru The unique identity of rewinder writing to.
-     *  \return The address of the memory buffer with the state.
+    /** Saves the state of the object by appending it to a buffer provided
+     *  by the RewindManager, so no memory needs to be allocated per state.
+     *  \param buffer The buffer to append the state to.
+     *  \param[out] ru The unique identity of rewinder writing to, only added
+     *         if a state is saved.
+     *  \return False if no state is saved, anything written to buffer will
+     *          be discarded in this case.
      */
-    virtual BareNetworkString* saveState(std::vector<std::string>* ru) = 0;
+    virtual bool saveState(BareNetworkString* buffer,
+                           std::vector<std::string>* ru) = 0;
 
     /** Called when an event needs to be undone. This is called while going
      *  backwards for rewinding - all stored events will get an 'undo' call.
@@ -208,7 +208,33 @@ namespace ServerConfig
 
     SERVER_CFG_PREFIX StringServerConfigParam m_soccer_log_path
         SERVER_CFG_DEFAULT(StringServerConfigParam("soccer_log.txt", "soccer-log-path", "Directory where the soccer log should be written to with / at the end."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_soccer_log_flush_interval
+        SERVER_CFG_DEFAULT(IntServerConfigParam(1000, "soccer-log-flush-interval",
+        "Milliseconds after which queued soccer and race log lines are written "
+        "to the file, 0 writes every line as soon as possible."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_soccer_log_flush_size
+        SERVER_CFG_DEFAULT(IntServerConfigParam(16384, "soccer-log-flush-size",
+        "Queued bytes of soccer and race log after which they are written "
+        "before the flush interval."));
+
+    SERVER_CFG_PREFIX BoolServerConfigParam m_soccer_log_json
+        SERVER_CFG_DEFAULT(BoolServerConfigParam(false, "soccer-log-json",
+        "Write the soccer and race log as JSON lines with event, tick, "
+        "world_kart_id and payload fields instead of plain text."));
     
+    SERVER_CFG_PREFIX IntServerConfigParam m_resident_tracks_memory
+        SERVER_CFG_DEFAULT(IntServerConfigParam(0, "resident-tracks-memory",
+        "Megabytes of track meshes kept loaded between races (server-only "
+        "builds), so a track played again is not read from disk. The least "
+        "recently played tracks are released first, 0 disables it."));
+
+    SERVER_CFG_PREFIX StringServerConfigParam m_track_records_file
+        SERVER_CFG_DEFAULT(StringServerConfigParam("track_records.txt",
+        "track-records-file", "File where the best times of world record "
+        "races are stored, one line per track, mode, direction and laps."));
+
     SERVER_CFG_PREFIX StringServerConfigParam m_live_soccer_log_path
         SERVER_CFG_DEFAULT(StringServerConfigParam("soccer_match.log", "live-soccer-log-path", "File path to the live soccer log."));
 
@@ -221,6 +247,18 @@ namespace ServerConfig
     SERVER_CFG_PREFIX StringServerConfigParam m_replay_dir
 	    SERVER_CFG_DEFAULT(StringServerConfigParam("replay/", "replay-directory", "Directory path for storing replay files."));
 
+    SERVER_CFG_PREFIX BoolServerConfigParam m_replay_binary
+        SERVER_CFG_DEFAULT(BoolServerConfigParam(false, "replay-binary",
+        "Save replays in the binary replay format, which is smaller and "
+        "faster to load but can't be read by official STK versions. Use "
+        "--convert-replay to convert text replays."));
+
+    SERVER_CFG_PREFIX BoolServerConfigParam m_replay_compress
+        SERVER_CFG_DEFAULT(BoolServerConfigParam(false, "replay-compress",
+        "Compress saved replays with gzip, which adds .gz to their file name. "
+        "This is for archiving only, compressed replays are not listed in the "
+        "game and have to be decompressed before they can be watched."));
+
     SERVER_CFG_PREFIX BoolServerConfigParam m_wan_server
         SERVER_CFG_DEFAULT(BoolServerConfigParam(true, "wan-server",
         "Enable wan server, which requires you to have an stk-addons account "
@@ -529,6 +567,37 @@ namespace ServerConfig
         "more rewind, which clients with slow device may have problem playing "
         "this server, use the default value is recommended."));
 
+    SERVER_CFG_PREFIX BoolServerConfigParam m_delta_state
+        SERVER_CFG_DEFAULT(BoolServerConfigParam(true,
+        "delta-state",
+        "Send states as a delta against the last state confirmed by each "
+        "client, which reduces the bandwidth used by states. Clients not "
+        "supporting it and clients without a recently confirmed state will "
+        "receive full states."));
+
+    SERVER_CFG_PREFIX FloatServerConfigParam m_state_interest_distance
+        SERVER_CFG_DEFAULT(FloatServerConfigParam(0.0f,
+        "state-interest-distance",
+        "Karts farther than this distance (in meters) from all karts of a "
+        "player are only included in some states sent to that player, "
+        "spectators are treated as far from all karts. This reduces the "
+        "bandwidth used by states in large free-for-all or capture the flag "
+        "games. Clients not supporting it receive all karts in each state, "
+        "0 to disable."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_state_far_interval
+        SERVER_CFG_DEFAULT(IntServerConfigParam(3,
+        "state-far-interval",
+        "If state-interest-distance is enabled, far karts are included in one "
+        "out of this many states."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_send_threads
+        SERVER_CFG_DEFAULT(IntServerConfigParam(2,
+        "send-threads",
+        "Number of threads which encrypt a packet sent to many players in "
+        "parallel with the sending thread, 0 to encrypt all packets on the "
+        "sending thread."));
+
     SERVER_CFG_PREFIX BoolServerConfigParam m_sql_management
         SERVER_CFG_DEFAULT(BoolServerConfigParam(false,
         "sql-management",
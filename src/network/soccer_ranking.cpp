@@ -1,9 +1,38 @@
 #include "network/soccer_ranking.hpp"
 #include "network/server_config.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+#include "utils/vs.hpp"
+#include <algorithm>
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <thread>
+
+namespace
+{
+    // Ranking files are checked for changes at most this often (ms)
+    const uint64_t RANKING_CHECK_INTERVAL = 2000;
+
+    struct RankingFile
+    {
+        std::shared_ptr<const SoccerRanking::RankingIndex> m_index;
+        time_t      m_mtime;
+        off_t       m_size;
+        uint64_t    m_last_check;
+        bool        m_loading;
+        std::thread m_loader;
+
+        RankingFile() : m_mtime(0), m_size(-1), m_last_check(0),
+                        m_loading(false) {}
+    };
+
+    std::mutex g_ranking_files_mutex;
+    std::map<std::string, RankingFile> g_ranking_files;
+}
 
 void SoccerRanking::parseLineTo(
         SoccerRanking::RankingEntry& out,
@@ -48,84 +77,156 @@ void SoccerRanking::readRankings(
         std::size_t offset
         )
 {
-    const std::string path = ServerConfig::m_soccer_ranking_file;
-    if (path.empty())
+    auto index = getRankings(ServerConfig::m_soccer_ranking_file);
+    if (!index || offset >= index->m_entries.size())
         return;
-    try 
+    const std::size_t count =
+        std::min(max, index->m_entries.size() - offset);
+    out.insert(out.end(), index->m_entries.begin() + offset,
+            index->m_entries.begin() + offset + count);
+} // readRankings
+//--------------------------------------------------------------------
+SoccerRanking::RankingEntry SoccerRanking::getRankOf(
+        const std::string &playername)
+{
+    auto index = getRankings(ServerConfig::m_soccer_ranking_file);
+    if (!index)
     {
-        // REPLACE ME WHEN PROPER DATABASE INTERFACE IS IMPLEMENTED
-        // open a file (closes it automatically)
-        std::ifstream f(path, std::ios_base::in);
-        f.exceptions(
-                std::ifstream::failbit |
-                std::ifstream::badbit);
-        char linebuf[256];
-        RankingEntry re;
+        RankingEntry re = {};
         re.m_rank = 1;
-    
-        if (offset)
-            for (std::size_t i = 0; !f.eof() && i < offset; ++i, ++re.m_rank)
-                f.getline(linebuf, 256);
-
-        if (f.eof() || f.bad() || f.fail())
-            return;
-        for (std::size_t i = 0; i < max; ++i, ++re.m_rank)
-        {
-            f.getline(linebuf, 256);
+        return re;
+    }
 
-            if (f.eof() || f.bad() || f.fail())
-                break;
+    const RankingEntry* re =
+        index->findByPrefix(StringUtils::toLowerCase(playername));
+    if (re)
+        return *re;
 
-            parseLineTo(re, linebuf);
-            out.push_back(re);
-        }
+    RankingEntry res;
+    res.m_rank = 0;
+    return res;
+} // getRankOf
+//--------------------------------------------------------------------
+const SoccerRanking::RankingEntry* SoccerRanking::RankingIndex::find(
+        const std::string& name) const
+{
+    auto it = m_by_name.find(name);
+    return it == m_by_name.end() ? NULL : &m_entries[it->second];
+} // find
+//--------------------------------------------------------------------
+/** Returns the best ranked entry whose lower case name starts with the
+ *  lower case prefix. */
+const SoccerRanking::RankingEntry* SoccerRanking::RankingIndex::findByPrefix(
+        const std::string& prefix) const
+{
+    auto it = std::lower_bound(m_lower_names.begin(), m_lower_names.end(),
+            std::make_pair(prefix, 0U));
+    const RankingEntry* best = NULL;
+    for (; it != m_lower_names.end() &&
+            StringUtils::startsWith(it->first, prefix); it++)
+    {
+        const RankingEntry* re = &m_entries[it->second];
+        if (!best || re->m_rank < best->m_rank)
+            best = re;
     }
-    catch (const std::exception& e)
+    return best;
+} // findByPrefix
+//--------------------------------------------------------------------
+std::shared_ptr<const SoccerRanking::RankingIndex> SoccerRanking::loadIndex(
+        const std::string& path)
+{
+    std::shared_ptr<RankingIndex> index = std::make_shared<RankingIndex>();
+    std::ifstream f(FileUtils::getPortableReadingPath(path),
+            std::ios_base::in);
+    std::string line;
+    while (std::getline(f, line))
     {
-        Log::verbose("SoccerRanking", "Failed to read ranking data: %s",
-                e.what());
-        return;
+        if (line.empty())
+            continue;
+        RankingEntry re = parseLine(line);
+        re.m_rank = (unsigned)index->m_entries.size() + 1;
+        index->m_by_name.emplace(re.m_name,
+                (unsigned)index->m_entries.size());
+        index->m_lower_names.emplace_back(
+                StringUtils::toLowerCase(re.m_name),
+                (unsigned)index->m_entries.size());
+        index->m_entries.push_back(re);
     }
-} // readRankings
+    std::sort(index->m_lower_names.begin(), index->m_lower_names.end());
+    Log::info("SoccerRanking", "Loaded %d rankings from %s.",
+            (int)index->m_entries.size(), path.c_str());
+    return index;
+} // loadIndex
 //--------------------------------------------------------------------
-SoccerRanking::RankingEntry SoccerRanking::getRankOf(
-        const std::string &playername)
+/** Returns the rankings of the file, which are loaded when first used and
+ *  reloaded in a separate thread when the modification time of the file
+ *  changes, the previous rankings are returned meanwhile.
+ *  \return NULL if path is empty.
+ */
+std::shared_ptr<const SoccerRanking::RankingIndex> SoccerRanking::getRankings(
+        const std::string& path)
 {
-    const std::string path = ServerConfig::m_soccer_ranking_file;
-    RankingEntry re = {};
-    re.m_rank = 1;
-    std::string lower_pn = StringUtils::toLowerCase(playername);
-
     if (path.empty())
-        return re;
+        return nullptr;
 
-    try
-    {
-        std::ifstream f(path, std::ios_base::in);
-        f.exceptions(
-                std::ifstream::failbit |
-                std::ifstream::badbit);
-        char linebuf[256];
-        for (; !f.eof() && !f.fail() && !f.bad(); ++re.m_rank)
-        {
-            f.getline(linebuf, 256);
-            if (linebuf[0] == 0)
-                return re;
-            parseLineTo(re, linebuf);
+    std::unique_lock<std::mutex> ul(g_ranking_files_mutex);
+    RankingFile& file = g_ranking_files[path];
+    const uint64_t now = StkTime::getMonoTimeMs();
+    if (file.m_index &&
+        (file.m_loading || now < file.m_last_check + RANKING_CHECK_INTERVAL))
+        return file.m_index;
+    file.m_last_check = now;
 
-            if (StringUtils::startsWith(
-                        StringUtils::toLowerCase(re.m_name),
-                        lower_pn))
-                return re;
-        }
+    struct stat st;
+    if (FileUtils::statU8Path(path, &st) != 0)
+    {
+        if (!file.m_index)
+            file.m_index = std::make_shared<RankingIndex>();
+        return file.m_index;
     }
-    catch (const std::exception& e)
+    if (file.m_index && st.st_mtime == file.m_mtime &&
+        st.st_size == file.m_size)
+        return file.m_index;
+    file.m_mtime = st.st_mtime;
+    file.m_size = st.st_size;
+
+    if (!file.m_index)
     {
-        Log::verbose("SoccerRanking", "Failed to read ranking data: %s",
-                e.what());
+        // First use, nothing to return until it is loaded
+        ul.unlock();
+        auto index = loadIndex(path);
+        ul.lock();
+        file.m_index = index;
+        return file.m_index;
     }
 
-    RankingEntry res;
-    res.m_rank = 0;
-    return res;
-} // getRankOf
+    if (file.m_loader.joinable())
+        file.m_loader.join();
+    file.m_loading = true;
+    file.m_loader = std::thread([path]()
+        {
+            VS::setThreadName("SoccerRanking");
+            auto index = loadIndex(path);
+            std::lock_guard<std::mutex> lock(g_ranking_files_mutex);
+            RankingFile& file = g_ranking_files[path];
+            file.m_index = index;
+            file.m_loading = false;
+        });
+    return file.m_index;
+} // getRankings
+//--------------------------------------------------------------------
+/** Waits for reloading rankings to finish, called at exit. */
+void SoccerRanking::destroy()
+{
+    std::vector<std::thread> loaders;
+    {
+        std::lock_guard<std::mutex> lock(g_ranking_files_mutex);
+        for (auto& p : g_ranking_files)
+        {
+            if (p.second.m_loader.joinable())
+                loaders.push_back(std::move(p.second.m_loader));
+        }
+    }
+    for (std::thread& t : loaders)
+        t.join();
+} // destroy
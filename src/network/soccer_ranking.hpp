@@ -21,7 +21,10 @@
 #define HEADER_SOCCER_RANKING_HPP
 
 #include <limits>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 class SoccerRanking
@@ -42,7 +45,25 @@ public:
 
         std::string     m_name;
     };
+
+    /* In-memory copy of a ranking file, replaced as a whole when the file
+     * changes, so it can be used without locking. */
+    struct RankingIndex
+    {
+        // in rank order
+        std::vector<RankingEntry> m_entries;
+        // exact name to index in m_entries
+        std::unordered_map<std::string, unsigned> m_by_name;
+        // lower case names with index in m_entries, sorted for prefix search
+        std::vector<std::pair<std::string, unsigned> > m_lower_names;
+
+        const RankingEntry* find(const std::string& name) const;
+        const RankingEntry* findByPrefix(const std::string& prefix) const;
+    };
 private:
+    static std::shared_ptr<const RankingIndex> loadIndex(
+            const std::string& path
+            );
 
     static RankingEntry parseLine(
             const std::string& line
@@ -60,6 +81,9 @@ public:
             std::size_t offset = 0);
     static RankingEntry getRankOf(
             const std::string& playername);
+    static std::shared_ptr<const RankingIndex> getRankings(
+            const std::string& path);
+    static void destroy();
 }; // SoccerRanking
 
 #endif//HEADER_SOCCER_RANKING_HPP
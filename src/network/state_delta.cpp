@@ -0,0 +1,211 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/state_delta.hpp"
+
+#include "network/network_string.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace StateDelta
+{
+// ----------------------------------------------------------------------------
+/** Adds an unsigned integer with 7 bits per byte, the highest bit of each
+ *  byte tells if more bytes follow. */
+static void addVarUInt(BareNetworkString* out, size_t value)
+{
+    while (value >= 0x80)
+    {
+        out->addUInt8(uint8_t(value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out->addUInt8(uint8_t(value));
+}   // addVarUInt
+
+// ----------------------------------------------------------------------------
+static size_t getVarUInt(const BareNetworkString& in)
+{
+    size_t value = 0;
+    for (unsigned shift = 0; shift < 32; shift += 7)
+    {
+        uint8_t byte = in.getUInt8();
+        value |= size_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+    throw std::out_of_range("getVarUInt too long.");
+}   // getVarUInt
+
+// ----------------------------------------------------------------------------
+/** Encodes state against baseline and appends the result to out.
+ *  \param baseline The state which the receiver has confirmed.
+ *  \param state Pointer to the new state to be sent.
+ *  \param state_size Size of the new state in bytes.
+ *  \param out Network string to which the encoded delta is appended.
+ */
+void encode(const std::vector<uint8_t>& baseline, const uint8_t* state,
+            size_t state_size, BareNetworkString* out)
+{
+    const size_t base_size = baseline.size();
+    auto xor_at = [&](size_t i) -> uint8_t
+    {
+        return i < base_size ? state[i] ^ baseline[i] : state[i];
+    };
+
+    addVarUInt(out, state_size);
+    size_t i = 0;
+    while (i < state_size)
+    {
+        size_t start = i;
+        while (i < state_size && xor_at(i) == 0)
+            i++;
+        addVarUInt(out, i - start);
+        if (i == state_size)
+            break;
+
+        // Keep short runs of unchanged bytes inside the literal, a new
+        // skip / literal pair costs at least 2 bytes
+        start = i;
+        size_t end = i;
+        unsigned unchanged = 0;
+        while (i < state_size)
+        {
+            if (xor_at(i) == 0)
+            {
+                if (++unchanged >= 3)
+                    break;
+            }
+            else
+            {
+                unchanged = 0;
+                end = i + 1;
+            }
+            i++;
+        }
+        i = end;
+        addVarUInt(out, end - start);
+        for (size_t j = start; j < end; j++)
+            out->addUInt8(xor_at(j));
+    }
+}   // encode
+
+// ----------------------------------------------------------------------------
+/** Rebuilds a full state from the baseline and an encoded delta.
+ *  \param baseline The state which the delta was encoded against.
+ *  \param in Network string with the encoded delta at its current offset.
+ *  \param state Output full state.
+ *  \return False if the delta is malformed.
+ */
+bool decode(const std::vector<uint8_t>& baseline, const BareNetworkString& in,
+            std::vector<uint8_t>* state)
+{
+    try
+    {
+        const size_t state_size = getVarUInt(in);
+        // A state never gets close to this size, avoid allocating a huge
+        // buffer from a malformed packet
+        if (state_size > 1024 * 1024)
+            return false;
+        state->assign(baseline.begin(), baseline.begin() +
+            std::min(baseline.size(), state_size));
+        state->resize(state_size, 0);
+        size_t i = 0;
+        while (i < state_size)
+        {
+            i += getVarUInt(in);
+            if (i > state_size)
+                return false;
+            if (i == state_size)
+                break;
+            const size_t literal = getVarUInt(in);
+            if (literal == 0 || i + literal > state_size)
+                return false;
+            for (size_t j = 0; j < literal; j++)
+                (*state)[i + j] ^= in.getUInt8();
+            i += literal;
+        }
+    }
+    catch (std::exception&)
+    {
+        return false;
+    }
+    return true;
+}   // decode
+
+// ----------------------------------------------------------------------------
+/** Unit testing function.
+ */
+void unitTesting()
+{
+    std::vector<uint8_t> baseline;
+    std::vector<uint8_t> state;
+    for (unsigned i = 0; i < 300; i++)
+    {
+        baseline.push_back(uint8_t(i * 7));
+        state.push_back(uint8_t(i * 7));
+    }
+    // Identical states only need the size and one skip
+    BareNetworkString same;
+    encode(baseline, state.data(), state.size(), &same);
+    assert(same.size() < 8);
+    std::vector<uint8_t> result;
+    assert(decode(baseline, same, &result));
+    assert(result == state);
+
+    // Changed bytes in the middle and at the end, short unchanged runs
+    // inside a literal
+    state[10] ^= 0xff;
+    state[12] ^= 0x01;
+    state[200] = 0;
+    state[299] ^= 0x10;
+    BareNetworkString changed;
+    encode(baseline, state.data(), state.size(), &changed);
+    assert(decode(baseline, changed, &result));
+    assert(result == state);
+
+    // Growing and shrinking state
+    std::vector<uint8_t> longer = state;
+    longer.insert(longer.end(), 200, 0x5a);
+    BareNetworkString grow;
+    encode(baseline, longer.data(), longer.size(), &grow);
+    assert(decode(baseline, grow, &result));
+    assert(result == longer);
+
+    std::vector<uint8_t> shorter(state.begin(), state.begin() + 100);
+    BareNetworkString shrink;
+    encode(baseline, shorter.data(), shorter.size(), &shrink);
+    assert(decode(baseline, shrink, &result));
+    assert(result == shorter);
+
+    // Empty baseline works as a keyframe
+    std::vector<uint8_t> empty;
+    BareNetworkString full;
+    encode(empty, state.data(), state.size(), &full);
+    assert(decode(empty, full, &result));
+    assert(result == state);
+
+    // Truncated delta must be rejected
+    BareNetworkString truncated;
+    truncated.getBuffer().assign(changed.getBuffer().begin(),
+        changed.getBuffer().end() - 1);
+    assert(!decode(baseline, truncated, &result));
+}   // unitTesting
+
+}   // namespace StateDelta
@@ -0,0 +1,50 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_STATE_DELTA_HPP
+#define HEADER_STATE_DELTA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class BareNetworkString;
+
+/** \ingroup network
+ *  Helper functions to encode a world state against a baseline state which
+ *  the receiver has already confirmed. The current state is XORed with the
+ *  baseline (bytes past the end of the baseline are XORed with 0), and the
+ *  result is run-length encoded as alternating runs of unchanged bytes and
+ *  literal bytes, each run length stored as a 7-bit variable length integer.
+ *  Since most of a state (item states, kart attachments, powerups and
+ *  usually the upper bytes of positions) does not change between two state
+ *  ticks, this typically reduces the state size significantly.
+ */
+namespace StateDelta
+{
+    // ------------------------------------------------------------------------
+    void encode(const std::vector<uint8_t>& baseline, const uint8_t* state,
+                size_t state_size, BareNetworkString* out);
+    // ------------------------------------------------------------------------
+    bool decode(const std::vector<uint8_t>& baseline,
+                const BareNetworkString& in, std::vector<uint8_t>* state);
+    // ------------------------------------------------------------------------
+    void unitTesting();
+};   // namespace StateDelta
+
+#endif
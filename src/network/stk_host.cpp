@@ -39,7 +39,9 @@
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/time.hpp"
+#include "utils/tracer.hpp"
 #include "utils/vs.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <cstddef>
 #include <string.h>
@@ -322,6 +324,15 @@ void STKHost::init()
     m_network          = NULL;
     m_exit_timeout.store(std::numeric_limits<uint64_t>::max());
     m_client_ping.store(0);
+    m_enet_cmd.reset(new MPSCQueue<ENetCommand>(16384));
+    m_enet_cmd_overflowed.store(false);
+    m_enet_cmd_queued.store(0);
+    m_enet_cmd_done.store(0);
+    m_enet_cmd_max_batch.store(0);
+    m_enet_cmd_total_latency.store(0);
+    m_enet_cmd_max_latency.store(0);
+    m_enet_waiting.store(false);
+    m_peer_snapshot_dirty.store(true);
 
     // Start with initialising ENet
     // ============================
@@ -335,6 +346,12 @@ void STKHost::init()
     Network::openLog();  // Open packet log file
     ProtocolManager::createInstance();
 
+    if (NetworkConfig::get()->isServer() && ServerConfig::m_send_threads > 0)
+    {
+        m_send_pool.reset(new WorkerPool(ServerConfig::m_send_threads,
+            "SendPackets", STKProcess::getType()));
+    }
+
     // Optional: start the network console
     if (m_enable_console)
     {
@@ -364,13 +381,13 @@ STKHost::~STKHost()
     stopListening();
 
     // Drop all unsent packets
-    for (auto& p : m_enet_cmd)
+    ENetCommand cmd;
+    while (m_enet_cmd->pop(&cmd))
+        m_enet_cmd_overflow.push_back(cmd);
+    for (ENetCommand& c : m_enet_cmd_overflow)
     {
-        if (std::get<3>(p) == ECT_SEND_PACKET)
-        {
-            ENetPacket* packet = std::get<1>(p);
-            enet_packet_destroy(packet);
-        }
+        if (c.m_type == ECT_SEND_PACKET)
+            enet_packet_destroy(c.m_packet);
     }
     delete m_network;
     enet_deinitialize();
@@ -747,6 +764,7 @@ void STKHost::disconnectAllPeers(bool timeout_waiting)
         m_exit_timeout.store(StkTime::getMonoTimeMs() + 2000);
     }
     m_peers.clear();
+    markPeersChanged();
 }   // disconnectAllPeers
 
 //-----------------------------------------------------------------------------
@@ -768,6 +786,8 @@ void STKHost::setErrorMessage(const irr::core::stringw &message)
 void STKHost::startListening()
 {
     m_exit_timeout.store(std::numeric_limits<uint64_t>::max());
+    m_wake_address.reset(new SocketAddress(
+        isIPv6Socket() ? "::1" : "127.0.0.1", getPrivatePort()));
     m_listening_thread = std::thread(std::bind(&STKHost::mainLoop, this,
         STKProcess::getType()));
 }   // startListening
@@ -784,6 +804,157 @@ void STKHost::stopListening()
         m_listening_thread.join();
 }   // stopListening
 
+// ----------------------------------------------------------------------------
+/** Queues a command for the listening thread, can be called from any thread.
+ *  \param peer The peer of the command.
+ *  \param packet The packet to send, or NULL.
+ *  \param i Channel of the packet or disconnect data.
+ *  \param ect Type of the command.
+ *  \param ea Address of the peer now, to detect if enet reused it.
+ */
+void STKHost::addEnetCommand(ENetPeer* peer, ENetPacket* packet, uint32_t i,
+                             ENetCommandType ect, ENetAddress ea)
+{
+    ENetCommand cmd;
+    cmd.m_peer        = peer;
+    cmd.m_packet      = packet;
+    cmd.m_data        = i;
+    cmd.m_type        = ect;
+    cmd.m_address     = ea;
+    cmd.m_queued_time = StkTime::getMonoTimeUs();
+    if (m_enet_cmd_overflowed.load() || !m_enet_cmd->push(cmd))
+    {
+        std::lock_guard<std::mutex> lock(m_enet_cmd_mutex);
+        m_enet_cmd_overflow.push_back(cmd);
+        m_enet_cmd_overflowed.store(true);
+    }
+    m_enet_cmd_queued.fetch_add(1);
+
+    // Wake up the listening thread if it is waiting for network events, the
+    // datagram is too short for enet and ignored
+    if (m_enet_waiting.exchange(false) && m_wake_address)
+    {
+        const char wake = 0;
+        sendto(m_network->getENetHost()->socket, &wake, 1, 0,
+            m_wake_address->getSockaddr(), m_wake_address->getSocklen());
+    }
+}   // addEnetCommand
+
+// ----------------------------------------------------------------------------
+/** Runs all queued commands in the listening thread. */
+void STKHost::runENetCommands(ENetHost* host)
+{
+    std::vector<ENetCommand> commands;
+    ENetCommand cmd;
+    while (m_enet_cmd->pop(&cmd))
+        commands.push_back(cmd);
+    if (m_enet_cmd_overflowed.load())
+    {
+        std::lock_guard<std::mutex> lock(m_enet_cmd_mutex);
+        commands.insert(commands.end(), m_enet_cmd_overflow.begin(),
+            m_enet_cmd_overflow.end());
+        m_enet_cmd_overflow.clear();
+        m_enet_cmd_overflowed.store(false);
+    }
+    if (commands.empty())
+        return;
+
+    const uint64_t now = StkTime::getMonoTimeUs();
+    uint64_t total_latency = 0;
+    uint64_t max_latency = 0;
+    for (ENetCommand& c : commands)
+    {
+        uint64_t latency = now > c.m_queued_time ? now - c.m_queued_time : 0;
+        total_latency += latency;
+        max_latency = std::max(max_latency, latency);
+
+        ENetPeer* peer = c.m_peer;
+        ENetAddress& ea = c.m_address;
+        ENetAddress& ea_peer_now = peer->address;
+        ENetPacket* packet = c.m_packet;
+        // Enet will reuse a disconnected peer so we check here to avoid
+        // sending to wrong peer
+        if (peer->state != ENET_PEER_STATE_CONNECTED ||
+#if defined(ENABLE_IPV6) || defined(__SWITCH__)
+            (enet_ip_not_equal(ea_peer_now.host, ea.host) &&
+            ea_peer_now.port != ea.port))
+#else
+            (ea_peer_now.host != ea.host && ea_peer_now.port != ea.port))
+#endif
+        {
+            if (packet != NULL)
+                enet_packet_destroy(packet);
+            continue;
+        }
+
+        switch (c.m_type)
+        {
+        case ECT_SEND_PACKET:
+        {
+            // If enet_peer_send failed, destroy the packet to
+            // prevent leaking, this can only be done if the packet
+            // is copied instead of shared sending to all peers
+            if (enet_peer_send(peer, (uint8_t)c.m_data, packet) < 0)
+            {
+                enet_packet_destroy(packet);
+            }
+            break;
+        }
+        case ECT_DISCONNECT:
+            enet_peer_disconnect(peer, c.m_data);
+            break;
+        case ECT_RESET:
+            // Flush enet before reset (so previous command is send)
+            enet_host_flush(host);
+            enet_peer_reset(peer);
+            // Remove the stk peer of it
+            std::lock_guard<std::mutex> lock(m_peers_mutex);
+            m_peers.erase(peer);
+            markPeersChanged();
+            break;
+        }
+    }
+    // Send now instead of after waiting for network events
+    enet_host_flush(host);
+
+    m_enet_cmd_done.fetch_add(commands.size());
+    m_enet_cmd_total_latency.fetch_add(total_latency);
+    if (max_latency > m_enet_cmd_max_latency.load())
+        m_enet_cmd_max_latency.store(max_latency);
+    if (commands.size() > m_enet_cmd_max_batch.load())
+        m_enet_cmd_max_batch.store(commands.size());
+}   // runENetCommands
+
+// ----------------------------------------------------------------------------
+/** Waits until a network event, a queued command or timeout milliseconds
+ *  passed, in the listening thread.
+ */
+void STKHost::waitForENetEvents(ENetHost* host, uint32_t timeout)
+{
+    m_enet_waiting.store(true);
+    // A command queued before m_enet_waiting was set did not wake us up
+    if (m_enet_cmd_queued.load() == m_enet_cmd_done.load())
+    {
+        enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE;
+        enet_socket_wait(host->socket, &condition, timeout);
+    }
+    m_enet_waiting.store(false);
+}   // waitForENetEvents
+
+// ----------------------------------------------------------------------------
+ENetCommandStats STKHost::getENetCommandStats() const
+{
+    ENetCommandStats stats;
+    uint64_t done = m_enet_cmd_done.load();
+    stats.m_queued = m_enet_cmd_queued.load();
+    stats.m_depth = stats.m_queued > done ? stats.m_queued - done : 0;
+    stats.m_max_batch = m_enet_cmd_max_batch.load();
+    stats.m_average_latency_us =
+        done > 0 ? m_enet_cmd_total_latency.load() / done : 0;
+    stats.m_max_latency_us = m_enet_cmd_max_latency.load();
+    return stats;
+}   // getENetCommandStats
+
 // ----------------------------------------------------------------------------
 /** \brief Thread function checking if data is received.
  *  This function tries to get data from network low-level functions as
@@ -910,8 +1081,7 @@ void STKHost::mainLoop(ProcessType pt)
                                 player_name.c_str(), ap, max_ping);
                             p.second->setWarnedForHighPing(true);
                             p.second->setDisconnected(true);
-                            std::lock_guard<std::mutex> lock(m_enet_cmd_mutex);
-                            m_enet_cmd.emplace_back(p.second->getENetPeer(),
+                            addEnetCommand(p.second->getENetPeer(),
                                 (ENetPacket*)NULL, PDI_KICK_HIGH_PING,
                                 ECT_DISCONNECT, p.first->address);
                         }
@@ -986,6 +1156,7 @@ void STKHost::mainLoop(ProcessType pt)
                     enet_host_flush(host);
                     enet_peer_reset(it->first);
                     it = m_peers.erase(it);
+                    markPeersChanged();
                 }
                 else
                 {
@@ -995,62 +1166,16 @@ void STKHost::mainLoop(ProcessType pt)
             peer_lock.unlock();
         }
 
-        std::vector<std::tuple<ENetPeer*, ENetPacket*, uint32_t,
-            ENetCommandType, ENetAddress> > copied_list;
-        std::unique_lock<std::mutex> lock(m_enet_cmd_mutex);
-        std::swap(copied_list, m_enet_cmd);
-        lock.unlock();
-        for (auto& p : copied_list)
         {
-            ENetPeer* peer = std::get<0>(p);
-            ENetAddress& ea = std::get<4>(p);
-            ENetAddress& ea_peer_now = peer->address;
-            ENetPacket* packet = std::get<1>(p);
-            // Enet will reuse a disconnected peer so we check here to avoid
-            // sending to wrong peer
-            if (peer->state != ENET_PEER_STATE_CONNECTED ||
-#if defined(ENABLE_IPV6) || defined(__SWITCH__)
-                (enet_ip_not_equal(ea_peer_now.host, ea.host) &&
-                ea_peer_now.port != ea.port))
-#else
-                (ea_peer_now.host != ea.host && ea_peer_now.port != ea.port))
-#endif
-            {
-                if (packet != NULL)
-                    enet_packet_destroy(packet);
-                continue;
-            }
-
-            switch (std::get<3>(p))
-            {
-            case ECT_SEND_PACKET:
-            {
-                // If enet_peer_send failed, destroy the packet to
-                // prevent leaking, this can only be done if the packet
-                // is copied instead of shared sending to all peers
-                if (enet_peer_send(peer, (uint8_t)std::get<2>(p), packet) < 0)
-                {
-                    enet_packet_destroy(packet);
-                }
-                break;
-            }
-            case ECT_DISCONNECT:
-                enet_peer_disconnect(peer, std::get<2>(p));
-                break;
-            case ECT_RESET:
-                // Flush enet before reset (so previous command is send)
-                enet_host_flush(host);
-                enet_peer_reset(peer);
-                // Remove the stk peer of it
-                std::lock_guard<std::mutex> lock(m_peers_mutex);
-                m_peers.erase(peer);
-                break;
-            }
+            TRACE_SCOPE("Run ENet commands");
+            runENetCommands(host);
         }
 
         bool need_ping_update = false;
-        while (enet_host_service(host, &event, 10) != 0)
+        waitForENetEvents(host, 10);
+        while (enet_host_service(host, &event, 0) != 0)
         {
+            TRACE_SCOPE("Handle ENet event");
             auto lp = LobbyProtocol::get<LobbyProtocol>();
             if (!is_server &&
                 last_ping_time_update_for_client < StkTime::getMonoTimeMs())
@@ -1081,6 +1206,7 @@ void STKHost::mainLoop(ProcessType pt)
                     (event.peer, this, ++m_next_unique_host_id);
                 std::unique_lock<std::mutex> lock(m_peers_mutex);
                 m_peers[event.peer] = stk_peer;
+                markPeersChanged();
                 size_t new_peer_count = m_peers.size();
                 lock.unlock();
                 stk_event = new Event(&event, stk_peer);
@@ -1113,6 +1239,7 @@ void STKHost::mainLoop(ProcessType pt)
                     addr = peer->getAddress().toString();
                     stk_event = new Event(&event, peer);
                     m_peers.erase(event.peer);
+                    markPeersChanged();
                     new_peer_count = m_peers.size();
                 }
                 Log::info("STKHost", "%s has just disconnected. There are "
@@ -1341,11 +1468,13 @@ std::shared_ptr<STKPeer> STKHost::getServerPeerForClient() const
 void STKHost::sendPacketToAllPeersInServer(NetworkString *data, bool reliable)
 {
     std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
+    std::vector<STKPeer*> peers;
+    for (auto& p : m_peers)
     {
         if (p.second->isValidated())
-            p.second->sendPacket(data, reliable);
+            peers.push_back(p.second.get());
     }
+    sendPacketToPeers(peers, data, reliable);
 }   // sendPacketToAllPeersInServer
 
 //-----------------------------------------------------------------------------
@@ -1356,11 +1485,13 @@ void STKHost::sendPacketToAllPeersInServer(NetworkString *data, bool reliable)
 void STKHost::sendPacketToAllPeers(NetworkString *data, bool reliable)
 {
     std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
+    std::vector<STKPeer*> peers;
+    for (auto& p : m_peers)
     {
         if (p.second->isValidated() && !p.second->isWaitingForGame())
-            p.second->sendPacket(data, reliable);
+            peers.push_back(p.second.get());
     }
+    sendPacketToPeers(peers, data, reliable);
 }   // sendPacketToAllPeers
 
 //-----------------------------------------------------------------------------
@@ -1373,15 +1504,17 @@ void STKHost::sendPacketExcept(STKPeer* peer, NetworkString *data,
                                bool reliable)
 {
     std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
+    std::vector<STKPeer*> peers;
+    for (auto& p : m_peers)
     {
         STKPeer* stk_peer = p.second.get();
         if (!stk_peer->isSamePeer(peer) && p.second->isValidated() &&
             !p.second->isWaitingForGame())
         {
-            stk_peer->sendPacket(data, reliable);
+            peers.push_back(stk_peer);
         }
     }
+    sendPacketToPeers(peers, data, reliable);
 }   // sendPacketExcept
 
 //-----------------------------------------------------------------------------
@@ -1394,16 +1527,53 @@ void STKHost::sendPacketToAllPeersWith(std::function<bool(STKPeer*)> predicate,
                                        NetworkString* data, bool reliable)
 {
     std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
+    std::vector<STKPeer*> peers;
+    for (auto& p : m_peers)
     {
         STKPeer* stk_peer = p.second.get();
         if (!stk_peer->isValidated())
             continue;
         if (predicate(stk_peer))
-            stk_peer->sendPacket(data, reliable);
+            peers.push_back(stk_peer);
     }
+    sendPacketToPeers(peers, data, reliable);
 }   // sendPacketToAllPeersWith
 
+//-----------------------------------------------------------------------------
+/** Sends encrypted data to the peers, m_peers_mutex must be locked. The
+ *  packets are created in parallel by m_send_pool if encrypting them takes
+ *  long enough, and are queued in the order of peers.
+ *  \param peers Peers to send to.
+ *  \param data Data to sent.
+ *  \param reliable If the data should be sent reliable or now.
+ */
+void STKHost::sendPacketToPeers(const std::vector<STKPeer*>& peers,
+                                NetworkString* data, bool reliable)
+{
+    // Waking the threads costs about as much as encrypting some kilobytes
+    const unsigned int MIN_PARALLEL_BYTES = 16384;
+    if (!m_send_pool || peers.size() < 2 ||
+        peers.size() * data->getTotalSize() < MIN_PARALLEL_BYTES)
+    {
+        for (STKPeer* peer : peers)
+            peer->sendPacket(data, reliable);
+        return;
+    }
+
+    std::vector<ENetPacket*> packets(peers.size(), NULL);
+    m_send_pool->parallelFor((unsigned int)peers.size(),
+        [&peers, &packets, data, reliable](unsigned int i)
+        {
+            if (!peers[i]->isDisconnected())
+            {
+                packets[i] = peers[i]->createPacket(data, reliable,
+                                                    true/*encrypted*/);
+            }
+        });
+    for (unsigned int i = 0; i < peers.size(); i++)
+        peers[i]->queuePacket(packets[i], true/*encrypted*/);
+}   // sendPacketToPeers
+
 //-----------------------------------------------------------------------------
 /** Sends a message from a client to the server. */
 void STKHost::sendToServer(NetworkString *data, bool reliable)
@@ -1416,22 +1586,44 @@ void STKHost::sendToServer(NetworkString *data, bool reliable)
 }   // sendToServer
 
 //-----------------------------------------------------------------------------
-std::vector<std::shared_ptr<NetworkPlayerProfile> >
-    STKHost::getAllPlayerProfiles() const
+/** Returns the peers and player profiles, which is one atomic load unless
+ *  they changed since the last call. In that case a new snapshot is built
+ *  under m_peers_mutex and published for all threads.
+ */
+std::shared_ptr<const PeerSnapshot> STKHost::getPeerSnapshot() const
 {
-    std::vector<std::shared_ptr<NetworkPlayerProfile> > p;
-    std::unique_lock<std::mutex> lock(m_peers_mutex);
+    if (!m_peer_snapshot_dirty.load())
+        return std::atomic_load(&m_peer_snapshot);
+
+    std::lock_guard<std::mutex> lock(m_peers_mutex);
+    // Another thread may have published it while waiting for the lock
+    if (!m_peer_snapshot_dirty.exchange(false))
+        return std::atomic_load(&m_peer_snapshot);
+
+    std::shared_ptr<PeerSnapshot> snapshot = std::make_shared<PeerSnapshot>();
+    snapshot->m_version = m_peer_snapshot ? m_peer_snapshot->m_version + 1 : 0;
+    snapshot->m_peers.reserve(m_peers.size());
     for (auto& peer : m_peers)
     {
+        snapshot->m_peers.push_back(peer.second);
         if (peer.second->isDisconnected() || !peer.second->isValidated())
             continue;
         if (ServerConfig::m_ai_handling && peer.second->isAIPeer())
             continue;
-        auto peer_profile = peer.second->getPlayerProfiles();
-        p.insert(p.end(), peer_profile.begin(), peer_profile.end());
+        auto& peer_profile = peer.second->getPlayerProfiles();
+        snapshot->m_profiles.insert(snapshot->m_profiles.end(),
+            peer_profile.begin(), peer_profile.end());
     }
-    lock.unlock();
-    return p;
+    std::shared_ptr<const PeerSnapshot> published = snapshot;
+    std::atomic_store(&m_peer_snapshot, published);
+    return published;
+}   // getPeerSnapshot
+
+//-----------------------------------------------------------------------------
+std::vector<std::shared_ptr<NetworkPlayerProfile> >
+    STKHost::getAllPlayerProfiles() const
+{
+    return getPeerSnapshot()->m_profiles;
 }   // getAllPlayerProfiles
 //-----------------------------------------------------------------------------
 std::vector<std::shared_ptr<NetworkPlayerProfile> >
@@ -1439,17 +1631,17 @@ std::vector<std::shared_ptr<NetworkPlayerProfile> >
             const bool onlyCanPlay) const
 {
     std::vector<std::shared_ptr<NetworkPlayerProfile> > p;
-    std::unique_lock<std::mutex> lock(m_peers_mutex);
-    for (auto& peer : m_peers)
+    auto snapshot = getPeerSnapshot();
+    for (auto& peer : snapshot->m_peers)
     {
-        if (peer.second->isDisconnected() || !peer.second->isValidated())
+        if (peer->isDisconnected() || !peer->isValidated())
             continue;
-        if (ServerConfig::m_ai_handling && peer.second->isAIPeer())
+        if (ServerConfig::m_ai_handling && peer->isAIPeer())
             continue;
-        if (onlyCanPlay && (peer.second->isSpectator() ||
-                    peer.second->alwaysSpectate()))
+        if (onlyCanPlay && (peer->isSpectator() ||
+                    peer->alwaysSpectate()))
             continue;
-        for (auto& profile : peer.second->getPlayerProfiles())
+        for (auto& profile : peer->getPlayerProfiles())
         {
             if (profile->getTeam() != team)
                 continue;
@@ -1461,7 +1653,6 @@ std::vector<std::shared_ptr<NetworkPlayerProfile> >
             p.push_back(profile);
         }
     }
-    lock.unlock();
     return p;
 }   // getAllPlayerProfiles
 //-----------------------------------------------------------------------------
@@ -1470,17 +1661,17 @@ void STKHost::getTeamLists(
     std::vector<std::shared_ptr<NetworkPlayerProfile>>& red_team,
     const bool onlyCanPlay) const
 {
-    std::unique_lock<std::mutex> lock(m_peers_mutex);
-    for (auto& peer : m_peers)
+    auto snapshot = getPeerSnapshot();
+    for (auto& peer : snapshot->m_peers)
     {
-        if (peer.second->isDisconnected() || !peer.second->isValidated())
+        if (peer->isDisconnected() || !peer->isValidated())
             continue;
-        if (onlyCanPlay && (peer.second->isSpectator() ||
-                    peer.second->alwaysSpectate()))
+        if (onlyCanPlay && (peer->isSpectator() ||
+                    peer->alwaysSpectate()))
             continue;
-        if (ServerConfig::m_ai_handling && peer.second->isAIPeer())
+        if (ServerConfig::m_ai_handling && peer->isAIPeer())
             continue;
-        for (auto& profile : peer.second->getPlayerProfiles())
+        for (auto& profile : peer->getPlayerProfiles())
         {
             if (profile->getTeam() == KART_TEAM_NONE)
                 continue;
@@ -1496,50 +1687,48 @@ void STKHost::getTeamLists(
                 red_team.push_back(profile);
         }
     }
-    lock.unlock();
 } // getTeamLists
 //-----------------------------------------------------------------------------
 std::set<uint32_t> STKHost::getAllPlayerOnlineIds() const
 {
     std::set<uint32_t> online_ids;
-    std::unique_lock<std::mutex> lock(m_peers_mutex);
-    for (auto& peer : m_peers)
+    auto snapshot = getPeerSnapshot();
+    for (auto& peer : snapshot->m_peers)
     {
-        if (peer.second->isDisconnected() || !peer.second->isValidated())
+        if (peer->isDisconnected() || !peer->isValidated())
             continue;
-        if (!peer.second->getPlayerProfiles().empty())
+        if (!peer->getPlayerProfiles().empty())
         {
             online_ids.insert(
-                peer.second->getPlayerProfiles()[0]->getOnlineId());
+                peer->getPlayerProfiles()[0]->getOnlineId());
         }
     }
-    lock.unlock();
     return online_ids;
 }   // getAllPlayerOnlineIds
 
 //-----------------------------------------------------------------------------
 std::shared_ptr<STKPeer> STKHost::findPeerByHostId(uint32_t id) const
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    auto ret = std::find_if(m_peers.begin(), m_peers.end(),
-        [id](const std::pair<ENetPeer*, std::shared_ptr<STKPeer> >& p)
+    auto snapshot = getPeerSnapshot();
+    auto ret = std::find_if(snapshot->m_peers.begin(), snapshot->m_peers.end(),
+        [id](const std::shared_ptr<STKPeer>& p)
         {
-            return p.second->getHostId() == id;
+            return p->getHostId() == id;
         });
-    return ret != m_peers.end() ? ret->second : nullptr;
+    return ret != snapshot->m_peers.end() ? *ret : nullptr;
 }   // findPeerByHostId
 
 //-----------------------------------------------------------------------------
 std::shared_ptr<STKPeer> STKHost::findPeerByOnlineId(uint32_t id) const
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    auto ret = std::find_if(m_peers.begin(), m_peers.end(),
-        [id](const std::pair<ENetPeer*, std::shared_ptr<STKPeer> >& p)
+    auto snapshot = getPeerSnapshot();
+    auto ret = std::find_if(snapshot->m_peers.begin(), snapshot->m_peers.end(),
+        [id](const std::shared_ptr<STKPeer>& p)
         {
-            return p.second->hasPlayerProfiles() && 
-                p.second->getPlayerProfiles()[0]->getOnlineId() == id;
+            return p->hasPlayerProfiles() && 
+                p->getPlayerProfiles()[0]->getOnlineId() == id;
         });
-    return ret != m_peers.end() ? ret->second : nullptr;
+    return ret != snapshot->m_peers.end() ? *ret : nullptr;
 }  // findPeerByOnlineId
 //-----------------------------------------------------------------------------
 std::shared_ptr<STKPeer>
@@ -1547,12 +1736,12 @@ std::shared_ptr<STKPeer>
             const bool ignoreCase, const bool onlyPrefix,
             std::shared_ptr<NetworkPlayerProfile>* const out_ptr) const
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    auto ret = std::find_if(m_peers.begin(), m_peers.end(),
-        [name, onlyPrefix, ignoreCase, out_ptr](const std::pair<ENetPeer*, std::shared_ptr<STKPeer> >& p)
+    auto snapshot = getPeerSnapshot();
+    auto ret = std::find_if(snapshot->m_peers.begin(), snapshot->m_peers.end(),
+        [name, onlyPrefix, ignoreCase, out_ptr](const std::shared_ptr<STKPeer>& p)
         {
             bool found = false;
-            for (auto& profile : p.second->getPlayerProfiles())
+            for (auto& profile : p->getPlayerProfiles())
             {
                 const irr::core::stringw& cname = profile->getName();
                 if (
@@ -1576,7 +1765,7 @@ std::shared_ptr<STKPeer>
             }
             return found;
         });
-    return ret != m_peers.end() ? ret->second : nullptr;
+    return ret != snapshot->m_peers.end() ? *ret : nullptr;
 }   // findPeerByName
 
 //-----------------------------------------------------------------------------
@@ -1594,6 +1783,7 @@ void STKHost::initClientNetwork(ENetEvent& event, Network* new_network)
         m_next_unique_host_id++);
     stk_peer->setValidated(true);
     m_peers[event.peer] = stk_peer;
+    markPeersChanged();
     auto pm = ProtocolManager::lock();
     if (pm && !pm->isExiting())
         pm->propagateEvent(new Event(&event, stk_peer));
@@ -1648,8 +1838,7 @@ std::vector<std::shared_ptr<NetworkPlayerProfile> >
             {
                 // test for assets, only send peer to the game when the track_ident
                 // is available to be loaded.
-                std::set<std::string> tracks = stk_peer->getClientAssets().second;
-                stk_peer->setWaitingForGame(tracks.find(track_ident) == tracks.end());
+                stk_peer->setWaitingForGame(!stk_peer->hasTrack(track_ident));
             }
             stk_peer->setSpectator(true);
             continue;
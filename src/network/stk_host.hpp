@@ -24,6 +24,7 @@
 
 #include "network/remote_kart_info.hpp"
 #include "utils/stk_process.hpp"
+#include "utils/mpsc_queue.hpp"
 #include "utils/synchronised.hpp"
 #include "utils/time.hpp"
 
@@ -45,7 +46,6 @@
 #include <mutex>
 #include <set>
 #include <thread>
-#include <tuple>
 #include <vector>
 
 class BareNetworkString;
@@ -60,6 +60,7 @@ class ServerLobby;
 class ChildLoop;
 class SocketAddress;
 class STKPeer;
+class WorkerPool;
 
 using namespace irr;
 
@@ -70,6 +71,63 @@ enum ENetCommandType : unsigned int
     ECT_RESET = 2
 };
 
+/** A command for the listening thread (atm enet_peer_send and
+ *  enet_peer_disconnect), which runs them. */
+struct ENetCommand
+{
+    /** Peer receiving the packet or disconnected. */
+    ENetPeer* m_peer;
+
+    /** Packet to send, or NULL. */
+    ENetPacket* m_packet;
+
+    /** Channel of the packet or disconnect data. */
+    uint32_t m_data;
+
+    ENetCommandType m_type;
+
+    /** Address of the peer when queued, enet can reuse disconnected peers. */
+    ENetAddress m_address;
+
+    /** StkTime::getMonoTimeUs when queued. */
+    uint64_t m_queued_time;
+};
+
+/** Counters of the commands of the listening thread, used by the network
+ *  console. */
+struct ENetCommandStats
+{
+    /** Number of commands queued since start. */
+    uint64_t m_queued;
+
+    /** Number of commands queued but not run yet. */
+    uint64_t m_depth;
+
+    /** Largest number of commands run in one batch. */
+    uint64_t m_max_batch;
+
+    /** Average and largest time from queueing to running a command. */
+    uint64_t m_average_latency_us;
+
+    uint64_t m_max_latency_us;
+};
+
+/** Peers and player profiles of the host at one moment. A published
+ *  snapshot is never changed, so any thread can read it without locking
+ *  \ref STKHost::m_peers_mutex. */
+struct PeerSnapshot
+{
+    /** Increased each time a snapshot is published. */
+    uint64_t m_version;
+
+    /** All peers, in the order of \ref STKHost::m_peers. */
+    std::vector<std::shared_ptr<STKPeer> > m_peers;
+
+    /** Player profiles of validated and connected peers, without the AI
+     *  peer if ai-handling is enabled. */
+    std::vector<std::shared_ptr<NetworkPlayerProfile> > m_profiles;
+};
+
 class STKHost
 {
 private:
@@ -91,17 +149,50 @@ private:
     mutable std::mutex m_peers_mutex;
 
     /** Let (atm enet_peer_send and enet_peer_disconnect) run in the listening
-     *  thread. */
-    std::vector<std::tuple</*peer receive*/ENetPeer*,
-        /*packet to send*/ENetPacket*, /*integer data*/uint32_t,
-        ENetCommandType, ENetAddress> > m_enet_cmd;
+     *  thread, which pops all queued commands in each iteration. */
+    std::unique_ptr<MPSCQueue<ENetCommand> > m_enet_cmd;
 
-    /** Protect \ref m_enet_cmd from multiple threads usage. */
+    /** Commands queued while \ref m_enet_cmd was full, they are run after
+     *  the commands in it. */
+    std::vector<ENetCommand> m_enet_cmd_overflow;
+
+    /** True if m_enet_cmd_overflow is not empty, so new commands are added
+     *  to it to keep them in order. */
+    std::atomic_bool m_enet_cmd_overflowed;
+
+    /** Protect \ref m_enet_cmd_overflow from multiple threads usage. */
     std::mutex m_enet_cmd_mutex;
 
+    /** Counters of ENetCommandStats. */
+    std::atomic<uint64_t> m_enet_cmd_queued;
+    std::atomic<uint64_t> m_enet_cmd_done;
+    std::atomic<uint64_t> m_enet_cmd_max_batch;
+    std::atomic<uint64_t> m_enet_cmd_total_latency;
+    std::atomic<uint64_t> m_enet_cmd_max_latency;
+
+    /** True while the listening thread waits for network events, so it has
+     *  to be woken up if a command is queued. */
+    std::atomic_bool m_enet_waiting;
+
+    /** Loopback address of the enet socket, a datagram sent to it wakes up
+     *  the listening thread. */
+    std::unique_ptr<SocketAddress> m_wake_address;
+
+    /** Threads creating the encrypted packets of a packet sent to many peers
+     *  in parallel, NULL if send-threads is 0 or this is not a server. */
+    std::unique_ptr<WorkerPool> m_send_pool;
+
     /** The list of peers connected to this instance. */
     std::map<ENetPeer*, std::shared_ptr<STKPeer> > m_peers;
 
+    /** Last published snapshot of \ref m_peers, read and replaced with
+     *  std::atomic_load and std::atomic_store. */
+    mutable std::shared_ptr<const PeerSnapshot> m_peer_snapshot;
+
+    /** Set if the peers or their profiles changed after m_peer_snapshot was
+     *  published, the next reader publishes a new one. */
+    mutable std::atomic_bool m_peer_snapshot_dirty;
+
     /** Network player profile that takes precedence over the resulting
      *  vector that is returned by the method getPlayersForNewGame(),
      *  always first. */
@@ -183,6 +274,13 @@ private:
     // ------------------------------------------------------------------------
     void getIPFromStun(int socket, const std::string& stun_address,
                        short family, SocketAddress* result);
+    // ------------------------------------------------------------------------
+    void runENetCommands(ENetHost* host);
+    // ------------------------------------------------------------------------
+    void waitForENetEvents(ENetHost* host, uint32_t timeout);
+    // ------------------------------------------------------------------------
+    void sendPacketToPeers(const std::vector<STKPeer*>& peers,
+                           NetworkString* data, bool reliable);
 public:
     /** If a network console should be started. */
     static bool m_enable_console;
@@ -312,11 +410,9 @@ public:
     void setErrorMessage(const irr::core::stringw &message);
     // ------------------------------------------------------------------------
     void addEnetCommand(ENetPeer* peer, ENetPacket* packet, uint32_t i,
-                        ENetCommandType ect, ENetAddress ea)
-    {
-        std::lock_guard<std::mutex> lock(m_enet_cmd_mutex);
-        m_enet_cmd.emplace_back(peer, packet, i, ect, ea);
-    }
+                        ENetCommandType ect, ENetAddress ea);
+    // ------------------------------------------------------------------------
+    ENetCommandStats getENetCommandStats() const;
     // ------------------------------------------------------------------------
     /** Returns the last error (or "" if no error has happened). */
     const irr::core::stringw& getErrorMessage() const
@@ -334,17 +430,15 @@ public:
     // ------------------------------------------------------------------------
     Network* getNetwork() const                           { return m_network; }
     // ------------------------------------------------------------------------
-    /** Returns a copied list of peers. */
+    std::shared_ptr<const PeerSnapshot> getPeerSnapshot() const;
+    // ------------------------------------------------------------------------
+    /** Tells that peers or their profiles changed, called by STKPeer. */
+    void markPeersChanged()             { m_peer_snapshot_dirty.store(true); }
+    // ------------------------------------------------------------------------
+    /** Returns a copied list of peers, use getPeerSnapshot to avoid the
+     *  copy. */
     std::vector<std::shared_ptr<STKPeer> > getPeers() const
-    {
-        std::lock_guard<std::mutex> lock(m_peers_mutex);
-        std::vector<std::shared_ptr<STKPeer> > peers;
-        for (auto p : m_peers)
-        {
-            peers.push_back(p.second);
-        }
-        return peers;
-    }
+                                         { return getPeerSnapshot()->m_peers; }
     // ------------------------------------------------------------------------
     /** Returns currently forced first position for network player profiles */
     std::shared_ptr<NetworkPlayerProfile> getForcedFirstPlayer() const
@@ -387,10 +481,7 @@ public:
     // ------------------------------------------------------------------------
     /** Returns the number of currently connected peers. */
     unsigned int getPeerCount() const
-    {
-        std::lock_guard<std::mutex> lock(m_peers_mutex);
-        return (unsigned)m_peers.size();
-    }
+                     { return (unsigned)getPeerSnapshot()->m_peers.size(); }
     // ------------------------------------------------------------------------
     /** Sets the global host id of this host (client use). */
     void setMyHostId(uint32_t my_host_id)           { m_host_id = my_host_id; }
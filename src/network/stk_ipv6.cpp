@@ -482,6 +482,56 @@ extern "C" int insideIPv6CIDR(const char* ipv6_cidr, const char* ipv6_in)
     return 1;
 }   // andIPv6
 
+// ----------------------------------------------------------------------------
+/** Converts an IPv6 address to its upper and lower 64 bits, return 1 if
+ *  succeeded. */
+extern "C" int splitIPv6(const char* ipv6, uint64_t* upper, uint64_t* lower)
+{
+    struct in6_addr v6_in;
+    if (stk_inet_pton6(ipv6, &v6_in) != 1)
+        return 0;
+    *upper = 0;
+    *lower = 0;
+    for (unsigned i = 0; i < 8; i++)
+    {
+        *upper = (*upper << 8) | v6_in.s6_addr[i];
+        *lower = (*lower << 8) | v6_in.s6_addr[i + 8];
+    }
+    return 1;
+}   // splitIPv6
+
+// ----------------------------------------------------------------------------
+/** Gets the first and last address of an IPv6 CIDR range, each as upper
+ *  and lower 64 bits in a 2-element array, return 1 if succeeded. The same
+ *  ranges are accepted as in insideIPv6CIDR. */
+extern "C" int rangeIPv6CIDR(const char* ipv6_cidr, uint64_t* start,
+                             uint64_t* end)
+{
+    const char* mask_location = strchr(ipv6_cidr, '/');
+    if (mask_location == NULL ||
+        mask_location - ipv6_cidr >= INET6_ADDRSTRLEN)
+        return 0;
+
+    char ipv6[INET6_ADDRSTRLEN] = {};
+    memcpy(ipv6, ipv6_cidr, mask_location - ipv6_cidr);
+    if (splitIPv6(ipv6, &start[0], &start[1]) != 1)
+        return 0;
+
+    int mask_length = atoi(mask_location + 1);
+    if (mask_length > 128 || mask_length <= 0)
+        return 0;
+
+    uint64_t mask_upper = mask_length >= 64 ?
+        ~(uint64_t)0 : ~(uint64_t)0 << (64 - mask_length);
+    uint64_t mask_lower = mask_length <= 64 ?
+        0 : ~(uint64_t)0 << (128 - mask_length);
+    start[0] &= mask_upper;
+    start[1] &= mask_lower;
+    end[0] = start[0] | ~mask_upper;
+    end[1] = start[1] | ~mask_lower;
+    return 1;
+}   // rangeIPv6CIDR
+
 #ifndef ENABLE_IPV6
 // ----------------------------------------------------------------------------
 extern "C" int isIPv6Socket()
@@ -27,6 +27,8 @@ int getaddrinfo_compat(const char* hostname, const char* servname,
                        const struct addrinfo* hints, struct addrinfo** res);
 int64_t upperIPv6(const char* ipv6);
 int insideIPv6CIDR(const char* ipv6_cidr, const char* ipv6_in);
+int splitIPv6(const char* ipv6, uint64_t* upper, uint64_t* lower);
+int rangeIPv6CIDR(const char* ipv6_cidr, uint64_t* start, uint64_t* end);
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,7 @@
 #include "network/stk_peer.hpp"
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
+#include "network/asset_ids.hpp"
 #include "network/crypto.hpp"
 #include "network/event.hpp"
 #include "network/network.hpp"
@@ -54,6 +55,7 @@ STKPeer::STKPeer(ENetPeer *enet_peer, STKHost* host, uint32_t host_id)
     m_last_activity.store((int64_t)StkTime::getMonoTimeMs());
     m_last_message.store(0);
     m_consecutive_messages = 0;
+    m_all_unknown_addons = true;
 }   // STKPeer
 
 //-----------------------------------------------------------------------------
@@ -104,21 +106,33 @@ void STKPeer::sendPacket(NetworkString *data, bool reliable, bool encrypted)
 {
     if (m_disconnected.load())
         return;
+    queuePacket(createPacket(data, reliable, encrypted), encrypted);
+}   // sendPacket
 
-    ENetPacket* packet = NULL;
+//-----------------------------------------------------------------------------
+/** Creates the enet packet of data for this peer, which is encrypted if the
+ *  peer has a crypto and encrypted is true. It can be called from any
+ *  thread.
+ *  \return The packet, or NULL if it cannot be created.
+ */
+ENetPacket* STKPeer::createPacket(NetworkString *data, bool reliable,
+                                  bool encrypted)
+{
     if (m_crypto && encrypted)
-    {
-        packet = m_crypto->encryptSend(*data, reliable);
-    }
-    else
-    {
-        packet = enet_packet_create(data->getData(),
-            data->getTotalSize(), (reliable ?
-            ENET_PACKET_FLAG_RELIABLE :
-            (ENET_PACKET_FLAG_UNSEQUENCED |
-            ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT)));
-    }
+        return m_crypto->encryptSend(*data, reliable);
+    return enet_packet_create(data->getData(),
+        data->getTotalSize(), (reliable ?
+        ENET_PACKET_FLAG_RELIABLE :
+        (ENET_PACKET_FLAG_UNSEQUENCED |
+        ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT)));
+}   // createPacket
 
+//-----------------------------------------------------------------------------
+/** Passes a packet created by createPacket to the listening thread, which
+ *  sends it to this peer.
+ */
+void STKPeer::queuePacket(ENetPacket* packet, bool encrypted)
+{
     if (packet)
     {
         if (Network::m_connection_debug)
@@ -131,7 +145,7 @@ void STKPeer::sendPacket(NetworkString *data, bool reliable, bool encrypted)
                 encrypted ? EVENT_CHANNEL_NORMAL : EVENT_CHANNEL_UNENCRYPTED,
                 ECT_SEND_PACKET, m_address);
     }
-}   // sendPacket
+}   // queuePacket
 
 //-----------------------------------------------------------------------------
 /** Returns if the peer is connected or not.
@@ -158,6 +172,100 @@ bool STKPeer::isSamePeer(const ENetPeer* peer) const
     return peer==m_enet_peer;
 }   // isSamePeer
 
+//-----------------------------------------------------------------------------
+/** The functions below change what the peer snapshot of the host contains,
+ *  so it is republished when read next time.
+ */
+void STKPeer::cleanPlayerProfiles()
+{
+    m_players.clear();
+    m_host->markPeersChanged();
+}   // cleanPlayerProfiles
+
+//-----------------------------------------------------------------------------
+void STKPeer::addPlayer(std::shared_ptr<NetworkPlayerProfile> p)
+{
+    m_players.push_back(p);
+    m_host->markPeersChanged();
+}   // addPlayer
+
+//-----------------------------------------------------------------------------
+void STKPeer::setValidated(bool val)
+{
+    m_validated.store(val);
+    m_host->markPeersChanged();
+}   // setValidated
+
+//-----------------------------------------------------------------------------
+void STKPeer::setDisconnected(bool val)
+{
+    m_disconnected.store(val);
+    m_host->markPeersChanged();
+}   // setDisconnected
+
+//-----------------------------------------------------------------------------
+void STKPeer::setUserVersion(const std::string& uv)
+{
+    m_user_version = uv;
+    m_host->markPeersChanged();
+}   // setUserVersion
+
+//-----------------------------------------------------------------------------
+bool STKPeer::hasKart(const std::string& kart) const
+{
+    int id = AssetIds::find(kart);
+    return id != -1 && m_available_karts.test(id);
+}   // hasKart
+
+//-----------------------------------------------------------------------------
+bool STKPeer::hasTrack(const std::string& track) const
+{
+    int id = AssetIds::find(track);
+    return id != -1 && m_available_tracks.test(id);
+}   // hasTrack
+
+//-----------------------------------------------------------------------------
+/** Returns if this peer has an addon kart or track, including the ones
+ *  unknown to the server.
+ */
+bool STKPeer::hasAddon(const std::string& addon) const
+{
+    return hasKart(addon) || hasTrack(addon) ||
+        m_unknown_addons.find(addon) != m_unknown_addons.end();
+}   // hasAddon
+
+//-----------------------------------------------------------------------------
+/** Adds the karts of the server which this peer doesn't have to karts_erase,
+ *  nothing if the peer didn't send its karts.
+ */
+void STKPeer::eraseServerKarts(const std::set<std::string>& server_karts,
+                               std::set<std::string>& karts_erase) const
+{
+    if (m_available_karts.none())
+        return;
+    for (const std::string& server_kart : server_karts)
+    {
+        if (!hasKart(server_kart))
+            karts_erase.insert(server_kart);
+    }
+}   // eraseServerKarts
+
+//-----------------------------------------------------------------------------
+/** Adds the tracks of the server which this peer doesn't have to
+ *  tracks_erase, nothing if the peer didn't send its tracks.
+ */
+void STKPeer::eraseServerTracks(const std::set<std::string>& server_tracks,
+                                std::set<std::string>& tracks_erase) const
+{
+    if (m_available_tracks.none())
+        return;
+    for (const std::string& server_track : server_tracks)
+    {
+        if (!hasTrack(server_track))
+            tracks_erase.insert(server_track);
+    }
+}   // eraseServerTracks
+
 //-----------------------------------------------------------------------------
 /** Returns the ping to this peer from host, it waits for 3 seconds for a
  *  stable ping returned by enet measured in ms.
@@ -23,6 +23,7 @@
 #ifndef STK_PEER_HPP
 #define STK_PEER_HPP
 
+#include "utils/dynamic_bitset.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/time.hpp"
 #include "utils/types.hpp"
@@ -111,8 +112,18 @@ protected:
 
     int m_consecutive_messages;
 
-    /** Available karts and tracks from this peer */
-    std::pair<std::set<std::string>, std::set<std::string> > m_available_kts;
+    /** Available karts and tracks from this peer, as AssetIds. Karts or
+     *  tracks unknown to the server are not stored. */
+    DynamicBitset m_available_karts;
+
+    DynamicBitset m_available_tracks;
+
+    /** Addon karts and tracks of this peer unknown to the server, only used
+     *  by /playerhasaddon. */
+    std::set<std::string> m_unknown_addons;
+
+    /** False if the peer has more unknown addons than stored. */
+    bool m_all_unknown_addons;
 
     std::unique_ptr<Crypto> m_crypto;
 
@@ -139,6 +150,11 @@ public:
     void sendPacket(NetworkString *data, bool reliable = true,
                     bool encrypted = true);
     // ------------------------------------------------------------------------
+    ENetPacket* createPacket(NetworkString *data, bool reliable,
+                             bool encrypted);
+    // ------------------------------------------------------------------------
+    void queuePacket(ENetPacket* packet, bool encrypted);
+    // ------------------------------------------------------------------------
     void disconnect();
     // ------------------------------------------------------------------------
     void kick();
@@ -155,12 +171,11 @@ public:
     // ------------------------------------------------------------------------
     bool hasPlayerProfiles() const               { return !m_players.empty(); }
     // ------------------------------------------------------------------------
-    void cleanPlayerProfiles()                           { m_players.clear(); }
+    void cleanPlayerProfiles();
     // ------------------------------------------------------------------------
-    void addPlayer(std::shared_ptr<NetworkPlayerProfile> p)
-                                                    { m_players.push_back(p); }
+    void addPlayer(std::shared_ptr<NetworkPlayerProfile> p);
     // ------------------------------------------------------------------------
-    void setValidated(bool val)                     { m_validated.store(val); }
+    void setValidated(bool val);
     // ------------------------------------------------------------------------
     /** Returns if the client is validated by server. */
     bool isValidated() const                     { return m_validated.load(); }
@@ -171,42 +186,36 @@ public:
     float getConnectedTime() const
        { return float(StkTime::getMonoTimeMs() - m_connected_time) / 1000.0f; }
     // ------------------------------------------------------------------------
-    void setAvailableKartsTracks(std::set<std::string>& k,
-                                 std::set<std::string>& t)
-              { m_available_kts = std::make_pair(std::move(k), std::move(t)); }
+    void setAvailableKartsTracks(const DynamicBitset& k,
+                                 const DynamicBitset& t)
+                               { m_available_karts = k; m_available_tracks = t; }
     // ------------------------------------------------------------------------
-    void eraseServerKarts(const std::set<std::string>& server_karts,
-                          std::set<std::string>& karts_erase) const
+    void setUnknownAddons(std::set<std::string>& addons, bool all)
     {
-        if (m_available_kts.first.empty())
-            return;
-        for (const std::string& server_kart : server_karts)
-        {
-            if (m_available_kts.first.find(server_kart) ==
-                m_available_kts.first.end())
-            {
-                karts_erase.insert(server_kart);
-            }
-        }
+        std::swap(m_unknown_addons, addons);
+        m_all_unknown_addons = all;
     }
     // ------------------------------------------------------------------------
-    void eraseServerTracks(const std::set<std::string>& server_tracks,
-                           std::set<std::string>& tracks_erase) const
-    {
-        if (m_available_kts.second.empty())
-            return;
-        for (const std::string& server_track : server_tracks)
-        {
-            if (m_available_kts.second.find(server_track) ==
-                m_available_kts.second.end())
-            {
-                tracks_erase.insert(server_track);
-            }
-        }
-    }
+    /** Returns false if hasAddon may miss addons unknown to the server. */
+    bool hasAllUnknownAddons() const          { return m_all_unknown_addons; }
     // ------------------------------------------------------------------------
-    std::pair<std::set<std::string>, std::set<std::string> >
-                            getClientAssets() const { return m_available_kts; }
+    const DynamicBitset& getAvailableKarts() const
+                                                  { return m_available_karts; }
+    // ------------------------------------------------------------------------
+    const DynamicBitset& getAvailableTracks() const
+                                                 { return m_available_tracks; }
+    // ------------------------------------------------------------------------
+    bool hasKart(const std::string& kart) const;
+    // ------------------------------------------------------------------------
+    bool hasTrack(const std::string& track) const;
+    // ------------------------------------------------------------------------
+    bool hasAddon(const std::string& addon) const;
+    // ------------------------------------------------------------------------
+    void eraseServerKarts(const std::set<std::string>& server_karts,
+                          std::set<std::string>& karts_erase) const;
+    // ------------------------------------------------------------------------
+    void eraseServerTracks(const std::set<std::string>& server_tracks,
+                           std::set<std::string>& tracks_erase) const;
     // ------------------------------------------------------------------------
     void setPingInterval(uint32_t interval)
                             { enet_peer_ping_interval(m_enet_peer, interval); }
@@ -231,7 +240,7 @@ public:
     // ------------------------------------------------------------------------
     bool isDisconnected() const               { return m_disconnected.load(); }
     // ------------------------------------------------------------------------
-    void setDisconnected(bool val)        { return m_disconnected.store(val); }
+    void setDisconnected(bool val);
     // ------------------------------------------------------------------------
     bool hasWarnedForHighPing() const { return m_warned_for_high_ping.load(); }
     // ------------------------------------------------------------------------
@@ -247,7 +256,7 @@ public:
     const std::set<unsigned>& getAvailableKartIDs() const
                                                { return m_available_kart_ids; }
     // ------------------------------------------------------------------------
-    void setUserVersion(const std::string& uv)         { m_user_version = uv; }
+    void setUserVersion(const std::string& uv);
     // ------------------------------------------------------------------------
     const std::string& getUserVersion() const        { return m_user_version; }
     // ------------------------------------------------------------------------
@@ -0,0 +1,299 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/track_records.hpp"
+
+#include "network/server_config.hpp"
+#include "race/race_manager.hpp"
+#include "utils/file_utils.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+TrackRecords* TrackRecords::m_track_records = NULL;
+
+// ----------------------------------------------------------------------------
+/** Parses a non-negative number, return false if text is not a number. */
+static bool parseNumber(const std::string& text, double* number)
+{
+    if (text.empty())
+        return false;
+    char* end = NULL;
+    *number = strtod(text.c_str(), &end);
+    return end && *end == 0 && *number >= 0.0;
+}   // parseNumber
+
+// ----------------------------------------------------------------------------
+/** Splits a line at spaces and tabulators. */
+static std::vector<std::string> splitWords(const std::string& line)
+{
+    std::vector<std::string> words;
+    std::istringstream iss(line);
+    std::string word;
+    while (iss >> word)
+        words.push_back(word);
+    return words;
+}   // splitWords
+
+// ----------------------------------------------------------------------------
+TrackRecords* TrackRecords::get()
+{
+    static std::mutex create_mutex;
+    std::lock_guard<std::mutex> lock(create_mutex);
+    if (!m_track_records)
+    {
+        m_track_records =
+            new TrackRecords(ServerConfig::m_track_records_file);
+    }
+    return m_track_records;
+}   // get
+
+// ----------------------------------------------------------------------------
+void TrackRecords::destroy()
+{
+    delete m_track_records;
+    m_track_records = NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+TrackRecords::TrackRecords(const std::string& filename)
+            : m_filename(filename)
+{
+    std::ifstream file(m_filename);
+    if (!file.is_open())
+        return;
+    std::string line;
+    int invalid = 0;
+    while (std::getline(file, line))
+    {
+        Record record;
+        if (parseLine(line, &record))
+            addRecordLocked(record);
+        else if (!StringUtils::removeWhitespaces(line).empty())
+            invalid++;
+    }
+    if (invalid > 0)
+    {
+        Log::warn("TrackRecords", "Ignored %d invalid lines in %s.", invalid,
+            m_filename.c_str());
+    }
+    Log::info("TrackRecords", "Loaded %d records from %s.",
+        (int)m_records.size(), m_filename.c_str());
+}   // TrackRecords
+
+// ----------------------------------------------------------------------------
+std::string TrackRecords::getKey(const std::string& track,
+                                 const std::string& mode, bool reverse,
+                                 int laps)
+{
+    return track + " " + mode + (reverse ? " 1 " : " 0 ") +
+        StringUtils::toString(laps);
+}   // getKey
+
+// ----------------------------------------------------------------------------
+/** Parses a line of the records file, return false if it is not valid. */
+bool TrackRecords::parseLine(const std::string& line, Record* record)
+{
+    std::vector<std::string> parts =
+        splitWords(line);
+    if (parts.size() != 8)
+        return false;
+    double reverse, laps, time, date;
+    if (!parseNumber(parts[2], &reverse) || !parseNumber(parts[3], &laps) ||
+        !parseNumber(parts[4], &time) || !parseNumber(parts[7], &date))
+        return false;
+    record->m_track = parts[0];
+    record->m_mode = parts[1];
+    record->m_reverse = reverse != 0.0;
+    record->m_laps = (int)laps;
+    record->m_time = (float)time;
+    record->m_player = parts[5];
+    record->m_kart = parts[6];
+    record->m_date = (uint64_t)date;
+    return true;
+}   // parseLine
+
+// ----------------------------------------------------------------------------
+std::string TrackRecords::toLine(const Record& record)
+{
+    return getKey(record.m_track, record.m_mode, record.m_reverse,
+        record.m_laps) + " " + StringUtils::toString(record.m_time) + " " +
+        record.m_player + " " + record.m_kart + " " +
+        StringUtils::toString(record.m_date);
+}   // toLine
+
+// ----------------------------------------------------------------------------
+/** Stores the record if it is faster than the current one of its key,
+ *  m_records_mutex must be locked (or not shared yet).
+ *  \return True if the record was stored. */
+bool TrackRecords::addRecordLocked(const Record& record)
+{
+    std::string key = getKey(record.m_track, record.m_mode,
+        record.m_reverse, record.m_laps);
+    auto it = m_records.find(key);
+    if (it != m_records.end() && it->second.m_time <= record.m_time)
+        return false;
+    m_records[key] = record;
+    return true;
+}   // addRecordLocked
+
+// ----------------------------------------------------------------------------
+/** Rewrites the records file with one line per record. */
+bool TrackRecords::saveLocked() const
+{
+    std::string temp = FileUtils::getTempPath(m_filename);
+    std::ofstream file(temp, std::ios::trunc);
+    if (!file.is_open())
+    {
+        Log::error("TrackRecords", "Cannot write %s.", temp.c_str());
+        return false;
+    }
+    for (auto& p : m_records)
+        file << toLine(p.second) << "\n";
+    file.close();
+    if (file.fail() || rename(temp.c_str(), m_filename.c_str()) != 0)
+    {
+        Log::error("TrackRecords", "Cannot write %s.", m_filename.c_str());
+        return false;
+    }
+    return true;
+}   // saveLocked
+
+// ----------------------------------------------------------------------------
+/** Adds a finish time, it is appended to the records file if it is a new
+ *  record.
+ *  \return True if it is a new record. */
+bool TrackRecords::addResult(const Record& record)
+{
+    std::lock_guard<std::mutex> lock(m_records_mutex);
+    if (!addRecordLocked(record))
+        return false;
+    std::ofstream file(m_filename, std::ios::app);
+    if (file.is_open())
+        file << toLine(record) << "\n";
+    else
+        Log::error("TrackRecords", "Cannot write %s.", m_filename.c_str());
+    return true;
+}   // addResult
+
+// ----------------------------------------------------------------------------
+/** Copies the record of the track, mode, direction and laps to record.
+ *  \return False if there is no record yet. */
+bool TrackRecords::getRecord(const std::string& track, const std::string& mode,
+                             bool reverse, int laps, Record* record) const
+{
+    std::string key = getKey(track, mode, reverse, laps);
+    std::lock_guard<std::mutex> lock(m_records_mutex);
+    auto it = m_records.find(key);
+    if (it == m_records.end())
+        return false;
+    *record = it->second;
+    return true;
+}   // getRecord
+
+// ----------------------------------------------------------------------------
+/** Imports the records of a file and rewrites the records file if any record
+ *  improved. Lines can be in the format of the records file, or of the
+ *  plain text race log, where "Addon: reverse track laps" lines start a race
+ *  and "player time kart" lines are its finishers. Races of the log are
+ *  imported as time trial, the mode of world record races.
+ *  \return Number of improved records, or -1 if the file cannot be read.
+ */
+int TrackRecords::importFile(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        Log::error("TrackRecords", "Cannot open %s.", filename.c_str());
+        return -1;
+    }
+    std::vector<Record> records;
+    // Race of the log which the following finishers belong to
+    Record race;
+    bool has_race = false;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        Record record;
+        if (parseLine(line, &record))
+        {
+            records.push_back(record);
+            continue;
+        }
+        std::vector<std::string> parts =
+            splitWords(line);
+        double reverse, laps, time;
+        if (parts.size() == 4 && parts[0] == "Addon:" &&
+            parseNumber(parts[1], &reverse) && parseNumber(parts[3], &laps))
+        {
+            race.m_track = parts[2];
+            race.m_mode = RaceManager::getIdentOf(
+                RaceManager::MINOR_MODE_TIME_TRIAL);
+            race.m_reverse = reverse != 0.0;
+            race.m_laps = (int)laps;
+            has_race = true;
+        }
+        else if (parts.size() > 0 && parts[0] == "Addon:")
+        {
+            // Not a linear race
+            has_race = false;
+        }
+        else if (has_race && parts.size() == 3 &&
+            parseNumber(parts[1], &time))
+        {
+            record = race;
+            record.m_time = (float)time;
+            record.m_player = parts[0];
+            record.m_kart = parts[2];
+            record.m_date = 0;
+            records.push_back(record);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_records_mutex);
+    int improved = 0;
+    for (const Record& record : records)
+    {
+        if (addRecordLocked(record))
+            improved++;
+    }
+    if (improved > 0)
+        saveLocked();
+    Log::info("TrackRecords", "Imported %d of %d records from %s.", improved,
+        (int)records.size(), filename.c_str());
+    return improved;
+}   // importFile
+
+// ----------------------------------------------------------------------------
+size_t TrackRecords::size() const
+{
+    std::lock_guard<std::mutex> lock(m_records_mutex);
+    return m_records.size();
+}   // size
+
+// ----------------------------------------------------------------------------
+/** Reverts the space replacement of player names in GlobalLog. */
+std::string TrackRecords::getDisplayName(const std::string& player)
+{
+    return StringUtils::replace(player,
+        StringUtils::wideToUtf8(L"\u03df"), " ");
+}   // getDisplayName
@@ -0,0 +1,103 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TRACK_RECORDS_HPP
+#define HEADER_TRACK_RECORDS_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/** \ingroup network
+ *  Best finish times of the server, one per track, minor mode, direction and
+ *  number of laps. Records are kept in memory and a new record is appended
+ *  to track-records-file, which is read once when first used (later lines
+ *  of the same key replace earlier ones if they are faster).
+ *  A line of the file is "track mode reverse laps time player kart date",
+ *  with the player name normalized like in GlobalLog (no spaces) and date
+ *  in seconds since epoch.
+ */
+class TrackRecords
+{
+public:
+    struct Record
+    {
+        std::string m_track;
+
+        std::string m_mode;
+
+        bool m_reverse;
+
+        int m_laps;
+
+        float m_time;
+
+        std::string m_player;
+
+        std::string m_kart;
+
+        uint64_t m_date;
+    };
+
+private:
+    static TrackRecords* m_track_records;
+
+    mutable std::mutex m_records_mutex;
+
+    std::unordered_map<std::string, Record> m_records;
+
+    std::string m_filename;
+
+    // ------------------------------------------------------------------------
+    TrackRecords(const std::string& filename);
+    // ------------------------------------------------------------------------
+    static std::string getKey(const std::string& track,
+                              const std::string& mode, bool reverse,
+                              int laps);
+    // ------------------------------------------------------------------------
+    static bool parseLine(const std::string& line, Record* record);
+    // ------------------------------------------------------------------------
+    static std::string toLine(const Record& record);
+    // ------------------------------------------------------------------------
+    bool addRecordLocked(const Record& record);
+    // ------------------------------------------------------------------------
+    bool saveLocked() const;
+
+public:
+    // ------------------------------------------------------------------------
+    /** Returns the records of the server, reading track-records-file when
+     *  first called. */
+    static TrackRecords* get();
+    // ------------------------------------------------------------------------
+    static void destroy();
+    // ------------------------------------------------------------------------
+    bool addResult(const Record& record);
+    // ------------------------------------------------------------------------
+    bool getRecord(const std::string& track, const std::string& mode,
+                   bool reverse, int laps, Record* record) const;
+    // ------------------------------------------------------------------------
+    int importFile(const std::string& filename);
+    // ------------------------------------------------------------------------
+    size_t size() const;
+    // ------------------------------------------------------------------------
+    static std::string getDisplayName(const std::string& player);
+
+};   // class TrackRecords
+
+#endif // HEADER_TRACK_RECORDS_HPP
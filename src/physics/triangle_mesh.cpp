@@ -22,13 +22,28 @@
 #include "main_loop.hpp"
 #include "physics/physics.hpp"
 #include "utils/constants.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
 #include "utils/time.hpp"
 
 #include "btBulletDynamicsCommon.h"
 
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 
+/** Header of a cached BVH file, the serialized BVH follows it. The cache is
+ *  only read by the same build, so it is stored in native byte order. */
+struct BvhFileHeader
+{
+    char     m_magic[8];
+    uint32_t m_scalar_size;
+    uint32_t m_num_triangles;
+    uint64_t m_content_hash;
+    uint64_t m_bvh_size;
+};
+static const char BVH_FILE_MAGIC[8] = { 'S', 'T', 'K', 'B', 'V', 'H', '0', '1' };
+
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
  */
@@ -45,6 +60,7 @@ TriangleMesh::TriangleMesh(bool can_be_transformed) : m_mesh()
     // (and m_mesh->m_weldingThreshold at m_normals
     m_collision_shape  = NULL;
     m_collision_object = NULL;
+    m_serialized_bvh   = NULL;
     m_user_pointer.set(this);
 }   // TriangleMesh
 
@@ -90,8 +106,10 @@ void TriangleMesh::addTriangle(const btVector3 &t1, const btVector3 &t2,
 // -----------------------------------------------------------------------------
 /** Creates a collision body only, which can be used for raycasting, but
  *  has no physical properties.
- *  @param serialized_bhv if non-null, load the serialized bhv from file instead
- *                        of builing it on the fly
+ *  @param serialized_bhv if non-null, load the serialized bhv from this file
+ *                        instead of builing it on the fly. If the file does
+ *                        not exist or was saved for different triangles,
+ *                        the bhv is built and saved to it.
  */
 void TriangleMesh::createCollisionShape(bool create_collision_object, const char* serialized_bhv)
 {
@@ -108,51 +126,24 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
 
     if (serialized_bhv != NULL)
     {
-        FILE *f = fopen(serialized_bhv, "rb");
-        fseek(f, 0, SEEK_END);
-        long pos = ftell(f);
-        assert(pos != -1L);
-        fseek(f, 0, SEEK_SET);
-
-        void* bytes = btAlignedAlloc(pos, 16);
-        fread(bytes, pos, 1, f);
-        fclose(f);
-
-        btOptimizedBvh* bhv = btOptimizedBvh::deSerializeInPlace(bytes, pos, !IS_LITTLE_ENDIAN);
-        if (bhv == NULL)
+        const uint64_t hash = getContentHash();
+        btOptimizedBvh* bvh = loadBvh(serialized_bhv, hash);
+        if (bvh)
         {
-            Log::warn("TriangleMesh", "Failed to load serialized BHV");
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
+            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
+                                                           false /* buildBvh */);
+            bhv_triangle_mesh->setOptimizedBvh(bvh);
         }
         else
         {
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
-                                                           false /* buildBvh */);
-            bhv_triangle_mesh->setOptimizedBvh( bhv );
+            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
+            saveBvh(bhv_triangle_mesh->getOptimizedBvh(), serialized_bhv,
+                    hash);
         }
-        // Do *NOT* free the bytes, 'deSerializeInPlace' makes the btOptimizedBvh object
-        // directly at this memory location
-        //free(bytes);
-
     }
     else
     {
         bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-
-        /*
-         // code to serialize triangle mesh
-        btOptimizedBvh* bvh = bhv_triangle_mesh->getOptimizedBvh();
-        unsigned int ssize = bvh->calculateSerializeBufferSize();
-        char* buffer = (char*)btAlignedAlloc(ssize, 16);
-        bool success = bvh->serialize(buffer, ssize, !IS_LITTLE_ENDIAN);
-        printf("serialization success = %i\n", success);
-
-        std::ofstream fileout("/tmp/btOptimizedBvh");
-        fileout.write(buffer, ssize);
-        fileout.close();
-
-        btAlignedFree(buffer);
-         */
     }
 
     m_collision_shape = bhv_triangle_mesh;
@@ -179,8 +170,9 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
  *  for height of terrain detection).
  *  \param friction Friction to be used for this TriangleMesh.
  *  \param flags Additional collision flags (default 0).
- *  \param serializedBhv if non-NULL, the bhv is deserialized instead of
- *                       being calculated on the fly
+ *  \param serializedBhv if non-NULL, the file from which the bhv is
+ *                       deserialized instead of being calculated on the fly,
+ *                       see createCollisionShape.
  */
 void TriangleMesh::createPhysicalBody(float friction,
                                       btCollisionObject::CollisionFlags flags,
@@ -233,8 +225,127 @@ void TriangleMesh::removeAll()
     }
     delete m_collision_shape;
     m_collision_shape = NULL;
+    if (m_serialized_bvh)
+    {
+        ((btQuantizedBvh*)m_serialized_bvh)->~btQuantizedBvh();
+        btAlignedFree(m_serialized_bvh);
+        m_serialized_bvh = NULL;
+    }
 }   // removeAll
 
+// -----------------------------------------------------------------------------
+/** Returns a hash of the vertices of all triangles, used to check that a
+ *  cached bhv was built for the same triangles.
+ */
+uint64_t TriangleMesh::getContentHash() const
+{
+    // FNV-1a over 32-bit words
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < m_mesh.getNumTriangles(); i++)
+    {
+        btVector3 p[3];
+        getTriangle(i, p, p + 1, p + 2);
+        for (unsigned j = 0; j < 3; j++)
+        {
+            for (unsigned k = 0; k < 3; k++)
+            {
+                float f = p[j][k];
+                uint32_t word;
+                memcpy(&word, &f, sizeof(word));
+                hash = (hash ^ word) * 1099511628211ULL;
+            }
+        }
+    }
+    return hash;
+}   // getContentHash
+
+// -----------------------------------------------------------------------------
+/** Loads the bhv saved by saveBvh, returns NULL if the file does not exist or
+ *  does not match the triangles of this mesh.
+ *  \param hash The content hash of this mesh.
+ */
+btOptimizedBvh* TriangleMesh::loadBvh(const char* filename, uint64_t hash)
+{
+    FILE* f = fopen(filename, "rb");
+    if (!f)
+        return NULL;
+
+    BvhFileHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.m_magic, BVH_FILE_MAGIC, sizeof(BVH_FILE_MAGIC)) != 0 ||
+        header.m_scalar_size != sizeof(btScalar) ||
+        header.m_num_triangles != (uint32_t)m_mesh.getNumTriangles() ||
+        header.m_content_hash != hash || header.m_bvh_size == 0 ||
+        header.m_bvh_size > 0xffffffffULL)
+    {
+        fclose(f);
+        Log::info("TriangleMesh", "Cached bhv %s is outdated.", filename);
+        return NULL;
+    }
+
+    void* bytes = btAlignedAlloc((size_t)header.m_bvh_size, 16);
+    size_t read = fread(bytes, (size_t)header.m_bvh_size, 1, f);
+    fclose(f);
+    btOptimizedBvh* bvh = read == 1 ?
+        btOptimizedBvh::deSerializeInPlace(bytes,
+            (unsigned)header.m_bvh_size, !IS_LITTLE_ENDIAN) : NULL;
+    if (bvh == NULL)
+    {
+        Log::warn("TriangleMesh", "Failed to load serialized BHV %s",
+            filename);
+        btAlignedFree(bytes);
+        return NULL;
+    }
+    // Do *NOT* free the bytes, 'deSerializeInPlace' makes the
+    // btOptimizedBvh object directly at this memory location
+    m_serialized_bvh = bytes;
+    return bvh;
+}   // loadBvh
+
+// -----------------------------------------------------------------------------
+/** Saves the bhv with a header identifying the triangles it was built for.
+ *  The file is written under a temporary name first, so another process
+ *  never reads a partial file.
+ */
+void TriangleMesh::saveBvh(const btOptimizedBvh* bvh, const char* filename,
+                           uint64_t hash) const
+{
+    if (!bvh)
+        return;
+    unsigned size = bvh->calculateSerializeBufferSize();
+    char* buffer = (char*)btAlignedAlloc(size, 16);
+    bool success = bvh->serialize(buffer, size, !IS_LITTLE_ENDIAN);
+
+    BvhFileHeader header;
+    memcpy(header.m_magic, BVH_FILE_MAGIC, sizeof(BVH_FILE_MAGIC));
+    header.m_scalar_size = sizeof(btScalar);
+    header.m_num_triangles = (uint32_t)m_mesh.getNumTriangles();
+    header.m_content_hash = hash;
+    header.m_bvh_size = size;
+
+    std::string temp = FileUtils::getTempPath(filename);
+    FILE* f = success ? fopen(temp.c_str(), "wb") : NULL;
+    if (f)
+    {
+        success = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(buffer, size, 1, f) == 1;
+        success = fclose(f) == 0 && success;
+#ifdef WIN32
+        // rename does not replace existing files on windows
+        if (success)
+            remove(filename);
+#endif
+        success = success && rename(temp.c_str(), filename) == 0;
+        if (!success)
+            remove(temp.c_str());
+    }
+    else
+        success = false;
+    btAlignedFree(buffer);
+    if (!success)
+        Log::warn("TriangleMesh", "Failed to save BHV to %s", filename);
+}   // saveBvh
+
 // -----------------------------------------------------------------------------
 /** Interpolates the normal at the given position for the triangle with
  *  a given index. The position must be inside of the given triangle.
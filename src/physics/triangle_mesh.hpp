@@ -19,6 +19,7 @@
 #ifndef HEADER_TRIANGLE_MESH_HPP
 #define HEADER_TRIANGLE_MESH_HPP
 
+#include <cstdint>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 
@@ -46,6 +47,10 @@ private:
     btDefaultMotionState        *m_motion_state;
     btCollisionShape            *m_collision_shape;
 
+    /** Buffer of a BVH loaded from a file, the BVH is constructed in place
+     *  so the buffer must live as long as the collision shape. */
+    void                        *m_serialized_bvh;
+
     /** The three normals for each triangle. */
     AlignedArray<btVector3>      m_normals;
 
@@ -57,6 +62,11 @@ private:
      *  to the current transform of the body. */
     bool m_can_be_transformed;
 
+    uint64_t getContentHash() const;
+    btOptimizedBvh* loadBvh(const char* filename, uint64_t hash);
+    void saveBvh(const btOptimizedBvh* bvh, const char* filename,
+                 uint64_t hash) const;
+
 public:
     class RigidBodyTriangleMesh : public btRigidBody
     {
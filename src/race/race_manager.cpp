@@ -56,6 +56,8 @@
 #include "network/protocols/lobby_protocol.hpp"
 #include "network/protocols/server_lobby.hpp"
 #include "network/stk_peer.hpp"
+#include "network/server_config.hpp"
+#include "network/track_records.hpp"
 #include "replay/replay_play.hpp"
 #include "scriptengine/property_animator.hpp"
 #include "states_screens/grand_prix_cutscene.hpp"
@@ -69,6 +71,7 @@
 #include "utils/ptr_vector.hpp"
 #include "utils/stk_process.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 #include "utils/translation.hpp"
 #include "io/rich_presence.hpp"
 
@@ -1100,8 +1103,37 @@ void RaceManager::kartFinishedRace(const AbstractKart *kart, float time)
         Log::verbose("RaceManager", "Finisher: %s %f %s",
                 player_name.c_str(), time, kart_name.c_str());
         // legacy support
-        GlobalLog::writeLog(player_name + " " + std::to_string(time) + " " + kart_name + "\n",
-                GlobalLogTypes::POS_LOG);
+        GlobalLog::writeEvent(GlobalLogTypes::POS_LOG, "finish", id,
+                player_name + " " + std::to_string(time) + " " + kart_name + "\n",
+                { { "time", std::to_string(time) }, { "kart", kart_name } });
+
+        // The name of the player is taken from the kart info, the global
+        // log only knows it if logging is enabled. AI karts have no name.
+        std::string record_player;
+        if (id < m_player_karts.size())
+        {
+            record_player =
+                StringUtils::wideToUtf8(m_player_karts[id].getPlayerName());
+        }
+        if (NetworkConfig::get()->isServer() &&
+            ServerConfig::m_is_world_record_race && isLinearRaceMode() &&
+            m_minor_mode != MINOR_MODE_LAP_TRIAL && !record_player.empty())
+        {
+            TrackRecords::Record record;
+            record.m_track = getTrackName();
+            record.m_mode = getIdentOf(m_minor_mode);
+            record.m_reverse = getReverseTrack();
+            record.m_laps = getNumLaps();
+            record.m_time = time;
+            record.m_player = record_player;
+            record.m_kart = kart_name;
+            record.m_date = StkTime::getTimeSinceEpoch();
+            if (TrackRecords::get()->addResult(record))
+            {
+                Log::info("RaceManager", "New record on %s: %s %f",
+                    record.m_track.c_str(), record_player.c_str(), time);
+            }
+        }
     }
     m_num_finished_karts ++;
     if(kart->getController()->isPlayerController())
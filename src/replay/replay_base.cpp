@@ -18,7 +18,18 @@
 #include "replay/replay_base.hpp"
 
 #include "io/file_manager.hpp"
+#include "network/network_string.hpp"
 #include "utils/file_utils.hpp"
+#include "utils/log.hpp"
+
+#include "mini_glm.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+/** First bytes of a binary replay file. */
+static const char g_binary_magic[4] = { 'S', 'T', 'K', 'R' };
 
 // -----------------------------------------------------------------------------
 ReplayBase::ReplayBase()
@@ -28,13 +39,15 @@ ReplayBase::ReplayBase()
 /** Opens a replay file which is determined by sub classes.
  *  \param writeable True if the file should be opened for writing.
  *  \param full_path True if the file is full path.
+ *  \param binary True to open a binary replay.
  *  \return A FILE *, or NULL if the file could not be opened.
  */
-FILE* ReplayBase::openReplayFile(bool writeable, bool full_path, int replay_file_number)
+FILE* ReplayBase::openReplayFile(bool writeable, bool full_path, int replay_file_number,
+                                 bool binary)
 {
     FILE* fd = FileUtils::fopenU8Path(full_path ? getReplayFilename(replay_file_number) :
         file_manager->getReplayDir() + getReplayFilename(replay_file_number),
-        writeable ? "w" : "r");
+        binary ? (writeable ? "wb" : "rb") : (writeable ? "w" : "r"));
     if (!fd)
     {
         return NULL;
@@ -42,3 +55,333 @@ FILE* ReplayBase::openReplayFile(bool writeable, bool full_path, int replay_file
     return fd;
 
 }   // openReplayFile
+
+// -----------------------------------------------------------------------------
+btTransform ReplayBase::ReplayFrame::getTransform() const
+{
+    return btTransform(MiniGLM::decompressbtQuaternion(m_rotation),
+        btVector3(m_xyz[0], m_xyz[1], m_xyz[2]));
+}   // getTransform
+
+// -----------------------------------------------------------------------------
+float ReplayBase::ReplayFrame::getSpeed() const
+{
+    return MiniGLM::toFloat32(m_speed);
+}   // getSpeed
+
+// -----------------------------------------------------------------------------
+float ReplayBase::ReplayFrame::getSteer() const
+{
+    return MiniGLM::toFloat32(m_steer);
+}   // getSteer
+
+// -----------------------------------------------------------------------------
+float ReplayBase::ReplayFrame::getSuspensionLength(int wheel) const
+{
+    return MiniGLM::toFloat32(m_suspension_length[wheel]);
+}   // getSuspensionLength
+
+// -----------------------------------------------------------------------------
+float ReplayBase::ReplayFrame::getNitroAmount() const
+{
+    return MiniGLM::toFloat32(m_nitro_amount);
+}   // getNitroAmount
+
+// -----------------------------------------------------------------------------
+/** Converts the recorded values of a kart at a certain time to the frame
+ *  stored in binary replays.
+ */
+ReplayBase::ReplayFrame ReplayBase::encodeFrame(float time,
+                                                const btTransform& trans,
+                                                const PhysicInfo& pi,
+                                                const BonusInfo& bi,
+                                                const KartReplayEvent& kre)
+{
+    static_assert(sizeof(ReplayFrame) == 48,
+                  "Binary replay frames must have a fixed size.");
+    ReplayFrame f;
+    f.m_time = time;
+    f.m_xyz[0] = trans.getOrigin().getX();
+    f.m_xyz[1] = trans.getOrigin().getY();
+    f.m_xyz[2] = trans.getOrigin().getZ();
+    btQuaternion q = trans.getRotation();
+    f.m_rotation = MiniGLM::compressQuaternion(
+        q.length2() > 0.0f ? q : btQuaternion(0, 0, 0, 1));
+    f.m_distance = kre.m_distance;
+    f.m_speed = MiniGLM::toFloat16(pi.m_speed);
+    f.m_steer = MiniGLM::toFloat16(pi.m_steer);
+    for (int i = 0; i < 4; i++)
+        f.m_suspension_length[i] = MiniGLM::toFloat16(pi.m_suspension_length[i]);
+    f.m_nitro_amount = MiniGLM::toFloat16(bi.m_nitro_amount);
+    f.m_special_value = (int16_t)bi.m_special_value;
+    f.m_skidding_state = (int8_t)pi.m_skidding_state;
+    f.m_attachment = (uint8_t)bi.m_attachment;
+    f.m_item_amount = (uint8_t)bi.m_item_amount;
+    f.m_item_type = (uint8_t)bi.m_item_type;
+    f.m_nitro_usage = (uint8_t)kre.m_nitro_usage;
+    f.m_skidding_effect = (uint8_t)kre.m_skidding_effect;
+    f.m_flags = (kre.m_zipper_usage ? RF_ZIPPER : 0) |
+        (kre.m_red_skidding ? RF_RED_SKIDDING : 0) |
+        (kre.m_jumping ? RF_JUMPING : 0);
+    f.m_reserved = 0;
+    return f;
+}   // encodeFrame
+
+// -----------------------------------------------------------------------------
+/** Returns true if the file starts with the magic of binary replays. The
+ *  file position is after the magic if so, otherwise at the beginning.
+ */
+bool ReplayBase::isBinaryReplay(FILE* fd)
+{
+    char magic[4];
+    if (fread(magic, 1, 4, fd) == 4 && memcmp(magic, g_binary_magic, 4) == 0)
+        return true;
+    fseek(fd, 0, SEEK_SET);
+    return false;
+}   // isBinaryReplay
+
+// -----------------------------------------------------------------------------
+/** Reads the header of a binary replay, the file position must be after the
+ *  magic. Only the header is read, so this is cheap for listing replays.
+ *  \return False if the file is not a valid binary replay.
+ */
+bool ReplayBase::readBinaryHeader(FILE* fd, BinaryHeader* header)
+{
+#ifdef __BIG_ENDIAN__
+    Log::warn("Replay", "Binary replays are not supported on big endian.");
+    return false;
+#endif
+    uint32_t version_size[2];
+    if (fread(version_size, sizeof(uint32_t), 2, fd) != 2)
+        return false;
+    if (version_size[0] != getBinaryReplayVersion())
+    {
+        Log::warn("Replay", "Binary replay is version '%d', STK binary "
+            "replay version is '%d'.", version_size[0],
+            getBinaryReplayVersion());
+        return false;
+    }
+    // Sanity check of the header size, it has 256 bytes per kart at most
+    if (version_size[1] > 65536)
+        return false;
+    std::vector<char> data(version_size[1]);
+    if (fread(data.data(), 1, data.size(), fd) != data.size())
+        return false;
+
+    BareNetworkString bns(data.data(), (int)data.size());
+    try
+    {
+        bns.decodeString(&header->m_stk_version);
+        unsigned num_karts = bns.getUInt8();
+        header->m_kart_list.resize(num_karts);
+        header->m_name_list.resize(num_karts);
+        header->m_kart_color.resize(num_karts);
+        header->m_num_frames.resize(num_karts);
+        header->m_frames_offset.resize(num_karts);
+        for (unsigned i = 0; i < num_karts; i++)
+        {
+            bns.decodeString(&header->m_kart_list[i]);
+            bns.decodeString(&header->m_name_list[i]);
+            header->m_kart_color[i] = bns.getFloat();
+            header->m_num_frames[i] = bns.getUInt32();
+            header->m_frames_offset[i] = bns.getUInt32();
+        }
+        header->m_reverse = bns.getUInt8() != 0;
+        header->m_difficulty = bns.getUInt8();
+        bns.decodeString(&header->m_minor_mode);
+        bns.decodeString(&header->m_track_name);
+        header->m_laps = bns.getUInt32();
+        header->m_min_time = bns.getFloat();
+        header->m_replay_uid = bns.getUInt64();
+    }
+    catch (std::exception& e)
+    {
+        Log::warn("Replay", "Invalid binary replay header: %s", e.what());
+        return false;
+    }
+    return true;
+}   // readBinaryHeader
+
+// -----------------------------------------------------------------------------
+/** Reads all frames of a kart of a binary replay with one fread.
+ */
+bool ReplayBase::readBinaryFrames(FILE* fd, const BinaryHeader& header,
+                                  unsigned int kart,
+                                  std::vector<ReplayFrame>* frames)
+{
+    frames->resize(header.m_num_frames.at(kart));
+    if (frames->empty())
+        return true;
+    if (fseek(fd, header.m_frames_offset.at(kart), SEEK_SET) != 0)
+        return false;
+    return fread(frames->data(), sizeof(ReplayFrame), frames->size(), fd) ==
+        frames->size();
+}   // readBinaryFrames
+
+// -----------------------------------------------------------------------------
+/** Writes a binary replay, the number of frames and offsets of the header
+ *  are set from the frames of each kart.
+ */
+bool ReplayBase::writeBinaryReplay(FILE* fd, BinaryHeader* header,
+                        const std::vector<std::vector<ReplayFrame> >& frames)
+{
+#ifdef __BIG_ENDIAN__
+    Log::error("Replay", "Binary replays are not supported on big endian.");
+    return false;
+#endif
+    const unsigned num_karts = (unsigned)header->m_kart_list.size();
+    assert(frames.size() == num_karts);
+    header->m_num_frames.resize(num_karts);
+    header->m_frames_offset.resize(num_karts);
+
+    // Offsets depend on the header size, which doesn't depend on them
+    BareNetworkString bns;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bns.getBuffer().clear();
+        bns.encodeString(header->m_stk_version);
+        bns.addUInt8((uint8_t)num_karts);
+        for (unsigned i = 0; i < num_karts; i++)
+        {
+            bns.encodeString(header->m_kart_list[i])
+                .encodeString(header->m_name_list[i])
+                .addFloat(header->m_kart_color[i])
+                .addUInt32(header->m_num_frames[i])
+                .addUInt32(header->m_frames_offset[i]);
+        }
+        bns.addUInt8(header->m_reverse ? 1 : 0)
+            .addUInt8((uint8_t)header->m_difficulty)
+            .encodeString(header->m_minor_mode)
+            .encodeString(header->m_track_name)
+            .addUInt32(header->m_laps)
+            .addFloat(header->m_min_time)
+            .addUInt64(header->m_replay_uid);
+        // Magic, version and header size come before the header
+        uint32_t offset = 12 + bns.getTotalSize();
+        for (unsigned i = 0; i < num_karts; i++)
+        {
+            header->m_num_frames[i] = (uint32_t)frames[i].size();
+            header->m_frames_offset[i] = offset;
+            offset += (uint32_t)(frames[i].size() * sizeof(ReplayFrame));
+        }
+    }
+
+    uint32_t version_size[2] =
+        { getBinaryReplayVersion(), bns.getTotalSize() };
+    if (fwrite(g_binary_magic, 1, 4, fd) != 4 ||
+        fwrite(version_size, sizeof(uint32_t), 2, fd) != 2 ||
+        fwrite(bns.getData(), 1, bns.getTotalSize(), fd) != bns.getTotalSize())
+        return false;
+    for (unsigned i = 0; i < num_karts; i++)
+    {
+        if (!frames[i].empty() && fwrite(frames[i].data(),
+            sizeof(ReplayFrame), frames[i].size(), fd) != frames[i].size())
+            return false;
+    }
+    return true;
+}   // writeBinaryReplay
+
+// -----------------------------------------------------------------------------
+/** Writes a binary replay with a header and frames of two karts to a
+ *  temporary file, and checks that reading it back gives the same values.
+ */
+void ReplayBase::unitTesting()
+{
+#ifndef __BIG_ENDIAN__
+    BinaryHeader header;
+    header.m_stk_version = "1.4";
+    header.m_kart_list = { "tux", "nolok" };
+    header.m_name_list = { "", "Player" };
+    header.m_kart_color = { 0.0f, 0.5f };
+    header.m_reverse = true;
+    header.m_difficulty = 2;
+    header.m_minor_mode = "time-trial";
+    header.m_track_name = "lighthouse";
+    header.m_laps = 3;
+    header.m_min_time = 42.5f;
+    header.m_replay_uid = 1234567890123ull;
+
+    std::vector<std::vector<ReplayFrame> > frames(2);
+    for (unsigned i = 0; i < 100; i++)
+    {
+        btTransform trans(btQuaternion(btVector3(0, 1, 0), i * 0.1f),
+            btVector3(i * 1.0f, 2.0f, -(i * 0.5f)));
+        PhysicInfo pi;
+        pi.m_speed = i * 0.25f;
+        pi.m_steer = -0.5f;
+        for (int j = 0; j < 4; j++)
+            pi.m_suspension_length[j] = 0.1f * j;
+        pi.m_skidding_state = i % 3;
+        BonusInfo bi;
+        bi.m_attachment = i % 6;
+        bi.m_nitro_amount = 1.5f;
+        bi.m_item_amount = i % 4;
+        bi.m_item_type = i % 10;
+        bi.m_special_value = 0;
+        KartReplayEvent kre;
+        kre.m_distance = i * 3.0f;
+        kre.m_nitro_usage = i % 2;
+        kre.m_zipper_usage = i % 5 == 0;
+        kre.m_skidding_effect = 0;
+        kre.m_red_skidding = i % 7 == 0;
+        kre.m_jumping = i % 11 == 0;
+        frames[0].push_back(encodeFrame(i / 60.0f, trans, pi, bi, kre));
+        // The second kart has less frames
+        if (i % 2 == 0)
+            frames[1].push_back(encodeFrame(i / 60.0f, trans, pi, bi, kre));
+    }
+
+    FILE* fd = tmpfile();
+    assert(fd);
+    if (!fd)
+        return;
+    bool written = writeBinaryReplay(fd, &header, frames);
+    assert(written);
+    rewind(fd);
+
+    BinaryHeader read_header;
+    bool binary = isBinaryReplay(fd);
+    assert(binary);
+    bool read = readBinaryHeader(fd, &read_header);
+    assert(read);
+    assert(read_header.m_stk_version == header.m_stk_version);
+    assert(read_header.m_kart_list == header.m_kart_list);
+    assert(read_header.m_name_list == header.m_name_list);
+    assert(read_header.m_kart_color == header.m_kart_color);
+    assert(read_header.m_reverse == header.m_reverse);
+    assert(read_header.m_difficulty == header.m_difficulty);
+    assert(read_header.m_minor_mode == header.m_minor_mode);
+    assert(read_header.m_track_name == header.m_track_name);
+    assert(read_header.m_laps == header.m_laps);
+    assert(read_header.m_min_time == header.m_min_time);
+    assert(read_header.m_replay_uid == header.m_replay_uid);
+    assert(read_header.m_num_frames == header.m_num_frames);
+    assert(read_header.m_num_frames[1] == 50);
+
+    // Read the karts in reverse order to check the offsets
+    for (int kart = 1; kart >= 0; kart--)
+    {
+        std::vector<ReplayFrame> read_frames;
+        read = readBinaryFrames(fd, read_header, kart, &read_frames);
+        assert(read);
+        assert(read_frames.size() == frames[kart].size());
+        assert(memcmp(read_frames.data(), frames[kart].data(),
+            read_frames.size() * sizeof(ReplayFrame)) == 0);
+    }
+    fclose(fd);
+
+    // Values decoded from a frame
+    const ReplayFrame& f = frames[0][10];
+    assert(f.getTransform().getOrigin() == btVector3(10.0f, 2.0f, -5.0f));
+    assert(fabsf(f.getSpeed() - 2.5f) < 0.01f);
+    assert(fabsf(f.getSteer() + 0.5f) < 0.01f);
+    assert(fabsf(f.getSuspensionLength(3) - 0.3f) < 0.01f);
+    assert(fabsf(f.getNitroAmount() - 1.5f) < 0.01f);
+    assert(f.getZipperUsage() && !f.getRedSkidding() && !f.getJumping());
+    assert(frames[0][77].getJumping() && frames[0][77].getRedSkidding());
+    (void)written;
+    (void)binary;
+    (void)read;
+    (void)f;
+#endif
+}   // unitTesting
@@ -22,6 +22,7 @@
 #include "LinearMath/btTransform.h"
 #include "utils/no_copy.hpp"
 
+#include <cstdint>
 #include <stdio.h>
 #include <string>
 #include <vector>
@@ -98,7 +99,85 @@ protected:
     };   // KartReplayEvent
 
     // ------------------------------------------------------------------------
-    FILE *openReplayFile(bool writeable, bool full_path = false, int replay_file_number=1);
+    enum ReplayFrameFlags
+    {
+        RF_ZIPPER       = 1,
+        RF_RED_SKIDDING = 2,
+        RF_JUMPING      = 4
+    };
+
+    // ------------------------------------------------------------------------
+    /** A frame of a kart as stored in binary replay files, and in memory by
+     *  ghost karts. The rotation is compressed like in CompressNetworkBody
+     *  and most values are half floats. Frames are stored in the file with
+     *  exactly this layout (little endian), so all frames of a kart are read
+     *  with one fread. */
+    struct ReplayFrame
+    {
+        float    m_time;
+        float    m_xyz[3];
+        /** Rotation compressed with MiniGLM::compressQuaternion. */
+        uint32_t m_rotation;
+        float    m_distance;
+        /** Half floats. */
+        int16_t  m_speed;
+        int16_t  m_steer;
+        int16_t  m_suspension_length[4];
+        int16_t  m_nitro_amount;
+        int16_t  m_special_value;
+        int8_t   m_skidding_state;
+        uint8_t  m_attachment;
+        uint8_t  m_item_amount;
+        uint8_t  m_item_type;
+        uint8_t  m_nitro_usage;
+        uint8_t  m_skidding_effect;
+        /** Combination of ReplayFrameFlags. */
+        uint8_t  m_flags;
+        uint8_t  m_reserved;
+        // --------------------------------------------------------------------
+        btTransform getTransform() const;
+        // --------------------------------------------------------------------
+        float getSpeed() const;
+        // --------------------------------------------------------------------
+        float getSteer() const;
+        // --------------------------------------------------------------------
+        float getSuspensionLength(int wheel) const;
+        // --------------------------------------------------------------------
+        float getNitroAmount() const;
+        // --------------------------------------------------------------------
+        bool  getZipperUsage() const     { return (m_flags & RF_ZIPPER) != 0; }
+        // --------------------------------------------------------------------
+        bool  getRedSkidding() const
+                                   { return (m_flags & RF_RED_SKIDDING) != 0; }
+        // --------------------------------------------------------------------
+        bool  getJumping() const        { return (m_flags & RF_JUMPING) != 0; }
+    };   // ReplayFrame
+
+    // ------------------------------------------------------------------------
+    /** Header of a binary replay file. It has the same information as the
+     *  lines before the frames of a text replay, and the number of frames
+     *  and file offset of the first frame of each kart. */
+    struct BinaryHeader
+    {
+        std::string              m_stk_version;
+        std::vector<std::string> m_kart_list;
+        /** Utf8 names of the karts, empty to use the kart name. */
+        std::vector<std::string> m_name_list;
+        std::vector<float>       m_kart_color;
+        bool                     m_reverse;
+        unsigned int             m_difficulty;
+        std::string              m_minor_mode;
+        std::string              m_track_name;
+        unsigned int             m_laps;
+        float                    m_min_time;
+        uint64_t                 m_replay_uid;
+        std::vector<uint32_t>    m_num_frames;
+        std::vector<uint32_t>    m_frames_offset;
+    };   // BinaryHeader
+
+    // ------------------------------------------------------------------------
+    FILE *openReplayFile(bool writeable, bool full_path = false, int replay_file_number=1,
+                         bool binary = false);
     // ------------------------------------------------------------------------
     /** Returns the filename that was opened. */
     virtual const std::string& getReplayFilename(int replay_file_number = 1) const = 0;
@@ -112,9 +191,31 @@ protected:
      *  be understood by this executable. */
     unsigned int getMinSupportedReplayVersion() const { return 3; }
 
+    // ------------------------------------------------------------------------
+    /** Version of the binary replay format, it is independent of the text
+     *  format version. */
+    static unsigned int getBinaryReplayVersion()                  { return 1; }
+    // ------------------------------------------------------------------------
+    static ReplayFrame encodeFrame(float time, const btTransform& trans,
+                                   const PhysicInfo& pi, const BonusInfo& bi,
+                                   const KartReplayEvent& kre);
+    // ------------------------------------------------------------------------
+    static bool isBinaryReplay(FILE* fd);
+    // ------------------------------------------------------------------------
+    static bool readBinaryHeader(FILE* fd, BinaryHeader* header);
+    // ------------------------------------------------------------------------
+    static bool readBinaryFrames(FILE* fd, const BinaryHeader& header,
+                                 unsigned int kart,
+                                 std::vector<ReplayFrame>* frames);
+    // ------------------------------------------------------------------------
+    static bool writeBinaryReplay(FILE* fd, BinaryHeader* header,
+                         const std::vector<std::vector<ReplayFrame> >& frames);
+
 public:
              ReplayBase();
     virtual ~ReplayBase() {};
+    // ------------------------------------------------------------------------
+    static void unitTesting();
 };   // ReplayBase
 
 #endif
@@ -109,8 +109,19 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
     char s[1024], s1[1024];
     if (StringUtils::getExtension(fn) != "replay") return false;
-    FILE* fd = FileUtils::fopenU8Path(custom_replay ? fn :
-        file_manager->getReplayDir() + fn, "r");
+    const std::string path = custom_replay ? fn :
+        file_manager->getReplayDir() + fn;
+    FILE* fd = FileUtils::fopenU8Path(path, "rb");
+    if (fd == NULL) return false;
+    if (isBinaryReplay(fd))
+    {
+        bool added = addBinaryReplayFile(fd, fn, custom_replay);
+        fclose(fd);
+        return added;
+    }
+    fclose(fd);
+
+    fd = FileUtils::fopenU8Path(path, "r");
     if (fd == NULL) return false;
     auto scoped = [&]() { fclose(fd); };
     MemUtils::deref<decltype(scoped)> cls(scoped); 
@@ -118,6 +129,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
     // custom_replay is true when full path of filename is given
     rd.m_custom_replay_file = custom_replay;
+    rd.m_binary = false;
     rd.m_filename = fn;
 
     fgets(s, 1023, fd);
@@ -267,22 +279,6 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
         return false;
     }
 
-    // If former official tracks are present as addons, show the matching replays.
-    if (rd.m_track_name.compare("greenvalley") == 0)
-        rd.m_track_name = std::string("addon_green-valley");
-    if (rd.m_track_name.compare("mansion") == 0)
-        rd.m_track_name = std::string("addon_blackhill-mansion");
-
-    Track* t = track_manager->getTrack(rd.m_track_name);
-    if (t == NULL)
-    {
-        Log::warn("Replay", "Track '%s' used in replay '%s' not found in STK!",
-        rd.m_track_name.c_str(), fn.c_str());
-        return false;
-    }
-
-    rd.m_track = t;
-
     fgets(s, 1023, fd);
     if (sscanf(s, "laps: %u", &rd.m_laps) != 1)
     {
@@ -310,16 +306,75 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
     else
         rd.m_replay_uid = call_index;
 
+    return addReplayData(rd);
+}   // addReplayFile
+
+//-----------------------------------------------------------------------------
+/** Adds a binary replay to the list, only its header is read.
+ *  \param fd The file, its position is after the magic.
+ */
+bool ReplayPlay::addBinaryReplayFile(FILE* fd, const std::string& fn,
+                                     bool custom_replay)
+{
+    BinaryHeader header;
+    if (!readBinaryHeader(fd, &header))
+    {
+        Log::warn("Replay", "Invalid binary replay file, '%s'.", fn.c_str());
+        return false;
+    }
+    ReplayData rd;
+    rd.m_custom_replay_file = custom_replay;
+    rd.m_binary = true;
+    rd.m_filename = fn;
+    rd.m_replay_version = getCurrentReplayVersion();
+    rd.m_stk_version = StringUtils::utf8ToWide(header.m_stk_version);
+    rd.m_kart_list = header.m_kart_list;
+    for (const std::string& name : header.m_name_list)
+        rd.m_name_list.push_back(StringUtils::utf8ToWide(name));
+    if (!rd.m_name_list.empty())
+        rd.m_user_name = rd.m_name_list[0];
+    rd.m_kart_color = header.m_kart_color;
+    rd.m_reverse = header.m_reverse;
+    rd.m_difficulty = header.m_difficulty;
+    rd.m_minor_mode = header.m_minor_mode;
+    rd.m_track_name = header.m_track_name;
+    rd.m_laps = header.m_laps;
+    rd.m_min_time = header.m_min_time;
+    rd.m_replay_uid = header.m_replay_uid;
+    return addReplayData(rd);
+}   // addBinaryReplayFile
+
+//-----------------------------------------------------------------------------
+/** Adds the header of a text or binary replay to the list if its track is
+ *  available.
+ */
+bool ReplayPlay::addReplayData(ReplayData& rd)
+{
+    // If former official tracks are present as addons, show the matching replays.
+    if (rd.m_track_name.compare("greenvalley") == 0)
+        rd.m_track_name = std::string("addon_green-valley");
+    if (rd.m_track_name.compare("mansion") == 0)
+        rd.m_track_name = std::string("addon_blackhill-mansion");
+
+    Track* t = track_manager->getTrack(rd.m_track_name);
+    if (t == NULL)
+    {
+        Log::warn("Replay", "Track '%s' used in replay '%s' not found in STK!",
+        rd.m_track_name.c_str(), rd.m_filename.c_str());
+        return false;
+    }
+
+    rd.m_track = t;
     m_replay_file_list.push_back(rd);
 
     assert(m_replay_file_list.size() > 0);
     // Force to use custom replay file immediately
-    if (custom_replay)
+    if (rd.m_custom_replay_file)
         m_current_replay_file = (unsigned int)m_replay_file_list.size() - 1;
 
     return true;
 
-}   // addReplayFile
+}   // addReplayData
 
 //-----------------------------------------------------------------------------
 void ReplayPlay::load()
@@ -343,7 +398,8 @@ void ReplayPlay::loadFile(bool second_replay)
     int replay_file_number = second_replay ? 2 : 1;
 
     FILE *fd = openReplayFile(/*writeable*/false,
-            m_replay_file_list.at(replay_index).m_custom_replay_file, replay_file_number);
+            m_replay_file_list.at(replay_index).m_custom_replay_file, replay_file_number,
+            m_replay_file_list.at(replay_index).m_binary);
 
     if(!fd)
     {
@@ -357,13 +413,13 @@ void ReplayPlay::loadFile(bool second_replay)
                     getReplayFilename(replay_file_number).c_str());
 
     ReplayData &rd = m_replay_file_list[replay_index];
-    unsigned int num_kart = (unsigned int)m_replay_file_list.at(replay_index)
-                                                            .m_kart_list.size();
-    unsigned int lines_to_skip = (rd.m_replay_version == 3) ? 7 : 10;
-    lines_to_skip += (rd.m_replay_version == 3) ? num_kart : 2*num_kart;
-
-    for (unsigned int i = 0; i < lines_to_skip; i++)
-        fgets(s, 1023, fd);
+    if (rd.m_binary)
+    {
+        readBinaryKartData(fd, second_replay);
+        fclose(fd);
+        return;
+    }
+    skipTextHeader(fd, rd);
 
     // eof actually doesn't trigger here, since it requires first to try
     // reading behind eof, but still it's clearer this way.
@@ -378,13 +434,25 @@ void ReplayPlay::loadFile(bool second_replay)
 }   // loadFile
 
 //-----------------------------------------------------------------------------
-/** Reads all data from a replay file for a specific kart.
- *  \param fd The file descriptor from which to read.
+/** Skips the lines of a text replay before the frames of the first kart.
  */
-void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
+void ReplayPlay::skipTextHeader(FILE *fd, const ReplayData& rd)
 {
     char s[1024];
+    unsigned int num_kart = (unsigned int)rd.m_kart_list.size();
+    unsigned int lines_to_skip = (rd.m_replay_version == 3) ? 7 : 10;
+    lines_to_skip += (rd.m_replay_version == 3) ? num_kart : 2*num_kart;
+
+    for (unsigned int i = 0; i < lines_to_skip; i++)
+        fgets(s, 1023, fd);
+}   // skipTextHeader
 
+//-----------------------------------------------------------------------------
+/** Creates the next ghost kart with its controller.
+ *  \return The index of the ghost kart.
+ */
+unsigned int ReplayPlay::createGhostKart(bool second_replay)
+{
     int replay_index = second_replay ? m_second_replay_file
                                      : m_current_replay_file;
 
@@ -403,6 +471,111 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
     Controller* controller = new GhostController(getGhostKart(kart_num).get(),
                                                  rd.m_name_list[kart_num-first_loaded_f_num]);
     getGhostKart(kart_num)->setController(controller);
+    return kart_num;
+}   // createGhostKart
+
+//-----------------------------------------------------------------------------
+/** Reads all frames of the karts of a binary replay, each kart is read with
+ *  one fread directly into the frames of its ghost kart.
+ *  \param fd The file descriptor from which to read.
+ */
+void ReplayPlay::readBinaryKartData(FILE *fd, bool second_replay)
+{
+    BinaryHeader header;
+    if (!isBinaryReplay(fd) || !readBinaryHeader(fd, &header))
+    {
+        Log::error("Replay", "Invalid binary replay file.");
+        return;
+    }
+    std::vector<ReplayFrame> frames;
+    for (unsigned int i = 0; i < header.m_kart_list.size(); i++)
+    {
+        unsigned int kart_num = createGhostKart(second_replay);
+        if (!readBinaryFrames(fd, header, i, &frames))
+            Log::fatal("Replay", "Frames of kart %d are missing.", kart_num);
+        for (const ReplayFrame& frame : frames)
+            m_ghost_karts[kart_num]->addReplayFrame(frame);
+    }
+}   // readBinaryKartData
+
+//-----------------------------------------------------------------------------
+/** Parses a frame line of a text replay.
+ *  \param version Version of the text replay.
+ *  \return False if the line is not a valid frame.
+ */
+bool ReplayPlay::parseTextFrame(unsigned int version, const char* s,
+                                ReplayFrame* frame)
+{
+    float x, y, z, rx, ry, rz, rw, time, speed, steer, w1, w2, w3, w4,
+        nitro_amount = 0.0f, distance = 0.0f;
+    int skidding_state = 0, attachment = 0, item_amount = 0, item_type = 0,
+        special_value = 0, nitro, zipper, skidding, red_skidding, jumping;
+
+    // Up to STK 0.9.3 replays, the values which are not saved stay 0
+    if (version == 3)
+    {
+        if (sscanf(s, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f  %d %d %d %d %d\n",
+            &time,
+            &x, &y, &z,
+            &rx, &ry, &rz, &rw,
+            &speed, &steer, &w1, &w2, &w3, &w4,
+            &nitro, &zipper, &skidding, &red_skidding, &jumping
+            ) != 19)
+            return false;
+    }
+    //version 4 replays (STK 0.9.4 and higher)
+    else
+    {
+        if (sscanf(s, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f %d  %d %f %d %d %d  %f %d %d %d %d %d\n",
+            &time,
+            &x, &y, &z,
+            &rx, &ry, &rz, &rw,
+            &speed, &steer, &w1, &w2, &w3, &w4, &skidding_state,
+            &attachment, &nitro_amount, &item_amount, &item_type, &special_value,
+            &distance, &nitro, &zipper, &skidding, &red_skidding, &jumping
+            ) != 26)
+            return false;
+    }
+
+    PhysicInfo pi             = {0};
+    BonusInfo bi              = {0};
+    KartReplayEvent kre       = {0};
+
+    pi.m_speed                = speed;
+    pi.m_steer                = steer;
+    pi.m_suspension_length[0] = w1;
+    pi.m_suspension_length[1] = w2;
+    pi.m_suspension_length[2] = w3;
+    pi.m_suspension_length[3] = w4;
+    pi.m_skidding_state       = skidding_state;
+    bi.m_attachment           = attachment;
+    bi.m_nitro_amount         = nitro_amount;
+    bi.m_item_amount          = item_amount;
+    bi.m_item_type            = item_type;
+    bi.m_special_value        = special_value;
+    kre.m_distance            = distance;
+    kre.m_nitro_usage         = nitro;
+    kre.m_zipper_usage        = zipper!=0;
+    kre.m_skidding_effect     = skidding;
+    kre.m_red_skidding        = red_skidding!=0;
+    kre.m_jumping             = jumping != 0;
+    *frame = encodeFrame(time, btTransform(btQuaternion(rx, ry, rz, rw),
+        btVector3(x, y, z)), pi, bi, kre);
+    return true;
+}   // parseTextFrame
+
+//-----------------------------------------------------------------------------
+/** Reads all data from a text replay file for a specific kart.
+ *  \param fd The file descriptor from which to read.
+ */
+void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
+{
+    char s[1024];
+
+    int replay_index = second_replay ? m_second_replay_file
+                                     : m_current_replay_file;
+    ReplayData &rd = m_replay_file_list[replay_index];
+    const unsigned int kart_num = createGhostKart(second_replay);
 
     unsigned int size;
     if(sscanf(next_line,"size: %u",&size)!=1)
@@ -412,108 +585,16 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
     for(unsigned int i=0; i<size; i++)
     {
         fgets(s, 1023, fd);
-        float x, y, z, rx, ry, rz, rw, time, speed, steer, w1, w2, w3, w4, nitro_amount, distance;
-        int skidding_state, attachment, item_amount, item_type, special_value,
-            nitro, zipper, skidding, red_skidding, jumping;
-
-        // Check for EV_TRANSFORM event:
-        // -----------------------------
-
-        // Up to STK 0.9.3 replays
-        if (rd.m_replay_version == 3)
-        {
-            if(sscanf(s, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f  %d %d %d %d %d\n",
-                &time,
-                &x, &y, &z,
-                &rx, &ry, &rz, &rw,
-                &speed, &steer, &w1, &w2, &w3, &w4,
-                &nitro, &zipper, &skidding, &red_skidding, &jumping
-                )==19)
-            {
-                btQuaternion q(rx, ry, rz, rw);
-                btVector3 xyz(x, y, z);
-                PhysicInfo pi             = {0};
-                BonusInfo bi              = {0};
-                KartReplayEvent kre       = {0};
-
-                pi.m_speed                = speed;
-                pi.m_steer                = steer;
-                pi.m_suspension_length[0] = w1;
-                pi.m_suspension_length[1] = w2;
-                pi.m_suspension_length[2] = w3;
-                pi.m_suspension_length[3] = w4;
-                pi.m_skidding_state       = 0;    //not saved in version 3 replays
-                bi.m_attachment           = 0;    //not saved in version 3 replays
-                bi.m_nitro_amount         = 0;    //not saved in version 3 replays
-                bi.m_item_amount          = 0;    //not saved in version 3 replays
-                bi.m_item_type            = 0;    //not saved in version 3 replays
-                bi.m_special_value        = 0;    //not saved in version 3 replays
-                kre.m_distance            = 0.0f; //not saved in version 3 replays
-                kre.m_nitro_usage         = nitro;
-                kre.m_zipper_usage        = zipper!=0;
-                kre.m_skidding_effect     = skidding;
-                kre.m_red_skidding        = red_skidding!=0;
-                kre.m_jumping             = jumping != 0;
-                m_ghost_karts[kart_num]->addReplayEvent(time,
-                    btTransform(q, xyz), pi, bi, kre);
-            }
-            else
-            {
-                // Invalid record found
-                // ---------------------
-                Log::warn("Replay", "Can't read replay data line %d:", i);
-                Log::warn("Replay", "%s", s);
-                Log::warn("Replay", "Ignored.");
-            }
-        }
-
-        //version 4 replays (STK 0.9.4 and higher)
+        ReplayFrame frame;
+        if (parseTextFrame(rd.m_replay_version, s, &frame))
+            m_ghost_karts[kart_num]->addReplayFrame(frame);
         else
         {
-            if(sscanf(s, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f %d  %d %f %d %d %d  %f %d %d %d %d %d\n",
-                &time,
-                &x, &y, &z,
-                &rx, &ry, &rz, &rw,
-                &speed, &steer, &w1, &w2, &w3, &w4, &skidding_state,
-                &attachment, &nitro_amount, &item_amount, &item_type, &special_value,
-                &distance, &nitro, &zipper, &skidding, &red_skidding, &jumping
-                )==26)
-            {
-                btQuaternion q(rx, ry, rz, rw);
-                btVector3 xyz(x, y, z);
-                PhysicInfo pi             = {0};
-                BonusInfo bi              = {0};
-                KartReplayEvent kre       = {0};
-
-                pi.m_speed                = speed;
-                pi.m_steer                = steer;
-                pi.m_suspension_length[0] = w1;
-                pi.m_suspension_length[1] = w2;
-                pi.m_suspension_length[2] = w3;
-                pi.m_suspension_length[3] = w4;
-                pi.m_skidding_state       = skidding_state;
-                bi.m_attachment           = attachment;
-                bi.m_nitro_amount         = nitro_amount;
-                bi.m_item_amount          = item_amount;
-                bi.m_item_type            = item_type;
-                bi.m_special_value        = special_value;
-                kre.m_distance            = distance;
-                kre.m_nitro_usage         = nitro;
-                kre.m_zipper_usage        = zipper!=0;
-                kre.m_skidding_effect     = skidding;
-                kre.m_red_skidding        = red_skidding!=0;
-                kre.m_jumping             = jumping != 0;
-                m_ghost_karts[kart_num]->addReplayEvent(time,
-                    btTransform(q, xyz), pi, bi, kre);
-            }
-            else
-            {
-                // Invalid record found
-                // ---------------------
-                Log::warn("Replay", "Can't read replay data line %d:", i);
-                Log::warn("Replay", "%s", s);
-                Log::warn("Replay", "Ignored.");
-            }
+            // Invalid record found
+            // ---------------------
+            Log::warn("Replay", "Can't read replay data line %d:", i);
+            Log::warn("Replay", "%s", s);
+            Log::warn("Replay", "Ignored.");
         }
     }   // for i
 
@@ -546,3 +627,92 @@ unsigned int ReplayPlay::getReplayIdByUID(uint64_t uid)
     Log::error("Replay", "Replay with UID of %" PRIu64 " not found.", uid);
     return 0;
 } //getReplayIdByUID
+
+//-----------------------------------------------------------------------------
+/** Converts a text replay to the binary replay format. The track of the
+ *  replay must be available.
+ *  \param filename Full path of the text replay.
+ *  \param output Full path of the binary replay to write.
+ *  \return True if the binary replay was written.
+ */
+bool ReplayPlay::convertReplayFile(const std::string& filename,
+                                   const std::string& output)
+{
+    const unsigned int current_replay_file = m_current_replay_file;
+    if (!addReplayFile(filename, /*custom_replay*/true))
+    {
+        Log::error("Replay", "Can't read replay '%s'.", filename.c_str());
+        return false;
+    }
+    ReplayData rd = m_replay_file_list.back();
+    m_replay_file_list.pop_back();
+    m_current_replay_file = current_replay_file;
+    if (rd.m_binary)
+    {
+        Log::warn("Replay", "'%s' is a binary replay already.",
+            filename.c_str());
+        return false;
+    }
+
+    FILE* fd = FileUtils::fopenU8Path(filename, "r");
+    if (!fd)
+        return false;
+    skipTextHeader(fd, rd);
+    std::vector<std::vector<ReplayFrame> > frames(rd.m_kart_list.size());
+    char s[1024];
+    unsigned int invalid = 0;
+    for (unsigned int k = 0; k < frames.size(); k++)
+    {
+        unsigned int size = 0;
+        if (fgets(s, 1023, fd) == NULL || sscanf(s, "size: %u", &size) != 1)
+        {
+            Log::error("Replay", "Number of records not found in replay "
+                "file for kart %d.", k);
+            fclose(fd);
+            return false;
+        }
+        frames[k].reserve(size);
+        for (unsigned int i = 0; i < size && fgets(s, 1023, fd); i++)
+        {
+            ReplayFrame frame;
+            if (parseTextFrame(rd.m_replay_version, s, &frame))
+                frames[k].push_back(frame);
+            else
+                invalid++;
+        }
+    }
+    fclose(fd);
+    if (invalid > 0)
+        Log::warn("Replay", "Ignored %d invalid lines.", invalid);
+
+    BinaryHeader header;
+    header.m_stk_version = StringUtils::wideToUtf8(rd.m_stk_version);
+    header.m_kart_list = rd.m_kart_list;
+    for (const core::stringw& name : rd.m_name_list)
+        header.m_name_list.push_back(StringUtils::wideToUtf8(name));
+    header.m_kart_color = rd.m_kart_color;
+    header.m_reverse = rd.m_reverse;
+    header.m_difficulty = rd.m_difficulty;
+    header.m_minor_mode = rd.m_minor_mode;
+    header.m_track_name = rd.m_track_name;
+    header.m_laps = rd.m_laps;
+    header.m_min_time = rd.m_min_time;
+    header.m_replay_uid = rd.m_replay_uid;
+
+    FILE* out = FileUtils::fopenU8Path(output, "wb");
+    if (!out)
+    {
+        Log::error("Replay", "Can't open '%s' for writing.", output.c_str());
+        return false;
+    }
+    bool written = writeBinaryReplay(out, &header, frames);
+    written = fclose(out) == 0 && written;
+    if (!written)
+    {
+        Log::error("Replay", "Can't write '%s'.", output.c_str());
+        return false;
+    }
+    Log::info("Replay", "Converted '%s' to '%s'.", filename.c_str(),
+        output.c_str());
+    return true;
+}   // convertReplayFile
@@ -67,6 +67,8 @@ public:
         std::vector<float>         m_kart_color; //no sorting for this
         bool                       m_reverse;
         bool                       m_custom_replay_file;
+        /** True for the binary replay format. */
+        bool                       m_binary;
         unsigned int               m_difficulty;
         unsigned int               m_laps;
         unsigned int               m_replay_version; //no sorting for this
@@ -125,11 +127,21 @@ private:
           ReplayPlay();
          ~ReplayPlay();
     void  readKartData(FILE *fd, char *next_line, bool second_replay);
+    void  readBinaryKartData(FILE *fd, bool second_replay);
+    unsigned int createGhostKart(bool second_replay);
+    bool  addBinaryReplayFile(FILE* fd, const std::string& fn,
+                              bool custom_replay);
+    bool  addReplayData(ReplayData& rd);
+    static void skipTextHeader(FILE *fd, const ReplayData& rd);
+    static bool parseTextFrame(unsigned int version, const char* s,
+                               ReplayFrame* frame);
 public:
     void  reset();
     void  load();
     void  loadFile(bool second_replay);
     void  loadAllReplayFile();
+    bool  convertReplayFile(const std::string& filename,
+                            const std::string& output);
     // ------------------------------------------------------------------------
     static void        setSortOrder(SortOrder so)       { m_sort_order = so; }
     // ------------------------------------------------------------------------
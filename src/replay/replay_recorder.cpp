@@ -31,16 +31,21 @@
 #include "modes/easter_egg_hunt.hpp"
 #include "modes/linear_world.hpp"
 #include "modes/world.hpp"
+#include "network/server_config.hpp"
 #include "physics/btKart.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/track.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
+#include "utils/vs.hpp"
 
 #include <algorithm>
+#include <functional>
 #include <stdio.h>
 #include <string>
 #include <cinttypes>
+#include <zlib.h>
 
 ReplayRecorder *ReplayRecorder::m_replay_recorder = NULL;
 
@@ -53,15 +58,18 @@ ReplayRecorder::ReplayRecorder()
     m_incorrect_replay = false;
 
     m_previous_steer   = 0.0f;
+    m_save_stop        = false;
 
     assert(stk_config->m_replay_max_frames >= 0);
     m_max_frames = stk_config->m_replay_max_frames;
 }   // ReplayRecorder
 
 //-----------------------------------------------------------------------------
-/** Frees all stored data. */
+/** Frees all stored data, replays which are not written yet are written
+ *  first. */
 ReplayRecorder::~ReplayRecorder()
 {
+    stopSaving();
 }   // ~Replay
 
 //-----------------------------------------------------------------------------
@@ -357,9 +365,14 @@ uint64_t ReplayRecorder::computeUID(float min_time)
 }
 
 //-----------------------------------------------------------------------------
-/** Saves the replay data stored in the internal data structures.
+/** Saves the replay data stored in the internal data structures. The data is
+ *  copied into a save job which is written by the replay writer thread, so
+ *  the race teardown doesn't wait for the disk. The recorder can be reset
+ *  or reused right after this returns.
+ *  \param callback If set, called by handleSaveCompletions() after the file
+ *         was written, with the success and the path of the file.
  */
-void ReplayRecorder::save()
+void ReplayRecorder::save(std::function<void(bool, const std::string&)> callback)
 {
     if (m_incorrect_replay)
     {
@@ -391,70 +404,234 @@ void ReplayRecorder::save()
         << "_" << num_karts << "_" << time << ".replay";
     m_filename = oss.str();
     Log::info("ReplayRecorder", "Filename: %s", getReplayFilename().c_str());
-    FILE *fd = openReplayFile(/*writeable*/true);
-    if (!fd)
-    {
-        Log::error("ReplayRecorder", "Can't open '%s' for writing", getReplayFilename().c_str());
-        return;
-    }
+
+    std::unique_ptr<SaveJob> job(new SaveJob());
+    job->m_path     = file_manager->getReplayDir() + getReplayFilename();
+    job->m_binary   = ServerConfig::m_replay_binary;
+    job->m_compress = ServerConfig::m_replay_compress;
+    job->m_callback = callback;
 
     core::stringw msg = _("Replay saved in \"%s\".",
-        StringUtils::utf8ToWide(file_manager->getReplayDir() + getReplayFilename()));
+        StringUtils::utf8ToWide(job->m_path));
     MessageQueue::add(MessageQueue::MT_GENERIC, msg);
-    fprintf(fd, "version: %d\n", getCurrentReplayVersion());
-    fprintf(fd, "stk_version: %s\n", STK_VERSION);
-    unsigned int player_count = 0;
 
+    BinaryHeader& header = job->m_header;
+    unsigned int player_count = 0;
     for (unsigned int real_karts = 0; real_karts < num_karts; real_karts++)
     {
         const AbstractKart *kart = world->getKart(real_karts);
         if (kart->isGhostKart()) continue;
-        fprintf(fd, "kart: %s %s\n", kart->getIdent().c_str(),			
-                StringUtils::xmlEncode(kart->getController()->getName()).c_str());
-        
+        float kart_color = 0.0f;
+        bool has_kart_color = false;
         if (kart->getController()->isPlayerController())
         {
-           StateManager* state_manager = StateManager::get();
-	   if (state_manager && state_manager->getActivePlayer(player_count) &&
-			   state_manager->getActivePlayer(player_count)->getConstProfile())
-		   {
-			   fprintf(fd, "kart_color: %f\n", state_manager->getActivePlayer(player_count)->getConstProfile()->getDefaultKartColor());
-		   }
-	   else
-	   {
-		   fprintf(fd, "kart_color: 0\n");
-	   }
-	  player_count++;
-    }
+            StateManager* state_manager = StateManager::get();
+            if (state_manager && state_manager->getActivePlayer(player_count) &&
+                state_manager->getActivePlayer(player_count)->getConstProfile())
+            {
+                kart_color = state_manager->getActivePlayer(player_count)
+                    ->getConstProfile()->getDefaultKartColor();
+            }
+            has_kart_color = true;
+            player_count++;
+        }
+        header.m_kart_list.push_back(kart->getIdent());
+        header.m_name_list.push_back(
+            StringUtils::wideToUtf8(kart->getController()->getName()));
+        header.m_kart_color.push_back(kart_color);
+        job->m_has_kart_color.push_back(has_kart_color);
     }
 
     m_last_uid = computeUID(min_time);
 
     int num_laps = RaceManager::get()->getNumLaps();
     if (num_laps == 9999) num_laps = 0; // no lap in that race mode
-    fprintf(fd, "kart_list_end\n");
-    fprintf(fd, "reverse: %d\n",    (int)RaceManager::get()->getReverseTrack());
-    fprintf(fd, "difficulty: %d\n", RaceManager::get()->getDifficulty());
-    fprintf(fd, "mode: %s\n",       RaceManager::get()->getMinorModeName().c_str());
-    fprintf(fd, "track: %s\n",      Track::getCurrentTrack()->getIdent().c_str());
-    fprintf(fd, "laps: %d\n",       num_laps);
-    fprintf(fd, "min_time: %f\n",   min_time);
-    fprintf(fd, "replay_uid: %" PRIu64 "\n", m_last_uid);
+    header.m_stk_version = STK_VERSION;
+    header.m_reverse     = RaceManager::get()->getReverseTrack();
+    header.m_difficulty  = RaceManager::get()->getDifficulty();
+    header.m_minor_mode  = RaceManager::get()->getMinorModeName();
+    header.m_track_name  = Track::getCurrentTrack()->getIdent();
+    header.m_laps        = num_laps;
+    header.m_min_time    = min_time;
+    header.m_replay_uid  = m_last_uid;
+
+    // Copy only the recorded part of the buffers, the recorder keeps
+    // recording into them after saving until it is reset
     for (unsigned int k = 0; k < std::min(num_karts, (unsigned)m_count_transforms.size()); k++)
     {
         if (world->getKart(k)->isGhostKart()) continue;
-
         const unsigned int num_transforms = std::min(m_max_frames,
                                                      m_count_transforms[k]);
+        job->m_transform_events.emplace_back(m_transform_events[k].begin(),
+            m_transform_events[k].begin() + num_transforms);
+        job->m_physic_info.emplace_back(m_physic_info[k].begin(),
+            m_physic_info[k].begin() + num_transforms);
+        job->m_bonus_info.emplace_back(m_bonus_info[k].begin(),
+            m_bonus_info[k].begin() + num_transforms);
+        job->m_kart_replay_event.emplace_back(m_kart_replay_event[k].begin(),
+            m_kart_replay_event[k].begin() + num_transforms);
+    }
+    // Karts without frames have no size line in text replays either
+    const size_t saved_karts = job->m_transform_events.size();
+    header.m_kart_list.resize(saved_karts);
+    header.m_name_list.resize(saved_karts);
+    header.m_kart_color.resize(saved_karts);
+    job->m_has_kart_color.resize(saved_karts);
+
+    std::lock_guard<std::mutex> lock(m_save_mutex);
+    if (!m_save_thread.joinable())
+    {
+        m_save_stop = false;
+        m_save_thread = std::thread(std::bind(&ReplayRecorder::saveLoop,
+                                              this));
+    }
+    m_save_jobs.push_back(std::move(job));
+    m_save_cv.notify_one();
+}   // save
+
+//-----------------------------------------------------------------------------
+/** Writes the queued save jobs, it runs in the replay writer thread until
+ *  all jobs are written after m_save_stop is set.
+ */
+void ReplayRecorder::saveLoop()
+{
+    VS::setThreadName("ReplayWriter");
+    while (true)
+    {
+        std::unique_ptr<SaveJob> job;
+        {
+            std::unique_lock<std::mutex> lock(m_save_mutex);
+            m_save_cv.wait(lock, [this]
+                { return m_save_stop || !m_save_jobs.empty(); });
+            if (m_save_jobs.empty())
+                return;
+            job = std::move(m_save_jobs.front());
+            m_save_jobs.pop_front();
+        }
+        uint64_t started = StkTime::getMonoTimeMs();
+        std::string path = job->m_path;
+        bool success = writeSaveJob(*job, &path);
+        if (success)
+        {
+            Log::info("ReplayRecorder", "Wrote %s in %dms.", path.c_str(),
+                (int)(StkTime::getMonoTimeMs() - started));
+        }
+        if (job->m_callback)
+        {
+            std::lock_guard<std::mutex> lock(m_completions_mutex);
+            std::function<void(bool, const std::string&)> callback =
+                job->m_callback;
+            m_completions.push_back([callback, success, path]()
+                { callback(success, path); });
+        }
+    }
+}   // saveLoop
+
+//-----------------------------------------------------------------------------
+/** Writes a replay file, first to a temporary file which is renamed (after
+ *  being compressed to another temporary file) at the end, so a replay file
+ *  is never seen half written.
+ *  \param job The replay to write.
+ *  \param path Set to the path of the written file.
+ *  \return True if the file was written.
+ */
+bool ReplayRecorder::writeSaveJob(const SaveJob& job, std::string* path) const
+{
+    const std::string temp = FileUtils::getTempPath(job.m_path);
+    FILE* fd = FileUtils::fopenU8Path(temp, job.m_binary ? "wb" : "w");
+    if (!fd)
+    {
+        Log::error("ReplayRecorder", "Can't open '%s' for writing",
+            temp.c_str());
+        return false;
+    }
+    bool success = job.m_binary ? writeBinarySaveJob(fd, job) :
+        writeTextSaveJob(fd, job);
+    if (fclose(fd) != 0)
+        success = false;
+    if (!success)
+    {
+        Log::error("ReplayRecorder", "Can't write '%s'", temp.c_str());
+        file_manager->removeFile(temp);
+        return false;
+    }
+    *path = job.m_path;
+    std::string written = temp;
+    if (job.m_compress)
+    {
+        *path = job.m_path + ".gz";
+        written = FileUtils::getTempPath(*path);
+        success = compressFile(temp, written);
+        file_manager->removeFile(temp);
+        if (!success)
+            return false;
+    }
+    file_manager->removeFile(*path);
+    if (FileUtils::renameU8Path(written, *path) != 0)
+    {
+        Log::error("ReplayRecorder", "Can't rename '%s' to '%s'",
+            written.c_str(), path->c_str());
+        file_manager->removeFile(written);
+        return false;
+    }
+    return true;
+}   // writeSaveJob
+
+//-----------------------------------------------------------------------------
+bool ReplayRecorder::writeBinarySaveJob(FILE* fd, const SaveJob& job)
+{
+    BinaryHeader header = job.m_header;
+    std::vector<std::vector<ReplayFrame> > frames(job.m_transform_events.size());
+    for (unsigned int k = 0; k < frames.size(); k++)
+    {
+        const std::vector<TransformEvent>& transforms =
+            job.m_transform_events[k];
+        frames[k].reserve(transforms.size());
+        for (unsigned int i = 0; i < transforms.size(); i++)
+        {
+            frames[k].push_back(encodeFrame(transforms[i].m_time,
+                transforms[i].m_transform, job.m_physic_info[k][i],
+                job.m_bonus_info[k][i], job.m_kart_replay_event[k][i]));
+        }
+    }
+    return writeBinaryReplay(fd, &header, frames);
+}   // writeBinarySaveJob
+
+//-----------------------------------------------------------------------------
+bool ReplayRecorder::writeTextSaveJob(FILE* fd, const SaveJob& job) const
+{
+    const BinaryHeader& header = job.m_header;
+    fprintf(fd, "version: %d\n", getCurrentReplayVersion());
+    fprintf(fd, "stk_version: %s\n", header.m_stk_version.c_str());
+    for (unsigned int k = 0; k < header.m_kart_list.size(); k++)
+    {
+        fprintf(fd, "kart: %s %s\n", header.m_kart_list[k].c_str(),
+            StringUtils::xmlEncode(
+            StringUtils::utf8ToWide(header.m_name_list[k])).c_str());
+        if (job.m_has_kart_color[k])
+            fprintf(fd, "kart_color: %f\n", header.m_kart_color[k]);
+    }
+    fprintf(fd, "kart_list_end\n");
+    fprintf(fd, "reverse: %d\n",    (int)header.m_reverse);
+    fprintf(fd, "difficulty: %d\n", header.m_difficulty);
+    fprintf(fd, "mode: %s\n",       header.m_minor_mode.c_str());
+    fprintf(fd, "track: %s\n",      header.m_track_name.c_str());
+    fprintf(fd, "laps: %d\n",       header.m_laps);
+    fprintf(fd, "min_time: %f\n",   header.m_min_time);
+    fprintf(fd, "replay_uid: %" PRIu64 "\n", header.m_replay_uid);
+    for (unsigned int k = 0; k < job.m_transform_events.size(); k++)
+    {
+        const unsigned int num_transforms =
+            (unsigned int)job.m_transform_events[k].size();
 
         fprintf(fd, "size:     %d\n", num_transforms);
 
         for (unsigned int i = 0; i < num_transforms; i++)
         {
-            const TransformEvent *p  = &(m_transform_events[k][i]);
-            const PhysicInfo *q      = &(m_physic_info[k][i]);
-            const BonusInfo *b      = &(m_bonus_info[k][i]);
-            const KartReplayEvent *r = &(m_kart_replay_event[k][i]);
+            const TransformEvent *p  = &(job.m_transform_events[k][i]);
+            const PhysicInfo *q      = &(job.m_physic_info[k][i]);
+            const BonusInfo *b      = &(job.m_bonus_info[k][i]);
+            const KartReplayEvent *r = &(job.m_kart_replay_event[k][i]);
 
             fprintf(fd, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f %d  %d %f %d %d %d  %f %d %d %d %d %d\n",
                     p->m_time,
@@ -486,8 +663,86 @@ void ReplayRecorder::save()
                 );
         }   // for i
     }
-    fclose(fd);
-}   // save
+    return ferror(fd) == 0;
+}   // writeTextSaveJob
+
+//-----------------------------------------------------------------------------
+/** Compresses a file with gzip.
+ *  \return True if the compressed file was written.
+ */
+bool ReplayRecorder::compressFile(const std::string& from,
+                                  const std::string& to)
+{
+    FILE* in = FileUtils::fopenU8Path(from, "rb");
+    if (!in)
+        return false;
+    gzFile out = gzopen(FileUtils::getPortableWritingPath(to).c_str(), "wb");
+    if (!out)
+    {
+        fclose(in);
+        Log::error("ReplayRecorder", "Can't open '%s' for writing",
+            to.c_str());
+        return false;
+    }
+    bool success = true;
+    char buffer[16384];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    {
+        if (gzwrite(out, buffer, (unsigned)read) != (int)read)
+        {
+            success = false;
+            break;
+        }
+    }
+    if (ferror(in))
+        success = false;
+    fclose(in);
+    if (gzclose(out) != Z_OK)
+        success = false;
+    if (!success)
+    {
+        Log::error("ReplayRecorder", "Can't write '%s'", to.c_str());
+        file_manager->removeFile(to);
+    }
+    return success;
+}   // compressFile
+
+//-----------------------------------------------------------------------------
+/** Calls the callbacks of save jobs which were written since the last call.
+ *  It is called regularly by the thread which wants the save results, so
+ *  callbacks never run in the replay writer thread.
+ */
+void ReplayRecorder::handleSaveCompletions()
+{
+    std::vector<std::function<void()> > completions;
+    {
+        std::lock_guard<std::mutex> lock(m_completions_mutex);
+        if (m_completions.empty())
+            return;
+        std::swap(completions, m_completions);
+    }
+    for (auto& completion : completions)
+        completion();
+}   // handleSaveCompletions
+
+//-----------------------------------------------------------------------------
+/** Writes all queued save jobs and stops the replay writer thread. Pending
+ *  callbacks are dropped.
+ */
+void ReplayRecorder::stopSaving()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_save_mutex);
+        if (!m_save_thread.joinable())
+            return;
+        m_save_stop = true;
+        m_save_cv.notify_one();
+    }
+    m_save_thread.join();
+    std::lock_guard<std::mutex> lock(m_completions_mutex);
+    m_completions.clear();
+}   // stopSaving
 
 /* Returns an encoding value for a given attachment type.
  * The internal values of the enum for attachments may change if attachments
@@ -24,6 +24,13 @@
 #include "karts/controller/kart_control.hpp"
 #include "replay/replay_base.hpp"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 
@@ -105,9 +112,60 @@ private:
     unsigned int m_count_skipped_interpolation;
 #endif
 
+    /** A replay to be written by the replay writer thread. It has copies of
+     *  the recorded data, so it's independent of the recorder. */
+    struct SaveJob
+    {
+        /** Full path of the replay file, without .gz. */
+        std::string m_path;
+
+        bool m_binary;
+
+        /** Compress the file with gzip. */
+        bool m_compress;
+
+        /** Race and kart information, also used for text replays. */
+        BinaryHeader m_header;
+
+        /** If the kart has a kart_color line in text replays. */
+        std::vector<bool> m_has_kart_color;
+
+        std::vector< std::vector<TransformEvent> > m_transform_events;
+
+        std::vector< std::vector<PhysicInfo> > m_physic_info;
+
+        std::vector< std::vector<BonusInfo> > m_bonus_info;
+
+        std::vector< std::vector<KartReplayEvent> > m_kart_replay_event;
+
+        std::function<void(bool, const std::string&)> m_callback;
+    };   // SaveJob
+
+    std::thread m_save_thread;
+
+    /** Protects m_save_jobs and m_save_stop. */
+    std::mutex m_save_mutex;
+
+    std::condition_variable m_save_cv;
+
+    std::deque<std::unique_ptr<SaveJob> > m_save_jobs;
+
+    bool m_save_stop;
+
+    std::mutex m_completions_mutex;
+
+    /** Callbacks of written save jobs, called by handleSaveCompletions. */
+    std::vector<std::function<void()> > m_completions;
+
     /** Compute the replay's UID ; partly based on race data ; partly randomly */
     uint64_t computeUID(float min_time);
 
+    void saveLoop();
+    bool writeSaveJob(const SaveJob& job, std::string* path) const;
+    bool writeTextSaveJob(FILE* fd, const SaveJob& job) const;
+    static bool writeBinarySaveJob(FILE* fd, const SaveJob& job);
+    static bool compressFile(const std::string& from, const std::string& to);
+
 
           ReplayRecorder();
          ~ReplayRecorder();
@@ -119,7 +177,9 @@ public:
     void setFilename(const std::string& filename) { m_filename = filename; } 
     void  init();
     void  reset();
-    void  save();
+    void  save(std::function<void(bool, const std::string&)> callback = nullptr);
+    void  handleSaveCompletions();
+    void  stopSaving();
     void  update(int ticks);
 
     const uint64_t getLastUID() { return m_last_uid; }
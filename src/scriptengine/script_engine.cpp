@@ -37,6 +37,7 @@ extern "C"
 #include "scriptengine/scriptstdstring.hpp"
 #include "scriptengine/scriptvec3.hpp"
 #include "scriptengine/scriptarray.hpp"
+#include <stdio.h>
 #include <string.h>
 #include "states_screens/dialogs/tutorial_message_dialog.hpp"
 #include "tracks/track_object_manager.hpp"
@@ -52,6 +53,46 @@ namespace Scripting
 {
     const char* MODULE_ID_MAIN_SCRIPT_FILE = "main";
 
+    /** Header of a bytecode cache file, followed by the data written by
+     *  SaveByteCode. */
+    struct ByteCodeCacheHeader
+    {
+        char     m_magic[8];
+        uint64_t m_sections_hash;
+    };
+    static const char BYTECODE_CACHE_MAGIC[8] =
+        { 'S', 'T', 'K', 'A', 'S', 'B', 'C', '1' };
+
+    /** Stream used by AngelScript to read or write bytecode from or to a
+     *  cache file. */
+    class ByteCodeFileStream : public asIBinaryStream
+    {
+        FILE* m_file;
+        bool  m_failed;
+    public:
+        ByteCodeFileStream(FILE* file) : m_file(file), m_failed(false) {}
+        // --------------------------------------------------------------------
+        virtual int Read(void* ptr, asUINT size)
+        {
+            if (size == 0)
+                return 0;
+            if (fread(ptr, size, 1, m_file) != 1)
+                m_failed = true;
+            return m_failed ? -1 : 0;
+        }
+        // --------------------------------------------------------------------
+        virtual int Write(const void* ptr, asUINT size)
+        {
+            if (size == 0)
+                return 0;
+            if (fwrite(ptr, size, 1, m_file) != 1)
+                m_failed = true;
+            return m_failed ? -1 : 0;
+        }
+        // --------------------------------------------------------------------
+        bool failed() const { return m_failed; }
+    };   // ByteCodeFileStream
+
     void AngelScript_ErrorCallback (const asSMessageInfo *msg, void *param)
     {
         const char *type = "ERR ";
@@ -77,6 +118,9 @@ namespace Scripting
         // The script compiler will write any compiler messages to the callback.
         m_engine->SetMessageCallback(asFUNCTION(AngelScript_ErrorCallback), 0, asCALL_CDECL);
 
+        // Reuse contexts instead of creating one for each function call
+        m_engine->SetContextCallbacks(requestContext, returnContext, this);
+
         // Configure the script engine with all the functions, 
         // and variables that the script should be able to use.
         configureEngine(m_engine);
@@ -86,10 +130,43 @@ namespace Scripting
     {
         // Release the engine
         m_pending_timeouts.clearAndDeleteAll();
+        for (asIScriptContext* ctx : m_context_pool)
+            ctx->Release();
+        m_context_pool.clear();
         m_engine->DiscardModule(MODULE_ID_MAIN_SCRIPT_FILE);
         m_engine->Release();
     }
 
+    //-----------------------------------------------------------------------------
+    /** Called by RequestContext, returns an idle context of the pool or a new
+     *  one if all contexts are in use (when a script calls a function which
+     *  runs another script).
+     */
+    asIScriptContext* ScriptEngine::requestContext(asIScriptEngine* engine,
+                                                   void* param)
+    {
+        ScriptEngine* se = (ScriptEngine*)param;
+        if (se->m_context_pool.empty())
+            return engine->CreateContext();
+        asIScriptContext* ctx = se->m_context_pool.back();
+        se->m_context_pool.pop_back();
+        return ctx;
+    }   // requestContext
+
+    //-----------------------------------------------------------------------------
+    /** Called by ReturnContext, puts the context back into the pool.
+     */
+    void ScriptEngine::returnContext(asIScriptEngine* engine,
+                                     asIScriptContext* ctx, void* param)
+    {
+        if (ctx == NULL)
+            return;
+        ScriptEngine* se = (ScriptEngine*)param;
+        // Releases the references to the function and its arguments
+        ctx->Unprepare();
+        se->m_context_pool.push_back(ctx);
+    }   // returnContext
+
 
 
     /** Get Script By it's file name
@@ -188,7 +265,7 @@ namespace Scripting
             return;
         }
 
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = m_engine->RequestContext();
         if (ctx == NULL)
         {
             Log::error("Scripting", "evalScript: Failed to create the context.");
@@ -200,7 +277,7 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "evalScript: Failed to prepare the context.");
-            ctx->Release();
+            m_engine->ReturnContext(ctx);
             return;
         }
 
@@ -223,7 +300,7 @@ namespace Scripting
             }
         }
 
-        ctx->Release();
+        m_engine->ReturnContext(ctx);
         func->Release();
     }
 
@@ -231,7 +308,7 @@ namespace Scripting
 
     void ScriptEngine::runDelegate(asIScriptFunction* delegate)
     {
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = m_engine->RequestContext();
         if (ctx == NULL)
         {
             Log::error("Scripting", "runMethod: Failed to create the context.");
@@ -243,7 +320,7 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "runMethod: Failed to prepare the context.");
-            ctx->Release();
+            m_engine->ReturnContext(ctx);
             return;
         }
 
@@ -268,7 +345,7 @@ namespace Scripting
             }
         }
 
-        ctx->Release();
+        m_engine->ReturnContext(ctx);
     }
 
     //-----------------------------------------------------------------------------
@@ -282,7 +359,7 @@ namespace Scripting
             Log::error("Scripting", ("runMethod: object does not implement method " + methodName).c_str());
 
 
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = m_engine->RequestContext();
         if (ctx == NULL)
         {
             Log::error("Scripting", "runMethod: Failed to create the context.");
@@ -294,7 +371,7 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "runMethod: Failed to prepare the context.");
-            ctx->Release();
+            m_engine->ReturnContext(ctx);
             return;
         }
 
@@ -317,7 +394,7 @@ namespace Scripting
             }
         }
 
-        ctx->Release();
+        m_engine->ReturnContext(ctx);
     }
     */
     //-----------------------------------------------------------------------------
@@ -407,7 +484,7 @@ namespace Scripting
         }
 
         // Create a context that will execute the script.
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = m_engine->RequestContext();
         if (ctx == NULL)
         {
             Log::error("Scripting", "Failed to create the context.");
@@ -424,7 +501,7 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "Failed to prepare the context.");
-            ctx->Release();
+            m_engine->ReturnContext(ctx);
             //m_engine->Release();
             return;
         }
@@ -472,8 +549,8 @@ namespace Scripting
                 get_return_value(ctx);
         }
 
-        // We must release the contexts when no longer using them
-        ctx->Release();
+        // Give the context back to the pool
+        m_engine->ReturnContext(ctx);
     }
 
     //-----------------------------------------------------------------------------
@@ -522,8 +599,6 @@ namespace Scripting
 
     bool ScriptEngine::loadScript(std::string script_path, bool clear_previous)
     {
-        int r;
-
         std::string script = getScript(script_path);
         if (script.size() == 0)
         {
@@ -531,23 +606,127 @@ namespace Scripting
             return false;
         }
 
-        // Add the script sections that will be compiled into executable code.
-        // If we want to combine more than one file into the same script, then 
-        // we can call AddScriptSection() several times for the same module and
-        // the script engine will treat them all as if they were one. The script
-        // section name, will allow us to localize any errors in the script code.
-        asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE,
-            clear_previous ? asGM_ALWAYS_CREATE : asGM_CREATE_IF_NOT_EXISTS);
-        r = mod->AddScriptSection("script", &script[0], script.size());
-        if (r < 0)
+        // The sections are only added to the module in compileLoadedScripts,
+        // so that they don't need to be compiled if there is cached bytecode
+        // for them.
+        if (clear_previous)
         {
-            Log::error("Scripting", "AddScriptSection() failed");
-            return false;
+            m_script_sections.clear();
+            m_engine->DiscardModule(MODULE_ID_MAIN_SCRIPT_FILE);
         }
-    
+        m_script_sections.push_back(std::move(script));
         return true;
     }
 
+    //-----------------------------------------------------------------------------
+    /** Returns a hash of the loaded script sections and of everything else the
+     *  compiled bytecode depends on.
+     */
+    uint64_t ScriptEngine::getSectionsHash() const
+    {
+        // FNV-1a over bytes
+        uint64_t hash = 14695981039346656037ULL;
+        auto add = [&hash](const void* data, size_t size)
+            {
+                const uint8_t* bytes = (const uint8_t*)data;
+                for (size_t i = 0; i < size; i++)
+                    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+            };
+        auto add_string = [&add](const std::string& s)
+            {
+                uint64_t size = s.size();
+                add(&size, sizeof(size));
+                add(s.data(), s.size());
+            };
+        add_string(STK_VERSION);
+        add_string(ANGELSCRIPT_VERSION_STRING);
+        uint32_t pointer_size = sizeof(void*);
+        add(&pointer_size, sizeof(pointer_size));
+        for (const std::string& section : m_script_sections)
+            add_string(section);
+        return hash;
+    }   // getSectionsHash
+
+    //-----------------------------------------------------------------------------
+    std::string ScriptEngine::getByteCodeCacheFile(uint64_t hash) const
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%016llx.asbc", (unsigned long long)hash);
+        return file_manager->getCachedScriptsDir() + name;
+    }   // getByteCodeCacheFile
+
+    //-----------------------------------------------------------------------------
+    /** Loads the bytecode saved by saveByteCode into the module.
+     *  \return False if there is no valid cache file, the module must be
+     *  rebuilt from the sources then.
+     */
+    bool ScriptEngine::loadByteCode(asIScriptModule* mod, uint64_t hash)
+    {
+        std::string filename = getByteCodeCacheFile(hash);
+        FILE* f = FileUtils::fopenU8Path(filename, "rb");
+        if (!f)
+            return false;
+
+        ByteCodeCacheHeader header;
+        bool success = fread(&header, sizeof(header), 1, f) == 1 &&
+            memcmp(header.m_magic, BYTECODE_CACHE_MAGIC,
+                   sizeof(BYTECODE_CACHE_MAGIC)) == 0 &&
+            header.m_sections_hash == hash;
+        if (success)
+        {
+            ByteCodeFileStream stream(f);
+            success = mod->LoadByteCode(&stream) >= 0 && !stream.failed();
+        }
+        fclose(f);
+        if (!success)
+        {
+            // Removed so that the warning is only printed once, it is
+            // replaced after building the module
+            Log::warn("Scripting", "Ignoring invalid bytecode cache '%s'.",
+                filename.c_str());
+            file_manager->removeFile(filename);
+        }
+        return success;
+    }   // loadByteCode
+
+    //-----------------------------------------------------------------------------
+    /** Saves the bytecode of the built module, it is written to a temporary
+     *  file first so that another process never reads a partial file.
+     */
+    void ScriptEngine::saveByteCode(asIScriptModule* mod, uint64_t hash) const
+    {
+        ByteCodeCacheHeader header;
+        memcpy(header.m_magic, BYTECODE_CACHE_MAGIC,
+            sizeof(BYTECODE_CACHE_MAGIC));
+        header.m_sections_hash = hash;
+
+        std::string filename = getByteCodeCacheFile(hash);
+        std::string temp = FileUtils::getTempPath(filename);
+        FILE* f = FileUtils::fopenU8Path(temp, "wb");
+        if (!f)
+        {
+            Log::warn("Scripting", "Cannot write bytecode cache '%s'.",
+                temp.c_str());
+            return;
+        }
+        ByteCodeFileStream stream(f);
+        // Debug info is kept for the line numbers of script exceptions
+        bool success = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            mod->SaveByteCode(&stream) >= 0 && !stream.failed();
+        success = fclose(f) == 0 && success;
+#ifdef WIN32
+        // rename does not replace existing files on windows
+        if (success)
+            file_manager->removeFile(filename);
+#endif
+        if (!success || FileUtils::renameU8Path(temp, filename) != 0)
+        {
+            Log::warn("Scripting", "Cannot write bytecode cache '%s'.",
+                filename.c_str());
+            file_manager->removeFile(temp);
+        }
+    }   // saveByteCode
+
     //-----------------------------------------------------------------------------
 
     bool ScriptEngine::compileLoadedScripts()
@@ -555,6 +734,39 @@ namespace Scripting
         int r;
         asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_CREATE_IF_NOT_EXISTS);
 
+        uint64_t hash = 0;
+        if (!m_script_sections.empty())
+        {
+            hash = getSectionsHash();
+            if (loadByteCode(mod, hash))
+            {
+                Log::debug("Scripting", "Loaded cached bytecode %016llx.",
+                    (unsigned long long)hash);
+                m_script_sections.clear();
+                return true;
+            }
+            // Start again with an empty module if loading failed halfway
+            mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE,
+                asGM_ALWAYS_CREATE);
+        }
+
+        // Add the script sections that will be compiled into executable code.
+        // If we want to combine more than one file into the same script, then 
+        // we can call AddScriptSection() several times for the same module and
+        // the script engine will treat them all as if they were one. The script
+        // section name, will allow us to localize any errors in the script code.
+        for (const std::string& section : m_script_sections)
+        {
+            r = mod->AddScriptSection("script", section.c_str(),
+                section.size());
+            if (r < 0)
+            {
+                Log::error("Scripting", "AddScriptSection() failed");
+                m_script_sections.clear();
+                return false;
+            }
+        }
+
         // Compile the script. If there are any compiler messages they will
         // be written to the message stream that we set right after creating the 
         // script engine. If there are no errors, and no warnings, nothing will
@@ -563,8 +775,14 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "Build() failed");
+            m_script_sections.clear();
             return false;
         }
+        if (!m_script_sections.empty())
+        {
+            saveByteCode(mod, hash);
+            m_script_sections.clear();
+        }
 
         // The engine doesn't keep a copy of the script sections after Build() has
         // returned. So if the script needs to be recompiled, then all the script
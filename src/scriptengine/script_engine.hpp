@@ -25,9 +25,11 @@
 #include "utils/singleton.hpp"
 
 #include <angelscript.h>
+#include <cstdint>
 #include <functional>
 #include <map>
 #include <string>
+#include <vector>
 
 class TrackObjectPresentation;
 
@@ -91,7 +93,24 @@ namespace Scripting
         std::map<std::string, asIScriptFunction*> m_functions_cache;
         PtrVector<PendingTimeout> m_pending_timeouts;
 
+        /** Contexts which are not executing anything, reused by
+         *  RequestContext instead of creating a new context for each call. */
+        std::vector<asIScriptContext*> m_context_pool;
+
+        /** The preprocessed sources added by loadScript, they are only
+         *  compiled if compileLoadedScripts finds no cached bytecode. */
+        std::vector<std::string> m_script_sections;
+
         void configureEngine(asIScriptEngine *engine);
+        uint64_t getSectionsHash() const;
+        std::string getByteCodeCacheFile(uint64_t hash) const;
+        bool loadByteCode(asIScriptModule* mod, uint64_t hash);
+        void saveByteCode(asIScriptModule* mod, uint64_t hash) const;
+
+        static asIScriptContext* requestContext(asIScriptEngine* engine,
+                                                void* param);
+        static void returnContext(asIScriptEngine* engine,
+                                  asIScriptContext* ctx, void* param);
     };   // class ScriptEngine
 
 }
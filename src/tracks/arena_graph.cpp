@@ -25,20 +25,42 @@
 #include "tracks/arena_node.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
 #include <queue>
+#include <thread>
+
+/** Header of a cached path table file, followed by the distance and parent
+ *  matrices. Stored in native byte order, it is only read by the same
+ *  build. */
+struct PathCacheHeader
+{
+    char     m_magic[8];
+    uint32_t m_num_nodes;
+    uint32_t m_reserved;
+    uint64_t m_navmesh_hash;
+};
+static const char PATH_CACHE_MAGIC[8] = { 'S', 'T', 'K', 'P', 'A', 'T', 'H', '1' };
 
 // -----------------------------------------------------------------------------
 ArenaGraph::ArenaGraph(const std::string &navmesh, const XMLNode *node)
           : Graph()
 {
+    m_num_nodes = 0;
     loadNavmesh(navmesh);
-    buildGraph();
-    // Compute shortest distance from all nodes
-    for (unsigned int i = 0; i < getNumNodes(); i++)
-        computeDijkstra(i);
+    buildSpatialGrid();
+    if (!loadPathCache())
+    {
+        buildGraph();
+        // Compute shortest distance from all nodes
+        computeAllPaths();
+        savePathCache();
+    }
 
     setNearbyNodesOfAllNodes();
     if (node && RaceManager::get()->getMinorMode() == RaceManager::MINOR_MODE_SOCCER)
@@ -178,32 +200,32 @@ void ArenaGraph::loadNavmesh(const std::string &navmesh)
 void ArenaGraph::buildGraph()
 {
     const unsigned int n_nodes = getNumNodes();
+    m_num_nodes = n_nodes;
 
-    m_distance_matrix = std::vector<std::vector<float>>
-        (n_nodes, std::vector<float>(n_nodes, 9999.9f));
+    m_distance_matrix.assign(n_nodes * n_nodes, 9999.9f);
     for (unsigned int i = 0; i < n_nodes; i++)
     {
         ArenaNode* cur_node = getNode(i);
+        float* row = &m_distance_matrix[i * n_nodes];
         for (const int& adjacent : cur_node->getAdjacentNodes())
         {
             Vec3 diff = getNode(adjacent)->getCenter() - cur_node->getCenter();
             float distance = diff.length();
-            m_distance_matrix[i][adjacent] = distance;
+            row[adjacent] = distance;
         }
-        m_distance_matrix[i][i] = 0.0f;
+        row[i] = 0.0f;
     }
 
     // Allocate and initialise the previous node data structure:
-    m_parent_node = std::vector<std::vector<int16_t>>
-        (n_nodes, std::vector<int16_t>(n_nodes, Graph::UNKNOWN_SECTOR));
+    m_parent_node.assign(n_nodes * n_nodes, Graph::UNKNOWN_SECTOR);
     for (unsigned int i = 0; i < n_nodes; i++)
     {
         for (unsigned int j = 0; j < n_nodes; j++)
         {
-            if (i == j || m_distance_matrix[i][j] >= 9899.9f)
-                m_parent_node[i][j] = -1;
+            if (i == j || m_distance_matrix[i * n_nodes + j] >= 9899.9f)
+                m_parent_node[i * n_nodes + j] = -1;
             else
-                m_parent_node[i][j] = i;
+                m_parent_node[i * n_nodes + j] = i;
         }   // for j
     }   // for i
 
@@ -216,6 +238,8 @@ void ArenaGraph::buildGraph()
  *  source to j and m_parent_node[source][j] stores the last vertex visited on
  *  the shortest path from i to j before visiting j. Suppose the shortest path
  *  from i to j is i->......->k->j  then m_parent_node[i][j] = k
+ *  Only the row of source is written and edge lengths are taken from the
+ *  nodes, so rows can be computed in parallel.
  */
 void ArenaGraph::computeDijkstra(int source)
 {
@@ -235,6 +259,8 @@ void ArenaGraph::computeDijkstra(int source)
     IndDistPair begin(source, 0.0f);
     queue.push(begin);
     const unsigned int n = getNumNodes();
+    float* distance = &m_distance_matrix[source * n];
+    int16_t* parent = &m_parent_node[source * n];
     std::vector<bool> visited;
     visited.resize(n, false);
     while (!queue.empty())
@@ -246,17 +272,18 @@ void ArenaGraph::computeDijkstra(int source)
         if (visited[cur_index]) continue;
         visited[cur_index] = true;
 
-        for (const int& adjacent : getNode(cur_index)->getAdjacentNodes())
+        ArenaNode* cur_node = getNode(cur_index);
+        for (const int& adjacent : cur_node->getAdjacentNodes())
         {
             // Distance already computed, can be ignored
             if (visited[adjacent]) continue;
 
-            float new_dist =
-                current.second + m_distance_matrix[cur_index][adjacent];
-            if (new_dist < m_distance_matrix[source][adjacent])
+            Vec3 diff = getNode(adjacent)->getCenter() - cur_node->getCenter();
+            float new_dist = current.second + diff.length();
+            if (new_dist < distance[adjacent])
             {
-                m_distance_matrix[source][adjacent] = new_dist;
-                m_parent_node[source][adjacent] = cur_index;
+                distance[adjacent] = new_dist;
+                parent[adjacent] = cur_index;
             }
             IndDistPair pair(adjacent, new_dist);
             queue.push(pair);
@@ -264,6 +291,154 @@ void ArenaGraph::computeDijkstra(int source)
     }
 }   // computeDijkstra
 
+// ----------------------------------------------------------------------------
+/** Runs computeDijkstra from every node, split over the available cores. */
+void ArenaGraph::computeAllPaths()
+{
+    const unsigned int n = getNumNodes();
+    // Small navmeshes are not worth starting threads
+    unsigned int thread_count = std::min(std::thread::hardware_concurrency(),
+        n / 128);
+    if (thread_count <= 1)
+    {
+        for (unsigned int i = 0; i < n; i++)
+            computeDijkstra(i);
+        return;
+    }
+
+    std::atomic<unsigned int> next_source(0);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back([this, n, &next_source]()
+            {
+                unsigned int source;
+                while ((source = next_source.fetch_add(1)) < n)
+                    computeDijkstra(source);
+            });
+    }
+    for (std::thread& t : threads)
+        t.join();
+}   // computeAllPaths
+
+// ----------------------------------------------------------------------------
+/** Returns a hash of the node centers and adjacency, which are all that the
+ *  path tables depend on. */
+uint64_t ArenaGraph::getNavmeshHash() const
+{
+    // FNV-1a over 32-bit words
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](uint32_t word)
+        {
+            hash = (hash ^ word) * 1099511628211ULL;
+        };
+    add(getNumNodes());
+    for (unsigned int i = 0; i < getNumNodes(); i++)
+    {
+        ArenaNode* node = getNode(i);
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            float f = node->getCenter()[j];
+            uint32_t word;
+            memcpy(&word, &f, sizeof(word));
+            add(word);
+        }
+        add((uint32_t)node->getAdjacentNodes().size());
+        for (const int& adjacent : node->getAdjacentNodes())
+            add((uint32_t)adjacent);
+    }
+    return hash;
+}   // getNavmeshHash
+
+// ----------------------------------------------------------------------------
+std::string ArenaGraph::getPathCacheFile() const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "navmesh-%016llx.paths",
+        (unsigned long long)getNavmeshHash());
+    return file_manager->getCachedPhysicsDir() + name;
+}   // getPathCacheFile
+
+// ----------------------------------------------------------------------------
+/** Loads the path tables saved by savePathCache for this navmesh.
+ *  \return False if there is no valid cache file.
+ */
+bool ArenaGraph::loadPathCache()
+{
+    const unsigned int n = getNumNodes();
+    if (n == 0)
+        return false;
+    const uint64_t hash = getNavmeshHash();
+    std::string filename = getPathCacheFile();
+    FILE* f = fopen(filename.c_str(), "rb");
+    if (!f)
+        return false;
+
+    PathCacheHeader header;
+    bool success = fread(&header, sizeof(header), 1, f) == 1 &&
+        memcmp(header.m_magic, PATH_CACHE_MAGIC,
+               sizeof(PATH_CACHE_MAGIC)) == 0 &&
+        header.m_num_nodes == n && header.m_navmesh_hash == hash;
+    if (success)
+    {
+        m_num_nodes = n;
+        m_distance_matrix.resize(n * n);
+        m_parent_node.resize(n * n);
+        success =
+            fread(m_distance_matrix.data(), sizeof(float) * n * n, 1, f) == 1 &&
+            fread(m_parent_node.data(), sizeof(int16_t) * n * n, 1, f) == 1;
+    }
+    fclose(f);
+    if (!success)
+    {
+        Log::warn("ArenaGraph", "Ignoring invalid path cache '%s'.",
+            filename.c_str());
+        m_distance_matrix.clear();
+        m_parent_node.clear();
+    }
+    return success;
+}   // loadPathCache
+
+// ----------------------------------------------------------------------------
+/** Saves the path tables, they are written to a temporary file first so that
+ *  another process never reads a partial file. */
+void ArenaGraph::savePathCache() const
+{
+    const unsigned int n = getNumNodes();
+    if (n == 0)
+        return;
+    PathCacheHeader header;
+    memcpy(header.m_magic, PATH_CACHE_MAGIC, sizeof(PATH_CACHE_MAGIC));
+    header.m_num_nodes = n;
+    header.m_reserved = 0;
+    header.m_navmesh_hash = getNavmeshHash();
+
+    std::string filename = getPathCacheFile();
+    std::string temp = FileUtils::getTempPath(filename);
+    FILE* f = fopen(temp.c_str(), "wb");
+    if (!f)
+    {
+        Log::warn("ArenaGraph", "Cannot write path cache '%s'.",
+            temp.c_str());
+        return;
+    }
+    bool success = fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(m_distance_matrix.data(), sizeof(float) * n * n, 1, f) == 1 &&
+        fwrite(m_parent_node.data(), sizeof(int16_t) * n * n, 1, f) == 1;
+    success = fclose(f) == 0 && success;
+#ifdef WIN32
+    // rename does not replace existing files on windows
+    if (success)
+        remove(filename.c_str());
+#endif
+    if (!success || rename(temp.c_str(), filename.c_str()) != 0)
+    {
+        Log::warn("ArenaGraph", "Cannot write path cache '%s'.",
+            filename.c_str());
+        remove(temp.c_str());
+    }
+}   // savePathCache
+
 // ----------------------------------------------------------------------------
 /** THIS FUNCTION IS ONLY USED FOR UNIT-TESTING, to verify that the new
  *  Dijkstra algorithm gives the same results.
@@ -284,12 +459,12 @@ void ArenaGraph::computeFloydWarshall()
         {
             for (unsigned int j = 0; j < n; j++)
             {
-                if ((m_distance_matrix[i][k] + m_distance_matrix[k][j]) <
-                    m_distance_matrix[i][j])
+                if ((m_distance_matrix[i * n + k] + m_distance_matrix[k * n + j]) <
+                    m_distance_matrix[i * n + j])
                 {
-                    m_distance_matrix[i][j] =
-                        m_distance_matrix[i][k] + m_distance_matrix[k][j];
-                    m_parent_node[i][j] = m_parent_node[k][j];
+                    m_distance_matrix[i * n + j] =
+                        m_distance_matrix[i * n + k] + m_distance_matrix[k * n + j];
+                    m_parent_node[i * n + j] = m_parent_node[k * n + j];
                 }
             }
         }
@@ -349,7 +524,8 @@ void ArenaGraph::setNearbyNodesOfAllNodes()
         // Get the distance to all nodes at i
         ArenaNode* cur_node = getNode(i);
         std::vector<int> nearby_nodes;
-        std::vector<float> dist = m_distance_matrix[i];
+        std::vector<float> dist(m_distance_matrix.begin() + i * m_num_nodes,
+            m_distance_matrix.begin() + (i + 1) * m_num_nodes);
 
         // Skip the same node
         dist[i] = 999999.0f;
@@ -371,13 +547,14 @@ void ArenaGraph::setNearbyNodesOfAllNodes()
  *  std::vector (in reverse order). Used only for unit testing.
  */
 std::vector<int16_t> ArenaGraph::getPathFromTo(int from, int to,
-                      const std::vector< std::vector< int16_t > >& parent_node)
+                                       const std::vector<int16_t>& parent_node,
+                                       unsigned int num_nodes)
 {
     std::vector<int16_t> path;
     path.push_back(to);
     while(from!=to)
     {
-        to = parent_node[from][to];
+        to = parent_node[from * num_nodes + to];
         path.push_back(to);
     }
     return path;
@@ -395,14 +572,28 @@ void ArenaGraph::unitTesting()
     Track *track = track_manager->getTrack("cave");
     std::string navmesh_file_name=track->getTrackFile("navmesh.xml");
 
-    double s = StkTime::getRealTime();
     ArenaGraph* ag = new ArenaGraph(navmesh_file_name);
+
+    // Compute again, the constructor may have used the path cache
+    double s = StkTime::getRealTime();
+    ag->buildGraph();
+    ag->computeAllPaths();
     double e = StkTime::getRealTime();
     Log::error("Time", "Dijkstra       %lf", e-s);
 
     // Save the Dijkstra results
-    std::vector< std::vector< float > > distance_matrix = ag->m_distance_matrix;
-    std::vector< std::vector< int16_t > > parent_node = ag->m_parent_node;
+    std::vector<float> distance_matrix = ag->m_distance_matrix;
+    std::vector<int16_t> parent_node = ag->m_parent_node;
+
+    // The cache must give the same tables
+    int error_count = 0;
+    ag->savePathCache();
+    if (!ag->loadPathCache() || ag->m_distance_matrix != distance_matrix ||
+        ag->m_parent_node != parent_node)
+    {
+        Log::error("ArenaGraph", "Path cache differs from computed paths.");
+        error_count++;
+    }
     ag->buildGraph();
 
     // Now compute results with Floyd-Warshall
@@ -411,16 +602,16 @@ void ArenaGraph::unitTesting()
     e = StkTime::getRealTime();
     Log::error("Time", "Floyd-Warshall %lf", e-s);
 
-    int error_count = 0;
-    for(unsigned int i=0; i<ag->m_distance_matrix.size(); i++)
+    const unsigned int n = ag->m_num_nodes;
+    for(unsigned int i=0; i<n; i++)
     {
-        for(unsigned int j=0; j<ag->m_distance_matrix[i].size(); j++)
+        for(unsigned int j=0; j<n; j++)
         {
-            if(ag->m_distance_matrix[i][j] - distance_matrix[i][j] > 0.001f)
+            if(ag->m_distance_matrix[i*n+j] - distance_matrix[i*n+j] > 0.001f)
             {
                 Log::error("ArenaGraph",
                            "Incorrect distance %d, %d: Dijkstra: %f F.W.: %f",
-                           i, j, distance_matrix[i][j], ag->m_distance_matrix[i][j]);
+                           i, j, distance_matrix[i*n+j], ag->m_distance_matrix[i*n+j]);
                 error_count++;
             }    // if distance is too different
 
@@ -432,16 +623,16 @@ void ArenaGraph::unitTesting()
             // debugging in the feature
 #undef TEST_PARENT_POLY_EVEN_THOUGH_MANY_FALSE_POSITIVES
 #ifdef TEST_PARENT_POLY_EVEN_THOUGH_MANY_FALSE_POSITIVES
-            if(ag->m_parent_node[i][j] != parent_node[i][j])
+            if(ag->m_parent_node[i*n+j] != parent_node[i*n+j])
             {
                 error_count++;
-                std::vector<int16_t> dijkstra_path = getPathFromTo(i, j, parent_node);
-                std::vector<int16_t> floyd_path = getPathFromTo(i, j, ag->m_parent_node);
+                std::vector<int16_t> dijkstra_path = getPathFromTo(i, j, parent_node, n);
+                std::vector<int16_t> floyd_path = getPathFromTo(i, j, ag->m_parent_node, n);
                 if(dijkstra_path.size()!=floyd_path.size())
                 {
                     Log::error("ArenaGraph",
                                "Incorrect path length %d, %d: Dijkstra: %d F.W.: %d",
-                               i, j, parent_node[i][j], ag->m_parent_node[i][j]);
+                               i, j, parent_node[i*n+j], ag->m_parent_node[i*n+j]);
                     continue;
                 }
                 Log::error("ArenaGraph", "Path problems from %d to %d:",
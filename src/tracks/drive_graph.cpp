@@ -29,8 +29,11 @@
 #include "tracks/check_manager.hpp"
 #include "tracks/drive_node.hpp"
 #include "tracks/track.hpp"
+#include "tracks/track_manager.hpp"
 #include "utils/string_utils.hpp"
 
+#include <algorithm>
+
 // ----------------------------------------------------------------------------
 /** Constructor, loads the graph information for a given set of quads
  *  from a graph file.
@@ -260,6 +263,7 @@ void DriveGraph::load(const std::string &quad_file_name,
             m_lap_length = l;
     }
 
+    buildSpatialGrid();
     loadBoundingBoxNodes();
 
 }   // load
@@ -764,3 +768,66 @@ bool DriveGraph::hasLapLine() const
         return false;
     return true;
 }   // hasLapLine
+
+// -----------------------------------------------------------------------------
+/** Loads the drive graph of all race tracks and compares the time of sector
+ *  lookups with and without the spatial grid, the largest tracks of the
+ *  official and addon tracks are logged last. Used by --benchmark-sectors.
+ */
+void DriveGraph::benchmarkSectorLookup()
+{
+    struct Result
+    {
+        std::string m_ident;
+        bool m_addon;
+        unsigned int m_nodes;
+        double m_grid_time;
+        double m_linear_time;
+    };
+    const unsigned int count = 20000;
+    std::vector<Result> results;
+    unsigned int mismatches = 0;
+    for (unsigned int i = 0; i < track_manager->getNumberOfTracks(); i++)
+    {
+        Track* track = track_manager->getTrack(i);
+        if (track->isArena() || track->isSoccer() || track->isInternal())
+            continue;
+        std::string quad_file = track->getTrackFile("quads.xml");
+        if (!file_manager->fileExists(quad_file))
+            continue;
+        DriveGraph* graph = new DriveGraph(quad_file,
+            track->getTrackFile("graph.xml"), false/*reverse*/);
+        Result r;
+        r.m_ident = track->getIdent();
+        r.m_addon = track->isAddon();
+        r.m_nodes = graph->getNumNodes();
+        unsigned int m = graph->compareSectorLookup(count, &r.m_grid_time,
+                                                    &r.m_linear_time);
+        Graph::destroy();
+        if (m > 0)
+        {
+            Log::error("DriveGraph", "%s: %d of %d sector lookups differ.",
+                r.m_ident.c_str(), m, count * 2);
+            mismatches += m;
+        }
+        results.push_back(r);
+    }
+
+    std::sort(results.begin(), results.end(),
+        [](const Result& a, const Result& b)
+        {
+            if (a.m_addon != b.m_addon)
+                return b.m_addon;
+            return a.m_nodes < b.m_nodes;
+        });
+    Log::info("DriveGraph", "Sector lookup of %d points (findRoadSector and "
+        "findOutOfRoadSector), microseconds per point:", count);
+    for (const Result& r : results)
+    {
+        Log::info("DriveGraph", "%-30s %s %5d quads: grid %8.3f linear %8.3f",
+            r.m_ident.c_str(), r.m_addon ? "addon   " : "official", r.m_nodes,
+            r.m_grid_time * 1e6 / count, r.m_linear_time * 1e6 / count);
+    }
+    Log::info("DriveGraph", "%d tracks, %d different results.",
+        (int)results.size(), mismatches);
+}   // benchmarkSectorLookup
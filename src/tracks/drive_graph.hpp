@@ -81,6 +81,8 @@ public:
     // ------------------------------------------------------------------------
     virtual ~DriveGraph() {}
     // ------------------------------------------------------------------------
+    static void benchmarkSectorLookup();
+    // ------------------------------------------------------------------------
     void getSuccessors(int node_number, std::vector<unsigned int>& succ,
                        bool for_ai=false) const;
     // ------------------------------------------------------------------------
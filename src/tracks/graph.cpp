@@ -32,6 +32,11 @@
 #include "tracks/drive_node_3d.hpp"
 #include "tracks/track.hpp"
 #include "utils/log.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
 
 #include <ICameraSceneNode.h>
 #include <ISceneManager.h>
@@ -55,6 +60,11 @@ Graph::Graph()
     m_bb_min      = Vec3( 99999,  99999,  99999);
     m_bb_max      = Vec3(-99999, -99999, -99999);
     memset(m_bb_nodes, 0, 4 * sizeof(int));
+    m_grid_min_x     = 0;
+    m_grid_min_z     = 0;
+    m_grid_cell_size = 1.0f;
+    m_grid_width     = 0;
+    m_grid_height    = 0;
 }  // Graph
 
 // -----------------------------------------------------------------------------
@@ -693,6 +703,13 @@ void Graph::findRoadSector(const Vec3& xyz, int *sector,
                             ? (unsigned int)all_sectors->size()
                             : (unsigned int)m_all_nodes.size();
     *sector = UNKNOWN_SECTOR;
+    if (!all_sectors && !m_grid_offsets.empty())
+    {
+        *sector = findRoadSectorInGrid(xyz,
+            indx < (int)m_all_nodes.size() - 1 ? indx + 1 : 0,
+            ignore_vertical);
+        return;
+    }
     for(unsigned int i=0; i<max_count; i++)
     {
         if(all_sectors)
@@ -754,10 +771,8 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
         // shortcut. If we only tested a limited number of quads to
         // improve the performance the crossing of a lap might not be
         // detected (because quad 0 is not tested, only quads on the
-        // shortcuts are tested). If this should become a performance
-        // bottleneck, we need to set up a graph of 'next' quads for each
-        // quad (similar to what the AI does), and only test the quads
-        // in this graph.
+        // shortcuts are tested). The spatial grid is used to test only
+        // the quads close to xyz, which gives the same result.
         const int LIMIT = getNumNodes();
         count           = LIMIT;
         // Start 10 quads before the current quad, so the quads closest
@@ -766,6 +781,21 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
         if(current_sector<0) current_sector += getNumNodes();
     }
 
+    if (!all_sectors && !m_grid_offsets.empty())
+    {
+        int start = current_sector + 1 == (int)getNumNodes()
+                  ? 0 : current_sector + 1;
+        for (int phase = 0; phase < 2; phase++)
+        {
+            int sector = findOutOfRoadSectorInGrid(xyz, start, phase,
+                                                   ignore_vertical);
+            if (sector != UNKNOWN_SECTOR)
+                return sector;
+        }
+        Log::warn("Graph", "unknown sector found.");
+        return 0;
+    }
+
     int   min_sector = UNKNOWN_SECTOR;
     float min_dist_2 = 999999.0f*999999.0f;
 
@@ -833,3 +863,264 @@ void Graph::loadBoundingBoxNodes()
     m_bb_nodes[3] = findOutOfRoadSector(Vec3(m_bb_max.x(), 0, m_bb_max.z()),
         -1/*curr_sector*/, NULL/*all_sectors*/, true/*ignore_vertical*/);
 }   // loadBoundingBoxNodes
+
+//-----------------------------------------------------------------------------
+/** Builds the grid used by findRoadSector and findOutOfRoadSector, it must be
+ *  called after all quads are created. Each quad is added to all cells
+ *  overlapping its bounding box on the XZ plane (enlarged for 3d quads,
+ *  whose pointInside accepts points up to 5 units above the quad).
+ */
+void Graph::buildSpatialGrid()
+{
+    m_grid_offsets.clear();
+    m_grid_nodes.clear();
+    const unsigned int n = getNumNodes();
+    if (n == 0)
+        return;
+
+    std::vector<float> bounds(n * 4);
+    float min_x = 999999.0f, min_z = 999999.0f;
+    float max_x = -999999.0f, max_z = -999999.0f;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const Quad* q = m_all_nodes[i];
+        float margin = q->is3DQuad() ? 5.01f : 0.01f;
+        float* b = &bounds[i * 4];
+        b[0] = b[1] = 999999.0f;
+        b[2] = b[3] = -999999.0f;
+        for (int j = 0; j < 4; j++)
+        {
+            b[0] = std::min(b[0], (*q)[j].getX());
+            b[1] = std::min(b[1], (*q)[j].getZ());
+            b[2] = std::max(b[2], (*q)[j].getX());
+            b[3] = std::max(b[3], (*q)[j].getZ());
+        }
+        b[0] -= margin; b[1] -= margin;
+        b[2] += margin; b[3] += margin;
+        min_x = std::min(min_x, b[0]); min_z = std::min(min_z, b[1]);
+        max_x = std::max(max_x, b[2]); max_z = std::max(max_z, b[3]);
+    }
+
+    // About one cell per quad, but not less than 1 unit and not more than
+    // 1024 cells along each axis
+    float size_x = max_x - min_x;
+    float size_z = max_z - min_z;
+    float cell = std::max(sqrtf(size_x * size_z / n), 1.0f);
+    cell = std::max(cell, std::max(size_x, size_z) / 1024.0f);
+    m_grid_min_x     = min_x;
+    m_grid_min_z     = min_z;
+    m_grid_cell_size = cell;
+    m_grid_width     = std::max((int)ceilf(size_x / cell), 1);
+    m_grid_height    = std::max((int)ceilf(size_z / cell), 1);
+
+    // Count the quads of each cell first, then fill the cells, so the nodes
+    // of a cell are sorted
+    const unsigned int num_cells = m_grid_width * m_grid_height;
+    std::vector<int> cell_range(n * 4);
+    m_grid_offsets.resize(num_cells + 1, 0);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        int* r = &cell_range[i * 4];
+        getGridCell(Vec3(bounds[i * 4], 0, bounds[i * 4 + 1]), &r[0], &r[1]);
+        getGridCell(Vec3(bounds[i * 4 + 2], 0, bounds[i * 4 + 3]),
+                    &r[2], &r[3]);
+        for (int z = r[1]; z <= r[3]; z++)
+        {
+            for (int x = r[0]; x <= r[2]; x++)
+                m_grid_offsets[z * m_grid_width + x + 1]++;
+        }
+    }
+    for (unsigned int i = 0; i < num_cells; i++)
+        m_grid_offsets[i + 1] += m_grid_offsets[i];
+    m_grid_nodes.resize(m_grid_offsets[num_cells]);
+    std::vector<unsigned int> fill(m_grid_offsets.begin(),
+                                   m_grid_offsets.end() - 1);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const int* r = &cell_range[i * 4];
+        for (int z = r[1]; z <= r[3]; z++)
+        {
+            for (int x = r[0]; x <= r[2]; x++)
+                m_grid_nodes[fill[z * m_grid_width + x]++] = i;
+        }
+    }
+    Log::debug("Graph", "Spatial grid with %dx%d cells of size %f for %d "
+        "quads, %d entries.", m_grid_width, m_grid_height, cell, n,
+        (int)m_grid_nodes.size());
+}   // buildSpatialGrid
+
+//-----------------------------------------------------------------------------
+/** Sets x and z to the grid cell of xyz, clamped to the grid.
+ *  \return False if xyz is outside of the grid. */
+bool Graph::getGridCell(const Vec3& xyz, int* x, int* z) const
+{
+    float fx = floorf((xyz.getX() - m_grid_min_x) / m_grid_cell_size);
+    float fz = floorf((xyz.getZ() - m_grid_min_z) / m_grid_cell_size);
+    bool inside = fx >= 0 && fx < m_grid_width && fz >= 0 &&
+                  fz < m_grid_height;
+    *x = (int)std::min(std::max(fx, 0.0f), (float)(m_grid_width - 1));
+    *z = (int)std::min(std::max(fz, 0.0f), (float)(m_grid_height - 1));
+    return inside;
+}   // getGridCell
+
+//-----------------------------------------------------------------------------
+/** Returns the quad containing xyz which comes first when testing all quads
+ *  in order starting with start, i.e. the same quad as the linear search of
+ *  findRoadSector, or UNKNOWN_SECTOR.
+ */
+int Graph::findRoadSectorInGrid(const Vec3& xyz, int start,
+                                bool ignore_vertical) const
+{
+    int x, z;
+    if (!getGridCell(xyz, &x, &z))
+        return UNKNOWN_SECTOR;
+    const unsigned int cell = z * m_grid_width + x;
+    const unsigned int* first = m_grid_nodes.data() + m_grid_offsets[cell];
+    const unsigned int* last = m_grid_nodes.data() + m_grid_offsets[cell + 1];
+    const unsigned int* mid = std::lower_bound(first, last,
+                                               (unsigned int)start);
+    for (const unsigned int* i = mid; i != last; i++)
+    {
+        if (m_all_nodes[*i]->pointInside(xyz, ignore_vertical))
+            return *i;
+    }
+    for (const unsigned int* i = first; i != mid; i++)
+    {
+        if (m_all_nodes[*i]->pointInside(xyz, ignore_vertical))
+            return *i;
+    }
+    return UNKNOWN_SECTOR;
+}   // findRoadSectorInGrid
+
+//-----------------------------------------------------------------------------
+/** Does one phase of findOutOfRoadSector using the grid: the cells are
+ *  tested in rings around xyz until no untested quad can be closer than the
+ *  closest one found. Equally close quads are decided by the order of the
+ *  linear search starting with start, so the result is the same.
+ *  \return The closest quad, or UNKNOWN_SECTOR if no quad is accepted.
+ */
+int Graph::findOutOfRoadSectorInGrid(const Vec3& xyz, int start, int phase,
+                                     bool ignore_vertical) const
+{
+    const int n = getNumNodes();
+    int cx, cz;
+    getGridCell(xyz, &cx, &cz);
+    const int max_ring = std::max(std::max(cx, m_grid_width - 1 - cx),
+                                  std::max(cz, m_grid_height - 1 - cz));
+    int   min_sector = UNKNOWN_SECTOR;
+    int   min_rank   = n;
+    float min_dist_2 = 999999.0f*999999.0f;
+    for (int r = 0; r <= max_ring; r++)
+    {
+        // The quads of ring r and further are at least r-1 cells away
+        if (min_sector != UNKNOWN_SECTOR && r > 1)
+        {
+            float d = (r - 1) * m_grid_cell_size;
+            if (d * d > min_dist_2)
+                break;
+        }
+        for (int z = cz - r; z <= cz + r; z++)
+        {
+            if (z < 0 || z >= m_grid_height)
+                continue;
+            // Only the first and last cell of inner rows are in the ring
+            int step = (z == cz - r || z == cz + r) ? 1 : std::max(2 * r, 1);
+            for (int x = cx - r; x <= cx + r; x += step)
+            {
+                if (x < 0 || x >= m_grid_width)
+                    continue;
+                const unsigned int cell = z * m_grid_width + x;
+                for (unsigned int i = m_grid_offsets[cell];
+                     i < m_grid_offsets[cell + 1]; i++)
+                {
+                    const int node = (int)m_grid_nodes[i];
+                    const Quad* q = m_all_nodes[node];
+                    if (q->isIgnored())
+                        continue;
+                    const int rank = node >= start ? node - start
+                                                   : node - start + n;
+                    float dist_2 = q->getDistance2FromPoint(xyz);
+                    if (dist_2 > min_dist_2 ||
+                        (dist_2 == min_dist_2 &&
+                         (min_sector == UNKNOWN_SECTOR || rank >= min_rank)))
+                        continue;
+                    // Same height test as findOutOfRoadSector
+                    float dist = xyz.getY() - q->getMinHeight();
+                    if (phase == 1 || (dist < 5.0f && dist>-1.0f) ||
+                        q->is3DQuad() || ignore_vertical)
+                    {
+                        min_dist_2 = dist_2;
+                        min_sector = node;
+                        min_rank   = rank;
+                    }
+                }
+            }
+        }
+    }
+    return min_sector;
+}   // findOutOfRoadSectorInGrid
+
+//-----------------------------------------------------------------------------
+/** Compares the sector lookup using the grid with testing all quads, for
+ *  count random points around the quads of this graph.
+ *  \param grid_time Returns the time in seconds of the lookups with grid.
+ *  \param linear_time Returns the time in seconds without grid.
+ *  \return The number of lookups with different results.
+ */
+unsigned int Graph::compareSectorLookup(unsigned int count, double* grid_time,
+                                        double* linear_time)
+{
+    *grid_time = *linear_time = 0.0;
+    if (m_all_nodes.empty())
+        return 0;
+
+    // Points on, above, below and next to random quads, with a random
+    // previous sector (unknown for a quarter of them)
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+    std::vector<Vec3> points(count);
+    std::vector<int> previous(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const Quad* q = m_all_nodes[random() % m_all_nodes.size()];
+        float w = (random() % 1000) / 1000.0f;
+        Vec3 p = (*q)[random() % 4] * w + q->getCenter() * (1.0f - w);
+        points[i] = p + Vec3(i % 2 ? offset(random) : 0.0f,
+                             offset(random) * 0.5f,
+                             i % 2 ? offset(random) : 0.0f);
+        previous[i] = random() % 4 == 0 ? UNKNOWN_SECTOR
+                                        : random() % m_all_nodes.size();
+    }
+
+    std::vector<int> results[2];
+    double times[2];
+    // Run without grid first by moving it out temporarily
+    std::vector<unsigned int> grid_offsets;
+    grid_offsets.swap(m_grid_offsets);
+    for (int with_grid = 0; with_grid < 2; with_grid++)
+    {
+        if (with_grid)
+            grid_offsets.swap(m_grid_offsets);
+        results[with_grid].resize(count * 2);
+        double start = StkTime::getRealTime();
+        for (unsigned int i = 0; i < count; i++)
+        {
+            int sector = UNKNOWN_SECTOR;
+            findRoadSector(points[i], &sector);
+            results[with_grid][i * 2] = sector;
+            results[with_grid][i * 2 + 1] =
+                findOutOfRoadSector(points[i], previous[i]);
+        }
+        times[with_grid] = StkTime::getRealTime() - start;
+    }
+    *linear_time = times[0];
+    *grid_time   = times[1];
+
+    unsigned int mismatches = 0;
+    for (unsigned int i = 0; i < count * 2; i++)
+    {
+        if (results[0][i] != results[1][i])
+            mismatches++;
+    }
+    return mismatches;
+}   // compareSectorLookup
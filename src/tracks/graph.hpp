@@ -66,6 +66,8 @@ protected:
     // ------------------------------------------------------------------------
     /** Map 4 bounding box points to 4 closest graph nodes. */
     void loadBoundingBoxNodes();
+    // ------------------------------------------------------------------------
+    void buildSpatialGrid();
 
 private:
     /** The 2d bounding box, used for hashing. */
@@ -75,6 +77,23 @@ private:
     /** The 4 closest graph nodes to the bounding box. */
     int m_bb_nodes[4];
 
+    /** Uniform grid on the XZ plane over the bounding boxes of all quads,
+     *  used to find the candidates of findRoadSector and findOutOfRoadSector
+     *  without testing every quad. The quads of cell i are
+     *  m_grid_nodes[m_grid_offsets[i]] to m_grid_nodes[m_grid_offsets[i+1]-1]
+     *  in increasing order, the grid is empty until buildSpatialGrid. */
+    std::vector<unsigned int> m_grid_offsets;
+    std::vector<unsigned int> m_grid_nodes;
+
+    /** Minimum X and Z and size of the cells of the grid. */
+    float m_grid_min_x;
+    float m_grid_min_z;
+    float m_grid_cell_size;
+
+    /** Number of cells along X and Z. */
+    int m_grid_width;
+    int m_grid_height;
+
     /** The node of the graph mesh. */
     scene::ISceneNode *m_node;
 
@@ -106,6 +125,14 @@ private:
     virtual bool hasLapLine() const = 0;
     // ------------------------------------------------------------------------
     virtual void differentNodeColor(int n, video::SColor* c) const = 0;
+    // ------------------------------------------------------------------------
+    bool getGridCell(const Vec3& xyz, int* x, int* z) const;
+    // ------------------------------------------------------------------------
+    int findRoadSectorInGrid(const Vec3& xyz, int start,
+                             bool ignore_vertical) const;
+    // ------------------------------------------------------------------------
+    int findOutOfRoadSectorInGrid(const Vec3& xyz, int start, int phase,
+                                  bool ignore_vertical) const;
 
 public:
     static const int UNKNOWN_SECTOR;
@@ -172,6 +199,9 @@ public:
     const Vec3& getBBMax() const                           { return m_bb_max; }
     // ------------------------------------------------------------------------
     const int* getBBNodes() const                        { return m_bb_nodes; }
+    // ------------------------------------------------------------------------
+    unsigned int compareSectorLookup(unsigned int count, double* grid_time,
+                                     double* linear_time);
 
 };   // Graph
 
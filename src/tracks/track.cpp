@@ -61,6 +61,8 @@
 #include "modes/linear_world.hpp"
 #include "modes/easter_egg_hunt.hpp"
 #include "network/network_config.hpp"
+#include "network/network_string.hpp"
+#include "network/server_config.hpp"
 #include "network/protocols/game_protocol.hpp"
 #include "network/protocols/server_lobby.hpp"
 #include "physics/physical_object.hpp"
@@ -95,6 +97,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <set>
 #include <stdexcept>
 #include <sstream>
 #include <wchar.h>
@@ -110,9 +113,16 @@ using namespace irr;
 const float Track::NOHIT               = -99999.9f;
 bool        Track::m_dont_load_navmesh = false;
 std::atomic<Track*> Track::m_current_track[PT_COUNT];
+std::list<Track*> Track::m_resident_tracks;
+size_t      Track::m_all_resident_bytes = 0;
 
 // ----------------------------------------------------------------------------
-Track::Track(const std::string &filename)
+/** Creates a track from its track.xml file.
+ *  \param filename Path of the track.xml file.
+ *  \param info If not NULL, the track information saved by saveTrackInfo
+ *         is used instead of reading track.xml.
+ */
+Track::Track(const std::string &filename, const BareNetworkString* info)
 {
 #ifdef DEBUG
     m_magic_number          = 0x17AC3802;
@@ -174,6 +184,7 @@ Track::Track(const std::string &filename)
     m_weather_sound         = "";
     m_cache_track           = UserConfigParams::m_cache_overworld &&
                               m_ident=="overworld";
+    m_resident_bytes        = 0;
     m_render_target         = NULL;
     m_check_manager         = NULL;
     m_minimap_x_scale       = 1.0f;
@@ -187,7 +198,7 @@ Track::Track(const std::string &filename)
     m_all_nodes.clear();
     m_static_physics_only_nodes.clear();
     m_all_cached_meshes.clear();
-    loadTrackInfo();
+    loadTrackInfo(info);
 }   // Track
 
 //-----------------------------------------------------------------------------
@@ -197,6 +208,7 @@ Track::~Track()
     // Note that the music information in m_music is globally managed
     // by the music_manager, and is freed there. So no need to free it
     // here (esp. since various track might share the same music).
+    releaseResidentMeshes();
 #ifdef DEBUG
     assert(m_magic_number == 0x17AC3802);
     m_magic_number = 0xDEADBEEF;
@@ -398,6 +410,8 @@ void Track::cleanup()
     // than once are in m_all_cached_mesh more than once (which is easier
     // than storing the mesh only once, but then having to test for each
     // mesh if it is already contained in the list or not).
+    if (isResidentEnabled() && STKProcess::getType() == PT_MAIN)
+        makeResident();
     for (unsigned int i = 0; i < m_all_cached_meshes.size(); i++)
     {
         irr_driver->dropAllTextures(m_all_cached_meshes[i]);
@@ -420,7 +434,9 @@ void Track::cleanup()
     for (unsigned int i = 0; i < m_detached_cached_meshes.size(); i++)
     {
         irr_driver->dropAllTextures(m_detached_cached_meshes[i]);
-        irr_driver->removeMeshFromCache(m_detached_cached_meshes[i]);
+        // Resident meshes must stay in the cache to be found next time
+        if (m_resident_meshes.empty())
+            irr_driver->removeMeshFromCache(m_detached_cached_meshes[i]);
     }
     m_detached_cached_meshes.clear();
 
@@ -516,7 +532,7 @@ void Track::cleanup()
 }   // cleanup
 
 //-----------------------------------------------------------------------------
-void Track::loadTrackInfo()
+void Track::loadTrackInfo(const BareNetworkString* info)
 {
     // Default values
     m_use_fog               = false;
@@ -540,6 +556,11 @@ void Track::loadTrackInfo()
     irr_driver->setSSAORadius(1.);
     irr_driver->setSSAOK(1.5);
     irr_driver->setSSAOSigma(1.);
+    if (info)
+    {
+        readTrackInfo(*info);
+        return;
+    }
     XMLNode *root           = file_manager->createXMLTree(m_filename);
 
     if(!root || root->getName()!="track")
@@ -556,8 +577,7 @@ void Track::loadTrackInfo()
     m_designer = StringUtils::xmlDecode(designer);
 
     root->get("version",               &m_version);
-    std::vector<std::string> filenames;
-    root->get("music",                 &filenames);
+    root->get("music",                 &m_music_files);
     root->get("screenshot",            &m_screenshot);
     root->get("gravity",               &m_gravity);
     root->get("friction",              &m_friction);
@@ -579,7 +599,7 @@ void Track::loadTrackInfo()
     root->get("color-level-in",        &m_color_inlevel);
     root->get("color-level-out",       &m_color_outlevel);
 
-    getMusicInformation(filenames, m_music);
+    getMusicInformation(m_music_files, m_music);
     if (m_default_number_of_laps <= 0)
         m_default_number_of_laps = 3;
     m_actual_number_of_laps = m_default_number_of_laps;
@@ -659,6 +679,127 @@ void Track::loadTrackInfo()
 
 }   // loadTrackInfo
 
+//-----------------------------------------------------------------------------
+/** Saves the information read by loadTrackInfo, so the track can be created
+ *  again without reading its xml files (see TrackManager).
+ *  \return False if the track can't be saved, e.g. it has curves.
+ */
+bool Track::saveTrackInfo(BareNetworkString* info) const
+{
+    std::string screenshot = m_screenshot;
+    if (!screenshot.empty())
+    {
+        if (!StringUtils::startsWith(screenshot, m_root))
+            return false;
+        screenshot = screenshot.substr(m_root.size());
+    }
+    std::vector<std::string> strings = { m_name, screenshot,
+        StringUtils::wideToUtf8(m_designer) };
+    strings.insert(strings.end(), m_music_files.begin(), m_music_files.end());
+    strings.insert(strings.end(), m_groups.begin(), m_groups.end());
+    for (const TrackMode& tm : m_all_modes)
+    {
+        strings.push_back(tm.m_name);
+        strings.push_back(tm.m_quad_name);
+        strings.push_back(tm.m_graph_name);
+        strings.push_back(tm.m_scene);
+    }
+    // Strings are saved with a 8 bit length
+    for (const std::string& str : strings)
+    {
+        if (str.size() > 255)
+            return false;
+    }
+    if (!m_all_curves.empty() || m_music_files.size() > 255 ||
+        m_groups.size() > 255 || m_all_modes.size() > 255)
+        return false;
+
+    info->encodeString(m_name).encodeString(strings[2])
+        .addUInt32(m_version).addUInt8((uint8_t)m_music_files.size());
+    for (const std::string& music : m_music_files)
+        info->encodeString(music);
+    info->encodeString(screenshot).addFloat(m_gravity).addFloat(m_friction)
+        .addUInt8(m_is_soccer).addUInt8(m_is_arena).addUInt8(m_is_ctf)
+        .addUInt32(m_max_arena_players).addUInt8(m_is_cutscene)
+        .addUInt8((uint8_t)m_groups.size());
+    for (const std::string& group : m_groups)
+        info->encodeString(group);
+    info->addUInt8(m_internal).addUInt8(m_reverse_available)
+        .addUInt32(m_default_number_of_laps).addUInt8(m_enable_push_back)
+        .addUInt8(m_bloom).addFloat(m_bloom_threshold).addUInt8(m_shadows)
+        .addUInt8(m_is_day).addFloat(m_displacement_speed)
+        .addFloat(m_color_inlevel.X).addFloat(m_color_inlevel.Y)
+        .addFloat(m_color_inlevel.Z).addFloat(m_color_outlevel.X)
+        .addFloat(m_color_outlevel.Y).addUInt8(m_enable_auto_rescue)
+        .addUInt8(m_smooth_normals).addUInt8((uint8_t)m_all_modes.size());
+    for (const TrackMode& tm : m_all_modes)
+    {
+        info->encodeString(tm.m_name).encodeString(tm.m_quad_name)
+            .encodeString(tm.m_graph_name).encodeString(tm.m_scene);
+    }
+    info->addUInt8(m_has_easter_eggs)
+        .addUInt8(file_manager->fileExists(m_root + "navmesh.xml"));
+    return true;
+}   // saveTrackInfo
+
+//-----------------------------------------------------------------------------
+/** Reads the information saved by saveTrackInfo, it throws if info is too
+ *  short.
+ */
+void Track::readTrackInfo(const BareNetworkString& info)
+{
+    std::string designer;
+    info.decodeString(&m_name);
+    info.decodeString(&designer);
+    m_designer = StringUtils::utf8ToWide(designer);
+    m_version = info.getUInt32();
+    m_music_files.resize(info.getUInt8());
+    for (std::string& music : m_music_files)
+        info.decodeString(&music);
+    info.decodeString(&m_screenshot);
+    if (!m_screenshot.empty())
+        m_screenshot = m_root + m_screenshot;
+    m_gravity = info.getFloat();
+    m_friction = info.getFloat();
+    m_is_soccer = info.getUInt8() != 0;
+    m_is_arena = info.getUInt8() != 0;
+    m_is_ctf = info.getUInt8() != 0;
+    m_max_arena_players = info.getUInt32();
+    m_is_cutscene = info.getUInt8() != 0;
+    m_groups.resize(info.getUInt8());
+    for (std::string& group : m_groups)
+        info.decodeString(&group);
+    m_internal = info.getUInt8() != 0;
+    m_reverse_available = info.getUInt8() != 0;
+    m_default_number_of_laps = info.getUInt32();
+    m_enable_push_back = info.getUInt8() != 0;
+    m_bloom = info.getUInt8() != 0;
+    m_bloom_threshold = info.getFloat();
+    m_shadows = info.getUInt8() != 0;
+    m_is_day = info.getUInt8() != 0;
+    m_displacement_speed = info.getFloat();
+    m_color_inlevel.X = info.getFloat();
+    m_color_inlevel.Y = info.getFloat();
+    m_color_inlevel.Z = info.getFloat();
+    m_color_outlevel.X = info.getFloat();
+    m_color_outlevel.Y = info.getFloat();
+    m_enable_auto_rescue = info.getUInt8() != 0;
+    m_smooth_normals = info.getUInt8() != 0;
+    m_all_modes.resize(info.getUInt8());
+    for (TrackMode& tm : m_all_modes)
+    {
+        info.decodeString(&tm.m_name);
+        info.decodeString(&tm.m_quad_name);
+        info.decodeString(&tm.m_graph_name);
+        info.decodeString(&tm.m_scene);
+    }
+    m_has_easter_eggs = info.getUInt8() != 0;
+    m_has_navmesh = info.getUInt8() != 0 && !m_dont_load_navmesh;
+
+    getMusicInformation(m_music_files, m_music);
+    m_actual_number_of_laps = m_default_number_of_laps;
+}   // readTrackInfo
+
 //-----------------------------------------------------------------------------
 /** Loads all curves from the XML node.
  */
@@ -925,7 +1066,11 @@ void Track::createPhysicsModel(unsigned int main_track_count,
     if (for_height_map)
         m_track_mesh->createCollisionShape();
     else
-        m_track_mesh->createPhysicalBody(m_friction);
+    {
+        m_track_mesh->createPhysicalBody(m_friction,
+            (btCollisionObject::CollisionFlags)0,
+            getPhysicsCacheFile().c_str());
+    }
     main_loop->renderGUI(5585);
     if (m_gfx_effect_mesh)
         m_gfx_effect_mesh->createCollisionShape();
@@ -933,6 +1078,21 @@ void Track::createPhysicsModel(unsigned int main_track_count,
 
 }   // createPhysicsModel
 
+// -----------------------------------------------------------------------------
+/** Returns the file in which the bhv of the track mesh is cached. Objects
+ *  joined to the track mesh can depend on the race mode and direction, so
+ *  each of them has its own file. The file also stores a hash of the
+ *  triangles, so a changed track rebuilds it.
+ */
+std::string Track::getPhysicsCacheFile() const
+{
+    std::string name = m_ident + "_" +
+        RaceManager::getIdentOf(RaceManager::get()->getMinorMode());
+    if (RaceManager::get()->getReverseTrack())
+        name += "_reverse";
+    return file_manager->getCachedPhysicsDir() + name + ".bvh";
+}   // getPhysicsCacheFile
+
 // -----------------------------------------------------------------------------
 
 
@@ -1531,8 +1691,9 @@ bool Track::loadMainTrack(const XMLNode &root)
         main_loop->renderGUI(4400, i, m_all_nodes.size());
     }
 
-    // Free the tangent (track mesh) after converting to physics
-    if (GUIEngine::isNoGraphics())
+    // Free the tangent (track mesh) after converting to physics, unless it
+    // is kept for the next race
+    if (GUIEngine::isNoGraphics() && !isResidentEnabled())
         tangent_mesh->freeMeshVertexBuffer();
 
     if (m_track_mesh == NULL)
@@ -1551,13 +1712,105 @@ bool Track::loadMainTrack(const XMLNode &root)
 // ----------------------------------------------------------------------------
 void Track::freeCachedMeshVertexBuffer()
 {
-    if (GUIEngine::isNoGraphics())
+    if (GUIEngine::isNoGraphics() && !isResidentEnabled())
     {
         for (unsigned i = 0; i < m_all_cached_meshes.size(); i++)
             m_all_cached_meshes[i]->freeMeshVertexBuffer();
     }
 }   // freeCachedMeshVertexBuffer
 
+// ----------------------------------------------------------------------------
+/** Returns true if the meshes of tracks are kept loaded between races, see
+ *  makeResident. This is only done in server-only builds: the meshes of
+ *  graphical builds keep pointers to the temporary materials of a track,
+ *  which are freed after each race.
+ */
+bool Track::isResidentEnabled()
+{
+#ifdef SERVER_ONLY
+    return ServerConfig::m_resident_tracks_memory > 0;
+#else
+    return false;
+#endif
+}   // isResidentEnabled
+
+// ----------------------------------------------------------------------------
+/** Called at cleanup to keep the meshes of this race loaded, so loading this
+ *  track again takes them from irrlicht's mesh cache. The least recently
+ *  used tracks are released when more than resident-tracks-memory
+ *  megabytes are resident.
+ */
+void Track::makeResident()
+{
+    std::vector<scene::IMesh*> meshes;
+    std::set<scene::IMesh*> added;
+    size_t bytes = 0;
+    for (unsigned int i = 0;
+        i < m_all_cached_meshes.size() + m_detached_cached_meshes.size(); i++)
+    {
+        scene::IMesh* mesh = i < m_all_cached_meshes.size() ?
+            m_all_cached_meshes[i] :
+            m_detached_cached_meshes[i - m_all_cached_meshes.size()];
+        if (!added.insert(mesh).second)
+            continue;
+        mesh->grab();
+        irr_driver->grabAllTextures(mesh);
+        meshes.push_back(mesh);
+        for (unsigned int j = 0; j < mesh->getMeshBufferCount(); j++)
+        {
+            scene::IMeshBuffer* mb = mesh->getMeshBuffer(j);
+            bytes += mb->getVertexCount() *
+                video::getVertexPitchFromType(mb->getVertexType());
+            bytes += mb->getIndexCount() *
+                (mb->getIndexType() == video::EIT_16BIT ? 2 : 4);
+        }
+    }
+    // The meshes of the previous race of this track are grabbed again above,
+    // so releasing them does not remove them from the cache
+    releaseResidentMeshes();
+    m_resident_meshes.swap(meshes);
+    m_resident_bytes = bytes;
+    m_all_resident_bytes += bytes;
+    m_resident_tracks.push_front(this);
+
+    const size_t budget =
+        (size_t)ServerConfig::m_resident_tracks_memory * 1024 * 1024;
+    while (m_all_resident_bytes > budget && !m_resident_tracks.empty())
+    {
+        Track* track = m_resident_tracks.back();
+        Log::info("Track", "Releasing resident meshes of '%s'.",
+            track->getIdent().c_str());
+        track->releaseResidentMeshes();
+    }
+}   // makeResident
+
+// ----------------------------------------------------------------------------
+/** Releases the meshes kept by makeResident, they are removed from the mesh
+ *  cache if no other track uses them.
+ */
+void Track::releaseResidentMeshes()
+{
+    if (m_resident_meshes.empty())
+        return;
+    for (unsigned int i = 0; i < m_resident_meshes.size(); i++)
+    {
+        scene::IMesh* mesh = m_resident_meshes[i];
+        irr_driver->dropAllTextures(mesh);
+        if (mesh->getReferenceCount() == 1)
+        {
+            mesh->drop();
+            continue;
+        }
+        mesh->drop();
+        if (mesh->getReferenceCount() == 1)
+            irr_driver->removeMeshFromCache(mesh);
+    }
+    m_resident_meshes.clear();
+    m_all_resident_bytes -= m_resident_bytes;
+    m_resident_bytes = 0;
+    m_resident_tracks.remove(this);
+}   // releaseResidentMeshes
+
 // ----------------------------------------------------------------------------
 /** Handles animated textures.
  *  \param node The scene node for which animated textures are handled.
@@ -2954,6 +3207,10 @@ void Track::copyFromMainProcess()
     m_all_cached_meshes.shrink_to_fit();
     m_detached_cached_meshes.clear();
     m_detached_cached_meshes.shrink_to_fit();
+    // Resident meshes belong to the main process track
+    m_resident_meshes.clear();
+    m_resident_meshes.shrink_to_fit();
+    m_resident_bytes = 0;
     m_sky_textures.clear();
     m_sky_textures.shrink_to_fit();
     m_spherical_harmonics_textures.clear();
@@ -3013,7 +3270,8 @@ void Track::initChildTrack()
 
     // We call physics init in child process too
     Physics::get()->init(m_aabb_min, m_aabb_max);
-    m_track_mesh->createPhysicalBody(m_friction);
+    m_track_mesh->createPhysicalBody(m_friction,
+        (btCollisionObject::CollisionFlags)0, getPhysicsCacheFile().c_str());
     m_gfx_effect_mesh->createCollisionShape();
 
     // All child track objects are only cloned if they have physical objects
@@ -28,6 +28,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <list>
 #include <memory>
 #include <string>
 #include <vector>
@@ -59,6 +60,7 @@ using namespace irr;
 
 class AbstractKart;
 class AnimationManager;
+class BareNetworkString;
 class BezierCurve;
 class CheckManager;
 class ItemManager;
@@ -189,6 +191,20 @@ private:
      *  for the overworld. */
     bool m_cache_track;
 
+    /** Meshes kept loaded after the last race of this track on servers
+     *  without graphics (grabbed and left in irrlicht's mesh cache), so
+     *  the next load of the track does not read them from disk again. */
+    std::vector<scene::IMesh*>      m_resident_meshes;
+
+    /** Estimated memory of the vertices and indices of m_resident_meshes. */
+    size_t m_resident_bytes;
+
+    /** Tracks with resident meshes, most recently used first. */
+    static std::list<Track*> m_resident_tracks;
+
+    /** Sum of m_resident_bytes of all tracks. */
+    static size_t m_all_resident_bytes;
+
 
 #ifdef DEBUG
     /** A list of textures that were cached before the track is loaded.
@@ -409,7 +425,11 @@ private:
     /** The number of laps that is predefined in a track info dialog. */
     int m_actual_number_of_laps;
 
-    void loadTrackInfo();
+    /** Music files in track.xml, relative to the track directory. */
+    std::vector<std::string> m_music_files;
+
+    void loadTrackInfo(const BareNetworkString* info);
+    void readTrackInfo(const BareNetworkString& info);
     void loadDriveGraph(unsigned int mode_id, const bool reverse);
     void loadArenaGraph(const XMLNode &node);
     btQuaternion getArenaStartRotation(const Vec3& xyz, float heading);
@@ -421,6 +441,9 @@ private:
     void loadCurves(const XMLNode &node);
     void handleSky(const XMLNode &root, const std::string &filename);
     void freeCachedMeshVertexBuffer();
+    static bool isResidentEnabled();
+    void makeResident();
+    void releaseResidentMeshes();
     void copyFromMainProcess();
     video::IImage* getSkyTexture(std::string path) const;
 public:
@@ -456,9 +479,11 @@ public:
 
     static const float NOHIT;
 
-                       Track             (const std::string &filename);
+                       Track             (const std::string &filename,
+                                          const BareNetworkString* info = NULL);
                       ~Track             ();
     void               cleanup           ();
+    bool               saveTrackInfo     (BareNetworkString* info) const;
     void               removeCachedData  ();
     void               startMusic        () const;
 
@@ -744,6 +769,8 @@ public:
     // ------------------------------------------------------------------------
     void convertTrackToBullet(scene::ISceneNode *node);
     // ------------------------------------------------------------------------
+    std::string getPhysicsCacheFile() const;
+    // ------------------------------------------------------------------------
     CheckManager* getCheckManager() const           { return m_check_manager; }
     // ------------------------------------------------------------------------
     ItemManager* getItemManager() const        { return m_item_manager.get(); }
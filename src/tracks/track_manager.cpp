@@ -21,13 +21,17 @@
 #include "config/stk_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "io/file_manager.hpp"
+#include "network/network_string.hpp"
 #include "tracks/track.hpp"
+#include "utils/constants.hpp"
+#include "utils/file_utils.hpp"
 
 #include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <stdio.h>
+#include <sys/stat.h>
 
 #include <IFileSystem.h>
 #include <ITexture.h>
@@ -43,7 +47,10 @@ std::vector<std::string>  TrackManager::m_track_search_path;
 /** Constructor (currently empty). The real work happens in loadTrackList.
  */
 TrackManager::TrackManager()
-{}   // TrackManager
+{
+    m_manifest_loaded = false;
+    m_manifest_changed = false;
+}   // TrackManager
 
 //-----------------------------------------------------------------------------
 /** Delete all tracks.
@@ -91,14 +98,10 @@ int TrackManager::getNumberOfRaceTracks() const
  */
 Track* TrackManager::getTrack(const std::string& ident) const
 {
-    for(Tracks::const_iterator i = m_tracks.begin(); i != m_tracks.end(); ++i)
-    {
-        if ((*i)->getIdent() == ident)
-            return *i;
-    }
-
-    return NULL;
-
+    auto it = m_track_indices.find(ident);
+    if (it == m_track_indices.end())
+        return NULL;
+    return m_tracks[it->second];
 }   // getTrack
 
 //-----------------------------------------------------------------------------
@@ -158,12 +161,21 @@ void TrackManager::loadTrackList()
     m_arena_groups.clear();
     m_soccer_arena_groups.clear();
     m_track_avail.clear();
+    m_track_indices.clear();
     // This function is called when install a new addons, delete previous
     // tracks
     for (Track* track : m_tracks)
         delete track;
     m_tracks.clear();
 
+    if (!m_manifest_loaded)
+    {
+        loadManifest();
+        m_manifest_loaded = true;
+    }
+    for (auto& entry : m_manifest)
+        entry.second.m_used = false;
+
     for(unsigned int i=0; i<m_track_search_path.size(); i++)
     {
         const std::string &dir = m_track_search_path[i];
@@ -174,15 +186,27 @@ void TrackManager::loadTrackList()
 
         // Then see if a subdir of this dir contains tracks
         // ------------------------------------------------
-        std::set<std::string> dirs;
-        file_manager->listFiles(dirs, dir);
-        for(std::set<std::string>::iterator subdir = dirs.begin();
-            subdir != dirs.end(); subdir++)
-        {
-            if(*subdir=="." || *subdir=="..") continue;
-            loadTrack(dir+*subdir+"/");
-        }   // for dir in dirs
+        const std::vector<std::string>& dirs = getSubdirs(dir);
+        for (const std::string& subdir : dirs)
+            loadTrack(dir + subdir + "/");
     }   // for i <m_track_search_path.size()
+
+    // Remove the directories which don't exist anymore
+    for (auto it = m_manifest.begin(); it != m_manifest.end();)
+    {
+        if (it->second.m_used)
+        {
+            it++;
+            continue;
+        }
+        it = m_manifest.erase(it);
+        m_manifest_changed = true;
+    }
+    if (m_manifest_changed)
+    {
+        saveManifest();
+        m_manifest_changed = false;
+    }
     updateScreenshotCache();
     onDemandLoadTrackScreenshots();
 }  // loadTrackList
@@ -195,20 +219,89 @@ void TrackManager::loadTrackList()
 bool TrackManager::loadTrack(const std::string& dirname)
 {
     std::string config_file = dirname+"track.xml";
+
+    // Compare the directory and the xml files with the manifest, so an
+    // unchanged track is created without reading its xml files
+    ManifestEntry files;
+    struct stat st;
+    if (FileUtils::statU8Path(dirname, &st) == 0)
+        files.m_mtime = (uint64_t)st.st_mtime;
+    if (FileUtils::statU8Path(config_file, &st) == 0)
+    {
+        files.m_xml_mtime = (uint64_t)st.st_mtime;
+        files.m_xml_size = (uint64_t)st.st_size;
+    }
+    if (FileUtils::statU8Path(dirname + "easter_eggs.xml", &st) == 0)
+    {
+        files.m_easter_mtime = (uint64_t)st.st_mtime;
+        files.m_easter_size = (uint64_t)st.st_size;
+    }
+    ManifestEntry& entry = m_manifest[dirname];
+    entry.m_used = true;
+    const bool unchanged = entry.hasSameFiles(files);
+    if (unchanged && !entry.m_is_track)
+        return false;
+    if (!unchanged)
+    {
+        entry.m_mtime = files.m_mtime;
+        entry.m_xml_mtime = files.m_xml_mtime;
+        entry.m_xml_size = files.m_xml_size;
+        entry.m_easter_mtime = files.m_easter_mtime;
+        entry.m_easter_size = files.m_easter_size;
+        entry.m_is_track = false;
+        entry.m_info.clear();
+        entry.m_has_subdirs = false;
+        entry.m_subdirs.clear();
+        setManifestChanged(dirname);
+    }
+
     if(!file_manager->fileExists(config_file))
         return false;
 
-    Track *track;
+    Track *track = NULL;
 
-    try
+    if (unchanged && !entry.m_info.empty())
     {
-        track = new Track(config_file);
+        try
+        {
+            BareNetworkString info(entry.m_info.data(),
+                (int)entry.m_info.size());
+            track = new Track(config_file, &info);
+        }
+        catch (std::exception& e)
+        {
+            Log::warn("TrackManager", "Cannot use track manifest for <%s> : "
+                "%s", dirname.c_str(), e.what());
+            delete track;
+            track = NULL;
+            entry.m_info.clear();
+            setManifestChanged(dirname);
+        }
     }
-    catch (std::exception& e)
+
+    if (!track)
     {
-        Log::error("TrackManager", "Cannot load track <%s> : %s\n",
-                dirname.c_str(), e.what());
-        return false;
+        try
+        {
+            track = new Track(config_file);
+        }
+        catch (std::exception& e)
+        {
+            Log::error("TrackManager", "Cannot load track <%s> : %s\n",
+                    dirname.c_str(), e.what());
+            return false;
+        }
+        // A track which cannot be saved in the manifest is read from its
+        // files at each start, which doesn't change the manifest
+        BareNetworkString info;
+        std::string new_info;
+        if (track->saveTrackInfo(&info))
+            new_info.assign(info.getData(), info.getTotalSize());
+        if (new_info != entry.m_info)
+        {
+            entry.m_info = new_info;
+            setManifestChanged(dirname);
+        }
     }
 
     if (track->getVersion()<stk_config->m_min_track_version ||
@@ -223,13 +316,191 @@ bool TrackManager::loadTrack(const std::string& dirname)
         delete track;
         return false;
     }
+    entry.m_is_track = true;
     m_all_track_dirs.push_back(dirname);
     m_tracks.push_back(track);
     m_track_avail.push_back(true);
+    m_track_indices.emplace(track->getIdent(), (int)m_tracks.size() - 1);
     updateGroups(track);
     return true;
 }   // loadTrack
 
+// ----------------------------------------------------------------------------
+/** Returns the subdirectories of a track search directory, which are taken
+ *  from the manifest if the directory wasn't changed.
+ *  \param dir The track search directory, loadTrack must have been called
+ *         for it before.
+ */
+const std::vector<std::string>& TrackManager::getSubdirs(const std::string& dir)
+{
+    ManifestEntry& entry = m_manifest[dir];
+    if (entry.m_has_subdirs)
+        return entry.m_subdirs;
+
+    std::set<std::string> dirs;
+    file_manager->listFiles(dirs, dir);
+    entry.m_subdirs.clear();
+    for (const std::string& subdir : dirs)
+    {
+        if (subdir == "." || subdir == "..")
+            continue;
+        entry.m_subdirs.push_back(subdir);
+    }
+    entry.m_has_subdirs = true;
+    setManifestChanged(dir);
+    return entry.m_subdirs;
+}   // getSubdirs
+
+// ----------------------------------------------------------------------------
+/** Marks the manifest to be saved after a change of the entry of a
+ *  directory. Entries which are not saved by saveManifest don't change it,
+ *  otherwise the manifest would be written at each start.
+ *  \param dir The directory of the changed entry.
+ */
+void TrackManager::setManifestChanged(const std::string& dir)
+{
+    if (canSaveManifestEntry(dir, m_manifest[dir]))
+        m_manifest_changed = true;
+}   // setManifestChanged
+
+// ----------------------------------------------------------------------------
+/** Returns if an entry can be saved in the manifest, strings are saved with
+ *  a 8 bit length.
+ */
+bool TrackManager::canSaveManifestEntry(const std::string& dir,
+                                        const ManifestEntry& entry)
+{
+    if (dir.size() > 255)
+        return false;
+    for (const std::string& subdir : entry.m_subdirs)
+    {
+        if (subdir.size() > 255)
+            return false;
+    }
+    return true;
+}   // canSaveManifestEntry
+
+// ----------------------------------------------------------------------------
+/** Reads the track manifest written by saveManifest. A manifest written by
+ *  another version of STK is ignored, because the saved track information
+ *  may be different.
+ */
+void TrackManager::loadManifest()
+{
+    m_manifest.clear();
+    const std::string path =
+        file_manager->getUserConfigFile("track_manifest.bin");
+    FILE* fp = FileUtils::fopenU8Path(path, "rb");
+    if (!fp)
+        return;
+    std::string data;
+    char buf[4096];
+    size_t read;
+    while ((read = fread(buf, 1, sizeof(buf), fp)) > 0)
+        data.append(buf, read);
+    fclose(fp);
+
+    BareNetworkString ns(data.data(), (int)data.size());
+    try
+    {
+        std::string version;
+        if (ns.getUInt32() != 1)
+            return;
+        ns.decodeString(&version);
+        if (version != STK_VERSION)
+            return;
+        unsigned count = ns.getUInt32();
+        for (unsigned i = 0; i < count; i++)
+        {
+            std::string dir;
+            ns.decodeString(&dir);
+            ManifestEntry entry;
+            entry.m_mtime = ns.getUInt64();
+            entry.m_xml_mtime = ns.getUInt64();
+            entry.m_xml_size = ns.getUInt64();
+            entry.m_easter_mtime = ns.getUInt64();
+            entry.m_easter_size = ns.getUInt64();
+            entry.m_is_track = ns.getUInt8() != 0;
+            unsigned info_size = ns.getUInt32();
+            if (info_size > (unsigned)ns.size())
+                throw std::out_of_range("Track info size");
+            entry.m_info.assign(ns.getCurrentData(), info_size);
+            ns.skip(info_size);
+            entry.m_has_subdirs = ns.getUInt8() != 0;
+            entry.m_subdirs.resize(ns.getUInt32());
+            for (std::string& subdir : entry.m_subdirs)
+                ns.decodeString(&subdir);
+            m_manifest[dir] = entry;
+        }
+    }
+    catch (std::exception& e)
+    {
+        Log::warn("TrackManager", "Track manifest %s is invalid: %s",
+            path.c_str(), e.what());
+        m_manifest.clear();
+        return;
+    }
+    Log::info("TrackManager", "Loaded track manifest with %d directories.",
+        (int)m_manifest.size());
+}   // loadManifest
+
+// ----------------------------------------------------------------------------
+/** Saves the manifest, it is written to a temporary file first, so an
+ *  interrupted save doesn't leave a broken manifest.
+ */
+void TrackManager::saveManifest()
+{
+    BareNetworkString ns;
+    ns.addUInt32(1).encodeString(std::string(STK_VERSION));
+    unsigned count = 0;
+    BareNetworkString entries;
+    for (auto& p : m_manifest)
+    {
+        const ManifestEntry& entry = p.second;
+        if (!canSaveManifestEntry(p.first, entry))
+            continue;
+        entries.encodeString(p.first).addUInt64(entry.m_mtime)
+            .addUInt64(entry.m_xml_mtime).addUInt64(entry.m_xml_size)
+            .addUInt64(entry.m_easter_mtime).addUInt64(entry.m_easter_size)
+            .addUInt8(entry.m_is_track)
+            .addUInt32((uint32_t)entry.m_info.size());
+        entries += BareNetworkString(entry.m_info.data(),
+            (int)entry.m_info.size());
+        entries.addUInt8(entry.m_has_subdirs)
+            .addUInt32((uint32_t)entry.m_subdirs.size());
+        for (const std::string& subdir : entry.m_subdirs)
+            entries.encodeString(subdir);
+        count++;
+    }
+    ns.addUInt32(count);
+    ns += entries;
+
+    const std::string path =
+        file_manager->getUserConfigFile("track_manifest.bin");
+    const std::string tmp_path = FileUtils::getTempPath(path);
+    FILE* fp = FileUtils::fopenU8Path(tmp_path, "wb");
+    if (!fp)
+    {
+        Log::warn("TrackManager", "Cannot write track manifest %s.",
+            tmp_path.c_str());
+        return;
+    }
+    bool ok = fwrite(ns.getData(), 1, ns.getTotalSize(), fp) ==
+        (size_t)ns.getTotalSize();
+    ok &= fclose(fp) == 0;
+    if (ok)
+    {
+        file_manager->removeFile(path);
+        ok = FileUtils::renameU8Path(tmp_path, path) == 0;
+    }
+    if (!ok)
+    {
+        Log::warn("TrackManager", "Cannot write track manifest %s.",
+            path.c_str());
+        file_manager->removeFile(tmp_path);
+    }
+}   // saveManifest
+
 // ----------------------------------------------------------------------------
 /** Removes a track.
  *  \param ident Identifier of the track (i.e. the name of the directory).
@@ -301,9 +572,20 @@ void TrackManager::removeTrack(const std::string &ident)
     m_tracks.erase(it);
     m_all_track_dirs.erase(m_all_track_dirs.begin()+index);
     m_track_avail.erase(m_track_avail.begin()+index);
+    updateTrackIndices();
     delete track;
 }   // removeTrack
 
+// ----------------------------------------------------------------------------
+/** Rebuilds m_track_indices after tracks were moved in m_tracks.
+ */
+void TrackManager::updateTrackIndices()
+{
+    m_track_indices.clear();
+    for (unsigned i = 0; i < m_tracks.size(); i++)
+        m_track_indices.emplace(m_tracks[i]->getIdent(), (int)i);
+}   // updateTrackIndices
+
 // ----------------------------------------------------------------------------
 /** \brief Updates the groups after a track was read in.
   * \param track Pointer to the new track, whose groups are now analysed.
@@ -338,12 +620,8 @@ void TrackManager::updateGroups(const Track* track)
 // ----------------------------------------------------------------------------
 int TrackManager::getTrackIndexByIdent(const std::string& ident) const
 {
-    for (unsigned i = 0; i < m_tracks.size(); i++)
-    {
-        if (m_tracks[i]->getIdent() == ident)
-            return i;
-    }
-    return -1;
+    auto it = m_track_indices.find(ident);
+    return it == m_track_indices.end() ? -1 : it->second;
 }   // getTrackIndexByIdent
 
 // ----------------------------------------------------------------------------
@@ -19,7 +19,9 @@
 #ifndef HEADER_TRACK_MANAGER_HPP
 #define HEADER_TRACK_MANAGER_HPP
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <map>
 
@@ -67,7 +69,65 @@ private:
      */
     std::vector<bool>                        m_track_avail;
 
+    /** Index of each track in m_tracks by its identifier. */
+    std::unordered_map<std::string, int>     m_track_indices;
+
+    /** What loadTrack found in a directory, stored in the track manifest
+     *  file so unchanged directories are not read again at startup. */
+    struct ManifestEntry
+    {
+        /** Modification time of the directory. */
+        uint64_t    m_mtime;
+        /** Modification time and size of track.xml and easter_eggs.xml,
+         *  0 if the file doesn't exist. */
+        uint64_t    m_xml_mtime;
+        uint64_t    m_xml_size;
+        uint64_t    m_easter_mtime;
+        uint64_t    m_easter_size;
+        /** True if a track was loaded from the directory. */
+        bool        m_is_track;
+        /** Track information saved by Track::saveTrackInfo, empty if the
+         *  track has to be read from its files. */
+        std::string m_info;
+        /** True if m_subdirs is set, only for track search directories. */
+        bool        m_has_subdirs;
+        std::vector<std::string> m_subdirs;
+        /** True if the directory was used by the last loadTrackList, other
+         *  entries are removed. Not saved. */
+        bool        m_used;
+        // --------------------------------------------------------------------
+        ManifestEntry()
+        {
+            m_mtime = m_xml_mtime = m_xml_size = 0;
+            m_easter_mtime = m_easter_size = 0;
+            m_is_track = m_has_subdirs = m_used = false;
+        }
+        // --------------------------------------------------------------------
+        bool hasSameFiles(const ManifestEntry& other) const
+        {
+            return m_mtime == other.m_mtime &&
+                m_xml_mtime == other.m_xml_mtime &&
+                m_xml_size == other.m_xml_size &&
+                m_easter_mtime == other.m_easter_mtime &&
+                m_easter_size == other.m_easter_size;
+        }
+    };   // ManifestEntry
+
+    /** Manifest entries by directory. */
+    std::unordered_map<std::string, ManifestEntry> m_manifest;
+
+    bool          m_manifest_loaded;
+
+    bool          m_manifest_changed;
+
     void          updateGroups(const Track* track);
+    void          updateTrackIndices();
+    void          loadManifest();
+    void          saveManifest();
+    void          setManifestChanged(const std::string& dir);
+    static bool   canSaveManifestEntry(const std::string& dir,
+                                       const ManifestEntry& entry);
+    const std::vector<std::string>& getSubdirs(const std::string& dir);
 
 public:
                 TrackManager();
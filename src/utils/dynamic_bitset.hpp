@@ -0,0 +1,126 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_DYNAMIC_BITSET_HPP
+#define HEADER_DYNAMIC_BITSET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** A set of small non-negative integers stored as bits, which grows when a
+ *  larger integer is added. Intersections are done a word at a time.
+ * \ingroup utils
+ */
+class DynamicBitset
+{
+private:
+    std::vector<uint64_t> m_words;
+
+public:
+    // ------------------------------------------------------------------------
+    void set(size_t i)
+    {
+        if (i / 64 >= m_words.size())
+            m_words.resize(i / 64 + 1, 0);
+        m_words[i / 64] |= (uint64_t)1 << (i % 64);
+    }   // set
+    // ------------------------------------------------------------------------
+    void reset(size_t i)
+    {
+        if (i / 64 < m_words.size())
+            m_words[i / 64] &= ~((uint64_t)1 << (i % 64));
+    }   // reset
+    // ------------------------------------------------------------------------
+    bool test(size_t i) const
+    {
+        return i / 64 < m_words.size() &&
+            (m_words[i / 64] & ((uint64_t)1 << (i % 64))) != 0;
+    }   // test
+    // ------------------------------------------------------------------------
+    void clear()                                           { m_words.clear(); }
+    // ------------------------------------------------------------------------
+    bool none() const
+    {
+        for (uint64_t word : m_words)
+        {
+            if (word != 0)
+                return false;
+        }
+        return true;
+    }   // none
+    // ------------------------------------------------------------------------
+    size_t count() const
+    {
+        size_t count = 0;
+        for (uint64_t word : m_words)
+        {
+            while (word != 0)
+            {
+                word &= word - 1;
+                count++;
+            }
+        }
+        return count;
+    }   // count
+    // ------------------------------------------------------------------------
+    /** Returns the number of integers which are in both sets. */
+    size_t countCommon(const DynamicBitset& other) const
+    {
+        size_t count = 0;
+        const size_t words = m_words.size() < other.m_words.size() ?
+            m_words.size() : other.m_words.size();
+        for (size_t i = 0; i < words; i++)
+        {
+            uint64_t word = m_words[i] & other.m_words[i];
+            while (word != 0)
+            {
+                word &= word - 1;
+                count++;
+            }
+        }
+        return count;
+    }   // countCommon
+    // ------------------------------------------------------------------------
+    DynamicBitset& operator&=(const DynamicBitset& other)
+    {
+        if (m_words.size() > other.m_words.size())
+            m_words.resize(other.m_words.size());
+        for (size_t i = 0; i < m_words.size(); i++)
+            m_words[i] &= other.m_words[i];
+        return *this;
+    }   // operator&=
+    // ------------------------------------------------------------------------
+    /** Calls f with each integer in the set in increasing order. */
+    template<typename F> void forEach(F f) const
+    {
+        for (size_t i = 0; i < m_words.size(); i++)
+        {
+            uint64_t word = m_words[i];
+            for (size_t bit = 0; word != 0; bit++, word >>= 1)
+            {
+                if ((word & 1) != 0)
+                    f(i * 64 + bit);
+            }
+        }
+    }   // forEach
+
+};   // class DynamicBitset
+
+#endif // HEADER_DYNAMIC_BITSET_HPP
@@ -23,6 +23,12 @@
 #include <string>
 #include <sys/stat.h>
 
+#if defined(WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
 // ----------------------------------------------------------------------------
 #if defined(WIN32)
 #include <windows.h>
@@ -166,3 +172,18 @@ int FileUtils::renameU8Path(const std::string& u8_path_old,
     return rename(u8_path_old.c_str(), u8_path_new.c_str());
 #endif
 }   // renameU8Path
+
+// ----------------------------------------------------------------------------
+/** Returns the name of a temporary file to write before renaming it to
+ *  u8_path. It contains the process id, so several servers sharing a
+ *  directory don't write to the same temporary file.
+ */
+std::string FileUtils::getTempPath(const std::string& u8_path)
+{
+#if defined(WIN32)
+    int pid = _getpid();
+#else
+    int pid = (int)getpid();
+#endif
+    return u8_path + "." + StringUtils::toString(pid) + ".tmp";
+}   // getTempPath
@@ -0,0 +1,105 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "utils/interval_index.hpp"
+
+#include <assert.h>
+#include <cstdint>
+
+// ----------------------------------------------------------------------------
+/** Compares find with a search through all intervals, which returns an
+ *  interval containing the key with the largest start.
+ */
+static void checkIntervals(const IntervalIndex<int, int>& index,
+                           const std::vector<std::pair<int, int> >& intervals,
+                           int min_key, int max_key)
+{
+    for (int key = min_key; key <= max_key; key++)
+    {
+        int best = -1;
+        for (unsigned i = 0; i < intervals.size(); i++)
+        {
+            if (intervals[i].first <= key && key <= intervals[i].second &&
+                (best == -1 || intervals[best].first < intervals[i].first))
+                best = i;
+        }
+        // The interval found must be one containing the key with the
+        // largest start
+        const int* found = index.find(key);
+        bool correct = found == NULL;
+        if (best != -1)
+        {
+            correct = found != NULL && intervals[*found].first <= key &&
+                key <= intervals[*found].second &&
+                intervals[*found].first == intervals[best].first;
+        }
+        assert(correct);
+        (void)correct;
+    }
+}   // checkIntervals
+
+// ----------------------------------------------------------------------------
+/** Unit tests for IntervalIndex with disjoint, overlapping and very wide
+ *  intervals, and intervals added after a build.
+ */
+template<> void IntervalIndex<int, int>::unitTesting()
+{
+    IntervalIndex<int, int> empty;
+    empty.build();
+    assert(empty.find(0) == NULL);
+
+    // A wide interval (like a /8 ban) followed by many small ones, keys in
+    // the gaps between the small ones must still find the wide one
+    IntervalIndex<int, int> index;
+    std::vector<std::pair<int, int> > intervals;
+    auto add = [&index, &intervals](int start, int end)
+        {
+            index.add(start, end, (int)intervals.size());
+            intervals.emplace_back(start, end);
+        };
+    add(0, 10000);
+    for (int i = 0; i < 500; i++)
+        add(100 + i * 10, 100 + i * 10 + 4);
+    // Ignored as end is before start
+    index.add(20, 10, -1);
+    index.build();
+    assert(index.size() == intervals.size());
+    checkIntervals(index, intervals, -5, 10005);
+    assert(*index.find(102) == 1);
+    assert(*index.find(105) == 0);
+    assert(index.find(10001) == NULL);
+
+    // Nested intervals with ends decreasing, and overlapping ones added
+    // after the first build
+    for (int i = 0; i < 200; i++)
+        add(20000 + i, 30000 - i * 20);
+    index.build();
+    checkIntervals(index, intervals, 19990, 30010);
+    uint32_t seed = 12345;
+    for (int i = 0; i < 300; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        const int start = 40000 + (int)((seed >> 8) % 5000);
+        seed = seed * 1103515245 + 12345;
+        add(start, start + (int)((seed >> 8) % 700));
+    }
+    index.build();
+    assert(index.size() == intervals.size());
+    checkIntervals(index, intervals, -5, 46000);
+}   // unitTesting
@@ -0,0 +1,148 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_INTERVAL_INDEX_HPP
+#define HEADER_INTERVAL_INDEX_HPP
+
+#include <algorithm>
+#include <vector>
+
+/** \ingroup utils
+ *  A sorted array of closed intervals [start, end] with a value each, used
+ *  to find the interval containing a key. The intervals are sorted by start
+ *  and a segment tree stores the maximum end of each range of them, so a
+ *  search finds the last interval starting before the key which reaches the
+ *  key in O(log n), also with overlapping or very wide intervals.
+ *  Intervals added after build() are merged in by the next build(), so an
+ *  index can be extended without sorting it again.
+ */
+template<typename Key, typename Value>
+class IntervalIndex
+{
+private:
+    struct Interval
+    {
+        Key m_start;
+        Key m_end;
+        Value m_value;
+        bool operator<(const Interval& other) const
+                                          { return m_start < other.m_start; }
+    };
+
+    std::vector<Interval> m_intervals;
+
+    /** Segment tree of the maximum end of intervals, node 1 is the root
+     *  covering all intervals and node n has children 2n and 2n + 1. */
+    std::vector<Key> m_max_end;
+
+    /** Number of intervals sorted by the last build(). */
+    size_t m_built_size;
+
+    // ------------------------------------------------------------------------
+    void buildTree(size_t node, size_t first, size_t last)
+    {
+        if (last - first == 1)
+        {
+            m_max_end[node] = m_intervals[first].m_end;
+            return;
+        }
+        const size_t middle = (first + last) / 2;
+        buildTree(2 * node, first, middle);
+        buildTree(2 * node + 1, middle, last);
+        m_max_end[node] = std::max(m_max_end[2 * node],
+                                   m_max_end[2 * node + 1]);
+    }   // buildTree
+    // ------------------------------------------------------------------------
+    /** Returns the largest index below count of the intervals [first, last)
+     *  of a node whose end is not below key, or -1. */
+    size_t findLast(size_t node, size_t first, size_t last, size_t count,
+                    const Key& key) const
+    {
+        if (first >= count || m_max_end[node] < key)
+            return (size_t)-1;
+        if (last - first == 1)
+            return first;
+        const size_t middle = (first + last) / 2;
+        size_t i = findLast(2 * node + 1, middle, last, count, key);
+        if (i != (size_t)-1)
+            return i;
+        return findLast(2 * node, first, middle, count, key);
+    }   // findLast
+
+public:
+    // ------------------------------------------------------------------------
+    IntervalIndex() : m_built_size(0) {}
+    // ------------------------------------------------------------------------
+    void reserve(size_t size)                  { m_intervals.reserve(size); }
+    // ------------------------------------------------------------------------
+    /** Adds an interval, it is only found after the next build(). Intervals
+     *  with start larger than end are ignored. */
+    void add(const Key& start, const Key& end, const Value& value)
+    {
+        if (end < start)
+            return;
+        Interval i;
+        i.m_start = start;
+        i.m_end = end;
+        i.m_value = value;
+        m_intervals.push_back(i);
+    }   // add
+    // ------------------------------------------------------------------------
+    /** Sorts the intervals added since the last build and merges them with
+     *  the already sorted ones. */
+    void build()
+    {
+        auto middle = m_intervals.begin() + m_built_size;
+        std::stable_sort(middle, m_intervals.end());
+        std::inplace_merge(m_intervals.begin(), middle, m_intervals.end());
+        m_built_size = m_intervals.size();
+        m_max_end.clear();
+        if (m_built_size == 0)
+            return;
+        m_max_end.resize(4 * m_built_size);
+        buildTree(1, 0, m_built_size);
+    }   // build
+    // ------------------------------------------------------------------------
+    /** Returns the value of the interval containing the key with the largest
+     *  start, or NULL if no interval contains it. */
+    const Value* find(const Key& key) const
+    {
+        Interval k;
+        k.m_start = key;
+        auto it = std::upper_bound(m_intervals.begin(),
+            m_intervals.begin() + m_built_size, k);
+        // All intervals before it start before or at the key
+        const size_t count = it - m_intervals.begin();
+        if (count == 0)
+            return NULL;
+        size_t i = findLast(1, 0, m_built_size, count, key);
+        return i == (size_t)-1 ? NULL : &m_intervals[i].m_value;
+    }   // find
+    // ------------------------------------------------------------------------
+    size_t size() const                             { return m_built_size; }
+    // ------------------------------------------------------------------------
+    bool empty() const                         { return m_built_size == 0; }
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+
+};   // IntervalIndex
+
+// Only the tests of this instance exist, see interval_index.cpp
+template<> void IntervalIndex<int, int>::unitTesting();
+
+#endif
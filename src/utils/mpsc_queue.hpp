@@ -0,0 +1,119 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_MPSC_QUEUE_HPP
+#define HEADER_MPSC_QUEUE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/** A bounded lock-free queue which can be pushed by many threads and popped
+ *  by one thread. Each slot has a sequence number telling if it is free for
+ *  the push of a position or ready for its pop, so pushing only needs one
+ *  compare-and-swap of the push position.
+ * \ingroup utils
+ */
+template<typename T>
+class MPSCQueue : public NoCopy
+{
+private:
+    struct Slot
+    {
+        std::atomic<size_t> m_sequence;
+
+        T m_data;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+
+    /** Number of slots minus 1, the number of slots is a power of 2. */
+    const size_t m_mask;
+
+    std::atomic<size_t> m_push_position;
+
+    /** Only used by the popping thread. */
+    size_t m_pop_position;
+
+public:
+    // ------------------------------------------------------------------------
+    /** \param capacity Maximum number of queued elements, a power of 2. */
+    MPSCQueue(size_t capacity)
+        : m_slots(new Slot[capacity]), m_mask(capacity - 1)
+    {
+        assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+        for (size_t i = 0; i < capacity; i++)
+            m_slots[i].m_sequence.store(i, std::memory_order_relaxed);
+        m_push_position.store(0, std::memory_order_relaxed);
+        m_pop_position = 0;
+    }   // MPSCQueue
+    // ------------------------------------------------------------------------
+    /** Adds data to the queue, can be called from any thread.
+     *  \return False if the queue is full. */
+    bool push(const T& data)
+    {
+        size_t position = m_push_position.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true)
+        {
+            slot = &m_slots[position & m_mask];
+            size_t sequence = slot->m_sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+            if (diff == 0)
+            {
+                if (m_push_position.compare_exchange_weak(position,
+                    position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                // The slot of one round ago is not popped yet
+                return false;
+            }
+            else
+                position = m_push_position.load(std::memory_order_relaxed);
+        }
+        slot->m_data = data;
+        slot->m_sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }   // push
+    // ------------------------------------------------------------------------
+    /** Removes the oldest element, must only be called by one thread.
+     *  \return False if the queue is empty. */
+    bool pop(T* data)
+    {
+        Slot* slot = &m_slots[m_pop_position & m_mask];
+        size_t sequence = slot->m_sequence.load(std::memory_order_acquire);
+        if ((intptr_t)sequence - (intptr_t)(m_pop_position + 1) < 0)
+            return false;
+        *data = slot->m_data;
+        slot->m_sequence.store(m_pop_position + m_mask + 1,
+                               std::memory_order_release);
+        m_pop_position++;
+        return true;
+    }   // pop
+    // ------------------------------------------------------------------------
+    size_t capacity() const                               { return m_mask + 1; }
+
+};   // class MPSCQueue
+
+#endif // HEADER_MPSC_QUEUE_HPP
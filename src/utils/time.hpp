@@ -111,6 +111,15 @@ public:
         return value.count();
     }
     // ------------------------------------------------------------------------
+    /** Like getMonoTimeMs, but in microseconds. */
+    static uint64_t getMonoTimeUs()
+    {
+        auto duration = std::chrono::steady_clock::now() - m_mono_start;
+        auto value =
+            std::chrono::duration_cast<std::chrono::microseconds>(duration);
+        return value.count();
+    }
+    // ------------------------------------------------------------------------
     /**
      * \brief Compare two different times.
      * \return A signed integral indicating the relation between the time.
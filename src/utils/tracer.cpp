@@ -0,0 +1,322 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "utils/tracer.hpp"
+
+#include "utils/file_utils.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+
+#if defined(__linux__) && defined(__GLIBC__)
+#  include <pthread.h>
+#endif
+
+namespace Tracer
+{
+std::atomic<bool> g_enabled(false);
+
+namespace
+{
+/** Number of events kept for each thread, a power of 2. */
+const uint64_t EVENTS_PER_THREAD = 1 << 16;
+
+/** Deeper nested scopes are not recorded. */
+const unsigned MAX_DEPTH = 64;
+
+// ----------------------------------------------------------------------------
+struct Event
+{
+    uint64_t m_start_ns;
+    uint64_t m_duration_ns;
+    uint16_t m_name_id;
+    uint16_t m_depth;
+};   // Event
+
+// ----------------------------------------------------------------------------
+/** The ring buffer of a thread. Only the thread using it writes events, the
+ *  other members are protected by g_mutex. */
+struct ThreadBuffer
+{
+    std::unique_ptr<Event[]> m_events;
+
+    /** Number of events written since the buffer was taken by a thread,
+     *  the event n is stored at n % EVENTS_PER_THREAD. */
+    std::atomic<uint64_t> m_written;
+
+    std::string m_thread_name;
+
+    /** False if the thread using this buffer has exited, so it can be used
+     *  by a new thread. */
+    bool m_in_use;
+
+    /** Start times of the currently open scopes, only used by the thread. */
+    uint64_t m_start_ns[MAX_DEPTH];
+
+    unsigned m_depth;
+};   // ThreadBuffer
+
+// ----------------------------------------------------------------------------
+/** Gives the buffer of a thread back when the thread exits. */
+struct ThreadBufferHolder
+{
+    ThreadBuffer* m_buffer;
+    ThreadBufferHolder() : m_buffer(NULL) {}
+    ~ThreadBufferHolder();
+};   // ThreadBufferHolder
+
+std::mutex g_mutex;
+std::vector<const char*> g_names;
+std::vector<std::unique_ptr<ThreadBuffer> > g_buffers;
+const std::chrono::steady_clock::time_point g_epoch =
+    std::chrono::steady_clock::now();
+/** Events before the last setEnabled(true) are not saved. */
+std::atomic<uint64_t> g_enabled_since(0);
+thread_local ThreadBufferHolder g_thread_buffer;
+
+// ----------------------------------------------------------------------------
+ThreadBufferHolder::~ThreadBufferHolder()
+{
+    if (!m_buffer)
+        return;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    m_buffer->m_in_use = false;
+}   // ~ThreadBufferHolder
+
+// ----------------------------------------------------------------------------
+uint64_t getTimeNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>
+        (std::chrono::steady_clock::now() - g_epoch).count();
+}   // getTimeNs
+
+// ----------------------------------------------------------------------------
+/** Returns the buffer of the calling thread, which is allocated the first
+ *  time the thread records an event. */
+ThreadBuffer* getThreadBuffer()
+{
+    if (g_thread_buffer.m_buffer)
+        return g_thread_buffer.m_buffer;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    ThreadBuffer* buffer = NULL;
+    for (auto& b : g_buffers)
+    {
+        if (!b->m_in_use)
+        {
+            buffer = b.get();
+            break;
+        }
+    }
+    if (!buffer)
+    {
+        buffer = new ThreadBuffer();
+        buffer->m_events.reset(new Event[EVENTS_PER_THREAD]);
+        g_buffers.emplace_back(buffer);
+    }
+    buffer->m_written.store(0, std::memory_order_relaxed);
+    buffer->m_in_use = true;
+    buffer->m_depth = 0;
+    buffer->m_thread_name.clear();
+#if defined(__linux__) && defined(__GLIBC__)
+    char name[16] = {};
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0)
+        buffer->m_thread_name = name;
+#endif
+    if (buffer->m_thread_name.empty())
+    {
+        buffer->m_thread_name = "Thread " +
+            std::to_string(g_buffers.size());
+    }
+    g_thread_buffer.m_buffer = buffer;
+    return buffer;
+}   // getThreadBuffer
+
+// ----------------------------------------------------------------------------
+void writeJSONString(FILE* fp, const char* str)
+{
+    fputc('"', fp);
+    for (const char* c = str; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', fp);
+        if ((unsigned char)*c >= 0x20)
+            fputc(*c, fp);
+    }
+    fputc('"', fp);
+}   // writeJSONString
+
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Switches recording on or off. Events recorded before it is switched on
+ *  are not saved anymore. */
+void setEnabled(bool enabled)
+{
+    if (enabled)
+        g_enabled_since.store(getTimeNs());
+    g_enabled.store(enabled);
+    Log::info("Tracer", "Tracing %s.", enabled ? "enabled" : "disabled");
+}   // setEnabled
+
+// ----------------------------------------------------------------------------
+/** Returns the id of an event name, called once for each TRACE_SCOPE.
+ *  \param name A string literal, it is not copied.
+ */
+uint16_t registerName(const char* name)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (unsigned i = 0; i < g_names.size(); i++)
+    {
+        if (g_names[i] == name)
+            return (uint16_t)i;
+    }
+    if (g_names.size() >= 0xFFFF)
+        return 0xFFFF;
+    g_names.push_back(name);
+    return (uint16_t)(g_names.size() - 1);
+}   // registerName
+
+// ----------------------------------------------------------------------------
+/** Starts an event in the calling thread. */
+void begin()
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    if (buffer->m_depth < MAX_DEPTH)
+        buffer->m_start_ns[buffer->m_depth] = getTimeNs();
+    buffer->m_depth++;
+}   // begin
+
+// ----------------------------------------------------------------------------
+/** Ends the event last started in the calling thread, and adds it to the
+ *  ring buffer of the thread. */
+void end(uint16_t name_id)
+{
+    ThreadBuffer* buffer = g_thread_buffer.m_buffer;
+    if (!buffer || buffer->m_depth == 0)
+        return;
+    buffer->m_depth--;
+    if (buffer->m_depth >= MAX_DEPTH || name_id == 0xFFFF)
+        return;
+    uint64_t written = buffer->m_written.load(std::memory_order_relaxed);
+    Event& e = buffer->m_events[written & (EVENTS_PER_THREAD - 1)];
+    e.m_start_ns = buffer->m_start_ns[buffer->m_depth];
+    e.m_duration_ns = getTimeNs() - e.m_start_ns;
+    e.m_name_id = name_id;
+    e.m_depth = (uint16_t)buffer->m_depth;
+    buffer->m_written.store(written + 1, std::memory_order_release);
+}   // end
+
+// ----------------------------------------------------------------------------
+/** Saves the events of all threads in the Chrome trace event format (JSON),
+ *  which can be opened in chrome://tracing or ui.perfetto.dev. It can be
+ *  called while events are recorded, only the events which were overwritten
+ *  during the copy are dropped.
+ *  \return False if the file can't be written.
+ */
+bool writeChromeTrace(const std::string& filename)
+{
+    struct ThreadEvents
+    {
+        std::string m_name;
+        std::vector<Event> m_events;
+    };
+    std::vector<ThreadEvents> threads;
+    std::vector<const char*> names;
+    const uint64_t since = g_enabled_since.load();
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        names = g_names;
+        for (auto& b : g_buffers)
+        {
+            ThreadEvents te;
+            te.m_name = b->m_thread_name;
+            uint64_t written = b->m_written.load(std::memory_order_acquire);
+            uint64_t first = written > EVENTS_PER_THREAD ?
+                written - EVENTS_PER_THREAD : 0;
+            for (uint64_t i = first; i < written; i++)
+                te.m_events.push_back(b->m_events[i & (EVENTS_PER_THREAD - 1)]);
+            // The thread may have overwritten the oldest events while they
+            // were copied, including the one it writes now
+            written = b->m_written.load(std::memory_order_acquire);
+            uint64_t valid = written >= EVENTS_PER_THREAD ?
+                written - EVENTS_PER_THREAD + 1 : 0;
+            if (valid > first)
+            {
+                te.m_events.erase(te.m_events.begin(), te.m_events.begin() +
+                    std::min<uint64_t>(valid - first, te.m_events.size()));
+            }
+            threads.push_back(std::move(te));
+        }
+    }
+
+    FILE* fp = FileUtils::fopenU8Path(filename, "wb");
+    if (!fp)
+    {
+        Log::error("Tracer", "Cannot write trace to %s.", filename.c_str());
+        return false;
+    }
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first_event = true;
+    unsigned count = 0;
+    for (unsigned tid = 0; tid < threads.size(); tid++)
+    {
+        ThreadEvents& te = threads[tid];
+        fprintf(fp, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,"
+            "\"tid\":%u,\"args\":{\"name\":", first_event ? "" : ",\n", tid);
+        writeJSONString(fp, te.m_name.c_str());
+        fprintf(fp, "}}");
+        first_event = false;
+        // Events are written when they end, sort them by start with the
+        // outer events first
+        std::sort(te.m_events.begin(), te.m_events.end(),
+            [](const Event& a, const Event& b)
+            {
+                if (a.m_start_ns != b.m_start_ns)
+                    return a.m_start_ns < b.m_start_ns;
+                return a.m_depth < b.m_depth;
+            });
+        for (const Event& e : te.m_events)
+        {
+            if (e.m_start_ns < since || e.m_name_id >= names.size())
+                continue;
+            fprintf(fp, ",\n{\"ph\":\"X\",\"name\":");
+            writeJSONString(fp, names[e.m_name_id]);
+            fprintf(fp, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", tid,
+                e.m_start_ns / 1000.0, e.m_duration_ns / 1000.0);
+            count++;
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    if (fclose(fp) != 0)
+    {
+        Log::error("Tracer", "Cannot write trace to %s.", filename.c_str());
+        return false;
+    }
+    Log::info("Tracer", "Saved %u events of %u threads to %s.", count,
+        (unsigned)threads.size(), filename.c_str());
+    return true;
+}   // writeChromeTrace
+
+}   // namespace Tracer
@@ -0,0 +1,93 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_TRACER_HPP
+#define HEADER_TRACER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/** Records the time spent in TRACE_SCOPE blocks, to be viewed in the
+ *  chrome://tracing page of Chrome or in the Perfetto UI. Unlike Profiler it
+ *  doesn't need graphics, so it can be used by servers: it is switched on and
+ *  saved from the network console.
+ *  Each thread writes its events into its own ring buffer which only keeps
+ *  the most recent events, so recording takes no lock. When tracing is off a
+ *  TRACE_SCOPE only costs the check of an atomic bool.
+ * \ingroup utils
+ */
+namespace Tracer
+{
+    /** True if events are recorded, only to be read by isEnabled. */
+    extern std::atomic<bool> g_enabled;
+
+    // ------------------------------------------------------------------------
+    inline bool isEnabled()
+                         { return g_enabled.load(std::memory_order_relaxed); }
+    // ------------------------------------------------------------------------
+    void setEnabled(bool enabled);
+    // ------------------------------------------------------------------------
+    uint16_t registerName(const char* name);
+    // ------------------------------------------------------------------------
+    void begin();
+    // ------------------------------------------------------------------------
+    void end(uint16_t name_id);
+    // ------------------------------------------------------------------------
+    bool writeChromeTrace(const std::string& filename);
+
+    // ========================================================================
+    /** Records an event from its construction to its destruction, if tracing
+     *  was enabled at its construction. */
+    class Scope
+    {
+    private:
+        uint16_t m_name_id;
+
+        bool m_recording;
+
+    public:
+        // --------------------------------------------------------------------
+        Scope(uint16_t name_id) : m_name_id(name_id)
+        {
+            m_recording = isEnabled();
+            if (m_recording)
+                begin();
+        }   // Scope
+        // --------------------------------------------------------------------
+        ~Scope()
+        {
+            if (m_recording)
+                end(m_name_id);
+        }   // ~Scope
+    };   // Scope
+}   // namespace Tracer
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+/** Records the time until the end of the enclosing block as an event called
+ *  name, which must be a string literal. */
+#define TRACE_SCOPE(name)                                                     \
+    static const uint16_t TRACE_CONCAT(trace_name_id_, __LINE__) =            \
+        Tracer::registerName(name);                                           \
+    Tracer::Scope TRACE_CONCAT(trace_scope_, __LINE__)(                       \
+        TRACE_CONCAT(trace_name_id_, __LINE__))
+
+#endif
@@ -0,0 +1,121 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/worker_pool.hpp"
+
+#include "utils/string_utils.hpp"
+#include "utils/vs.hpp"
+
+// ----------------------------------------------------------------------------
+/** Starts the threads.
+ *  \param num_threads Number of threads besides the calling thread.
+ *  \param name Name of the threads (with their number added) for debuggers.
+ *  \param pt Process type of the threads, the one of the creating thread if
+ *         the jobs use per process data like NetworkConfig.
+ */
+WorkerPool::WorkerPool(unsigned int num_threads, const std::string& name,
+                       ProcessType pt)
+{
+    m_job          = NULL;
+    m_job_count    = 0;
+    m_next.store(0);
+    m_busy_threads = 0;
+    m_job_id       = 0;
+    m_stop         = false;
+    for (unsigned int i = 0; i < num_threads; i++)
+    {
+        m_threads.emplace_back(&WorkerPool::mainLoop, this,
+            name + StringUtils::toString(i), pt);
+    }
+}   // WorkerPool
+
+// ----------------------------------------------------------------------------
+WorkerPool::~WorkerPool()
+{
+    std::unique_lock<std::mutex> lock(m_job_mutex);
+    m_stop = true;
+    m_job_cv.notify_all();
+    lock.unlock();
+    for (std::thread& t : m_threads)
+        t.join();
+}   // ~WorkerPool
+
+// ----------------------------------------------------------------------------
+void WorkerPool::mainLoop(std::string name, ProcessType pt)
+{
+    STKProcess::init(pt);
+    VS::setThreadName(name.c_str());
+    uint64_t last_job_id = 0;
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(m_job_mutex);
+        m_job_cv.wait(lock, [this, last_job_id]()
+            { return m_stop || m_job_id != last_job_id; });
+        if (m_stop)
+            return;
+        last_job_id = m_job_id;
+        lock.unlock();
+
+        runIterations();
+
+        lock.lock();
+        if (--m_busy_threads == 0)
+            m_done_cv.notify_one();
+    }
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+void WorkerPool::runIterations()
+{
+    unsigned int i;
+    while ((i = m_next.fetch_add(1)) < m_job_count)
+        (*m_job)(i);
+}   // runIterations
+
+// ----------------------------------------------------------------------------
+/** Calls job with 0 to count - 1 using the threads of the pool and the
+ *  calling thread, and returns when all calls are finished.
+ */
+void WorkerPool::parallelFor(unsigned int count,
+                             const std::function<void(unsigned int)>& job)
+{
+    if (count == 0)
+        return;
+    if (m_threads.empty() || count == 1)
+    {
+        for (unsigned int i = 0; i < count; i++)
+            job(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(m_run_mutex);
+    std::unique_lock<std::mutex> lock(m_job_mutex);
+    m_job          = &job;
+    m_job_count    = count;
+    m_next.store(0);
+    m_busy_threads = (unsigned int)m_threads.size();
+    m_job_id++;
+    m_job_cv.notify_all();
+    lock.unlock();
+
+    runIterations();
+
+    lock.lock();
+    m_done_cv.wait(lock, [this]() { return m_busy_threads == 0; });
+    m_job = NULL;
+}   // parallelFor
@@ -0,0 +1,90 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2024 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_WORKER_POOL_HPP
+#define HEADER_WORKER_POOL_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/stk_process.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** A fixed number of threads which run the iterations of a loop in parallel
+ *  with the calling thread. Calls of parallelFor from different threads are
+ *  run one after another.
+ * \ingroup utils
+ */
+class WorkerPool : public NoCopy
+{
+private:
+    std::vector<std::thread> m_threads;
+
+    /** Allows only one parallelFor at a time. */
+    std::mutex m_run_mutex;
+
+    /** Protects the job fields below. */
+    std::mutex m_job_mutex;
+
+    std::condition_variable m_job_cv;
+
+    std::condition_variable m_done_cv;
+
+    /** The loop body of the current job. */
+    const std::function<void(unsigned int)>* m_job;
+
+    unsigned int m_job_count;
+
+    /** Next iteration of the current job to run. */
+    std::atomic<unsigned int> m_next;
+
+    /** Number of threads still running the current job. */
+    unsigned int m_busy_threads;
+
+    /** Increased for each job, so threads know a new job started. */
+    uint64_t m_job_id;
+
+    bool m_stop;
+
+    // ------------------------------------------------------------------------
+    void mainLoop(std::string name, ProcessType pt);
+    // ------------------------------------------------------------------------
+    void runIterations();
+
+public:
+    // ------------------------------------------------------------------------
+    WorkerPool(unsigned int num_threads, const std::string& name,
+               ProcessType pt = PT_MAIN);
+    // ------------------------------------------------------------------------
+    ~WorkerPool();
+    // ------------------------------------------------------------------------
+    void parallelFor(unsigned int count,
+                     const std::function<void(unsigned int)>& job);
+    // ------------------------------------------------------------------------
+    unsigned int getNumThreads() const
+                                      { return (unsigned int)m_threads.size(); }
+
+};   // class WorkerPool
+
+#endif // HEADER_WORKER_POOL_HPP
@@ -181,31 +181,37 @@ def createAcGetter(groups):
 }}  // get{1}
 """.format(m.typeC, nameTitle, nameUnderscore.upper(), typeC, result))
 
+""" Types which are returned by reference from the resolved characteristic """
+def returnType(m):
+    if m.typeC == "float" or m.typeC == "bool":
+        return m.typeC
+    return "const {0}&".format(m.typeC)
+
 def createKpDefs(groups):
     for g in groups:
         print()
         for m in g.members:
             nameTitle = joinSubName(g, m, True)
             nameUnderscore = joinSubName(g, m, False)
-            typeC = m.typeC
 
-            print("    {0} get{1}() const;".
-                format(typeC, nameTitle, nameUnderscore))
+            print("    {0} get{1}() const\n        {{ return m_resolved.m_{2}; }}".
+                format(returnType(m), nameTitle, nameUnderscore))
 
-def createKpGetter(groups):
+def createRcFields(groups):
     for g in groups:
+        print()
+        print("    // {0}".format(g.getBaseName().title()))
         for m in g.members:
-            nameTitle = joinSubName(g, m, True)
             nameUnderscore = joinSubName(g, m, False)
-            typeC = m.typeC
-            result = "result"
+            print("    {0} m_{1};".format(m.typeC, nameUnderscore))
 
-            print("""// ----------------------------------------------------------------------------
-{1} KartProperties::get{0}() const
-{{
-    return m_cached_characteristic->get{0}();
-}}  // get{0}
-""".format(nameTitle, typeC))
+def createRcResolve(groups):
+    for g in groups:
+        for m in g.members:
+            nameTitle = joinSubName(g, m, True)
+            nameUnderscore = joinSubName(g, m, False)
+            print("    m_{0} = characteristic->get{1}();".
+                format(nameUnderscore, nameTitle))
 
 def createGetType(groups):
     for g in groups:
@@ -244,7 +250,8 @@ functions = {
     "getType":  (createGetType,  "Implement the getType function",                         "karts/abstract_characteristic.cpp"),
     "getName":  (createGetName,  "Implement the getName function",                         "karts/abstract_characteristic.cpp"),
     "kpdefs":   (createKpDefs,   "Create the header function definitions for the getters", "karts/kart_properties.hpp"),
-    "kpgetter": (createKpGetter, "Implement the getters",                                  "karts/kart_properties.cpp"),
+    "rcfields": (createRcFields, "Create the values of the resolved characteristic",       "karts/resolved_characteristic.hpp"),
+    "rcresolve":(createRcResolve,"Read the values of the resolved characteristic",         "karts/resolved_characteristic.cpp"),
     "loadXml":  (createLoadXml,  "Code to load the characteristics from an xml file",      "karts/xml_characteristic.cpp"),
 }
 